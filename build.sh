@@ -6,6 +6,13 @@ EXTERNAL_DIR="$PWD/external"
 DAWN_DIR="$EXTERNAL_DIR/dawn"
 BUILD_DIR="$PWD/build"
 
+GOLDEN_DIR="$PWD/golden"
+GOLDEN_FRAMES=60
+GOLDEN_SEED=1
+
+BENCHMARK_FRAMES=600
+BENCHMARK_RESULTS="$PWD/benchmark_results.csv"
+
 DOCKER_DIR="$PWD/docker"
 DOCKER_NAME="docker-webgpu-native-examples:latest"
 
@@ -31,6 +38,70 @@ webgpu_native_examples() {
     cd "$WORKING_DIR"
 }
 
+golden_images() {
+    WORKING_DIR=`pwd`
+    UPDATE_FLAG="$1"
+
+    echo "---------- Running golden image tests ----------"
+    mkdir -p "$GOLDEN_DIR"
+    cd "$BUILD_DIR/Release"
+    FAILED=0
+    for EXAMPLE in `./wgpu_sample_launcher --list`; do
+        if ./wgpu_sample_launcher -s "$EXAMPLE" --cpu-adapter \
+             --seed $GOLDEN_SEED --frames $GOLDEN_FRAMES \
+             --golden "$GOLDEN_DIR/$EXAMPLE.png" $UPDATE_FLAG; then
+            echo "[PASSED] $EXAMPLE"
+        else
+            echo "[FAILED] $EXAMPLE"
+            FAILED=$((FAILED + 1))
+        fi
+    done
+    echo "$FAILED example(s) failed"
+
+    cd "$WORKING_DIR"
+    [ $FAILED -eq 0 ]
+}
+
+benchmark_adapters() {
+    WORKING_DIR=`pwd`
+    EXAMPLES="$@"
+
+    echo "---------- Benchmarking all adapters ----------"
+    cd "$BUILD_DIR/Release"
+    if [ -z "$EXAMPLES" ]; then
+        EXAMPLES=`./wgpu_sample_launcher --list`
+    fi
+    rm -f "$BENCHMARK_RESULTS"
+    ./wgpu_sample_launcher --list-adapters
+    for ADAPTER in `./wgpu_sample_launcher --list-adapters | cut -f1`; do
+        for EXAMPLE in $EXAMPLES; do
+            ./wgpu_sample_launcher -s "$EXAMPLE" --adapter-index $ADAPTER \
+              --seed $GOLDEN_SEED --frames $BENCHMARK_FRAMES \
+              --benchmark "$BENCHMARK_RESULTS" \
+              || echo "[FAILED] $EXAMPLE on adapter $ADAPTER"
+        done
+    done
+
+    # Average CPU frame time per example relative to the fastest adapter
+    echo "---------- Benchmark results ($BENCHMARK_RESULTS) ----------"
+    printf "%-32s %-40s %-10s %10s %10s %8s\n" example adapter backend \
+           cpu_ms gpu_ms relative
+    awk -F, 'NR > 1 {
+        rows[$1 SUBSEP $2] = $0
+        if (!($1 in best) || $7 < best[$1]) best[$1] = $7
+    }
+    END {
+        for (key in rows) {
+            split(rows[key], f, ",")
+            printf "%-32s %-40s %-10s %10.3f %10.3f %8.2f\n", f[1], \
+                   "[" f[2] "] " f[3], f[5], f[7], f[12], \
+                   (best[f[1]] > 0 ? f[7] / best[f[1]] : 0)
+        }
+    }' "$BENCHMARK_RESULTS" | sort
+
+    cd "$WORKING_DIR"
+}
+
 docker_build() {
     WORKING_DIR=`pwd`
 
@@ -70,6 +141,23 @@ while [[ $# -gt 0 ]]; do case "$1" in
     shift
     webgpu_native_examples
     ;;
+  -golden_images)
+    shift
+    golden_images
+    ;;
+  -update_golden_images)
+    shift
+    golden_images --golden-update
+    ;;
+  -benchmark_adapters)
+    shift
+    EXAMPLES=""
+    while [[ $# -gt 0 && "$1" != -* ]]; do
+      EXAMPLES="$EXAMPLES $1"
+      shift
+    done
+    benchmark_adapters $EXAMPLES
+    ;;
   -docker_build)
     shift
     docker_build
@@ -84,6 +172,14 @@ usage: $0 [options]
 options:
   -update_dawn            Update to the latest version of "depot_tools" and "Dawn"
   -webgpu_native_examples Build WebGPU native examples
+  -golden_images          Run every example on the CPU adapter and compare the
+                          final frame against the golden images in golden/
+  -update_golden_images   Run every example on the CPU adapter and store the
+                          final frame as golden image in golden/
+  -benchmark_adapters [example...]
+                          Run the given (default: all) examples on every
+                          available adapter and compare the frame times, the
+                          results are written to benchmark_results.csv
   -docker_build           Build Docker image for running the examples
   -docker_run             Run the Docker container with the examples
   -help                   Show help on stdout and exit
@@ -0,0 +1,154 @@
+# ==============================================================================
+# WGSL validation
+#
+# Validates the WGSL shaders of one source file with Tint, invoked at build
+# time by the wgsl_validation target:
+#
+#   cmake -DTINT_EXECUTABLE=<tint> -DSOURCE=<file> -DOUTPUT_DIR=<dir>
+#         -DSTAMP=<file> -P wgsl_validation.cmake
+#
+# For C sources every "static const char* name = CODE(...)" block is
+# extracted. Blocks without an entry point are snippets the
+# examples concatenate with other blocks at run time: a shader that does not
+# validate on its own is validated again prefixed with the snippets of its
+# file. For shader assets (.wgsl) the common.wgsl of their directory is the
+# snippet, the way cornell_box loads them. Assets using WGSL preprocessor
+# directives and C sources that select their blocks with directives (shader
+# permutations, e.g. a "#ifdef NAME" chunk) are skipped. Tint writes the
+# validated, comment free WGSL of every shader to OUTPUT_DIR; the build fails
+# if a source file holds an invalid shader.
+# ==============================================================================
+
+cmake_policy(VERSION 3.16)
+
+file(REMOVE_RECURSE ${OUTPUT_DIR})
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+set(failed FALSE)
+
+# Runs Tint on a shader, sets <result_var> to the error output or to ""
+function(run_tint name code result_var)
+  set(shader_file ${OUTPUT_DIR}/${name}.wgsl)
+  file(WRITE ${shader_file} "${code}")
+  execute_process(
+    COMMAND ${TINT_EXECUTABLE} --format wgsl -o ${OUTPUT_DIR}/${name}.min.wgsl
+            ${shader_file}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output
+  )
+  if(result EQUAL 0)
+    set(${result_var} "" PARENT_SCOPE)
+  else()
+    set(${result_var} "${shader_file}\n${output}" PARENT_SCOPE)
+  endif()
+endfunction()
+
+# Validates a shader on its own, then prefixed with the snippets of its file
+function(validate_shader name code snippets location)
+  if(NOT code MATCHES "@(vertex|fragment|compute)")
+    return()
+  endif()
+  run_tint(${name} "${code}" errors)
+  if(errors AND snippets)
+    run_tint(${name} "${snippets}\n${code}" snippet_errors)
+    if(NOT snippet_errors)
+      set(errors "")
+    endif()
+  endif()
+  if(errors)
+    message(SEND_ERROR "Invalid WGSL: ${location}\n${errors}")
+    set(failed TRUE PARENT_SCOPE)
+  endif()
+endfunction()
+
+file(READ ${SOURCE} content)
+get_filename_component(extension ${SOURCE} EXT)
+
+if(extension STREQUAL ".wgsl")
+  get_filename_component(name ${SOURCE} NAME_WE)
+  get_filename_component(directory ${SOURCE} DIRECTORY)
+  set(common_code "")
+  if(NOT name STREQUAL "common" AND EXISTS ${directory}/common.wgsl)
+    file(READ ${directory}/common.wgsl common_code)
+  endif()
+  if(NOT content MATCHES "(^|\n)[ \t]*#")
+    validate_shader(${name} "${content}" "${common_code}" ${SOURCE})
+  endif()
+elseif(content MATCHES "\"#(if|ifdef|ifndef)[ \t]")
+  # Blocks only form valid shaders once preprocessed
+else()
+  # Extract the CODE(...) blocks by matching their parentheses, with the list
+  # separator and brackets masked. The blocks without an entry point are
+  # snippets shared by the shaders of the file.
+  string(ASCII 1 semicolon)
+  string(ASCII 2 left_bracket)
+  string(ASCII 3 right_bracket)
+  string(REPLACE ";" "${semicolon}" content "${content}")
+  string(REPLACE "[" "${left_bracket}" content "${content}")
+  string(REPLACE "]" "${right_bracket}" content "${content}")
+  string(REGEX MATCHALL "static const char\\* [A-Za-z0-9_]+ = CODE\\(\n"
+         headers "${content}")
+  set(offset 0)
+  set(count 0)
+  set(snippets "")
+  foreach(header ${headers})
+    string(REGEX REPLACE "static const char\\* ([A-Za-z0-9_]+) = .*" "\\1"
+           name "${header}")
+    string(SUBSTRING "${content}" ${offset} -1 rest)
+    string(FIND "${rest}" "${header}" header_index)
+    string(LENGTH "${header}" header_length)
+    math(EXPR begin "${offset} + ${header_index} + ${header_length}")
+    string(SUBSTRING "${content}" ${begin} -1 rest)
+    string(REGEX MATCHALL "[^()]*[()]" chunks "${rest}")
+    set(depth 1)
+    set(length 0)
+    foreach(chunk ${chunks})
+      string(LENGTH "${chunk}" chunk_length)
+      math(EXPR length "${length} + ${chunk_length}")
+      if("${chunk}" MATCHES "[(]$")
+        math(EXPR depth "${depth} + 1")
+      else()
+        math(EXPR depth "${depth} - 1")
+      endif()
+      if(depth EQUAL 0)
+        break()
+      endif()
+    endforeach()
+    if(NOT depth EQUAL 0)
+      break()
+    endif()
+    math(EXPR length "${length} - 1")
+    string(SUBSTRING "${rest}" 0 ${length} code)
+    math(EXPR offset "${begin} + ${length}")
+    string(REPLACE "${semicolon}" ";" code "${code}")
+    string(REPLACE "${left_bracket}" "[" code "${code}")
+    string(REPLACE "${right_bracket}" "]" code "${code}")
+    if(NOT code MATCHES "@(vertex|fragment|compute)")
+      set(snippets "${snippets}\n${code}")
+      continue()
+    endif()
+
+    # Line of the block in the source for the error message
+    string(SUBSTRING "${content}" 0 ${begin} prefix)
+    string(REGEX MATCHALL "\n" newlines "${prefix}")
+    list(LENGTH newlines line)
+    set(name_${count} ${name})
+    set(code_${count} "${code}")
+    set(location_${count} "${SOURCE}:${line} ${name}")
+    math(EXPR count "${count} + 1")
+  endforeach()
+
+  if(count GREATER 0)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+      validate_shader(${name_${i}} "${code_${i}}" "${snippets}"
+                      "${location_${i}}")
+    endforeach()
+  endif()
+endif()
+
+if(failed)
+  message(FATAL_ERROR "WGSL validation failed for ${SOURCE}")
+endif()
+file(WRITE ${STAMP} "")
@@ -94,6 +94,13 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
 {
   Initialize();
 
+  // Backend: explicitly requested or the compile time default
+  const bool explicitBackend
+    = options && options->backendType != WGPUBackendType_Undefined;
+  const wgpu::BackendType backendType
+    = explicitBackend ? static_cast<wgpu::BackendType>(options->backendType) :
+                        gpuContext.adapter.backendType;
+
   WGPUPowerPreference powerPreference
     = options ?
         (options->powerPreference == WGPUPowerPreference_HighPerformance ?
@@ -104,7 +111,13 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
   // Search available adapters for a good match, in the following priority
   // order
   std::vector<wgpu::AdapterType> typePriority;
-  if (powerPreference == WGPUPowerPreference_LowPower) {
+  if (options && options->forceFallbackAdapter) {
+    // fallback: CPU adapter (SwiftShader) only
+    typePriority = std::vector<wgpu::AdapterType>{
+      wgpu::AdapterType::CPU,
+    };
+  }
+  else if (powerPreference == WGPUPowerPreference_LowPower) {
     // low power
     typePriority = std::vector<wgpu::AdapterType>{
       wgpu::AdapterType::IntegratedGPU,
@@ -120,6 +133,10 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
       wgpu::AdapterType::CPU,
     };
   }
+  if (explicitBackend) {
+    // Accept any adapter of the requested backend as last resort
+    typePriority.push_back(wgpu::AdapterType::Unknown);
+  }
 
   std::vector<dawn::native::Adapter> adapters
     = gpuContext.dawn_native.instance->EnumerateAdapters();
@@ -127,9 +144,16 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
     for (const dawn::native::Adapter& adapter : adapters) {
       wgpu::AdapterProperties ap;
       adapter.GetProperties(&ap);
-      if (ap.adapterType == reqType
-          && (reqType == wgpu::AdapterType::CPU
-              || ap.backendType == gpuContext.adapter.backendType)) {
+      if (ap.adapterType != reqType) {
+        continue;
+      }
+      // Without an explicitly requested backend, CPU adapters (SwiftShader)
+      // of any backend but the Null backend are accepted
+      const bool backendMatches
+        = ap.backendType == backendType
+          || (!explicitBackend && reqType == wgpu::AdapterType::CPU
+              && ap.backendType != wgpu::BackendType::Null);
+      if (backendMatches) {
         gpuContext.adapter.handle = adapter;
         SetAdapterInfo(ap);
         dlog("Selected adapter %s (device=0x%x vendor=0x%x type=%s/%s)",
@@ -144,23 +168,58 @@ static WGPUAdapter RequestAdapter(WGPURequestAdapterOptions* options)
   return nullptr;
 }
 
+static WGPUAdapter RequestAdapterByIndex(uint32_t index)
+{
+  Initialize();
+
+  std::vector<dawn::native::Adapter> adapters
+    = gpuContext.dawn_native.instance->EnumerateAdapters();
+  if (index >= adapters.size()) {
+    return nullptr;
+  }
+
+  wgpu::AdapterProperties ap;
+  adapters[index].GetProperties(&ap);
+  gpuContext.adapter.handle = adapters[index];
+  SetAdapterInfo(ap);
+  dlog("Selected adapter %u: %s (device=0x%x vendor=0x%x type=%s/%s)", index,
+       ap.name, ap.deviceID, ap.vendorID, gpuContext.adapter.info.typeName,
+       gpuContext.adapter.info.backendName);
+  return gpuContext.adapter.handle.Get();
+}
+
 static void LogAvailableAdapters()
 {
   Initialize();
 
   fprintf(stderr, "Available adapters:\n");
+  uint32_t index = 0;
   for (auto&& a : gpuContext.dawn_native.instance->EnumerateAdapters()) {
     wgpu::AdapterProperties p;
     a.GetProperties(&p);
     fprintf(
       stderr,
-      "  %s (%s)\n"
+      "  [%u] %s (%s)\n"
       "    deviceID=%u, vendorID=0x%x, BackendType::%s, AdapterType::%s\n",
-      p.name, p.driverDescription, p.deviceID, p.vendorID,
+      index++, p.name, p.driverDescription, p.deviceID, p.vendorID,
       BackendTypeName(p.backendType), AdapterTypeName(p.adapterType));
   }
 }
 
+static void PrintAdapterList()
+{
+  Initialize();
+
+  // One tab separated line per adapter: index, backend, type, name
+  uint32_t index = 0;
+  for (auto&& a : gpuContext.dawn_native.instance->EnumerateAdapters()) {
+    wgpu::AdapterProperties p;
+    a.GetProperties(&p);
+    printf("%u\t%s\t%s\t%s\n", index++, BackendTypeName(p.backendType),
+           AdapterTypeName(p.adapterType), p.name);
+  }
+}
+
 static void GetAdapterInfo(char (*adapter_info)[256])
 {
   strncpy(adapter_info[0], gpuContext.adapter.info.name, 256);
@@ -251,6 +310,11 @@ void wgpu_log_available_adapters()
   WGPUImpl::LogAvailableAdapters();
 }
 
+void wgpu_print_adapter_list()
+{
+  WGPUImpl::PrintAdapterList();
+}
+
 void wgpu_get_adapter_info(char (*adapter_info)[256])
 {
   WGPUImpl::GetAdapterInfo(adapter_info);
@@ -261,6 +325,11 @@ WGPUAdapter wgpu_request_adapter(WGPURequestAdapterOptions* options)
   return WGPUImpl::RequestAdapter(options);
 }
 
+WGPUAdapter wgpu_request_adapter_by_index(uint32_t index)
+{
+  return WGPUImpl::RequestAdapterByIndex(index);
+}
+
 WGPUSurface wgpu_create_surface(void* display, void* window_handle)
 {
   return WGPUImpl::CreateSurface(display, window_handle);
@@ -10,8 +10,10 @@ extern "C" {
 #endif
 
 void wgpu_log_available_adapters();
+void wgpu_print_adapter_list();
 void wgpu_get_adapter_info(char (*adapter_info)[256]);
 WGPUAdapter wgpu_request_adapter(WGPURequestAdapterOptions* options);
+WGPUAdapter wgpu_request_adapter_by_index(uint32_t index);
 WGPUSurface wgpu_create_surface(void* display, void* window_handle);
 
 #ifdef __cplusplus
@@ -8,7 +8,10 @@
 #include "log.h"
 #include "macro.h"
 #include "math.h"
+#include "mesh_processing.h"
+#include "parallel.h"
 #include "platform.h"
+#include "trace.h"
 #include "utils.h"
 #include "window.h"
 
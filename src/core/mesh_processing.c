@@ -0,0 +1,233 @@
+#include "mesh_processing.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+
+#include "macro.h"
+#include "parallel.h"
+
+/* -------------------------------------------------------------------------- *
+ * Mesh processing
+ * -------------------------------------------------------------------------- */
+
+/* Minimum number of triangles / vertices processed by a thread */
+#define MESH_MIN_CHUNK_SIZE 4096u
+
+/* Components of the partial normals and tangents (xyz + bitangent sign) */
+#define MESH_NORMAL_COMPONENTS 3u
+#define MESH_TANGENT_COMPONENTS 4u
+
+typedef struct mesh_job_t {
+  const mesh_desc_t* mesh;
+  float* partials; /* components floats per vertex and chunk */
+  uint32_t components;
+  uint32_t chunk_count;
+} mesh_job_t;
+
+static float* mesh_attribute(const mesh_attribute_t* attribute,
+                             uint32_t components, uint32_t index)
+{
+  const size_t stride = attribute->stride > 0 ?
+                          attribute->stride :
+                          components * sizeof(float);
+  return (float*)((uint8_t*)attribute->data + index * stride);
+}
+
+/* Vertex indices of a triangle, false if they are out of range */
+static bool mesh_triangle(const mesh_desc_t* mesh, uint32_t triangle,
+                          uint32_t indices[3])
+{
+  for (uint32_t i = 0; i < 3; ++i) {
+    const uint32_t index
+      = mesh->index_size == 2 ?
+          ((const uint16_t*)mesh->indices)[triangle * 3 + i] :
+          ((const uint32_t*)mesh->indices)[triangle * 3 + i];
+    indices[i] = index - mesh->base_vertex;
+    if (index < mesh->base_vertex || indices[i] >= mesh->vertex_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static float* mesh_partial(const mesh_job_t* job, uint32_t chunk,
+                           uint32_t vertex)
+{
+  return &job->partials[((size_t)chunk * job->mesh->vertex_count + vertex)
+                        * job->components];
+}
+
+/* Sums the partials of all chunks into the partials of chunk 0 */
+static void mesh_reduce_partials(const mesh_job_t* job, uint32_t vertex)
+{
+  float* sum = mesh_partial(job, 0, vertex);
+  for (uint32_t c = 1; c < job->chunk_count; ++c) {
+    const float* partial = mesh_partial(job, c, vertex);
+    for (uint32_t i = 0; i < job->components; ++i) {
+      sum[i] += partial[i];
+    }
+  }
+}
+
+static void mesh_run_job(const mesh_desc_t* mesh, uint32_t components,
+                         parallel_for_func_t accumulate,
+                         parallel_for_func_t reduce)
+{
+  mesh_job_t job = {
+    .mesh        = mesh,
+    .components  = components,
+    .chunk_count = parallel_for_chunk_count(mesh->triangle_count,
+                                            MESH_MIN_CHUNK_SIZE),
+  };
+  job.partials = (float*)calloc(
+    (size_t)job.chunk_count * mesh->vertex_count * components, sizeof(float));
+  parallel_for(mesh->triangle_count, MESH_MIN_CHUNK_SIZE, accumulate, &job);
+  parallel_for(mesh->vertex_count, MESH_MIN_CHUNK_SIZE, reduce, &job);
+  free(job.partials);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Normals
+ * -------------------------------------------------------------------------- */
+
+static void mesh_accumulate_normals(uint32_t begin, uint32_t end,
+                                    uint32_t chunk, void* user_data)
+{
+  const mesh_job_t* job   = (const mesh_job_t*)user_data;
+  const mesh_desc_t* mesh = job->mesh;
+  for (uint32_t t = begin; t < end; ++t) {
+    uint32_t indices[3] = {0};
+    if (!mesh_triangle(mesh, t, indices)) {
+      continue;
+    }
+    const float* p0 = mesh_attribute(&mesh->positions, 3, indices[0]);
+    const float* p1 = mesh_attribute(&mesh->positions, 3, indices[1]);
+    const float* p2 = mesh_attribute(&mesh->positions, 3, indices[2]);
+    vec3 e1, e2, normal;
+    glm_vec3_sub((float*)p1, (float*)p0, e1);
+    glm_vec3_sub((float*)p2, (float*)p0, e2);
+    /* The length of the cross product is twice the triangle area */
+    glm_vec3_cross(e1, e2, normal);
+    for (uint32_t i = 0; i < 3; ++i) {
+      glm_vec3_add(mesh_partial(job, chunk, indices[i]), normal,
+                   mesh_partial(job, chunk, indices[i]));
+    }
+  }
+}
+
+static void mesh_reduce_normals(uint32_t begin, uint32_t end, uint32_t chunk,
+                                void* user_data)
+{
+  UNUSED_VAR(chunk);
+  const mesh_job_t* job   = (const mesh_job_t*)user_data;
+  const mesh_desc_t* mesh = job->mesh;
+  for (uint32_t v = begin; v < end; ++v) {
+    mesh_reduce_partials(job, v);
+    float* normal = mesh_attribute(&mesh->normals, 3, v);
+    glm_vec3_normalize_to(mesh_partial(job, 0, v), normal);
+  }
+}
+
+void mesh_compute_normals(const mesh_desc_t* mesh)
+{
+  mesh_run_job(mesh, MESH_NORMAL_COMPONENTS, mesh_accumulate_normals,
+               mesh_reduce_normals);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Tangents
+ * -------------------------------------------------------------------------- */
+
+/* v projected into the plane with the given normal and normalized */
+static void mesh_project_normalize(vec3 v, vec3 normal, vec3 dest)
+{
+  vec3 projected;
+  glm_vec3_copy(v, projected);
+  glm_vec3_muladds(normal, -glm_vec3_dot(normal, v), projected);
+  glm_vec3_normalize_to(projected, dest);
+}
+
+static void mesh_accumulate_tangents(uint32_t begin, uint32_t end,
+                                     uint32_t chunk, void* user_data)
+{
+  const mesh_job_t* job   = (const mesh_job_t*)user_data;
+  const mesh_desc_t* mesh = job->mesh;
+  for (uint32_t t = begin; t < end; ++t) {
+    uint32_t indices[3] = {0};
+    if (!mesh_triangle(mesh, t, indices)) {
+      continue;
+    }
+    float* p[3]  = {0};
+    float* uv[3] = {0};
+    for (uint32_t i = 0; i < 3; ++i) {
+      p[i]  = mesh_attribute(&mesh->positions, 3, indices[i]);
+      uv[i] = mesh_attribute(&mesh->uvs, 2, indices[i]);
+    }
+
+    /* Triangle tangent, flipped for triangles mirrored in texture space */
+    vec3 e1, e2, tangent;
+    glm_vec3_sub(p[1], p[0], e1);
+    glm_vec3_sub(p[2], p[0], e2);
+    const float s1 = uv[1][0] - uv[0][0], t1 = uv[1][1] - uv[0][1];
+    const float s2 = uv[2][0] - uv[0][0], t2 = uv[2][1] - uv[0][1];
+    const float signed_area = s1 * t2 - s2 * t1;
+    glm_vec3_scale(e1, t2, tangent);
+    glm_vec3_muladds(e2, -t1, tangent);
+    if (glm_vec3_norm(tangent) <= 0.0f) {
+      continue;
+    }
+    glm_vec3_scale(tangent, signed_area < 0.0f ? -1.0f : 1.0f, tangent);
+    const float orientation = signed_area > 0.0f ? 1.0f : -1.0f;
+
+    /* Projected into the tangent plane of every corner, weighted by the
+     * corner angle measured in that plane */
+    for (uint32_t i = 0; i < 3; ++i) {
+      float* normal = mesh_attribute(&mesh->normals, 3, indices[i]);
+      vec3 edge_next, edge_prev, corner_tangent;
+      glm_vec3_sub(p[(i + 1) % 3], p[i], edge_next);
+      glm_vec3_sub(p[(i + 2) % 3], p[i], edge_prev);
+      mesh_project_normalize(edge_next, normal, edge_next);
+      mesh_project_normalize(edge_prev, normal, edge_prev);
+      mesh_project_normalize(tangent, normal, corner_tangent);
+      const float angle
+        = acosf(glm_clamp(glm_vec3_dot(edge_next, edge_prev), -1.0f, 1.0f));
+
+      float* partial = mesh_partial(job, chunk, indices[i]);
+      glm_vec3_muladds(corner_tangent, angle, partial);
+      partial[3] += orientation * angle;
+    }
+  }
+}
+
+static void mesh_reduce_tangents(uint32_t begin, uint32_t end, uint32_t chunk,
+                                 void* user_data)
+{
+  UNUSED_VAR(chunk);
+  const mesh_job_t* job   = (const mesh_job_t*)user_data;
+  const mesh_desc_t* mesh = job->mesh;
+  for (uint32_t v = begin; v < end; ++v) {
+    mesh_reduce_partials(job, v);
+    float* sum     = mesh_partial(job, 0, v);
+    float* normal  = mesh_attribute(&mesh->normals, 3, v);
+    float* tangent = mesh_attribute(&mesh->tangents, 4, v);
+    mesh_project_normalize(sum, normal, tangent);
+    if (glm_vec3_norm(tangent) <= 0.0f) {
+      /* No usable texture coordinates, any vector in the tangent plane */
+      vec3 axis = {1.0f, 0.0f, 0.0f};
+      if (fabsf(normal[0]) > 0.9f) {
+        glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, axis);
+      }
+      mesh_project_normalize(axis, normal, tangent);
+    }
+    tangent[3] = sum[3] < 0.0f ? -1.0f : 1.0f;
+  }
+}
+
+void mesh_compute_tangents(const mesh_desc_t* mesh)
+{
+  mesh_run_job(mesh, MESH_TANGENT_COMPONENTS, mesh_accumulate_tangents,
+               mesh_reduce_tangents);
+}
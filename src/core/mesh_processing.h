@@ -0,0 +1,50 @@
+#ifndef MESH_PROCESSING_H
+#define MESH_PROCESSING_H
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * Mesh processing
+ *
+ * CPU preprocessing of indexed triangle meshes at load time: smooth vertex
+ * normals and MikkTSpace style tangents. Both run in parallel over the
+ * triangles (see parallel.h): every chunk of triangles accumulates into its
+ * own partial vertex attributes, the partials are reduced per vertex
+ * afterwards. Vertex attributes are addressed with byte strides, so
+ * interleaved vertex structs and separate attribute arrays both work.
+ * -------------------------------------------------------------------------- */
+
+typedef struct mesh_attribute_t {
+  float* data;
+  uint32_t stride; /* in bytes, 0 if tightly packed */
+} mesh_attribute_t;
+
+typedef struct mesh_desc_t {
+  uint32_t vertex_count;
+  mesh_attribute_t positions; /* vec3 */
+  mesh_attribute_t normals;   /* vec3 */
+  mesh_attribute_t uvs;       /* vec2 */
+  mesh_attribute_t tangents;  /* vec4, w holds the bitangent sign */
+  uint32_t triangle_count;
+  const void* indices;  /* three indices per triangle */
+  uint32_t index_size;  /* 2 or 4 bytes */
+  uint32_t base_vertex; /* subtracted from the indices */
+} mesh_desc_t;
+
+/**
+ * @brief Computes smooth vertex normals, the sum of the normals of the
+ * adjacent triangles weighted by their area. Writes the normals.
+ */
+void mesh_compute_normals(const mesh_desc_t* mesh);
+
+/**
+ * @brief Computes per vertex tangents from the positions, normals and texture
+ * coordinates. The tangent of a triangle is projected into the tangent plane
+ * of each corner and weighted by the corner angle, the bitangent sign follows
+ * the winding of the triangles in texture space, like MikkTSpace does. Unlike
+ * MikkTSpace, vertices are not split where tangent spaces diverge. Writes
+ * the tangents.
+ */
+void mesh_compute_tangents(const mesh_desc_t* mesh);
+
+#endif
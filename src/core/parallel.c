@@ -0,0 +1,94 @@
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "log.h"
+#include "macro.h"
+
+/* -------------------------------------------------------------------------- *
+ * Parallel for
+ * -------------------------------------------------------------------------- */
+
+typedef struct parallel_chunk_t {
+  pthread_t thread;
+  bool started;
+  uint32_t begin;
+  uint32_t end;
+  uint32_t index;
+  parallel_for_func_t func;
+  void* user_data;
+} parallel_chunk_t;
+
+static void* parallel_chunk_main(void* arg)
+{
+  parallel_chunk_t* chunk = (parallel_chunk_t*)arg;
+  chunk->func(chunk->begin, chunk->end, chunk->index, chunk->user_data);
+  return NULL;
+}
+
+uint32_t parallel_thread_count(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  const long thread_count = (long)system_info.dwNumberOfProcessors;
+#else
+  const long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return thread_count > 0 ?
+           MIN((uint32_t)thread_count, PARALLEL_MAX_THREADS) :
+           1u;
+}
+
+uint32_t parallel_for_chunk_count(uint32_t count, uint32_t min_chunk_size)
+{
+  const uint32_t max_chunk_count = count / MAX(min_chunk_size, 1u);
+  return MAX(MIN(parallel_thread_count(), max_chunk_count), 1u);
+}
+
+void parallel_for(uint32_t count, uint32_t min_chunk_size,
+                  parallel_for_func_t func, void* user_data)
+{
+  if (count == 0) {
+    return;
+  }
+
+  const uint32_t chunk_count = parallel_for_chunk_count(count, min_chunk_size);
+  parallel_chunk_t chunks[PARALLEL_MAX_THREADS] = {0};
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    chunks[i] = (parallel_chunk_t){
+      .begin     = (uint32_t)((uint64_t)count * i / chunk_count),
+      .end       = (uint32_t)((uint64_t)count * (i + 1) / chunk_count),
+      .index     = i,
+      .func      = func,
+      .user_data = user_data,
+    };
+  }
+
+  /* Chunks without a thread run on the calling thread */
+  for (uint32_t i = 1; i < chunk_count; ++i) {
+    chunks[i].started = pthread_create(&chunks[i].thread, NULL,
+                                       parallel_chunk_main, &chunks[i])
+                        == 0;
+    if (!chunks[i].started) {
+      log_warn("Parallel for: could not create a thread");
+    }
+  }
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    if (!chunks[i].started) {
+      parallel_chunk_main(&chunks[i]);
+    }
+  }
+  for (uint32_t i = 1; i < chunk_count; ++i) {
+    if (chunks[i].started) {
+      pthread_join(chunks[i].thread, NULL);
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * Parallel for
+ *
+ * Splits a range of items into contiguous chunks and processes each chunk on
+ * its own thread, the calling thread processes the first chunk and returns
+ * once all chunks are done. The chunk index is passed to the loop body, so
+ * loops can accumulate into per chunk partial results and reduce them
+ * afterwards instead of synchronizing with atomics:
+ *
+ *   uint32_t chunks = parallel_for_chunk_count(count, 1024);
+ *   float* partials = calloc(chunks * size, sizeof(float));
+ *   parallel_for(count, 1024, accumulate, partials); // partials[chunk]
+ *   parallel_for(size, 1024, reduce, partials);      // sums all chunks
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of threads of a parallel loop */
+#define PARALLEL_MAX_THREADS 16u
+
+/* Loop body, processes the items [begin, end) of a chunk */
+typedef void (*parallel_for_func_t)(uint32_t begin, uint32_t end,
+                                    uint32_t chunk, void* user_data);
+
+/* Number of hardware threads, at most PARALLEL_MAX_THREADS */
+uint32_t parallel_thread_count(void);
+
+/**
+ * @brief Returns the number of chunks parallel_for() splits count items into,
+ * every chunk holds at least min_chunk_size items (a single chunk otherwise).
+ */
+uint32_t parallel_for_chunk_count(uint32_t count, uint32_t min_chunk_size);
+
+/* Calls func for every chunk of the count items, returns when all are done */
+void parallel_for(uint32_t count, uint32_t min_chunk_size,
+                  parallel_for_func_t func, void* user_data);
+
+#endif
@@ -0,0 +1,288 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "macro.h"
+#include "platform.h"
+
+/* -------------------------------------------------------------------------- *
+ * Chrome trace (JSON) timeline export
+ * -------------------------------------------------------------------------- */
+
+#define TRACE_MAX_DEPTH 64u
+#define TRACE_THREAD_NAME_MAX 64u
+
+/* Process ids used to separate the CPU and GPU tracks in the viewer */
+#define TRACE_PID_CPU 1
+#define TRACE_PID_GPU 2
+
+typedef struct trace_event_t {
+  const char* name;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+} trace_event_t;
+
+typedef struct trace_thread_t {
+  uint32_t tid;
+  char name[TRACE_THREAD_NAME_MAX];
+  /* Ring buffer of completed events, count is the total number written */
+  trace_event_t* events;
+  uint64_t count;
+  /* Open events */
+  struct {
+    const char* name;
+    uint64_t begin_ns;
+  } stack[TRACE_MAX_DEPTH];
+  uint32_t depth;
+  struct trace_thread_t* next;
+} trace_thread_t;
+
+static struct {
+  bool initialized;
+  volatile bool enabled;
+  char filename[STRMAX];
+  uint64_t start_ns;
+  pthread_key_t thread_key;
+  pthread_mutex_t mutex;
+  trace_thread_t* threads; /* all registered threads, guarded by mutex */
+  uint32_t next_tid;
+  trace_thread_t gpu; /* GPU track, guarded by mutex */
+} trace_state = {0};
+
+static void trace_push_event(trace_thread_t* thread, const char* name,
+                             uint64_t begin_ns, uint64_t end_ns)
+{
+  trace_event_t* event
+    = &thread->events[thread->count % TRACE_EVENTS_PER_THREAD];
+  event->name     = name;
+  event->begin_ns = begin_ns;
+  event->end_ns   = end_ns;
+  ++thread->count;
+}
+
+static trace_thread_t* trace_get_thread(void)
+{
+  trace_thread_t* thread
+    = (trace_thread_t*)pthread_getspecific(trace_state.thread_key);
+  if (thread != NULL) {
+    return thread;
+  }
+
+  /* First event on this thread, register its ring buffer */
+  thread = (trace_thread_t*)calloc(1, sizeof(trace_thread_t));
+  thread->events
+    = (trace_event_t*)malloc(TRACE_EVENTS_PER_THREAD * sizeof(trace_event_t));
+  pthread_mutex_lock(&trace_state.mutex);
+  thread->tid = ++trace_state.next_tid;
+  snprintf(thread->name, sizeof(thread->name), "Thread %u", thread->tid);
+  thread->next        = trace_state.threads;
+  trace_state.threads = thread;
+  pthread_mutex_unlock(&trace_state.mutex);
+  pthread_setspecific(trace_state.thread_key, thread);
+
+  return thread;
+}
+
+void trace_init(const char* filename)
+{
+  /* Thread buffers stay bound to their threads, tracing can be initialized
+   * once per process */
+  if (trace_state.initialized || filename == NULL) {
+    return;
+  }
+
+  snprintf(trace_state.filename, sizeof(trace_state.filename), "%s",
+           filename);
+  pthread_key_create(&trace_state.thread_key, NULL);
+  pthread_mutex_init(&trace_state.mutex, NULL);
+  trace_state.start_ns = platform_get_timestamp_ns();
+  trace_state.gpu.events
+    = (trace_event_t*)malloc(TRACE_EVENTS_PER_THREAD * sizeof(trace_event_t));
+  snprintf(trace_state.gpu.name, sizeof(trace_state.gpu.name), "GPU queue");
+  trace_state.initialized = true;
+  trace_state.enabled     = true;
+
+  trace_set_thread_name("Main thread");
+}
+
+bool trace_is_enabled(void)
+{
+  return trace_state.enabled;
+}
+
+void trace_begin(const char* name)
+{
+  if (!trace_state.enabled) {
+    return;
+  }
+
+  trace_thread_t* thread = trace_get_thread();
+  if (thread->depth < TRACE_MAX_DEPTH) {
+    thread->stack[thread->depth].name     = name;
+    thread->stack[thread->depth].begin_ns = platform_get_timestamp_ns();
+  }
+  /* Keep counting beyond the maximum depth to keep begin / end balanced */
+  ++thread->depth;
+}
+
+void trace_end(void)
+{
+  if (!trace_state.enabled) {
+    return;
+  }
+
+  trace_thread_t* thread = trace_get_thread();
+  if (thread->depth == 0) {
+    return;
+  }
+  --thread->depth;
+  if (thread->depth < TRACE_MAX_DEPTH) {
+    trace_push_event(thread, thread->stack[thread->depth].name,
+                     thread->stack[thread->depth].begin_ns,
+                     platform_get_timestamp_ns());
+  }
+}
+
+int trace_scope_begin(const char* name)
+{
+  if (!trace_state.enabled) {
+    return 0;
+  }
+  trace_begin(name);
+  return 1;
+}
+
+void trace_scope_end(int* scope)
+{
+  if (*scope) {
+    trace_end();
+  }
+}
+
+void trace_set_thread_name(const char* name)
+{
+  if (!trace_state.enabled) {
+    return;
+  }
+
+  trace_thread_t* thread = trace_get_thread();
+  snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+void trace_add_gpu_event(const char* name, uint64_t begin_ns, uint64_t end_ns)
+{
+  if (!trace_state.enabled) {
+    return;
+  }
+
+  pthread_mutex_lock(&trace_state.mutex);
+  trace_push_event(&trace_state.gpu, name, begin_ns, MAX(begin_ns, end_ns));
+  pthread_mutex_unlock(&trace_state.mutex);
+}
+
+/* Writes a JSON string, event names are expected to be plain identifiers */
+static void trace_write_string(FILE* file, const char* str)
+{
+  fputc('"', file);
+  for (const char* c = str; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', file);
+    }
+    if ((unsigned char)*c >= 0x20) {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void trace_write_metadata(FILE* file, const char* type, int pid,
+                                 uint32_t tid, const char* name, bool* first)
+{
+  fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                "\"args\":{\"name\":",
+          *first ? "" : ",", type, pid, tid);
+  trace_write_string(file, name);
+  fputs("}}", file);
+  *first = false;
+}
+
+static void trace_write_events(FILE* file, const trace_thread_t* thread,
+                               int pid, bool* first)
+{
+  const uint64_t count = MIN(thread->count, TRACE_EVENTS_PER_THREAD);
+  for (uint64_t i = thread->count - count; i < thread->count; ++i) {
+    const trace_event_t* event = &thread->events[i % TRACE_EVENTS_PER_THREAD];
+    if (event->begin_ns < trace_state.start_ns) {
+      continue;
+    }
+    /* Chrome trace timestamps and durations are in microseconds */
+    fprintf(file, "%s\n{\"name\":", *first ? "" : ",");
+    trace_write_string(file, event->name);
+    fprintf(file,
+            ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            pid == TRACE_PID_GPU ? "gpu" : "cpu", pid, thread->tid,
+            (double)(event->begin_ns - trace_state.start_ns) / 1000.0,
+            (double)(event->end_ns - event->begin_ns) / 1000.0);
+    *first = false;
+  }
+}
+
+void trace_shutdown(void)
+{
+  if (!trace_state.initialized) {
+    return;
+  }
+
+  /* Stop recording, worker threads should be joined at this point */
+  trace_state.enabled = false;
+  pthread_mutex_lock(&trace_state.mutex);
+
+  FILE* file = fopen(trace_state.filename, "wb");
+  if (file == NULL) {
+    log_error("Trace: could not open %s for writing", trace_state.filename);
+  }
+  else {
+    bool first     = true;
+    uint64_t total = 0;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    trace_write_metadata(file, "process_name", TRACE_PID_CPU, 0, "CPU",
+                         &first);
+    trace_write_metadata(file, "process_name", TRACE_PID_GPU, 0, "GPU",
+                         &first);
+    for (trace_thread_t* thread = trace_state.threads; thread != NULL;
+         thread                 = thread->next) {
+      trace_write_metadata(file, "thread_name", TRACE_PID_CPU, thread->tid,
+                           thread->name, &first);
+      trace_write_events(file, thread, TRACE_PID_CPU, &first);
+      total += MIN(thread->count, TRACE_EVENTS_PER_THREAD);
+    }
+    trace_write_metadata(file, "thread_name", TRACE_PID_GPU,
+                         trace_state.gpu.tid, trace_state.gpu.name, &first);
+    trace_write_events(file, &trace_state.gpu, TRACE_PID_GPU, &first);
+    total += MIN(trace_state.gpu.count, TRACE_EVENTS_PER_THREAD);
+    fputs("\n]}\n", file);
+    fclose(file);
+    log_info("Trace: wrote %llu events to %s", (unsigned long long)total,
+             trace_state.filename);
+  }
+
+  /* Release the thread buffers */
+  trace_thread_t* thread = trace_state.threads;
+  while (thread != NULL) {
+    trace_thread_t* next = thread->next;
+    free(thread->events);
+    free(thread);
+    thread = next;
+  }
+  trace_state.threads = NULL;
+  free(trace_state.gpu.events);
+  trace_state.gpu.events = NULL;
+  pthread_setspecific(trace_state.thread_key, NULL);
+
+  pthread_mutex_unlock(&trace_state.mutex);
+}
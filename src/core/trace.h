@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- *
+ * Chrome trace (JSON) timeline export
+ *
+ * Lightweight CPU instrumentation: events are recorded into per-thread ring
+ * buffers and merged, together with GPU time ranges, into a trace file that
+ * can be loaded in chrome://tracing or https://ui.perfetto.dev. Tracing is off
+ * until trace_init() is called, disabled scopes cost a single branch.
+ *
+ * Usage:
+ *   TRACE_SCOPE("render");  // ends with the enclosing block (GCC / Clang)
+ *   TRACE_BEGIN("upload");  // explicit begin / end pair
+ *   TRACE_END();
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of events kept per thread, older events are overwritten */
+#define TRACE_EVENTS_PER_THREAD 65536u
+
+/* Tracing lifecycle */
+void trace_init(const char* filename);
+void trace_shutdown(void); /* writes the trace file */
+bool trace_is_enabled(void);
+
+/* CPU events, name must be a string literal or otherwise outlive tracing */
+void trace_begin(const char* name);
+void trace_end(void);
+void trace_set_thread_name(const char* name);
+
+/* GPU range, timestamps in the CPU timeline (see platform_get_timestamp_ns) */
+void trace_add_gpu_event(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+/* Helpers for TRACE_SCOPE */
+int trace_scope_begin(const char* name);
+void trace_scope_end(int* scope);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_BEGIN(name)                                                      \
+  do {                                                                         \
+    if (trace_is_enabled()) {                                                  \
+      trace_begin(name);                                                       \
+    }                                                                          \
+  } while (0)
+#define TRACE_END()                                                            \
+  do {                                                                         \
+    if (trace_is_enabled()) {                                                  \
+      trace_end();                                                             \
+    }                                                                          \
+  } while (0)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TRACE_SCOPE(name)                                                      \
+  int TRACE_CONCAT(trace_scope_, __LINE__)                                     \
+    __attribute__((cleanup(trace_scope_end), unused))                          \
+    = trace_scope_begin(name)
+#else
+/* No scope exit hook available, use TRACE_BEGIN / TRACE_END instead */
+#define TRACE_SCOPE(name)
+#endif
+
+#endif /* TRACE_H */
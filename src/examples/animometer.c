@@ -9,6 +9,13 @@
  *
  * A WebGPU port of the Animometer MotionMark benchmark.
  *
+ * The triangles can be drawn with one bind group and draw call per triangle,
+ * with a single bind group using dynamic offsets or with one instanced draw
+ * call, each with or without render bundles. The scaling sweep doubles the
+ * triangle count for every configuration until the frame time exceeds the
+ * target and logs a table with the CPU encoding and GPU time per triangle,
+ * i.e. the draw call overhead of the current backend.
+ *
  * Ref:
  * https://github.com/austinEng/webgpu-samples/blob/main/src/pages/samples/animometer.ts
  * -------------------------------------------------------------------------- */
@@ -24,38 +31,77 @@ static const char* fragment_shader_wgsl;
  * Animometer example
  * -------------------------------------------------------------------------- */
 
+// Draw modes
+typedef enum draw_mode_t {
+  DRAW_MODE_BIND_GROUPS,     /* one bind group and draw call per triangle */
+  DRAW_MODE_DYNAMIC_OFFSETS, /* one bind group, dynamic offset per triangle */
+  DRAW_MODE_INSTANCING,      /* one instanced draw call */
+  DRAW_MODE_COUNT,
+} draw_mode_t;
+
+static const char* draw_mode_names[DRAW_MODE_COUNT] = {
+  "Bind Groups",     /* */
+  "Dynamic Offsets", /* */
+  "Instancing",      /* */
+};
+
+// Per triangle data: scale, offsetX, offsetY, scalar, scalarOffset
+#define TRIANGLE_FLOATS 5u
+// Limits of the triangle count, per object modes use a 256 byte uniform slot
+#define MAX_NUM_TRIANGLES (1u << 22)
+#define MAX_PER_OBJECT_TRIANGLES (1u << 18)
+
+// Scaling sweep
+#define SWEEP_START_TRIANGLES 1000u
+#define SWEEP_WARMUP_FRAMES 10u
+#define SWEEP_MEASURE_FRAMES 60u
+#define SWEEP_CONFIG_COUNT (DRAW_MODE_COUNT * 2u)
+
 // Settings
 static struct settings_t {
-  uint64_t num_triangles;
+  uint32_t num_triangles;
   bool render_bundles;
-  bool dynamic_offsets;
+  int32_t draw_mode;
+  float target_frame_ms;
 } settings = {
   .num_triangles   = 20000,
   .render_bundles  = true,
-  .dynamic_offsets = false,
+  .draw_mode       = DRAW_MODE_BIND_GROUPS,
+  .target_frame_ms = 1000.0f / 60.0f,
 };
 static uint64_t uniform_bytes          = 0;
 static uint64_t aligned_uniform_bytes  = 0;
 static uint64_t aligned_uniform_floats = 0;
 
+// Random per triangle data, grown on demand and kept across triangle counts
+static struct {
+  float* data;
+  uint32_t count;
+} triangles = {0};
+
 // Vertex buffer
 static struct {
   WGPUBuffer buffer;
   uint32_t count;
 } vertices = {0};
 
-//  Uniform buffer
+//  Uniform buffers
 static WGPUBuffer uniform_buffer = NULL;
-static uint64_t time_offset      = 0;
+static WGPUBuffer time_buffer    = NULL;
 static float uniform_time[1]     = {0};
 
+// Storage buffer with the tightly packed triangle data for instancing
+static WGPUBuffer instance_buffer = NULL;
+
 // The pipeline layouts
-static WGPUPipelineLayout pipeline_layout         = NULL;
-static WGPUPipelineLayout dynamic_pipeline_layout = NULL;
+static WGPUPipelineLayout pipeline_layout           = NULL;
+static WGPUPipelineLayout dynamic_pipeline_layout   = NULL;
+static WGPUPipelineLayout instanced_pipeline_layout = NULL;
 
 // Pipelines
-static WGPURenderPipeline pipeline         = NULL;
-static WGPURenderPipeline dynamic_pipeline = NULL;
+static WGPURenderPipeline pipeline           = NULL;
+static WGPURenderPipeline dynamic_pipeline   = NULL;
+static WGPURenderPipeline instanced_pipeline = NULL;
 
 // Render pass descriptor for frame buffer writes
 static struct {
@@ -68,13 +114,44 @@ static struct {
 static WGPURenderBundle render_bundle = NULL;
 
 // Bind groups stores the resources bound to the binding points in a shader
-static WGPUBindGroupLayout time_bind_group_layout    = NULL;
-static WGPUBindGroupLayout bind_group_layout         = NULL;
-static WGPUBindGroupLayout dynamic_bind_group_layout = NULL;
+static WGPUBindGroupLayout time_bind_group_layout      = NULL;
+static WGPUBindGroupLayout bind_group_layout           = NULL;
+static WGPUBindGroupLayout dynamic_bind_group_layout   = NULL;
+static WGPUBindGroupLayout instanced_bind_group_layout = NULL;
+
+static WGPUBindGroup* bind_groups         = NULL;
+static uint32_t bind_group_count          = 0;
+static WGPUBindGroup dynamic_bind_group   = NULL;
+static WGPUBindGroup instanced_bind_group = NULL;
+static WGPUBindGroup time_bind_group      = NULL;
+
+// CPU time spent to encode the draw commands
+static struct {
+  float bundle_encode_ms; /* last render bundle encoding */
+  float pass_encode_ms;   /* render pass encoding of the last frame */
+  float pass_encode_avg_ms;
+} timings = {0};
+
+// Scaling sweep state
+typedef struct sweep_result_t {
+  int32_t draw_mode;
+  bool render_bundles;
+  uint32_t num_triangles; /* largest count within the frame time target */
+  float frame_ms;
+  float cpu_encode_ms;
+  float gpu_ms;
+} sweep_result_t;
 
-static WGPUBindGroup* bind_groups       = NULL;
-static WGPUBindGroup dynamic_bind_group = NULL;
-static WGPUBindGroup time_bind_group    = NULL;
+static struct {
+  bool running;
+  uint32_t config; /* draw mode * 2 + render bundles */
+  uint32_t frame;  /* frame of the current step */
+  double frame_ms, cpu_encode_ms, gpu_ms; /* sums of the measured frames */
+  sweep_result_t current;                 /* last step within the target */
+  sweep_result_t results[SWEEP_CONFIG_COUNT];
+  uint32_t result_count;
+  struct settings_t saved_settings;
+} sweep = {0};
 
 // Other variables
 static const char* example_title = "Animometer";
@@ -192,6 +269,38 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
   dynamic_pipeline_layout = wgpuDeviceCreatePipelineLayout(
     wgpu_context->device, &_dynamic_pipeline_layout_desc);
   ASSERT(dynamic_pipeline_layout != NULL);
+
+  // Instanced bind group layout, binding 1 to share the shader module
+  WGPUBindGroupLayoutEntry instanced_bgl_entries[1] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding = 1,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = TRIANGLE_FLOATS * sizeof(float),
+      },
+      .sampler = {0},
+    },
+  };
+  WGPUBindGroupLayoutDescriptor instanced_bgl_desc = {
+    .label      = "Instanced bind group layout",
+    .entryCount = (uint32_t)ARRAY_SIZE(instanced_bgl_entries),
+    .entries    = instanced_bgl_entries,
+  };
+  instanced_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &instanced_bgl_desc);
+  ASSERT(instanced_bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bgl_instanced_pipeline[2]
+    = {time_bind_group_layout, instanced_bind_group_layout};
+  WGPUPipelineLayoutDescriptor instanced_pipeline_layout_desc = {
+    .label                = "Instanced pipeline layout",
+    .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bgl_instanced_pipeline),
+    .bindGroupLayouts     = bgl_instanced_pipeline,
+  };
+  instanced_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &instanced_pipeline_layout_desc);
+  ASSERT(instanced_pipeline_layout != NULL);
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -235,34 +344,111 @@ static void update_uniform_buffers(wgpu_example_context_t* context)
     start_time = frame_timestamp_millis;
   }
   uniform_time[0] = (frame_timestamp_millis - start_time) / 1000.0f;
-  wgpu_queue_write_buffer(context->wgpu_context, uniform_buffer, time_offset,
-                          &uniform_time, sizeof(uniform_time));
+  wgpu_queue_write_buffer(context->wgpu_context, time_buffer, 0, &uniform_time,
+                          sizeof(uniform_time));
+}
+
+static void prepare_time_buffer(wgpu_context_t* wgpu_context)
+{
+  time_buffer = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+      .label = "Time uniform buffer",
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(uniform_time),
+    });
+
+  WGPUBindGroupEntry time_bg_entries[1] = {
+        [0] = (WGPUBindGroupEntry) {
+          .binding = 0,
+          .buffer = time_buffer,
+          .offset = 0,
+          .size = sizeof(float),
+        },
+      };
+  time_bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, (&(WGPUBindGroupDescriptor){
+                            .label      = "Time bind group layout",
+                            .layout     = time_bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(time_bg_entries),
+                            .entries    = time_bg_entries,
+                          }));
+}
+
+static void ensure_enough_triangles(void)
+{
+  if (triangles.count >= settings.num_triangles) {
+    return;
+  }
+
+  triangles.data = (float*)realloc(
+    triangles.data, settings.num_triangles * TRIANGLE_FLOATS * sizeof(float));
+  for (uint32_t i = triangles.count; i < settings.num_triangles; ++i) {
+    float* triangle = &triangles.data[i * TRIANGLE_FLOATS];
+    triangle[0]     = float_random(0.0f, 1.0f) * 0.2f + 0.2f; // scale
+    triangle[1] = 0.9f * 2.0f * (float_random(0.0f, 1.0f) - 0.5f); // offsetX
+    triangle[2] = 0.9f * 2.0f * (float_random(0.0f, 1.0f) - 0.5f); // offsetY
+    triangle[3] = float_random(0.0f, 1.0f) * 1.5f + 0.5f;           // scalar
+    triangle[4] = float_random(0.0f, 1.0f) * 10.0f; // scalarOffset
+  }
+  triangles.count = settings.num_triangles;
+}
+
+static void release_triangle_buffers(void)
+{
+  for (uint32_t i = 0; i < bind_group_count; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_groups[i])
+  }
+  free(bind_groups);
+  bind_groups      = NULL;
+  bind_group_count = 0;
+  WGPU_RELEASE_RESOURCE(BindGroup, dynamic_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instanced_bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, instance_buffer)
+}
+
+static void write_buffer_chunked(wgpu_context_t* wgpu_context,
+                                 WGPUBuffer buffer, const float* data,
+                                 uint64_t float_count)
+{
+  const uint64_t max_mapping_length = (14 * 1024 * 1024) / sizeof(float);
+  for (uint64_t offset = 0; offset < float_count;
+       offset += max_mapping_length) {
+    const uint64_t upload_count
+      = MIN(float_count - offset, max_mapping_length);
+
+    wgpuQueueWriteBuffer(wgpu_context->queue, buffer, offset * sizeof(float),
+                         &data[offset], upload_count * sizeof(float));
+  }
 }
 
+/* Uniform buffer with one 256 byte aligned slot per triangle */
 static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
 {
-  uniform_bytes          = 5 * sizeof(float);
+  uniform_bytes          = TRIANGLE_FLOATS * sizeof(float);
   aligned_uniform_bytes  = ceil(uniform_bytes / 256.0f) * 256;
   aligned_uniform_floats = aligned_uniform_bytes / sizeof(float);
   uniform_buffer         = wgpuDeviceCreateBuffer(
     wgpu_context->device,
     &(WGPUBufferDescriptor){
               .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
-              .size  = settings.num_triangles * aligned_uniform_bytes + sizeof(float),
+              .size  = settings.num_triangles * aligned_uniform_bytes,
     });
-  float uniform_buffer_data[settings.num_triangles * aligned_uniform_floats];
-  bind_groups = malloc(settings.num_triangles * sizeof(WGPUBindGroup));
+  float* uniform_buffer_data = (float*)calloc(
+    settings.num_triangles * aligned_uniform_floats, sizeof(float));
+  if (settings.draw_mode == DRAW_MODE_BIND_GROUPS) {
+    bind_groups = malloc(settings.num_triangles * sizeof(WGPUBindGroup));
+    bind_group_count = settings.num_triangles;
+  }
   for (uint64_t i = 0; i < settings.num_triangles; ++i) {
-    uniform_buffer_data[aligned_uniform_floats * i + 0]
-      = float_random(0.0f, 1.0f) * 0.2f + 0.2f; // scale
-    uniform_buffer_data[aligned_uniform_floats * i + 1]
-      = 0.9f * 2.0f * (float_random(0.0f, 1.0f) - 0.5f); // offsetX
-    uniform_buffer_data[aligned_uniform_floats * i + 2]
-      = 0.9f * 2.0f * (float_random(0.0f, 1.0f) - 0.5f); // offsetY
-    uniform_buffer_data[aligned_uniform_floats * i + 3]
-      = float_random(0.0f, 1.0f) * 1.5f + 0.5f; // scalar
-    uniform_buffer_data[aligned_uniform_floats * i + 4]
-      = float_random(0.0f, 1.0f) * 10.0f; // scalarOffset
+    memcpy(&uniform_buffer_data[aligned_uniform_floats * i],
+           &triangles.data[TRIANGLE_FLOATS * i],
+           TRIANGLE_FLOATS * sizeof(float));
+
+    if (settings.draw_mode != DRAW_MODE_BIND_GROUPS) {
+      continue;
+    }
 
     WGPUBindGroupEntry bg_entries[1] = {
       [0] = (WGPUBindGroupEntry) {
@@ -299,38 +485,56 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
       .entries    = dynamic_bg_entries,
     }));
 
-  time_offset = settings.num_triangles * aligned_uniform_bytes;
-  WGPUBindGroupEntry time_bg_entries[1] = {
+  write_buffer_chunked(wgpu_context, uniform_buffer, uniform_buffer_data,
+                       settings.num_triangles * aligned_uniform_floats);
+  free(uniform_buffer_data);
+}
+
+/* Storage buffer with the tightly packed triangle data */
+static void prepare_instance_buffer(wgpu_context_t* wgpu_context)
+{
+  const uint64_t float_count = settings.num_triangles * TRIANGLE_FLOATS;
+  instance_buffer            = wgpuDeviceCreateBuffer(
+    wgpu_context->device,
+    &(WGPUBufferDescriptor){
+                 .label = "Instance storage buffer",
+                 .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                 .size  = float_count * sizeof(float),
+    });
+
+  WGPUBindGroupEntry instanced_bg_entries[1] = {
         [0] = (WGPUBindGroupEntry) {
-          .binding = 0,
-          .buffer = uniform_buffer,
-          .offset = time_offset,
-          .size = sizeof(float),
+          .binding = 1,
+          .buffer = instance_buffer,
+          .offset = 0,
+          .size = float_count * sizeof(float),
         },
       };
-  time_bind_group = wgpuDeviceCreateBindGroup(
-    wgpu_context->device, (&(WGPUBindGroupDescriptor){
-                            .label      = "Time bind group layout",
-                            .layout     = time_bind_group_layout,
-                            .entryCount = (uint32_t)ARRAY_SIZE(time_bg_entries),
-                            .entries    = time_bg_entries,
-                          }));
-
-  const uint64_t max_mapping_length = (14 * 1024 * 1024) / sizeof(float);
-  for (uint64_t offset = 0; offset < ARRAY_SIZE(uniform_buffer_data);
-       offset += max_mapping_length) {
-    const uint64_t upload_count
-      = MIN(ARRAY_SIZE(uniform_buffer_data) - offset, max_mapping_length);
+  instanced_bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device,
+    (&(WGPUBindGroupDescriptor){
+      .label      = "Instanced bind group",
+      .layout     = instanced_bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(instanced_bg_entries),
+      .entries    = instanced_bg_entries,
+    }));
 
-    wgpuQueueWriteBuffer(wgpu_context->queue, uniform_buffer,
-                         offset * sizeof(float), &uniform_buffer_data[offset],
-                         upload_count * sizeof(float));
-  }
+  write_buffer_chunked(wgpu_context, instance_buffer, triangles.data,
+                       float_count);
 }
 
 #define RECORD_RENDER_PASS(Type, rpass_enc)                                    \
-  if (rpass_enc) {                                                             \
-    if (settings.dynamic_offsets) {                                            \
+  if (rpass_enc && settings.draw_mode == DRAW_MODE_INSTANCING) {               \
+    wgpu##Type##SetPipeline(rpass_enc, instanced_pipeline);                    \
+    wgpu##Type##SetVertexBuffer(rpass_enc, 0, vertices.buffer, 0,              \
+                                WGPU_WHOLE_SIZE);                              \
+    wgpu##Type##SetBindGroup(rpass_enc, 0, time_bind_group, 0, 0);             \
+    wgpu##Type##SetBindGroup(rpass_enc, 1, instanced_bind_group, 0, 0);        \
+    wgpu##Type##Draw(rpass_enc, 3, settings.num_triangles, 0, 0);              \
+  }                                                                            \
+  else if (rpass_enc) {                                                        \
+    const bool dynamic = settings.draw_mode == DRAW_MODE_DYNAMIC_OFFSETS;      \
+    if (dynamic) {                                                             \
       wgpu##Type##SetPipeline(rpass_enc, dynamic_pipeline);                    \
     }                                                                          \
     else {                                                                     \
@@ -341,7 +545,7 @@ static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
     wgpu##Type##SetBindGroup(rpass_enc, 0, time_bind_group, 0, 0);             \
     uint32_t dynamic_offsets[1] = {0};                                         \
     for (uint64_t i = 0; i < settings.num_triangles; ++i) {                    \
-      if (settings.dynamic_offsets) {                                          \
+      if (dynamic) {                                                           \
         dynamic_offsets[0] = i * aligned_uniform_bytes;                        \
         wgpu##Type##SetBindGroup(rpass_enc, 1, dynamic_bind_group, 1,          \
                                  dynamic_offsets);                             \
@@ -430,13 +634,21 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   dynamic_pipeline
     = wgpuDeviceCreateRenderPipeline(wgpu_context->device, &pipeline_desc);
 
+  pipeline_desc.layout            = instanced_pipeline_layout;
+  pipeline_desc.vertex.entryPoint = "vert_main_instanced";
+  instanced_pipeline
+    = wgpuDeviceCreateRenderPipeline(wgpu_context->device, &pipeline_desc);
+
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
 }
 
 static void prepare_render_bundle_encoder(wgpu_context_t* wgpu_context)
 {
+  WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
+
+  const uint64_t start_ns            = platform_get_timestamp_ns();
   WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
   WGPURenderBundleEncoder render_bundle_encoder
     = wgpuDeviceCreateRenderBundleEncoder(wgpu_context->device,
@@ -448,19 +660,140 @@ static void prepare_render_bundle_encoder(wgpu_context_t* wgpu_context)
                                           });
   RECORD_RENDER_PASS(RenderBundleEncoder, render_bundle_encoder)
   render_bundle = wgpuRenderBundleEncoderFinish(render_bundle_encoder, NULL);
+  timings.bundle_encode_ms
+    = (float)(platform_get_timestamp_ns() - start_ns) / 1000000.0f;
 
   WGPU_RELEASE_RESOURCE(RenderBundleEncoder, render_bundle_encoder)
 }
 
+static uint32_t get_max_num_triangles(int32_t draw_mode)
+{
+  return draw_mode == DRAW_MODE_INSTANCING ? MAX_NUM_TRIANGLES :
+                                             MAX_PER_OBJECT_TRIANGLES;
+}
+
+/* Recreates the per triangle resources after the count or draw mode changed */
+static void update_scene(wgpu_context_t* wgpu_context)
+{
+  settings.num_triangles
+    = MIN(settings.num_triangles, get_max_num_triangles(settings.draw_mode));
+  ensure_enough_triangles();
+  release_triangle_buffers();
+  if (settings.draw_mode == DRAW_MODE_INSTANCING) {
+    prepare_instance_buffer(wgpu_context);
+  }
+  else {
+    prepare_uniform_buffers(wgpu_context);
+  }
+  prepare_render_bundle_encoder(wgpu_context);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Scaling sweep
+ * -------------------------------------------------------------------------- */
+
+static void sweep_start_config(wgpu_context_t* wgpu_context, uint32_t config)
+{
+  sweep.config            = config;
+  sweep.current           = (sweep_result_t){0};
+  settings.draw_mode      = (int32_t)(config / 2);
+  settings.render_bundles = (config % 2) == 1;
+  settings.num_triangles  = SWEEP_START_TRIANGLES;
+  update_scene(wgpu_context);
+}
+
+static void sweep_start(wgpu_context_t* wgpu_context)
+{
+  sweep.saved_settings = settings;
+  sweep.running        = true;
+  sweep.result_count   = 0;
+  sweep.frame          = 0;
+  sweep.frame_ms = sweep.cpu_encode_ms = sweep.gpu_ms = 0.0;
+  sweep_start_config(wgpu_context, 0);
+}
+
+static void sweep_log_results(wgpu_example_context_t* context)
+{
+  log_info("Animometer scaling results: %s (%s), frame time target %.2f ms",
+           context->adapter_info[0], context->adapter_info[2],
+           settings.target_frame_ms);
+  log_info("%-16s %-8s %10s %9s %9s %13s %9s %13s", "mode", "bundles",
+           "triangles", "frame_ms", "cpu_ms", "cpu_us/object", "gpu_ms",
+           "gpu_us/object");
+  for (uint32_t i = 0; i < sweep.result_count; ++i) {
+    const sweep_result_t* r = &sweep.results[i];
+    log_info("%-16s %-8s %10u %9.3f %9.3f %13.4f %9.3f %13.4f",
+             draw_mode_names[r->draw_mode], r->render_bundles ? "yes" : "no",
+             r->num_triangles, r->frame_ms, r->cpu_encode_ms,
+             r->cpu_encode_ms * 1000.0f / r->num_triangles, r->gpu_ms,
+             r->gpu_ms * 1000.0f / r->num_triangles);
+  }
+}
+
+/* Measures the current step and advances the sweep */
+static void sweep_update(wgpu_example_context_t* context)
+{
+  if (!sweep.running) {
+    return;
+  }
+
+  if (sweep.frame >= SWEEP_WARMUP_FRAMES) {
+    sweep.frame_ms += context->frame_timer * 1000.0;
+    sweep.cpu_encode_ms += timings.pass_encode_ms;
+    if (context->gpu_timer != NULL) {
+      sweep.gpu_ms += wgpu_gpu_timer_get_frame_ms(context->gpu_timer);
+    }
+  }
+  if (++sweep.frame < SWEEP_WARMUP_FRAMES + SWEEP_MEASURE_FRAMES) {
+    return;
+  }
+
+  const sweep_result_t measured = {
+    .draw_mode      = settings.draw_mode,
+    .render_bundles = settings.render_bundles,
+    .num_triangles  = settings.num_triangles,
+    .frame_ms       = (float)(sweep.frame_ms / SWEEP_MEASURE_FRAMES),
+    .cpu_encode_ms  = (float)(sweep.cpu_encode_ms / SWEEP_MEASURE_FRAMES),
+    .gpu_ms         = (float)(sweep.gpu_ms / SWEEP_MEASURE_FRAMES),
+  };
+  sweep.frame    = 0;
+  sweep.frame_ms = sweep.cpu_encode_ms = sweep.gpu_ms = 0.0;
+
+  // Keep the first step even if it already exceeds the target
+  const bool within_target = measured.frame_ms <= settings.target_frame_ms;
+  if (within_target || sweep.current.num_triangles == 0) {
+    sweep.current = measured;
+  }
+  if (within_target
+      && settings.num_triangles * 2
+           <= get_max_num_triangles(settings.draw_mode)) {
+    settings.num_triangles *= 2;
+    update_scene(context->wgpu_context);
+    return;
+  }
+
+  // Configuration done, continue with the next one
+  sweep.results[sweep.result_count++] = sweep.current;
+  if (sweep.config + 1 < SWEEP_CONFIG_COUNT) {
+    sweep_start_config(context->wgpu_context, sweep.config + 1);
+    return;
+  }
+
+  sweep.running = false;
+  sweep_log_results(context);
+  settings = sweep.saved_settings;
+  update_scene(context->wgpu_context);
+}
+
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     prepare_vertex_buffer(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
-    prepare_uniform_buffers(context->wgpu_context);
+    prepare_time_buffer(context->wgpu_context);
     prepare_pipelines(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
-    prepare_render_bundle_encoder(context->wgpu_context);
+    update_scene(context->wgpu_context);
     prepared = true;
     return EXIT_SUCCESS;
   }
@@ -472,10 +805,44 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
 {
   if (imgui_overlay_header("Settings")) {
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
-    imgui_overlay_checkBox(context->imgui_overlay, "Render Bundles",
-                           &settings.render_bundles);
-    imgui_overlay_checkBox(context->imgui_overlay, "Dynamic Offsets",
-                           &settings.dynamic_offsets);
+    if (sweep.running) {
+      imgui_overlay_text("Sweeping: %s%s, %u triangles",
+                         draw_mode_names[settings.draw_mode],
+                         settings.render_bundles ? " + bundles" : "",
+                         settings.num_triangles);
+    }
+    else {
+      bool scene_changed = imgui_overlay_combo_box(
+        context->imgui_overlay, "Draw Mode", &settings.draw_mode,
+        draw_mode_names, DRAW_MODE_COUNT);
+      imgui_overlay_checkBox(context->imgui_overlay, "Render Bundles",
+                             &settings.render_bundles);
+      int32_t num_triangles = (int32_t)settings.num_triangles;
+      if (imgui_overlay_slider_int(
+            context->imgui_overlay, "Triangles", &num_triangles, 1000,
+            (int32_t)get_max_num_triangles(settings.draw_mode))) {
+        settings.num_triangles = (uint32_t)num_triangles;
+        scene_changed          = true;
+      }
+      if (scene_changed) {
+        update_scene(context->wgpu_context);
+      }
+      imgui_overlay_slider_float(context->imgui_overlay, "Target (ms)",
+                                 &settings.target_frame_ms, 1.0f, 100.0f,
+                                 "%.2f");
+      if (imgui_overlay_button(context->imgui_overlay, "Run Scaling Sweep")) {
+        sweep_start(context->wgpu_context);
+      }
+    }
+  }
+  if (imgui_overlay_header("Timings")) {
+    imgui_overlay_text("Bundle encode: %.3f ms", timings.bundle_encode_ms);
+    imgui_overlay_text("Pass encode: %.3f ms", timings.pass_encode_avg_ms);
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
   }
 }
 
@@ -489,6 +856,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
   {
     // Render pass
+    const uint64_t start_ns = platform_get_timestamp_ns();
     wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
       wgpu_context->cmd_enc, &render_pass.descriptor);
 
@@ -503,6 +871,10 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+    timings.pass_encode_ms
+      = (float)(platform_get_timestamp_ns() - start_ns) / 1000000.0f;
+    timings.pass_encode_avg_ms
+      = timings.pass_encode_avg_ms * 0.95f + timings.pass_encode_ms * 0.05f;
   }
 
   // Draw ui overlay
@@ -542,6 +914,7 @@ static int example_render(wgpu_example_context_t* context)
   if (!prepared) {
     return EXIT_FAILURE;
   }
+  sweep_update(context);
   const int draw_result = example_draw(context);
   if (!context->paused) {
     update_uniform_buffers(context);
@@ -554,20 +927,20 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
   WGPU_RELEASE_RESOURCE(Buffer, vertices.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer)
+  release_triangle_buffers();
+  free(triangles.data);
+  WGPU_RELEASE_RESOURCE(Buffer, time_buffer)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, dynamic_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, instanced_pipeline_layout)
   WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline)
   WGPU_RELEASE_RESOURCE(RenderPipeline, dynamic_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, instanced_pipeline)
   WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, time_bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, dynamic_bind_group_layout);
-  for (uint64_t i = 0; i < settings.num_triangles; ++i) {
-    WGPU_RELEASE_RESOURCE(BindGroup, bind_groups[i])
-  }
-  free(bind_groups);
-  WGPU_RELEASE_RESOURCE(BindGroup, dynamic_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, instanced_bind_group_layout);
   WGPU_RELEASE_RESOURCE(BindGroup, time_bind_group)
 }
 
@@ -576,9 +949,10 @@ void example_animometer(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title   = example_title,
-      .overlay = true,
-      .vsync   = false,
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = false,
+      .gpu_timer = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -607,6 +981,7 @@ static const char* vertex_shader_wgsl = CODE(
 
   @binding(0) @group(0) var<uniform> time : Time;
   @binding(0) @group(1) var<uniform> uniforms : Uniforms;
+  @binding(1) @group(1) var<storage, read> instances : array<Uniforms>;
 
   struct VertexOutput {
     @builtin(position) Position : vec4<f32>,
@@ -617,6 +992,23 @@ static const char* vertex_shader_wgsl = CODE(
   fn vert_main(
     @location(0) position : vec4<f32>,
     @location(1) color : vec4<f32>
+  ) -> VertexOutput {
+    return animate(uniforms, position, color);
+  }
+
+  @vertex
+  fn vert_main_instanced(
+    @builtin(instance_index) instanceIndex : u32,
+    @location(0) position : vec4<f32>,
+    @location(1) color : vec4<f32>
+  ) -> VertexOutput {
+    return animate(instances[instanceIndex], position, color);
+  }
+
+  fn animate(
+    uniforms : Uniforms,
+    position : vec4<f32>,
+    color : vec4<f32>
   ) -> VertexOutput {
     var fade = (uniforms.scalarOffset + time.value * uniforms.scalar / 10.0) % 1.0;
     if (fade < 0.5) {
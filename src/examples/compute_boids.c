@@ -35,7 +35,8 @@ static const char* update_sprites_compute_shader_wgsl;
 // Number of boid particles to simulate
 static const uint32_t NUM_PARTICLES = 1500u;
 
-// Number of single-particle calculations (invocations) in each gpu work group
+// Number of single-particle calculations (invocations) in each gpu work group,
+// used until the workgroup tuner found the fastest size for the adapter
 static const uint32_t PARTICLES_PER_GROUP = 64u;
 
 // Sim parameters
@@ -91,8 +92,8 @@ static WGPUPipelineLayout compute_pipeline_layout = NULL;
 static WGPUPipelineLayout render_pipeline_layout  = NULL;
 
 // Pipelines
-static WGPUComputePipeline compute_pipeline = NULL;
-static WGPURenderPipeline render_pipeline   = NULL;
+static wgpu_tuned_kernel_t* update_sprites_kernel = NULL;
+static WGPURenderPipeline render_pipeline         = NULL;
 
 // Bind groups and layouts
 static WGPUBindGroup particle_bind_groups[2]         = {0};
@@ -107,7 +108,6 @@ static struct {
 // Other variables
 static const char* example_title = "Compute Boids";
 static bool prepared             = false;
-static uint32_t work_group_count = 0;
 
 // Prepare vertex buffers
 static void prepare_vertices(wgpu_context_t* wgpu_context)
@@ -269,10 +269,6 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
       = wgpuDeviceCreateBindGroup(context->wgpu_context->device, &bg_desc);
     ASSERT(particle_bind_groups[i] != NULL);
   }
-
-  // Calculates number of work groups from PARTICLES_PER_GROUP constant
-  work_group_count
-    = (uint32_t)ceilf((float)NUM_PARTICLES / (float)PARTICLES_PER_GROUP);
 }
 
 static void update_sim_params(wgpu_context_t* wgpu_context)
@@ -282,8 +278,10 @@ static void update_sim_params(wgpu_context_t* wgpu_context)
 }
 
 // Create the compute & graphics pipelines
-static void prepare_pipelines(wgpu_context_t* wgpu_context)
+static void prepare_pipelines(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   // Primitive state
   WGPUPrimitiveState primitive_state = {
     .topology  = WGPUPrimitiveTopology_TriangleList,
@@ -337,15 +335,6 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     },
   };
 
-  // Compute shader
-  wgpu_shader_t boids_comp_shader = wgpu_shader_create(
-    wgpu_context, &(wgpu_shader_desc_t){
-                    // Compute shader WGSL
-                    .label            = "Update sprites compute shader",
-                    .wgsl_code.source = update_sprites_compute_shader_wgsl,
-                    .entry            = "main",
-                  });
-
   // Vertex state
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
             wgpu_context, &(wgpu_vertex_state_t){
@@ -379,15 +368,21 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
         .sample_count = 1,
       });
 
-  // Compute pipeline
-  compute_pipeline = wgpuDeviceCreateComputePipeline(
-    wgpu_context->device,
-    &(WGPUComputePipelineDescriptor){
-      .label   = "Compute boids - compute pipeline",
-      .layout  = compute_pipeline_layout,
-      .compute = boids_comp_shader.programmable_stage_descriptor,
+  // Compute pipelines, one per workgroup size candidate while tuning
+  update_sprites_kernel = wgpu_workgroup_tuner_add_kernel(
+    context->workgroup_tuner,
+    &(wgpu_tuned_kernel_desc_t){
+      .label  = "Compute boids - compute pipeline",
+      .shader = (wgpu_shader_desc_t){
+        // Compute shader WGSL
+        .label            = "Update sprites compute shader",
+        .wgsl_code.source = update_sprites_compute_shader_wgsl,
+        .entry            = "main",
+      },
+      .layout        = compute_pipeline_layout,
+      .default_value = PARTICLES_PER_GROUP,
     });
-  ASSERT(compute_pipeline != NULL);
+  ASSERT(update_sprites_kernel != NULL);
 
   // Create rendering pipeline using the specified states
   render_pipeline = wgpuDeviceCreateRenderPipeline(
@@ -402,9 +397,8 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   ASSERT(render_pipeline != NULL);
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
-  wgpu_shader_release(&boids_comp_shader);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -413,7 +407,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_vertices(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
     prepare_uniform_buffers(context);
-    prepare_pipelines(context->wgpu_context);
+    prepare_pipelines(context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return EXIT_SUCCESS;
@@ -432,6 +426,10 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
         update_sim_params(context->wgpu_context);
       }
     }
+    imgui_overlay_text(
+      "Workgroup size: %u%s",
+      wgpu_tuned_kernel_get_value(update_sprites_kernel),
+      wgpu_tuned_kernel_is_tuned(update_sprites_kernel) ? "" : " (tuning)");
   }
 }
 
@@ -446,10 +444,20 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
 
   /* Compute pass */
   {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute_pipeline);
+    wgpu_tuned_kernel_begin(update_sprites_kernel);
+    // Calculates number of work groups from the tuned workgroup size
+    const uint32_t work_group_count = (uint32_t)ceilf(
+      (float)NUM_PARTICLES
+      / (float)wgpu_tuned_kernel_get_value(update_sprites_kernel));
+    wgpu_context->cpass_enc = wgpuCommandEncoderBeginComputePass(
+      wgpu_context->cmd_enc,
+      &(WGPUComputePassDescriptor){
+        .timestampWrites
+        = wgpu_tuned_kernel_get_timestamp_writes(update_sprites_kernel),
+      });
+    wgpuComputePassEncoderSetPipeline(
+      wgpu_context->cpass_enc,
+      wgpu_tuned_kernel_get_pipeline(update_sprites_kernel));
     wgpuComputePassEncoderSetBindGroup(
       wgpu_context->cpass_enc, 0,
       particle_bind_groups[context->frame.index % 2], 0, NULL);
@@ -457,6 +465,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
                                              work_group_count, 1, 1);
     wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
     WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+    wgpu_tuned_kernel_end(update_sprites_kernel, wgpu_context->cmd_enc);
   }
 
   /* Render pass */
@@ -529,7 +538,6 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, particle_buffers[1])
   WGPU_RELEASE_RESOURCE(Buffer, sprite_vertex_buffer)
   WGPU_RELEASE_RESOURCE(RenderPipeline, render_pipeline)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, compute_pipeline)
 }
 
 void example_compute_boids(int argc, char* argv[])
@@ -537,9 +545,10 @@ void example_compute_boids(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-     .title   = example_title,
-     .overlay = true,
-     .vsync   = true,
+     .title           = example_title,
+     .overlay         = true,
+     .vsync           = true,
+     .workgroup_tuner = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -610,10 +619,16 @@ static const char* update_sprites_compute_shader_wgsl = CODE(
   @binding(1) @group(0) var<storage, read> particlesA : Particles;
   @binding(2) @group(0) var<storage, read_write> particlesB : Particles;
 
+  // Tuned per adapter by the workgroup tuner
+  override workgroup_size : u32 = 64u;
+
   // https://github.com/austinEng/Project6-Vulkan-Flocking/blob/master/data/shaders/computeparticles/particle.comp
-  @compute @workgroup_size(64)
+  @compute @workgroup_size(workgroup_size)
   fn main(@builtin(global_invocation_id) GlobalInvocationID : vec3<u32>) {
     var index = GlobalInvocationID.x;
+    if (index >= arrayLength(&particlesA.particles)) {
+      return;
+    }
 
     var vPos = particlesA.particles[index].pos;
     var vVel = particlesA.particles[index].vel;
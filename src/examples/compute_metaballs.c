@@ -163,6 +163,8 @@ static const quality_option_t QUALITIES[3] = {
 
 static quality_settings_enum _quality = QualitySettings_Low;
 
+static const char* quality_names[3] = {"Low", "Medium", "High"};
+
 static quality_option_t settings_get_quality_level(void)
 {
   return QUALITIES[_quality];
@@ -2840,8 +2842,10 @@ static void box_outline_init(box_outline_t* this)
     ASSERT(this->render_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               fragment_state.module);
   }
 }
 
@@ -3218,8 +3222,10 @@ static void ground_init(ground_t* this)
     ASSERT(this->pipeline_layouts.render_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               fragment_state.module);
   }
 
   /* Ground shadow render pipeline layout */
@@ -3320,7 +3326,8 @@ static void ground_init(ground_t* this)
     ASSERT(this->pipeline_layouts.render_shadow_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
   }
 }
 
@@ -3711,8 +3718,10 @@ static void metaballs_init(metaballs_t* this)
     ASSERT(this->pipeline_layouts.render_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               fragment_state.module);
   }
 
   /* Metaballs shadow render pipeline layout */
@@ -3799,7 +3808,8 @@ static void metaballs_init(metaballs_t* this)
     ASSERT(this->pipeline_layouts.render_shadow_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
   }
 }
 
@@ -4110,8 +4120,10 @@ static void particles_init(particles_t* this)
     ASSERT(this->render_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               fragment_state.module);
   }
 }
 
@@ -4319,8 +4331,10 @@ static void effect_init(effect_t* this, const char* fragment_shader_file,
     ASSERT(this->render_pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               vertex_state.module);
+    wgpu_release_shader_module(this->renderer->wgpu_context,
+                               fragment_state.module);
   }
 }
 
@@ -5780,10 +5794,16 @@ static struct {
   float last_frame_time;     // has seconds unit
   float dt;                  // has seconds unit
   float rearrange_countdown; // has seconds unit
+  // Quality selected in the UI, used while the quality governor is disabled
+  int32_t manual_quality;
+  // Output size relative to the surface, lowered by the quality governor
+  float render_scale;
 } example_state = {
   .last_frame_time     = 0.0f,
   .dt                  = 0.0f,
   .rearrange_countdown = 5.0f,
+  .manual_quality      = QualitySettings_Low,
+  .render_scale        = 1.0f,
 };
 
 // Other variables
@@ -5796,38 +5816,26 @@ static void example_rearrange(void)
   metaballs_rearrange(&example_state.metaballs);
 }
 
-static void init_example_state(wgpu_context_t* wgpu_context)
+/* Renderer, passes and geometry, recreated when the quality changes */
+static void init_render_state(wgpu_context_t* wgpu_context)
 {
-  const uint32_t inner_width  = wgpu_context->surface.width;
-  const uint32_t inner_height = wgpu_context->surface.height;
+  const float output_scale
+    = settings_get_quality_level().output_scale * example_state.render_scale;
 
   /* WebGPU renderer */
   webgpu_renderer_t* renderer = &example_state.renderer;
   webgpu_renderer_create(renderer, wgpu_context);
   renderer->device_pixel_ratio = 1.0f;
   renderer->output_size[0]
-    = inner_width * settings_get_quality_level().output_scale;
+    = MAX((uint32_t)(wgpu_context->surface.width * output_scale), 1u);
   renderer->output_size[1]
-    = inner_height * settings_get_quality_level().output_scale;
-
-  /* Perspective camera */
-  perspective_camera_t* persp_camera = &example_state.persp_camera;
-  perspective_camera_init(persp_camera, (45.0f * PI) / 180.0f,
-                          (float)inner_width / (float)inner_height, 0.1f,
-                          100.0f);
-  perspective_camera_set_position(persp_camera, (vec3){10.0f, 2.0f, 16.0f});
-  perspective_camera_look_at(persp_camera, GLM_VEC3_ZERO);
-
-  /* Camera controller */
-  camera_controller_create(&example_state.camera_controller, persp_camera,
-                           false, 0.1f);
-  camera_controller_look_at(&example_state.camera_controller,
-                            (vec3){0.0f, 1.0f, 0.0f});
+    = MAX((uint32_t)(wgpu_context->surface.height * output_scale), 1u);
 
   /* Initialize WebGPU renderer */
   webgpu_renderer_init(&example_state.renderer);
 
   /* Projection UBO */
+  perspective_camera_t* persp_camera = &example_state.persp_camera;
   projection_uniforms_t* projection_ubo = &renderer->ubos_data.projection_ubo;
   glm_mat4_copy(persp_camera->projection_matrix, projection_ubo->matrix);
   glm_mat4_copy(persp_camera->projection_inv_matrix,
@@ -5889,6 +5897,85 @@ static void init_example_state(wgpu_context_t* wgpu_context)
                    &deferred_pass->point_lights.lights_buffer);
 }
 
+static void destroy_render_state(void)
+{
+  webgpu_renderer_destroy(&example_state.renderer);
+  deferred_pass_destroy(&example_state.deferred_pass);
+  copy_pass_destroy(&example_state.copy_pass);
+  if (settings_get_quality_level().bloom_toggle) {
+    bloom_pass_destroy(&example_state.bloom_pass);
+  }
+  result_pass_destroy(&example_state.result_pass);
+  metaballs_destroy(&example_state.metaballs);
+  ground_destroy(&example_state.ground);
+  box_outline_destroy(&example_state.box_outline);
+  particles_destroy(&example_state.particles);
+}
+
+/* Quality level and render scale chosen by the quality governor, or the
+ * quality selected in the UI while the governor is disabled */
+static void get_target_quality(wgpu_example_context_t* context,
+                               quality_settings_enum* quality,
+                               float* render_scale)
+{
+  wgpu_quality_governor_t* governor = context->quality_governor;
+  if (governor != NULL && wgpu_quality_governor_is_enabled(governor)) {
+    *quality
+      = (quality_settings_enum)wgpu_quality_governor_get_level(governor);
+    *render_scale = wgpu_quality_governor_get_render_scale(governor);
+  }
+  else {
+    *quality      = (quality_settings_enum)example_state.manual_quality;
+    *render_scale = 1.0f;
+  }
+}
+
+static void init_example_state(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  const uint32_t inner_width   = wgpu_context->surface.width;
+  const uint32_t inner_height  = wgpu_context->surface.height;
+
+  /* Perspective camera */
+  perspective_camera_t* persp_camera = &example_state.persp_camera;
+  perspective_camera_init(persp_camera, (45.0f * PI) / 180.0f,
+                          (float)inner_width / (float)inner_height, 0.1f,
+                          100.0f);
+  perspective_camera_set_position(persp_camera, (vec3){10.0f, 2.0f, 16.0f});
+  perspective_camera_look_at(persp_camera, GLM_VEC3_ZERO);
+
+  /* Camera controller */
+  camera_controller_create(&example_state.camera_controller, persp_camera,
+                           false, 0.1f);
+  camera_controller_look_at(&example_state.camera_controller,
+                            (vec3){0.0f, 1.0f, 0.0f});
+
+  /* Quality settings */
+  quality_settings_enum quality = QualitySettings_Low;
+  get_target_quality(context, &quality, &example_state.render_scale);
+  settings_set_quality(quality);
+
+  init_render_state(wgpu_context);
+}
+
+/* Recreates the render state when the quality governor or the UI changed the
+ * quality, must be called outside of command buffer recording */
+static void update_quality(wgpu_example_context_t* context)
+{
+  quality_settings_enum quality = QualitySettings_Low;
+  float render_scale            = 1.0f;
+  get_target_quality(context, &quality, &render_scale);
+  if (quality == settings_get_quality()
+      && render_scale == example_state.render_scale) {
+    return;
+  }
+
+  destroy_render_state();
+  settings_set_quality(quality);
+  example_state.render_scale = render_scale;
+  init_render_state(context->wgpu_context);
+}
+
 static void update_uniform_buffers(wgpu_example_context_t* context)
 {
   if (context->paused) {
@@ -5933,8 +6020,6 @@ static void suppress_unused_functions(void)
 {
   UNUSED_VAR(SHADOW_MAP_SIZE);
 
-  UNUSED_FUNCTION(settings_get_quality);
-  UNUSED_FUNCTION(settings_set_quality);
   UNUSED_FUNCTION(orthographic_camera_set_position);
   UNUSED_FUNCTION(orthographic_camera_look_at);
   UNUSED_FUNCTION(orthographic_camera_init);
@@ -5953,7 +6038,7 @@ static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
     suppress_unused_functions();
-    init_example_state(context->wgpu_context);
+    init_example_state(context);
     prepared = true;
     return 0;
   }
@@ -5973,6 +6058,34 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
         example_state.deferred_pass.point_lights.lights_count);
     }
   }
+  if (imgui_overlay_header("Quality")) {
+    /* The render state is recreated by update_quality() on the next frame */
+    wgpu_quality_governor_t* governor = context->quality_governor;
+    bool auto_quality
+      = governor != NULL && wgpu_quality_governor_is_enabled(governor);
+    if (governor != NULL
+        && imgui_overlay_checkBox(context->imgui_overlay, "Auto Quality",
+                                  &auto_quality)) {
+      wgpu_quality_governor_set_enabled(governor, auto_quality);
+    }
+    if (auto_quality) {
+      float target_ms = wgpu_quality_governor_get_target_ms(governor);
+      if (imgui_overlay_slider_float(context->imgui_overlay, "Target (ms)",
+                                     &target_ms, 4.0f, 33.0f, "%.1f")) {
+        wgpu_quality_governor_set_target_ms(governor, target_ms);
+      }
+      imgui_overlay_text("GPU: %.2f ms (avg)",
+                         wgpu_quality_governor_get_average_ms(governor));
+      imgui_overlay_text("Level: %s, scale %.3f",
+                         quality_names[settings_get_quality()],
+                         example_state.render_scale);
+    }
+    else {
+      imgui_overlay_combo_box(context->imgui_overlay, "Quality",
+                              &example_state.manual_quality, quality_names,
+                              (uint32_t)ARRAY_SIZE(quality_names));
+    }
+  }
 }
 
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
@@ -6123,6 +6236,7 @@ static int example_render(wgpu_example_context_t* context)
   if (!prepared) {
     return 1;
   }
+  update_quality(context);
   const int draw_result = example_draw(context);
   camera_controller_handle_input_events(&example_state.camera_controller,
                                         context);
@@ -6136,17 +6250,7 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
 
-  webgpu_renderer_destroy(&example_state.renderer);
-  deferred_pass_destroy(&example_state.deferred_pass);
-  copy_pass_destroy(&example_state.copy_pass);
-  if (settings_get_quality_level().bloom_toggle) {
-    bloom_pass_destroy(&example_state.bloom_pass);
-  }
-  result_pass_destroy(&example_state.result_pass);
-  metaballs_destroy(&example_state.metaballs);
-  ground_destroy(&example_state.ground);
-  box_outline_destroy(&example_state.box_outline);
-  particles_destroy(&example_state.particles);
+  destroy_render_state();
 }
 
 void example_compute_metaballs(int argc, char* argv[])
@@ -6154,9 +6258,11 @@ void example_compute_metaballs(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title   = example_title,
-      .overlay = true,
-      .vsync   = true,
+      .title            = example_title,
+      .overlay          = true,
+      .vsync            = true,
+      .quality_governor = true,
+      .quality_levels   = (uint32_t)ARRAY_SIZE(QUALITIES),
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -0,0 +1,268 @@
+#include "example_base.h"
+
+#include <string.h>
+
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/particle_system.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - GPU Particle Emitter
+ *
+ * This example shows how to use the GPU particle system module: particles are
+ * continuously emitted, simulated and retired on the GPU. Emission and
+ * compaction of the live particles use atomics, dispatch and draw sizes are
+ * written by the GPU and consumed with indirect dispatches / draws, so the
+ * cost follows the number of live particles instead of the capacity. The
+ * particles can be depth sorted for alpha blending or blended additively,
+ * and stored with half precision where the device supports f16 in shaders.
+ * -------------------------------------------------------------------------- */
+
+#define PARTICLE_CAPACITY (1024u * 1024u)
+
+// Particle system and emitter
+static wgpu_particle_system_t* particle_system = NULL;
+static wgpu_particle_emitter_t emitter         = {
+  .position        = {0.0f, 0.0f, 0.0f},
+  .radius          = 0.05f,
+  .velocity        = {0.0f, 3.0f, 0.0f},
+  .velocity_spread = 0.6f,
+  .gravity         = {0.0f, -2.5f, 0.0f},
+  .drag            = 0.1f,
+  .rate            = 100000.0f,
+  .lifetime_min    = 1.5f,
+  .lifetime_max    = 3.0f,
+  .size            = 0.015f,
+  .color_begin     = {1.0f, 0.7f, 0.2f, 1.0f},
+  .color_end       = {0.8f, 0.1f, 0.4f, 0.0f},
+};
+
+// Settings
+static struct {
+  bool sort;
+  bool half_precision;
+  int32_t burst_count;
+} settings = {
+  .sort           = false,
+  .half_precision = false,
+  .burst_count    = 50000,
+};
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass = {0};
+
+// Other variables
+static const char* example_title = "GPU Particle Emitter";
+static bool prepared             = false;
+
+static void setup_camera(wgpu_example_context_t* context)
+{
+  context->camera       = camera_create();
+  context->camera->type = CameraType_LookAt;
+  camera_set_position(context->camera, (vec3){0.0f, -1.0f, -5.0f});
+  camera_set_rotation(context->camera, (vec3){-15.0f, 0.0f, 0.0f});
+  camera_set_perspective(context->camera, 60.0f,
+                         context->window_size.aspect_ratio, 0.1f, 256.0f);
+}
+
+static void prepare_particle_system(wgpu_context_t* wgpu_context)
+{
+  wgpu_particle_system_destroy(particle_system);
+  particle_system = wgpu_particle_system_create(
+    wgpu_context, &(wgpu_particle_system_desc_t){
+                    .capacity       = PARTICLE_CAPACITY,
+                    .color_format   = wgpu_context->swap_chain.format,
+                    .depth_format   = WGPUTextureFormat_Depth24PlusStencil8,
+                    .sort           = settings.sort,
+                    .half_precision = settings.half_precision,
+                  });
+  wgpu_particle_system_set_emitter(particle_system, &emitter);
+}
+
+static void setup_render_pass(wgpu_context_t* wgpu_context)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, /* Assigned later */
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor) {
+        .r = 0.025f,
+        .g = 0.025f,
+        .b = 0.025f,
+        .a = 1.0f,
+      },
+  };
+
+  // Depth attachment
+  wgpu_setup_deph_stencil(wgpu_context, NULL);
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .label                  = "Render pass descriptor",
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    setup_camera(context);
+    prepare_particle_system(context->wgpu_context);
+    setup_render_pass(context->wgpu_context);
+    prepared = true;
+    return EXIT_SUCCESS;
+  }
+
+  return EXIT_FAILURE;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    if (imgui_overlay_checkBox(context->imgui_overlay, "Depth Sort",
+                               &settings.sort)) {
+      prepare_particle_system(context->wgpu_context);
+    }
+    if (wgpu_has_feature(context->wgpu_context, WGPUFeatureName_ShaderF16)
+        && imgui_overlay_checkBox(context->imgui_overlay, "Half Precision",
+                                  &settings.half_precision)) {
+      prepare_particle_system(context->wgpu_context);
+    }
+    bool emitter_changed = imgui_overlay_slider_float(
+      context->imgui_overlay, "Emission Rate", &emitter.rate, 0.0f, 500000.0f,
+      "%.0f");
+    emitter_changed |= imgui_overlay_slider_float(
+      context->imgui_overlay, "Lifetime", &emitter.lifetime_max, 0.5f, 10.0f,
+      "%.1f");
+    emitter_changed |= imgui_overlay_slider_float(
+      context->imgui_overlay, "Spread", &emitter.velocity_spread, 0.0f, 3.0f,
+      "%.2f");
+    if (emitter_changed) {
+      emitter.lifetime_min = MIN(emitter.lifetime_min, emitter.lifetime_max);
+      wgpu_particle_system_set_emitter(particle_system, &emitter);
+    }
+    imgui_overlay_slider_int(context->imgui_overlay, "Burst Count",
+                             &settings.burst_count, 1000, 500000);
+    if (imgui_overlay_button(context->imgui_overlay, "Burst")) {
+      wgpu_particle_system_burst(particle_system,
+                                 (uint32_t)settings.burst_count);
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text(
+      "Live: %u / %u", wgpu_particle_system_get_live_count(particle_system),
+      wgpu_particle_system_get_capacity(particle_system));
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+  }
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  camera_t* camera             = context->camera;
+
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Emit, simulate and sort the particles
+  mat4 inverse_view = GLM_MAT4_IDENTITY_INIT;
+  glm_mat4_inv(camera->matrices.view, inverse_view);
+  wgpu_particle_system_update(
+    particle_system, wgpu_context->cmd_enc,
+    context->paused ? 0.0f : MIN(context->frame_timer, 0.1f), inverse_view[3]);
+
+  // Render pass
+  {
+    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &render_pass.descriptor);
+    wgpu_particle_system_draw(particle_system, wgpu_context->rpass_enc,
+                              camera->matrices.view,
+                              camera->matrices.perspective);
+    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  }
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit command buffer to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return EXIT_SUCCESS;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return EXIT_FAILURE;
+  }
+  return example_draw(context);
+}
+
+static void example_on_view_changed(wgpu_example_context_t* context)
+{
+  camera_update_aspect_ratio(context->camera,
+                             context->window_size.aspect_ratio);
+}
+
+// Clean up used resources
+static void example_destroy(wgpu_example_context_t* context)
+{
+  camera_release(context->camera);
+  wgpu_particle_system_destroy(particle_system);
+  particle_system = NULL;
+}
+
+void example_compute_particles_emitter(int argc, char* argv[])
+{
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = true,
+      .gpu_timer = true,
+    },
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_on_view_changed_func = &example_on_view_changed,
+  });
+  // clang-format on
+}
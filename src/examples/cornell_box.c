@@ -3,81 +3,42 @@
 #include <string.h>
 
 #include "../webgpu/imgui_overlay.h"
+#include "../webgpu/wgsl_preprocessor.h"
+
+#include <stb_image_write.h>
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Cornell Box
  *
  * A classic Cornell box, using a lightmap generated using software ray-tracing.
+ * The number of photons traced per frame follows a GPU frame time budget and
+ * photon tracing stops once the lightmap has converged, after which the
+ * lightmap can be baked to disk.
  *
  * Ref:
  * https://github.com/webgpu/webgpu-samples/tree/main/src/sample/cornell
  * -------------------------------------------------------------------------- */
 
 /* -------------------------------------------------------------------------- *
- * Shader store
+ * Shader code
  * -------------------------------------------------------------------------- */
 
 #define PRESENTATION_FORMAT "bgra8unorm"
 
-typedef struct {
-  const char* filename;
-  file_read_result_t read_result;
-} shader_store_entry;
-
-static struct {
-  shader_store_entry common;
-  shader_store_entry radiosity;
-  shader_store_entry rasterizer;
-  shader_store_entry raytracer;
-  shader_store_entry tonemapper;
-} shader_store = {
-  .common.filename     = "shaders/cornell_box/common.wgsl",
-  .radiosity.filename  = "shaders/cornell_box/radiosity.wgsl",
-  .rasterizer.filename = "shaders/cornell_box/rasterizer.wgsl",
-  .raytracer.filename  = "shaders/cornell_box/raytracer.wgsl",
-  .tonemapper.filename = "shaders/cornell_box/tonemapper.wgsl",
-};
-
-static void initialize_shader_store_entry(shader_store_entry* entry)
-{
-  read_file(entry->filename, &entry->read_result, true);
-  log_debug("Read file: %s, size: %d bytes\n", entry->filename,
-            entry->read_result.size);
-  ASSERT(entry->read_result.size > 0);
-}
-
-static void create_shader_store(void)
+/* Returns the WGSL code of a stage file prefixed with common.wgsl, holding the
+ * WGSL shared between the shaders. Must be released with free(). */
+static char* load_shader_code(const char* stage_filename)
 {
-  initialize_shader_store_entry(&shader_store.common);
-  initialize_shader_store_entry(&shader_store.radiosity);
-  initialize_shader_store_entry(&shader_store.rasterizer);
-  initialize_shader_store_entry(&shader_store.raytracer);
-  initialize_shader_store_entry(&shader_store.tonemapper);
-}
-
-static void destroy_shader_store_entry(shader_store_entry* entry)
-{
-  if (entry->read_result.size > 0) {
-    free(entry->read_result.data);
-    entry->read_result.size = 0;
-  }
-}
-
-static void destroy_shader_store(void)
-{
-  destroy_shader_store_entry(&shader_store.common);
-  destroy_shader_store_entry(&shader_store.radiosity);
-  destroy_shader_store_entry(&shader_store.rasterizer);
-  destroy_shader_store_entry(&shader_store.raytracer);
-  destroy_shader_store_entry(&shader_store.tonemapper);
-}
-
-static void concat_shader_store_entries(shader_store_entry* e1,
-                                        shader_store_entry* e2, char** dst)
-{
-  uint32_t total_size = e1->read_result.size + 1 + e2->read_result.size + 1;
-  *dst                = malloc(total_size);
-  sprintf(*dst, "%s\n%s%c", e1->read_result.data, e2->read_result.data, '\0');
+  char source[128];
+  snprintf(source, sizeof(source), "#include \"common.wgsl\"\n"
+                                   "#include \"%s\"\n",
+           stage_filename);
+  char* wgsl_code = wgpu_wgsl_preprocess(&(wgpu_wgsl_preprocess_desc_t){
+    .source      = source,
+    .include_dir = "shaders/cornell_box",
+  });
+  ASSERT(wgsl_code != NULL);
+  return wgsl_code;
 }
 
 /* -------------------------------------------------------------------------- *
@@ -729,8 +690,97 @@ typedef struct {
   // The maximum value of 'accumulationAverage' before all values in
   // 'accumulation' are reduced to avoid integer overflows.
   uint32_t accumulation_mean_max;
+  // Total number of photons traced since the last restart.
+  uint64_t total_photons;
+  // Frame time budget controller, scales 'workgroups_per_frame' so that the
+  // GPU frame time approaches 'target_ms'. It is frozen while converged, as
+  // the frames without photon tracing say nothing about the tracing cost.
+  struct {
+    bool enabled;
+    float target_ms;
+    uint32_t min_workgroups_per_frame;
+    uint32_t max_workgroups_per_frame;
+    // GPU timer frame count at the last adjustment.
+    uint64_t frame_count;
+    // Number of measurements ignored after a restart, they lag behind and
+    // still time frames of the converged state.
+    uint32_t settle_frames;
+    uint32_t frames_to_settle;
+  } budget;
+  // Convergence detection: every 'check_interval' frames the relative change
+  // of a subsampled lightmap since the previous check is measured on the GPU
+  // and read back. Photon tracing stops once the change drops below
+  // 'threshold'.
+  struct {
+    WGPUComputePipeline pipeline;
+    WGPUBindGroup bind_group;
+    wgpu_buffer_t uniform_buffer;
+    wgpu_buffer_t snapshot_buffer;
+    wgpu_buffer_t result_buffer;
+    // Texel stride of the lightmap subsampling in x and y.
+    uint32_t subsample;
+    uint32_t check_interval;
+    uint32_t frames_since_check;
+    float threshold;
+    // Relative change measured by the last check.
+    float delta;
+    // Bumped by every restart, a readback of an older generation measured
+    // the lightmap before the restart and is ignored.
+    uint32_t generation;
+    uint32_t readback_generation;
+    bool readback_pending;
+    bool converged;
+  } convergence;
+  // Lightmap bake to disk
+  struct {
+    const char* filename;
+    float accumulation_to_lightmap_scale;
+    bool pending;
+  } bake;
 } radiosity_t;
 
+// Measures the change of the subsampled lightmap since the previous check.
+// clang-format off
+static const char* radiosity_delta_shader_wgsl = CODE(
+  struct DeltaUniforms {
+    accumulation_to_lightmap_scale : f32,
+    subsample : u32,
+    lightmap_width : u32,
+    lightmap_height : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> uniforms : DeltaUniforms;
+  @group(0) @binding(1) var<storage, read> accumulation : array<u32>;
+  @group(0) @binding(2) var<storage, read_write> snapshot : array<f32>;
+  // [0]: sum of the absolute changes, [1]: sum of the values (fixed point)
+  @group(0) @binding(3) var<storage, read_write> result : array<atomic<u32>, 2>;
+
+  const FixedPointScale = 4096.0;
+  const MaxValue = 4.0;
+
+  @compute @workgroup_size(8, 8)
+  fn lightmap_delta(@builtin(global_invocation_id) id : vec3u) {
+    let size = vec2u(uniforms.lightmap_width, uniforms.lightmap_height)
+               / uniforms.subsample;
+    if (any(id.xy >= size)) {
+      return;
+    }
+    // Must match accumulation_base_index() in radiosity.wgsl
+    let coord = id.xy * uniforms.subsample;
+    let base = 3u * (coord.x + uniforms.lightmap_width
+                     * (coord.y + uniforms.lightmap_height * id.z));
+    let value = (f32(accumulation[base + 0u]) + f32(accumulation[base + 1u])
+                 + f32(accumulation[base + 2u]))
+                * uniforms.accumulation_to_lightmap_scale;
+    let index = id.x + size.x * (id.y + size.y * id.z);
+    let delta = abs(value - snapshot[index]);
+    snapshot[index] = value;
+    atomicAdd(&result[0], u32(min(delta, MaxValue) * FixedPointScale));
+    atomicAdd(&result[1], u32(min(value, MaxValue) * FixedPointScale));
+  }
+);
+// clang-format on
+
 static void radiosity_init_defaults(radiosity_t* this)
 {
   memset(this, 0, sizeof(*this));
@@ -751,6 +801,19 @@ static void radiosity_init_defaults(radiosity_t* this)
 
   this->accumulation_mean     = 0.0f;
   this->accumulation_mean_max = 0x10000000;
+
+  this->budget.enabled                  = true;
+  this->budget.target_ms                = 8.0f;
+  this->budget.min_workgroups_per_frame = 16;
+  this->budget.max_workgroups_per_frame = 8192;
+  this->budget.settle_frames            = 4;
+
+  this->convergence.subsample      = 4;
+  this->convergence.check_interval = 30;
+  this->convergence.threshold      = 0.002f;
+  this->convergence.delta          = 1.0f;
+
+  this->bake.filename = "cornell_box_lightmap.hdr";
 }
 
 static void radiosity_create(radiosity_t* this, wgpu_context_t* wgpu_context,
@@ -824,7 +887,9 @@ static void radiosity_create(radiosity_t* this, wgpu_context_t* wgpu_context,
                             .label = "Radiosity accumulation buffer",
                             .size = this->lightmap_width * this->lightmap_height
                                     * this->scene->quads_length * 16,
-                            .usage = WGPUBufferUsage_Storage,
+                            .usage = WGPUBufferUsage_Storage
+                                     | WGPUBufferUsage_CopySrc
+                                     | WGPUBufferUsage_CopyDst,
                           });
     this->total_lightmap_texels = this->lightmap_width * this->lightmap_height
                                   * this->scene->quads_length;
@@ -934,9 +999,7 @@ static void radiosity_create(radiosity_t* this, wgpu_context_t* wgpu_context,
   }
 
   /* Compute shader */
-  char* wgsl_code = {0};
-  concat_shader_store_entries(&shader_store.common, &shader_store.radiosity,
-                              &wgsl_code);
+  char* wgsl_code = load_shader_code("radiosity.wgsl");
 
   /* Radiosity compute pipeline */
   {
@@ -1017,6 +1080,79 @@ static void radiosity_create(radiosity_t* this, wgpu_context_t* wgpu_context,
 
   /* Cleanup */
   free(wgsl_code);
+
+  /* Convergence detection */
+  {
+    const uint32_t subsample = this->convergence.subsample;
+    const uint32_t snapshot_texels = (this->lightmap_width / subsample)
+                                     * (this->lightmap_height / subsample)
+                                     * this->lightmap_depth_or_array_layers;
+    this->convergence.uniform_buffer = wgpu_create_buffer(
+      this->wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Radiosity delta uniform buffer",
+        .size  = 4 * 4, /* f32 + 3 x u32 */
+        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+      });
+    this->convergence.snapshot_buffer = wgpu_create_buffer(
+      this->wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Radiosity lightmap snapshot buffer",
+        .size  = snapshot_texels * sizeof(float),
+        .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst,
+      });
+    this->convergence.result_buffer = wgpu_create_buffer(
+      this->wgpu_context, &(wgpu_buffer_desc_t){
+                            .label = "Radiosity delta result buffer",
+                            .size  = 2 * sizeof(uint32_t),
+                            .usage = WGPUBufferUsage_Storage
+                                     | WGPUBufferUsage_CopySrc
+                                     | WGPUBufferUsage_CopyDst,
+                          });
+
+    WGPUShaderModule shader_module = wgpu_create_shader_module(
+      wgpu_context, &(wgpu_shader_desc_t){
+                      .wgsl_code.source = radiosity_delta_shader_wgsl,
+                    });
+    this->convergence.pipeline = wgpuDeviceCreateComputePipeline(
+      wgpu_context->device, &(WGPUComputePipelineDescriptor){
+                              .label   = "Radiosity lightmap delta pipeline",
+                              .compute = {
+                                .module     = shader_module,
+                                .entryPoint = "lightmap_delta",
+                              },
+                            });
+    ASSERT(this->convergence.pipeline != NULL);
+    wgpu_release_shader_module(wgpu_context, shader_module);
+
+    const wgpu_buffer_t* buffers[4] = {
+      &this->convergence.uniform_buffer,  /* Binding 0 */
+      &this->accumulation_buffer,         /* Binding 1 */
+      &this->convergence.snapshot_buffer, /* Binding 2 */
+      &this->convergence.result_buffer,   /* Binding 3 */
+    };
+    WGPUBindGroupEntry bg_entries[4] = {0};
+    for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(bg_entries); ++i) {
+      bg_entries[i] = (WGPUBindGroupEntry){
+        .binding = i,
+        .buffer  = buffers[i]->buffer,
+        .offset  = 0,
+        .size    = buffers[i]->size,
+      };
+    }
+    this->convergence.bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .label  = "Radiosity lightmap delta bind group",
+        .layout = wgpuComputePipelineGetBindGroupLayout(
+          this->convergence.pipeline, 0),
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(this->convergence.bind_group != NULL);
+  }
+
+  wgpu_create_readback(wgpu_context);
 }
 
 static void radiosity_destroy(radiosity_t* this)
@@ -1030,12 +1166,152 @@ static void radiosity_destroy(radiosity_t* this)
   WGPU_RELEASE_RESOURCE(BindGroup, this->bind_group)
   WGPU_RELEASE_RESOURCE(Buffer, this->accumulation_buffer.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, this->uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, this->convergence.pipeline)
+  WGPU_RELEASE_RESOURCE(BindGroup, this->convergence.bind_group)
+  WGPU_RELEASE_RESOURCE(Buffer, this->convergence.uniform_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->convergence.snapshot_buffer.buffer)
+  WGPU_RELEASE_RESOURCE(Buffer, this->convergence.result_buffer.buffer)
+}
+
+/* Restarts the photon tracing from an empty accumulation buffer */
+static void radiosity_restart(radiosity_t* this,
+                              WGPUCommandEncoder command_encoder)
+{
+  wgpuCommandEncoderClearBuffer(command_encoder,
+                                this->accumulation_buffer.buffer, 0,
+                                this->accumulation_buffer.size);
+  wgpuCommandEncoderClearBuffer(command_encoder,
+                                this->convergence.snapshot_buffer.buffer, 0,
+                                this->convergence.snapshot_buffer.size);
+  this->accumulation_mean              = 0.0f;
+  this->total_photons                  = 0;
+  this->convergence.frames_since_check = 0;
+  this->convergence.delta              = 1.0f;
+  this->convergence.converged          = false;
+  this->budget.frames_to_settle        = this->budget.settle_frames;
+  /* Invalidates the delta readback still in flight */
+  ++this->convergence.generation;
+}
+
+/* Scales the photons traced per frame to the GPU frame time budget */
+static void radiosity_update_budget(radiosity_t* this,
+                                    wgpu_gpu_timer_t* gpu_timer)
+{
+  if (!this->budget.enabled || this->convergence.converged
+      || gpu_timer == NULL || !wgpu_gpu_timer_is_supported(gpu_timer)) {
+    return;
+  }
+
+  /* Only adjust once per new GPU frame time measurement */
+  wgpu_gpu_timer_stats_t stats = {0};
+  wgpu_gpu_timer_get_stats(gpu_timer, &stats);
+  if (stats.frame_count == this->budget.frame_count) {
+    return;
+  }
+  this->budget.frame_count = stats.frame_count;
+  if (this->budget.frames_to_settle > 0) {
+    --this->budget.frames_to_settle;
+    return;
+  }
+
+  /* The measurement lags a few frames behind, limit the step size to avoid
+   * oscillating around the target */
+  const float frame_ms = MAX(wgpu_gpu_timer_get_frame_ms(gpu_timer), 0.01f);
+  const float ratio
+    = MIN(MAX(this->budget.target_ms / frame_ms, 0.5f), 1.5f);
+  const float workgroups = (float)this->workgroups_per_frame * ratio;
+  this->workgroups_per_frame
+    = MIN(MAX((uint32_t)(workgroups + 0.5f),
+              this->budget.min_workgroups_per_frame),
+          this->budget.max_workgroups_per_frame);
+}
+
+static void radiosity_delta_readback_cb(const wgpu_readback_result_t* result,
+                                        void* user_data)
+{
+  radiosity_t* this                  = (radiosity_t*)user_data;
+  this->convergence.readback_pending = false;
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS
+      || result->size < 2 * sizeof(uint32_t)
+      || this->convergence.readback_generation
+           != this->convergence.generation) {
+    return;
+  }
+
+  uint32_t sums[2] = {0};
+  memcpy(sums, result->data, sizeof(sums));
+  this->convergence.delta = (float)sums[0] / (float)MAX(sums[1], 1u);
+  if (!this->convergence.converged
+      && this->convergence.delta < this->convergence.threshold) {
+    this->convergence.converged = true;
+    log_info("Radiosity converged after %llu photons",
+             (unsigned long long)this->total_photons);
+  }
+}
+
+static void radiosity_bake_readback_cb(const wgpu_readback_result_t* result,
+                                       void* user_data)
+{
+  radiosity_t* this  = (radiosity_t*)user_data;
+  this->bake.pending = false;
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS) {
+    log_error("Radiosity: lightmap readback failed");
+    return;
+  }
+
+  /* The lightmap layers are stacked vertically into a single image */
+  const uint32_t width  = this->lightmap_width;
+  const uint32_t height = this->lightmap_height
+                          * this->lightmap_depth_or_array_layers;
+  const uint64_t count  = (uint64_t)width * height * 3;
+  ASSERT(result->size >= count * sizeof(uint32_t));
+  const uint32_t* accumulation = (const uint32_t*)result->data;
+  float* texels                = (float*)malloc(count * sizeof(float));
+  for (uint64_t i = 0; i < count; ++i) {
+    texels[i]
+      = (float)accumulation[i] * this->bake.accumulation_to_lightmap_scale;
+  }
+  if (stbi_write_hdr(this->bake.filename, (int)width, (int)height, 3,
+                     texels)) {
+    log_info("Radiosity: lightmap baked to %s", this->bake.filename);
+  }
+  else {
+    log_error("Radiosity: could not write %s", this->bake.filename);
+  }
+  free(texels);
+}
+
+/* Reads the current lightmap back and writes it to disk as Radiance HDR */
+static void radiosity_bake(radiosity_t* this,
+                           WGPUCommandEncoder command_encoder)
+{
+  if (this->bake.pending || this->accumulation_mean <= 0.0f) {
+    return;
+  }
+  this->bake.accumulation_to_lightmap_scale = 1.0f / this->accumulation_mean;
+  this->bake.pending                        = wgpu_readback_copy_buffer(
+    this->wgpu_context->readback, command_encoder,
+    &(wgpu_readback_buffer_desc_t){
+      .buffer   = this->accumulation_buffer.buffer,
+      .size     = (uint64_t)this->total_lightmap_texels * 3 * sizeof(uint32_t),
+      .callback = radiosity_bake_readback_cb,
+      .userdata = this,
+    });
 }
 
 static void radiosity_run(radiosity_t* this, WGPUCommandEncoder command_encoder)
 {
   wgpu_context_t* wgpu_context = this->wgpu_context;
 
+  // Once converged the lightmap is final, nothing left to do
+  if (this->convergence.converged) {
+    return;
+  }
+
+  this->photons_per_frame
+    = this->photons_per_workgroup * this->workgroups_per_frame;
+  this->total_photons += this->photons_per_frame;
+
   // Calculate the new mean value for the accumulation buffer
   this->accumulation_mean += (this->photons_per_frame * this->photon_energy)
                              / (float)this->total_lightmap_texels;
@@ -1062,6 +1338,17 @@ static void radiosity_run(radiosity_t* this, WGPUCommandEncoder command_encoder)
   wgpu_queue_write_buffer(wgpu_context, this->uniform_buffer.buffer, 0,
                           &uniform_data_f32[0], sizeof(uniform_data_f32));
 
+  // Periodically check for convergence, the sums are accumulated from zero
+  const bool check_convergence
+    = ++this->convergence.frames_since_check >= this->convergence.check_interval
+      && !this->convergence.readback_pending
+      && wgpu_readback_can_accept(wgpu_context->readback);
+  if (check_convergence) {
+    wgpuCommandEncoderClearBuffer(command_encoder,
+                                  this->convergence.result_buffer.buffer, 0,
+                                  this->convergence.result_buffer.size);
+  }
+
   // Dispatch the radiosity workgroups
   wgpu_context->cpass_enc
     = wgpuCommandEncoderBeginComputePass(command_encoder, NULL);
@@ -1084,8 +1371,48 @@ static void radiosity_run(radiosity_t* this, WGPUCommandEncoder command_encoder)
     ceil(this->lightmap_height
          / (float)this->accumulation_to_lightmap_workgroup_size_y),
     this->lightmap_depth_or_array_layers);
+
+  // Then measure how much the lightmap changed since the last check
+  if (check_convergence) {
+    const uint32_t subsample = this->convergence.subsample;
+    const struct {
+      float accumulation_to_lightmap_scale;
+      uint32_t subsample;
+      uint32_t lightmap_width;
+      uint32_t lightmap_height;
+    } delta_uniforms = {
+      .accumulation_to_lightmap_scale = 1.0f / this->accumulation_mean,
+      .subsample                      = subsample,
+      .lightmap_width                 = this->lightmap_width,
+      .lightmap_height                = this->lightmap_height,
+    };
+    wgpu_queue_write_buffer(wgpu_context,
+                            this->convergence.uniform_buffer.buffer, 0,
+                            &delta_uniforms, sizeof(delta_uniforms));
+    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
+                                      this->convergence.pipeline);
+    wgpuComputePassEncoderSetBindGroup(wgpu_context->cpass_enc, 0,
+                                       this->convergence.bind_group, 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      wgpu_context->cpass_enc, (this->lightmap_width / subsample + 7) / 8,
+      (this->lightmap_height / subsample + 7) / 8,
+      this->lightmap_depth_or_array_layers);
+  }
   wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
   WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+
+  if (check_convergence) {
+    this->convergence.frames_since_check  = 0;
+    this->convergence.readback_generation = this->convergence.generation;
+    this->convergence.readback_pending    = wgpu_readback_copy_buffer(
+      wgpu_context->readback, command_encoder,
+      &(wgpu_readback_buffer_desc_t){
+        .buffer   = this->convergence.result_buffer.buffer,
+        .size     = this->convergence.result_buffer.size,
+        .callback = radiosity_delta_readback_cb,
+        .userdata = this,
+      });
+  }
 }
 
 /* --------------------------------------------------------------------------
@@ -1292,9 +1619,7 @@ static void rasterizer_create(rasterizer_t* this, wgpu_context_t* wgpu_context,
     depth_stencil_state_desc.depthCompare = WGPUCompareFunction_Less;
 
     // Shader code
-    char* wgsl_code = {0};
-    concat_shader_store_entries(&shader_store.common, &shader_store.rasterizer,
-                                &wgsl_code);
+    char* wgsl_code = load_shader_code("rasterizer.wgsl");
 
     // Vertex state
     WGPUVertexState vertex_state_desc = wgpu_create_vertex_state(
@@ -1344,8 +1669,8 @@ static void rasterizer_create(rasterizer_t* this, wgpu_context_t* wgpu_context,
 
     // Shader modules are no longer needed once the graphics pipeline has
     // been created
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
     free(wgsl_code);
   }
 }
@@ -1520,9 +1845,7 @@ static void raytracer_create(raytracer_t* this, wgpu_context_t* wgpu_context,
     };
 
     /* Compute shader */
-    char* wgsl_code = {0};
-    concat_shader_store_entries(&shader_store.common, &shader_store.raytracer,
-                                &wgsl_code);
+    char* wgsl_code = load_shader_code("raytracer.wgsl");
     wgpu_shader_t raytracer_comp_shader = wgpu_shader_create(
       wgpu_context, &(wgpu_shader_desc_t){
                       // Compute shader WGSL
@@ -1701,9 +2024,7 @@ static void tonemapper_create(tonemapper_t* this, wgpu_context_t* wgpu_context,
     };
 
     /* Compute shader */
-    char* wgsl_code = {0};
-    concat_shader_store_entries(&shader_store.common, &shader_store.tonemapper,
-                                &wgsl_code);
+    char* wgsl_code = load_shader_code("tonemapper.wgsl");
     wgpu_shader_t tonemapper_comp_shader = wgpu_shader_create(
       wgpu_context, &(wgpu_shader_desc_t){
                       // Compute shader WGSL
@@ -1948,8 +2269,8 @@ static void result_renderer_create(result_renderer_t* this,
     ASSERT(this->pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state.module);
   }
 }
 
@@ -2023,6 +2344,8 @@ typedef enum {
 static struct {
   renderer_t renderer;
   bool rotate_camera;
+  bool restart_radiosity;
+  bool bake_lightmap;
 } example_parms = {
   .renderer      = Renderer_Rasterizer,
   .rotate_camera = true,
@@ -2100,7 +2423,6 @@ static void create_frame_buffer(wgpu_context_t* wgpu_context,
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
-    create_shader_store();
     create_frame_buffer(context->wgpu_context, &example.frame_buffer.input,
                         WGPUTextureFormat_RGBA16Float);
     create_frame_buffer(context->wgpu_context, &example.frame_buffer.output,
@@ -2141,10 +2463,39 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     imgui_overlay_checkBox(context->imgui_overlay, "Rotate Camera",
                            &example_parms.rotate_camera);
   }
+  if (imgui_overlay_header("Radiosity")) {
+    radiosity_t* radiosity = &example.radiosity;
+    imgui_overlay_checkBox(context->imgui_overlay, "Frame Budget",
+                           &radiosity->budget.enabled);
+    imgui_overlay_slider_float(context->imgui_overlay, "Target (ms)",
+                               &radiosity->budget.target_ms, 1.0f, 33.0f,
+                               "%.1f");
+    imgui_overlay_text("Photons / frame: %u",
+                       radiosity->convergence.converged ?
+                         0 :
+                         radiosity->photons_per_frame);
+    imgui_overlay_text("Total photons: %.1f M",
+                       (double)radiosity->total_photons / 1000000.0);
+    imgui_overlay_text("Lightmap delta: %.4f", radiosity->convergence.delta);
+    imgui_overlay_text("%s", radiosity->convergence.converged ? "Converged" :
+                                                                "Converging");
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+    if (imgui_overlay_button(context->imgui_overlay, "Restart")) {
+      example_parms.restart_radiosity = true;
+    }
+    if (imgui_overlay_button(context->imgui_overlay, "Bake Lightmap")) {
+      example_parms.bake_lightmap = true;
+    }
+  }
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
   WGPUTextureView frame_buffer = wgpu_context->swap_chain.frame_buffer;
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
@@ -2157,8 +2508,17 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
                             / (float)wgpu_context->surface.height,
                 });
 
-  /* Software raytracing */
+  /* Software raytracing, within the frame time budget until converged */
+  if (example_parms.restart_radiosity) {
+    radiosity_restart(&example.radiosity, wgpu_context->cmd_enc);
+    example_parms.restart_radiosity = false;
+  }
+  radiosity_update_budget(&example.radiosity, context->gpu_timer);
   radiosity_run(&example.radiosity, wgpu_context->cmd_enc);
+  if (example_parms.bake_lightmap) {
+    radiosity_bake(&example.radiosity, wgpu_context->cmd_enc);
+    example_parms.bake_lightmap = false;
+  }
 
   switch (example_parms.renderer) {
     case Renderer_Rasterizer: {
@@ -2196,8 +2556,7 @@ static int example_draw(wgpu_example_context_t* context)
   // Command buffer to be submitted to the queue
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
-  wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
 
   // Submit command buffer to queue
   submit_command_buffers(context);
@@ -2224,7 +2583,6 @@ static void example_destroy(wgpu_example_context_t* context)
 {
   UNUSED_VAR(context);
 
-  destroy_shader_store();
   wgpu_destroy_texture(&example.frame_buffer.input);
   wgpu_destroy_texture(&example.frame_buffer.output);
   result_renderer_destroy(&example.result_renderer);
@@ -2241,9 +2599,10 @@ void example_cornell_box(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title   = example_title,
-      .overlay = true,
-      .vsync   = true,
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = true,
+      .gpu_timer = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
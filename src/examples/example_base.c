@@ -1,5 +1,7 @@
 #include "example_base.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../core/argparse.h"
@@ -41,6 +43,55 @@ typedef struct {
   float last_fps;
 } record_t;
 
+/* Launcher arguments that configure the example run */
+typedef struct {
+  struct {
+    int enabled;
+    int interval;
+    int max_frames;
+    const char* output;
+  } capture;
+  struct {
+    const char* filename;
+    int update;
+    float tolerance;
+  } golden;
+  int frames;
+  int cpu_adapter;
+  const char* backend;
+  int adapter_index;
+  const char* trace;
+  const char* benchmark;
+  struct {
+    int disabled;
+    int overdraw;
+  } depth_prepass;
+} example_arguments_t;
+
+/* Frame time used for deterministic runs (--frames) */
+static const float FIXED_FRAME_TIME = 1.0f / 60.0f;
+
+/* Benchmark runs (--benchmark) */
+static const uint32_t BENCHMARK_DEFAULT_FRAMES = 600;
+static const uint32_t BENCHMARK_WARMUP_FRAMES  = 30;
+
+/* Backend names accepted by --backend */
+static const struct {
+  const char* name;
+  WGPUBackendType backend_type;
+  bool force_fallback_adapter;
+} BACKENDS[8] = {
+  {"vulkan", WGPUBackendType_Vulkan, false},
+  {"opengl", WGPUBackendType_OpenGL, false},
+  {"opengles", WGPUBackendType_OpenGLES, false},
+  {"d3d11", WGPUBackendType_D3D11, false},
+  {"d3d12", WGPUBackendType_D3D12, false},
+  {"metal", WGPUBackendType_Metal, false},
+  {"null", WGPUBackendType_Null, false},
+  /* CPU implementation of the Vulkan backend */
+  {"swiftshader", WGPUBackendType_Vulkan, true},
+};
+
 static void get_pos_delta(vec2 old_pos, vec2 new_pos, vec2* result)
 {
   glm_vec2_sub(new_pos, old_pos, *result);
@@ -228,22 +279,43 @@ notify_key_input_state(record_t* record,
 }
 
 static void parse_example_arguments(int argc, char* argv[],
-                                    refexport_t* ref_export)
+                                    refexport_t* ref_export,
+                                    example_arguments_t* arguments)
 {
-  char* filters_short[2]           = {"-w", "-h"};
-  char* filters_eq[2]              = {"--width=", "--height="};
-  char* filtered_argv[1 + (2 * 2)] = {0};
-  char** argvc                     = (char**)argv;
-  int fargc                        = 1;
+  /* Options followed by a value, also accepted as "--option=value" */
+  static const char* const filters_value[14] = {
+    "-w", "-h", "--width", "--height", "--frames", "--golden",
+    "--golden-tolerance", "--capture-interval", "--capture-frames",
+    "--capture-output", "--backend", "--adapter-index", "--trace",
+    "--benchmark",
+  };
+  /* Options without a value */
+  static const char* const filters_flag[5] = {
+    "--capture",
+    "--golden-update",
+    "--cpu-adapter",
+    "--no-depth-prepass",
+    "--overdraw",
+  };
+  char** filtered_argv = (char**)calloc((size_t)argc + 1, sizeof(char*));
+  char** argvc         = (char**)argv;
+  int fargc            = 1;
   for (int32_t i = 0; i < argc; ++i) {
-    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_short); ++j) {
-      if (strcmp(argvc[i], filters_short[j]) == 0) {
-        filtered_argv[fargc++] = filters_short[j];
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_value); ++j) {
+      const size_t len = strlen(filters_value[j]);
+      if (strcmp(argvc[i], filters_value[j]) == 0 && i + 1 < argc) {
+        filtered_argv[fargc++] = argvc[i];
         filtered_argv[fargc++] = argvc[++i];
+        break;
+      }
+      if (strncmp(argvc[i], filters_value[j], len) == 0
+          && argvc[i][len] == '=') {
+        filtered_argv[fargc++] = argvc[i];
+        break;
       }
     }
-    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_eq); ++j) {
-      if (has_prefix(argvc[i], filters_eq[j])) {
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(filters_flag); ++j) {
+      if (strcmp(argvc[i], filters_flag[j]) == 0) {
         filtered_argv[fargc++] = argvc[i];
       }
     }
@@ -253,12 +325,49 @@ static void parse_example_arguments(int argc, char* argv[],
   struct argparse_option options[] = {
     OPT_INTEGER('w', "width", &window_width, "window width", NULL, 0, 0),
     OPT_INTEGER('h', "height", &window_height, "window height", NULL, 0, 0),
+    OPT_BOOLEAN(0, "capture", &arguments->capture.enabled,
+                "capture frames to an image sequence or video", NULL, 0, 0),
+    OPT_INTEGER(0, "capture-interval", &arguments->capture.interval,
+                "capture every Nth frame", NULL, 0, 0),
+    OPT_INTEGER(0, "capture-frames", &arguments->capture.max_frames,
+                "stop after capturing N frames", NULL, 0, 0),
+    OPT_STRING(0, "capture-output", &arguments->capture.output,
+               "PNG file name prefix or video file (.mp4, .mkv, ...)", NULL, 0,
+               0),
+    OPT_INTEGER(0, "frames", &arguments->frames,
+                "render N frames with a fixed time step and exit", NULL, 0, 0),
+    OPT_STRING(0, "golden", &arguments->golden.filename,
+               "compare the final frame against a golden PNG image", NULL, 0,
+               0),
+    OPT_BOOLEAN(0, "golden-update", &arguments->golden.update,
+                "store the final frame as golden image", NULL, 0, 0),
+    OPT_FLOAT(0, "golden-tolerance", &arguments->golden.tolerance,
+              "perceptual per-pixel tolerance", NULL, 0, 0),
+    OPT_BOOLEAN(0, "cpu-adapter", &arguments->cpu_adapter,
+                "use the CPU (SwiftShader) adapter", NULL, 0, 0),
+    OPT_STRING(0, "backend", &arguments->backend,
+               "WebGPU backend (vulkan, opengl, opengles, d3d11, d3d12, metal, "
+               "null, swiftshader)",
+               NULL, 0, 0),
+    OPT_INTEGER(0, "adapter-index", &arguments->adapter_index,
+                "adapter index as listed by --list-adapters", NULL, 0, 0),
+    OPT_STRING(0, "trace", &arguments->trace,
+               "write a chrome://tracing JSON timeline to the given file",
+               NULL, 0, 0),
+    OPT_STRING(0, "benchmark", &arguments->benchmark,
+               "append the frame time statistics to the given CSV file", NULL,
+               0, 0),
+    OPT_BOOLEAN(0, "no-depth-prepass", &arguments->depth_prepass.disabled,
+                "render without the depth pre-pass", NULL, 0, 0),
+    OPT_BOOLEAN(0, "overdraw", &arguments->depth_prepass.overdraw,
+                "show the overdraw heat map", NULL, 0, 0),
     OPT_END(),
   };
   struct argparse argparse;
   const char* const usages[] = {NULL};
   argparse_init(&argparse, options, usages, 0);
   argparse_parse(&argparse, fargc, (const char**)filtered_argv);
+  free(filtered_argv);
 
   // Override default example window dimensions
   if (window_width > 100) {
@@ -330,11 +439,33 @@ static void setup_window(wgpu_example_context_t* context,
   input_set_callbacks(context->window, context->callbacks);
 }
 
-static void intialize_webgpu(wgpu_example_context_t* context)
+static void intialize_webgpu(wgpu_example_context_t* context,
+                             example_arguments_t* arguments)
 {
-  context->wgpu_context = wgpu_context_create(&(wgpu_context_create_options_t){
-    .vsync = context->vsync,
-  });
+  wgpu_context_create_options_t options = {
+    // Frame times are not limited by the display refresh rate when benchmarking
+    .vsync = context->vsync && arguments->benchmark == NULL,
+    .swap_chain_readback
+    = arguments->capture.enabled || arguments->golden.filename != NULL,
+    .force_fallback_adapter = arguments->cpu_adapter,
+    .use_adapter_index      = arguments->adapter_index >= 0,
+    .adapter_index          = (uint32_t)MAX(arguments->adapter_index, 0),
+  };
+  if (arguments->backend != NULL) {
+    uint32_t i = 0;
+    for (; i < (uint32_t)ARRAY_SIZE(BACKENDS); ++i) {
+      if (strcmp(arguments->backend, BACKENDS[i].name) == 0) {
+        options.backend_type = BACKENDS[i].backend_type;
+        options.force_fallback_adapter |= BACKENDS[i].force_fallback_adapter;
+        break;
+      }
+    }
+    if (i == (uint32_t)ARRAY_SIZE(BACKENDS)) {
+      log_warn("Unknown backend \"%s\", using the default backend",
+               arguments->backend);
+    }
+  }
+  context->wgpu_context = wgpu_context_create(&options);
   context->wgpu_context->context = context;
 
   wgpu_create_device_and_queue(context->wgpu_context);
@@ -343,6 +474,225 @@ static void intialize_webgpu(wgpu_example_context_t* context)
   wgpu_get_context_info(context->adapter_info);
 }
 
+static void intialize_frame_capture(wgpu_example_context_t* context,
+                                    example_arguments_t* arguments)
+{
+  if (!arguments->capture.enabled) {
+    return;
+  }
+  context->frame_capture = wgpu_frame_capture_create(
+    context->wgpu_context, &(wgpu_frame_capture_desc_t){
+                             .output     = arguments->capture.output,
+                             .interval   = (uint32_t)arguments->capture.interval,
+                             .max_frames = (uint32_t)arguments->capture.max_frames,
+                           });
+}
+
+static void intialize_golden_image(wgpu_example_context_t* context,
+                                   example_arguments_t* arguments)
+{
+  if (arguments->frames > 0) {
+    // Deterministic run with a fixed number of frames and a fixed time step
+    context->max_frames       = (uint32_t)arguments->frames;
+    context->fixed_frame_time = FIXED_FRAME_TIME;
+  }
+  if (arguments->golden.filename == NULL) {
+    return;
+  }
+  if (context->max_frames == 0) {
+    log_warn("Golden image comparison without --frames, using 60 frames");
+    context->max_frames       = 60;
+    context->fixed_frame_time = FIXED_FRAME_TIME;
+  }
+  context->golden_image = wgpu_golden_image_create(
+    context->wgpu_context, &(wgpu_golden_image_desc_t){
+                             .filename  = arguments->golden.filename,
+                             .update    = arguments->golden.update,
+                             .tolerance = arguments->golden.tolerance,
+                           });
+}
+
+static bool finish_golden_image(wgpu_example_context_t* context)
+{
+  if (context->golden_image == NULL) {
+    return true;
+  }
+  wgpu_golden_image_result_t result;
+  bool passed = wgpu_golden_image_finish(context->golden_image, &result);
+  wgpu_golden_image_destroy(context->golden_image);
+  context->golden_image = NULL;
+  return passed;
+}
+
+static void intialize_profiling(wgpu_example_context_t* context,
+                                wgpu_example_settings_t* settings,
+                                example_arguments_t* arguments)
+{
+  if (arguments->trace != NULL) {
+    trace_init(arguments->trace);
+  }
+  if (arguments->benchmark != NULL) {
+    // Identical workload on every adapter: fixed time step and frame count
+    if (context->max_frames == 0) {
+      context->max_frames       = BENCHMARK_DEFAULT_FRAMES;
+      context->fixed_frame_time = FIXED_FRAME_TIME;
+    }
+    context->benchmark.frame_times_ms
+      = (float*)calloc(context->max_frames, sizeof(float));
+  }
+  if (arguments->trace != NULL || arguments->benchmark != NULL
+      || settings->gpu_timer || settings->quality_governor) {
+    context->gpu_timer = wgpu_gpu_timer_create(context->wgpu_context);
+  }
+  if (settings->quality_governor) {
+    context->quality_governor = wgpu_quality_governor_create(
+      context->gpu_timer, &(wgpu_quality_governor_desc_t){
+                            .level_count = settings->quality_levels,
+                          });
+    // Deterministic runs render the same workload on every adapter
+    if (context->fixed_frame_time > 0.0f) {
+      wgpu_quality_governor_set_enabled(context->quality_governor, false);
+    }
+  }
+  if (settings->workgroup_tuner) {
+    char adapter_key[STRMAX];
+    snprintf(adapter_key, sizeof(adapter_key), "%s / %s / %s",
+             context->adapter_info[0], context->adapter_info[1],
+             context->adapter_info[2]);
+    // Deterministic runs use the same dispatch shapes on every adapter
+    context->workgroup_tuner = wgpu_workgroup_tuner_create(
+      context->wgpu_context,
+      &(wgpu_workgroup_tuner_desc_t){
+        .adapter_key   = adapter_key,
+        .tuning        = true,
+        .defaults_only = context->fixed_frame_time > 0.0f,
+      });
+  }
+}
+
+static void intialize_depth_prepass(wgpu_example_context_t* context,
+                                    wgpu_example_settings_t* settings,
+                                    example_arguments_t* arguments)
+{
+  if (!settings->depth_prepass) {
+    return;
+  }
+  context->depth_prepass = wgpu_depth_prepass_create(
+    context->wgpu_context,
+    &(wgpu_depth_prepass_desc_t){
+      .color_format = context->wgpu_context->swap_chain.format,
+      .enabled      = !arguments->depth_prepass.disabled,
+      .overdraw     = arguments->depth_prepass.overdraw,
+    });
+}
+
+static void release_depth_prepass(wgpu_example_context_t* context)
+{
+  if (context->depth_prepass != NULL) {
+    wgpu_depth_prepass_destroy(context->depth_prepass);
+    context->depth_prepass = NULL;
+  }
+}
+
+static int compare_float(const void* a, const void* b)
+{
+  const float fa = *(const float*)a, fb = *(const float*)b;
+  return (fa > fb) - (fa < fb);
+}
+
+static void write_benchmark_results(wgpu_example_context_t* context,
+                                    example_arguments_t* arguments)
+{
+  // Skip the warm-up frames (pipeline creation, resource uploads, ...)
+  const uint32_t warmup
+    = MIN(BENCHMARK_WARMUP_FRAMES, context->benchmark.frame_count / 4);
+  const uint32_t count = context->benchmark.frame_count - warmup;
+  if (count == 0) {
+    log_error("Benchmark: no frames were rendered");
+    return;
+  }
+  float* frame_times = context->benchmark.frame_times_ms + warmup;
+  qsort(frame_times, count, sizeof(float), compare_float);
+  double total_ms = 0.0;
+  for (uint32_t i = 0; i < count; ++i) {
+    total_ms += frame_times[i];
+  }
+  const float cpu_avg_ms    = (float)(total_ms / count);
+  const float cpu_median_ms = frame_times[count / 2];
+  const float cpu_p95_ms    = frame_times[MIN(count - 1, count * 95 / 100)];
+
+  wgpu_gpu_timer_stats_t gpu_stats = {0};
+  if (context->gpu_timer != NULL) {
+    wgpu_gpu_timer_get_stats(context->gpu_timer, &gpu_stats);
+  }
+  const float gpu_avg_ms
+    = gpu_stats.frame_count > 0 ?
+        (float)(gpu_stats.total_ms / (double)gpu_stats.frame_count) :
+        0.0f;
+
+  // Adapter names are written unquoted, replace the separator
+  char adapter_name[256];
+  snprintf(adapter_name, sizeof(adapter_name), "%s", context->adapter_info[0]);
+  for (char* c = adapter_name; *c != '\0'; ++c) {
+    if (*c == ',') {
+      *c = ' ';
+    }
+  }
+
+  FILE* file = fopen(arguments->benchmark, "a");
+  if (file == NULL) {
+    log_error("Benchmark: could not open %s", arguments->benchmark);
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  if (ftell(file) == 0) {
+    fprintf(file, "example,adapter_index,adapter,adapter_type,backend,frames,"
+                  "cpu_avg_ms,cpu_median_ms,cpu_p95_ms,cpu_min_ms,cpu_max_ms,"
+                  "gpu_avg_ms\n");
+  }
+  fprintf(file, "%s,%d,%s,%s,%s,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+          context->example_title, arguments->adapter_index, adapter_name,
+          context->adapter_info[1], context->adapter_info[2], count,
+          cpu_avg_ms, cpu_median_ms, cpu_p95_ms, frame_times[0],
+          frame_times[count - 1], gpu_avg_ms);
+  fclose(file);
+
+  log_info("Benchmark: %s on %s (%s): CPU %.3f ms avg, %.3f ms p95, GPU %.3f "
+           "ms avg",
+           context->example_title, adapter_name, context->adapter_info[2],
+           cpu_avg_ms, cpu_p95_ms, gpu_avg_ms);
+}
+
+static void release_profiling(wgpu_example_context_t* context,
+                              example_arguments_t* arguments)
+{
+  if (arguments->benchmark != NULL) {
+    write_benchmark_results(context, arguments);
+    free(context->benchmark.frame_times_ms);
+    context->benchmark.frame_times_ms = NULL;
+  }
+  if (context->quality_governor != NULL) {
+    wgpu_quality_governor_destroy(context->quality_governor);
+    context->quality_governor = NULL;
+  }
+  if (context->workgroup_tuner != NULL) {
+    wgpu_workgroup_tuner_destroy(context->workgroup_tuner);
+    context->workgroup_tuner = NULL;
+  }
+  if (context->gpu_timer != NULL) {
+    wgpu_gpu_timer_destroy(context->gpu_timer);
+    context->gpu_timer = NULL;
+  }
+}
+
+static void release_frame_capture(wgpu_example_context_t* context)
+{
+  if (context->frame_capture != NULL) {
+    wgpu_frame_capture_destroy(context->frame_capture);
+    context->frame_capture = NULL;
+  }
+}
+
 static void intialize_imgui(wgpu_example_context_t* context,
                             wgpu_example_settings_t* example_settings)
 {
@@ -371,6 +721,26 @@ static void release_webgpu(wgpu_example_context_t* context)
   wgpu_context_release(context->wgpu_context);
 }
 
+static void update_depth_prepass_overlay(wgpu_example_context_t* context)
+{
+  if (!imgui_overlay_header("Depth pre-pass")) {
+    return;
+  }
+  wgpu_depth_prepass_t* depth_prepass = context->depth_prepass;
+  bool enabled  = wgpu_depth_prepass_is_enabled(depth_prepass);
+  bool overdraw = wgpu_depth_prepass_is_overdraw(depth_prepass);
+  if (imgui_overlay_checkBox(context->imgui_overlay, "Enabled", &enabled)) {
+    wgpu_depth_prepass_set_enabled(depth_prepass, enabled);
+  }
+  if (imgui_overlay_checkBox(context->imgui_overlay, "Overdraw", &overdraw)) {
+    wgpu_depth_prepass_set_overdraw(depth_prepass, overdraw);
+  }
+  if (overdraw) {
+    imgui_overlay_text("%.2f fragments / pixel",
+                       wgpu_depth_prepass_get_overdraw(depth_prepass));
+  }
+}
+
 static void
 update_overlay(wgpu_example_context_t* context,
                onupdateuioverlayfunc_t* example_on_update_ui_overlay_func)
@@ -397,6 +767,9 @@ update_overlay(wgpu_example_context_t* context,
     example_on_update_ui_overlay_func(context);
     igPopItemWidth();
   }
+  if (context->depth_prepass != NULL) {
+    update_depth_prepass_overlay(context);
+  }
   igEnd();
 
   imgui_overlay_render(context->imgui_overlay);
@@ -416,19 +789,43 @@ static void render_loop(wgpu_example_context_t* context,
   while (!window_should_close(context->window)) {
     time_start                      = platform_get_time();
     context->frame.timestamp_millis = time_start * 1000.0f;
+    if (context->fixed_frame_time > 0.0f) {
+      context->frame.timestamp_millis
+        = (float)context->frame.index * context->fixed_frame_time * 1000.0f;
+    }
     if (record.view_updated) {
       record.mouse_scrolled = 0;
       record.wheel_delta    = 0;
       record.view_updated   = false;
     }
+    TRACE_BEGIN("Frame");
+    TRACE_BEGIN("Poll input");
     input_poll_events();
+    TRACE_END();
     // update_window_size(context, &record);
+    if (context->quality_governor != NULL) {
+      wgpu_quality_governor_update(context->quality_governor);
+    }
+    TRACE_BEGIN("Render");
     render_func(context);
+    TRACE_END();
+    if (context->wgpu_context->readback != NULL) {
+      TRACE_BEGIN("Readback");
+      wgpu_readback_pump(context->wgpu_context->readback);
+      TRACE_END();
+    }
     ++record.frame_counter;
     ++context->frame.index;
     time_end             = platform_get_time();
     time_diff            = (time_end - time_start) * 1000.0f;
-    record.frame_timer   = time_diff / 1000.0f;
+    if (context->benchmark.frame_times_ms != NULL
+        && context->benchmark.frame_count < context->max_frames) {
+      context->benchmark.frame_times_ms[context->benchmark.frame_count++]
+        = time_diff;
+    }
+    record.frame_timer   = context->fixed_frame_time > 0.0f ?
+                             context->fixed_frame_time :
+                             time_diff / 1000.0f;
     context->frame_timer = record.frame_timer;
     context->run_time += context->frame_timer;
     update_camera(context, &record);
@@ -454,6 +851,15 @@ static void render_loop(wgpu_example_context_t* context,
       record.last_timestamp = time_end;
     }
     context->frame_counter = record.frame_counter;
+    TRACE_END();
+    if (context->frame_capture
+        && wgpu_frame_capture_is_finished(context->frame_capture)) {
+      break;
+    }
+    if (context->max_frames > 0
+        && context->frame.index >= context->max_frames) {
+      break;
+    }
   }
 }
 
@@ -461,6 +867,7 @@ void draw_ui(wgpu_example_context_t* context,
              onupdateuioverlayfunc_t* example_on_update_ui_overlay_func)
 {
   if (context->show_imgui_overlay) {
+    TRACE_SCOPE("ImGui");
     update_overlay(context, example_on_update_ui_overlay_func);
     imgui_overlay_draw_frame(context->imgui_overlay,
                              context->wgpu_context->swap_chain.frame_buffer);
@@ -477,16 +884,42 @@ void prepare_frame(wgpu_example_context_t* context)
 
 void submit_command_buffers(wgpu_example_context_t* context)
 {
+  TRACE_SCOPE("Submit command buffers");
   wgpu_context_t* wgpu_context = context->wgpu_context;
 
+  // Enclose the frame's command buffers in GPU timestamp queries
+  WGPUCommandBuffer begin_command_buffer
+    = context->gpu_timer ? wgpu_gpu_timer_begin_frame(context->gpu_timer) :
+                           NULL;
+  if (begin_command_buffer != NULL) {
+    wgpu_flush_command_buffers(wgpu_context, &begin_command_buffer, 1);
+  }
+
   // Submit command buffer(s) to the queue
   wgpu_flush_command_buffers(wgpu_context,
                              wgpu_context->submit_info.command_buffers,
                              wgpu_context->submit_info.command_buffer_count);
+
+  if (begin_command_buffer != NULL) {
+    WGPUCommandBuffer end_command_buffer
+      = wgpu_gpu_timer_end_frame(context->gpu_timer);
+    wgpu_flush_command_buffers(wgpu_context, &end_command_buffer, 1);
+  }
 }
 
 void submit_frame(wgpu_example_context_t* context)
 {
+  TRACE_SCOPE("Submit frame");
+
+  // Capture the current buffer before it is presented
+  if (context->frame_capture != NULL) {
+    wgpu_frame_capture_on_frame(context->frame_capture, context->frame.index);
+  }
+  if (context->golden_image != NULL
+      && context->frame.index + 1 == context->max_frames) {
+    wgpu_golden_image_capture(context->golden_image);
+  }
+
   // Present the current buffer to the swap chain
   wgpu_swap_chain_present(context->wgpu_context);
 }
@@ -494,14 +927,22 @@ void submit_frame(wgpu_example_context_t* context)
 void example_run(int argc, char* argv[], refexport_t* ref_export)
 {
   // Parse the example arguments
-  parse_example_arguments(argc, argv, ref_export);
+  example_arguments_t arguments = {.adapter_index = -1};
+  parse_example_arguments(argc, argv, ref_export, &arguments);
   // Initialize WebGPU example context
   wgpu_example_context_t context;
   intialize_wgpu_example_context(&context, &ref_export->example_settings);
   // Setup Window
   setup_window(&context, &ref_export->example_window_config);
   // Intialize WebGPU
-  intialize_webgpu(&context);
+  intialize_webgpu(&context, &arguments);
+  // Intialize frame capture and golden image comparison
+  intialize_frame_capture(&context, &arguments);
+  intialize_golden_image(&context, &arguments);
+  // Intialize CPU / GPU tracing and benchmarking
+  intialize_profiling(&context, &ref_export->example_settings, &arguments);
+  // Intialize the depth pre-pass
+  intialize_depth_prepass(&context, &ref_export->example_settings, &arguments);
   // Intialize ImGui
   intialize_imgui(&context, &ref_export->example_settings);
   // Intialize example
@@ -510,9 +951,18 @@ void example_run(int argc, char* argv[], refexport_t* ref_export)
   render_loop(&context, ref_export->example_render_func,
               ref_export->example_on_view_changed_func,
               ref_export->example_on_key_pressed_func);
+  // Compare the final frame against the golden image
+  const bool golden_image_passed = finish_golden_image(&context);
   // Cleanup
+  release_frame_capture(&context);
+  release_profiling(&context, &arguments);
   ref_export->example_destroy_func(&context);
+  release_depth_prepass(&context);
   release_imgui(&context);
   release_webgpu(&context);
   window_destroy(context.window);
+  trace_shutdown();
+  if (!golden_image_passed) {
+    exit(EXIT_FAILURE);
+  }
 }
@@ -32,6 +32,25 @@ typedef struct {
   // ImGui overlay
   bool show_imgui_overlay;
   void* imgui_overlay;
+  // Frame capture (--capture)
+  wgpu_frame_capture_t* frame_capture;
+  // Golden image comparison of the final frame (--golden)
+  wgpu_golden_image_t* golden_image;
+  // GPU frame timer, created when tracing, benchmarking or on request
+  wgpu_gpu_timer_t* gpu_timer;
+  // Adaptive quality governor, created on request
+  wgpu_quality_governor_t* quality_governor;
+  // Per adapter workgroup size tuner, created on request
+  wgpu_workgroup_tuner_t* workgroup_tuner;
+  // Depth pre-pass and overdraw visualization, created on request
+  wgpu_depth_prepass_t* depth_prepass;
+  // CPU frame times recorded for the benchmark results (--benchmark)
+  struct {
+    float* frame_times_ms;
+    uint32_t frame_count;
+  } benchmark;
+  // Number of frames to render before exiting, 0 if unlimited (--frames)
+  uint32_t max_frames;
   // Time the example has been running (in seconds)
   float run_time;
   // Last frame time measured using a high performance timer (if available)
@@ -41,6 +60,8 @@ typedef struct {
   float timer;
   // Multiplier for speeding up (or slowing down) the global timer
   float timer_speed;
+  // Fixed frame time (in seconds) used for deterministic runs, 0 if disabled
+  float fixed_frame_time;
   bool paused;
   camera_t* camera;
   // Input
@@ -63,6 +84,16 @@ typedef struct {
   WGPUTextureFormat overlay_deph_stencil_format;
   /** @brief Create texture client */
   bool create_texture_client;
+  /** @brief Create the GPU frame timer, e.g. to display GPU frame times */
+  bool gpu_timer;
+  /** @brief Create the quality governor (implies the GPU frame timer) */
+  bool quality_governor;
+  /** @brief Quality levels the example exposes to the quality governor */
+  uint32_t quality_levels;
+  /** @brief Create the workgroup tuner for the compute kernels */
+  bool workgroup_tuner;
+  /** @brief Create the depth pre-pass the example renders through */
+  bool depth_prepass;
 } wgpu_example_settings_t;
 
 typedef void* surface_t;
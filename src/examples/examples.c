@@ -19,6 +19,7 @@ void example_compute_metaballs(int argc, char* argv[]);
 void example_compute_n_body(int argc, char* argv[]);
 void example_compute_particles(int argc, char* argv[]);
 void example_compute_particles_easing(int argc, char* argv[]);
+void example_compute_particles_emitter(int argc, char* argv[]);
 void example_compute_particles_webgpu_logo(int argc, char* argv[]);
 void example_compute_ray_tracing(int argc, char* argv[]);
 void example_compute_shader(int argc, char* argv[]);
@@ -33,6 +34,7 @@ void example_deferred_rendering(int argc, char* argv[]);
 void example_dynamic_uniform_buffer(int argc, char* argv[]);
 void example_equirectangular_image(int argc, char* argv[]);
 void example_fluid_simulation(int argc, char* argv[]);
+void example_forward_plus_lighting(int argc, char* argv[]);
 void example_game_of_life(int argc, char* argv[]);
 void example_gears(int argc, char* argv[]);
 void example_gerstner_waves(int argc, char* argv[]);
@@ -58,6 +60,7 @@ void example_pbr_basic(int argc, char* argv[]);
 void example_pbr_ibl(int argc, char* argv[]);
 void example_pbr_texture(int argc, char* argv[]);
 void example_points(int argc, char* argv[]);
+void example_portal_mirrors(int argc, char* argv[]);
 void example_post_processing(int argc, char* argv[]);
 void example_pristine_grid(int argc, char* argv[]);
 void example_prng(int argc, char* argv[]);
@@ -69,6 +72,7 @@ void example_sampler_parameters(int argc, char* argv[]);
 void example_screenshot(int argc, char* argv[]);
 void example_shadertoy(int argc, char* argv[]);
 void example_shadow_mapping(int argc, char* argv[]);
+void example_sprite_batch(int argc, char* argv[]);
 void example_square(int argc, char* argv[]);
 void example_stencil_buffer(int argc, char* argv[]);
 void example_terrain_mesh(int argc, char* argv[]);
@@ -100,6 +104,7 @@ static examplecase_t g_example_cases[] = {
   {"compute_metaballs", example_compute_metaballs},
   {"compute_particles", example_compute_particles},
   {"compute_particles_easing", example_compute_particles_easing},
+  {"compute_particles_emitter", example_compute_particles_emitter},
   {"compute_particles_webgpu_logo", example_compute_particles_webgpu_logo},
   {"compute_ray_tracing", example_compute_ray_tracing},
   {"compute_shader", example_compute_shader},
@@ -114,6 +119,7 @@ static examplecase_t g_example_cases[] = {
   {"dynamic_uniform_buffer", example_dynamic_uniform_buffer},
   {"equirectangular_image", example_equirectangular_image},
   {"fluid_simulation", example_fluid_simulation},
+  {"forward_plus_lighting", example_forward_plus_lighting},
   {"game_of_life", example_game_of_life},
   {"gears", example_gears},
   {"gerstner_waves", example_gerstner_waves},
@@ -139,6 +145,7 @@ static examplecase_t g_example_cases[] = {
   {"pbr_ibl", example_pbr_ibl},
   {"pbr_texture", example_pbr_texture},
   {"points", example_points},
+  {"portal_mirrors", example_portal_mirrors},
   {"post_processing", example_post_processing},
   {"pristine_grid", example_pristine_grid},
   {"prng", example_prng},
@@ -150,6 +157,7 @@ static examplecase_t g_example_cases[] = {
   {"screenshot", example_screenshot},
   {"shadertoy", example_shadertoy},
   {"shadow_mapping", example_shadow_mapping},
+  {"sprite_batch", example_sprite_batch},
   {"square", example_square},
   {"stencil_buffer", example_stencil_buffer},
   {"terrain_mesh", example_terrain_mesh},
@@ -0,0 +1,638 @@
+#include "example_base.h"
+
+#include <string.h>
+
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/light_manager.h"
+#include "../webgpu/wgsl_preprocessor.h"
+
+#include "meshes.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Forward+ Lighting
+ *
+ * This example shows how to use the light manager module to shade a scene
+ * against thousands of dynamic point and spot lights in a single forward pass.
+ * Every frame the lights are culled into a froxel grid by a compute pass, the
+ * fragment shader only evaluates the lights of the froxel it falls into. The
+ * heatmap view shows the number of lights per froxel.
+ * -------------------------------------------------------------------------- */
+
+/* Animated point and spot lights, the moonlight comes on top */
+#define MAX_LIGHTS 4096u
+#define SPHERE_GRID_SIZE 8u
+#define SPHERE_SPACING 4.0f
+#define GROUND_SIZE 40.0f
+
+// Light manager and animated lights
+static wgpu_light_manager_t* light_manager = NULL;
+
+static struct {
+  uint32_t id;
+  wgpu_light_t light;
+  float orbit_radius;
+  float orbit_speed;
+  float phase;
+} lights[MAX_LIGHTS] = {0};
+static uint32_t light_count = 0;
+
+// Sphere mesh
+static struct {
+  wgpu_buffer_t vertices;
+  wgpu_buffer_t indices;
+} sphere = {0};
+
+// Scene uniforms, must match Scene in the shader
+static struct {
+  mat4 view_projection;
+  vec4 camera_position;
+  uint32_t heatmap;
+  uint32_t padding[3];
+} scene_ubo = {0};
+
+static wgpu_buffer_t scene_uniform_buffer = {0};
+
+// Pipelines and bind groups
+static WGPUBindGroupLayout scene_bind_group_layout = NULL;
+static WGPUBindGroup scene_bind_group              = NULL;
+static WGPUPipelineLayout pipeline_layout          = NULL;
+static WGPURenderPipeline sphere_pipeline          = NULL;
+static WGPURenderPipeline ground_pipeline          = NULL;
+
+// Settings
+static struct {
+  int32_t light_count;
+  bool heatmap;
+} settings = {
+  .light_count = 1024,
+  .heatmap     = false,
+};
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass = {0};
+
+// Other variables
+static const char* example_title = "Forward+ Lighting";
+static bool prepared             = false;
+
+// Shaders, in chunks below the string length limit of C99
+// clang-format off
+static const char* scene_shader_wgsl[2] = {
+  WGPU_LIGHT_MANAGER_WGSL(1),
+  CODE(
+  struct Scene {
+    viewProjection : mat4x4<f32>,
+    cameraPosition : vec4<f32>,
+    heatmap : u32,
+  }
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) worldPos : vec3<f32>,
+    @location(1) normal : vec3<f32>,
+    @location(2) albedo : vec3<f32>,
+  }
+
+  const SPHERE_GRID_SIZE = 8u;
+  const SPHERE_SPACING = 4.0;
+  const GROUND_SIZE = 40.0;
+
+  @group(0) @binding(0) var<uniform> scene : Scene;
+
+  @vertex
+  fn vs_sphere(@builtin(instance_index) instance : u32,
+               @location(0) position : vec3<f32>,
+               @location(1) normal : vec3<f32>) -> VertexOutput {
+    let cell = vec2<f32>(f32(instance % SPHERE_GRID_SIZE),
+                         f32(instance / SPHERE_GRID_SIZE));
+    let offset = (cell - 0.5 * f32(SPHERE_GRID_SIZE - 1u)) * SPHERE_SPACING;
+    var output : VertexOutput;
+    output.worldPos = position + vec3<f32>(offset.x, 1.0, offset.y);
+    output.position = scene.viewProjection * vec4<f32>(output.worldPos, 1.0);
+    output.normal = normal;
+    output.albedo = vec3<f32>(0.8);
+    return output;
+  }
+
+  @vertex
+  fn vs_ground(@builtin(vertex_index) vertexIndex : u32) -> VertexOutput {
+    var corners = array<vec2<f32>, 6>(
+      vec2<f32>(-1.0, -1.0), vec2<f32>(-1.0, 1.0), vec2<f32>(1.0, -1.0),
+      vec2<f32>(1.0, -1.0), vec2<f32>(-1.0, 1.0), vec2<f32>(1.0, 1.0)
+    );
+    let corner = corners[vertexIndex] * 0.5 * GROUND_SIZE;
+    var output : VertexOutput;
+    output.worldPos = vec3<f32>(corner.x, 0.0, corner.y);
+    output.position = scene.viewProjection * vec4<f32>(output.worldPos, 1.0);
+    output.normal = vec3<f32>(0.0, 1.0, 0.0);
+    output.albedo = vec3<f32>(0.5);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let froxel = lightManagerFroxel(input.position.xy, input.worldPos);
+    if (scene.heatmap != 0u) {
+      let t = f32(froxel.y) / f32(lightManager.maxLightsPerFroxel);
+      let heat = clamp(vec3<f32>(t * 3.0, t * 3.0 - 1.0, t * 3.0 - 2.0),
+                       vec3<f32>(0.0), vec3<f32>(1.0));
+      return vec4<f32>(heat, 1.0);
+    }
+
+    let N = normalize(input.normal);
+    let V = normalize(scene.cameraPosition.xyz - input.worldPos);
+    var color = input.albedo * 0.02;
+    for (var i = 0u; i < froxel.y; i++) {
+      let s = lightManagerSampleLight(lightManagerGetLight(froxel, i),
+                                      input.worldPos);
+      let NdotL = max(dot(N, s.direction), 0.0);
+      let H = normalize(s.direction + V);
+      let specular = pow(max(dot(N, H), 0.0), 64.0) * 0.5;
+      color += (input.albedo + specular) * NdotL * s.radiance;
+    }
+
+    // Reinhard tone mapping and gamma correction
+    color = color / (color + vec3<f32>(1.0));
+    return vec4<f32>(pow(color, vec3<f32>(1.0 / 2.2)), 1.0);
+  }
+  ),
+};
+// clang-format on
+
+static void setup_camera(wgpu_example_context_t* context)
+{
+  context->camera       = camera_create();
+  context->camera->type = CameraType_LookAt;
+  camera_set_position(context->camera, (vec3){0.0f, 0.0f, -30.0f});
+  camera_set_rotation(context->camera, (vec3){-30.0f, 0.0f, 0.0f});
+  camera_set_rotation_speed(context->camera, 0.25f);
+  camera_set_perspective(context->camera, 60.0f,
+                         context->window_size.aspect_ratio, 0.1f, 100.0f);
+}
+
+/* Adds or removes lights to match the requested light count */
+static void update_light_count(uint32_t count)
+{
+  count = MIN(count, MAX_LIGHTS);
+  while (light_count > count) {
+    wgpu_light_manager_remove_light(light_manager, lights[--light_count].id);
+  }
+  while (light_count < count) {
+    /* Every eighth light is a spot light pointing down */
+    const bool spot     = (light_count % 8) == 7;
+    wgpu_light_t* light = &lights[light_count].light;
+    *light              = (wgpu_light_t){
+      .type      = spot ? WGPU_LIGHT_TYPE_SPOT : WGPU_LIGHT_TYPE_POINT,
+      .position  = {random_float_min_max(-18.0f, 18.0f),
+                    random_float_min_max(0.3f, 3.0f),
+                    random_float_min_max(-18.0f, 18.0f)},
+      .direction = {0.0f, -1.0f, 0.0f},
+      .color     = {random_float_min_max(0.2f, 1.0f),
+                    random_float_min_max(0.2f, 1.0f),
+                    random_float_min_max(0.2f, 1.0f)},
+      .intensity = spot ? 8.0f : 2.0f,
+      .range     = spot ? 6.0f : random_float_min_max(1.5f, 3.0f),
+      .inner_cone_angle = glm_rad(15.0f),
+      .outer_cone_angle = glm_rad(30.0f),
+    };
+    lights[light_count].orbit_radius = random_float_min_max(0.5f, 2.0f);
+    lights[light_count].orbit_speed  = random_float_min_max(-1.0f, 1.0f);
+    lights[light_count].phase        = random_float_min_max(0.0f, PI2);
+    lights[light_count].id
+      = wgpu_light_manager_add_light(light_manager, light);
+    ++light_count;
+  }
+}
+
+/* Moves the lights on small circles around their start positions */
+static void update_lights(float time)
+{
+  for (uint32_t i = 0; i < light_count; ++i) {
+    wgpu_light_t light = lights[i].light;
+    const float angle  = lights[i].phase + time * lights[i].orbit_speed;
+    light.position[0] += cosf(angle) * lights[i].orbit_radius;
+    light.position[2] += sinf(angle) * lights[i].orbit_radius;
+    wgpu_light_manager_update_light(light_manager, lights[i].id, &light);
+  }
+}
+
+static void prepare_lights(wgpu_context_t* wgpu_context)
+{
+  light_manager = wgpu_light_manager_create(
+    wgpu_context, &(wgpu_light_manager_desc_t){
+                    .max_lights            = MAX_LIGHTS + 1, /* Moonlight */
+                    .grid_size             = {16, 9, 24},
+                    .max_lights_per_froxel = 128,
+                  });
+
+  /* Dim moonlight */
+  wgpu_light_manager_add_light(light_manager,
+                               &(wgpu_light_t){
+                                 .type      = WGPU_LIGHT_TYPE_DIRECTIONAL,
+                                 .direction = {-0.3f, -1.0f, 0.2f},
+                                 .color     = {0.6f, 0.7f, 1.0f},
+                                 .intensity = 0.05f,
+                               });
+  update_light_count((uint32_t)settings.light_count);
+}
+
+static void prepare_sphere_mesh(wgpu_context_t* wgpu_context)
+{
+  sphere_mesh_t sphere_mesh = {0};
+  sphere_mesh_init(&sphere_mesh, 1.0f, 32, 16, 0.0f);
+
+  sphere.vertices = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Sphere vertex buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+                    .size  = sphere_mesh.vertices.length * sizeof(float),
+                    .initial.data = sphere_mesh.vertices.data,
+                    .count        = sphere_mesh.vertices.length,
+                  });
+  sphere.indices = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Sphere index buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
+                    .size  = sphere_mesh.indices.length * sizeof(uint16_t),
+                    .initial.data = sphere_mesh.indices.data,
+                    .count        = sphere_mesh.indices.length,
+                  });
+
+  sphere_mesh_destroy(&sphere_mesh);
+}
+
+static void prepare_uniform_buffer(wgpu_context_t* wgpu_context)
+{
+  scene_uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Scene uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(scene_ubo),
+                  });
+}
+
+static void update_uniform_buffer(wgpu_example_context_t* context)
+{
+  camera_t* camera = context->camera;
+  glm_mat4_mul(camera->matrices.perspective, camera->matrices.view,
+               scene_ubo.view_projection);
+
+  /* Camera world position from the inverse view matrix */
+  mat4 inverse_view = GLM_MAT4_IDENTITY_INIT;
+  glm_mat4_inv(camera->matrices.view, inverse_view);
+  glm_vec4_copy(inverse_view[3], scene_ubo.camera_position);
+  scene_ubo.heatmap = settings.heatmap ? 1 : 0;
+
+  wgpu_queue_write_buffer(context->wgpu_context, scene_uniform_buffer.buffer, 0,
+                          &scene_ubo, sizeof(scene_ubo));
+}
+
+static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
+{
+  WGPUBindGroupLayoutEntry bgl_entry = {
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type           = WGPUBufferBindingType_Uniform,
+      .minBindingSize = sizeof(scene_ubo),
+    },
+  };
+  scene_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Scene bind group layout",
+                            .entryCount = 1,
+                            .entries    = &bgl_entry,
+                          });
+  ASSERT(scene_bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts[2] = {
+    scene_bind_group_layout,                                 /* Group 0 */
+    wgpu_light_manager_get_bind_group_layout(light_manager), /* Group 1 */
+  };
+  pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device,
+    &(WGPUPipelineLayoutDescriptor){
+      .label                = "Forward+ pipeline layout",
+      .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+      .bindGroupLayouts     = bind_group_layouts,
+    });
+  ASSERT(pipeline_layout != NULL);
+}
+
+static void setup_bind_group(wgpu_context_t* wgpu_context)
+{
+  WGPUBindGroupEntry bg_entry = {
+    .binding = 0,
+    .buffer  = scene_uniform_buffer.buffer,
+    .offset  = 0,
+    .size    = scene_uniform_buffer.size,
+  };
+  scene_bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Scene bind group",
+                            .layout     = scene_bind_group_layout,
+                            .entryCount = 1,
+                            .entries    = &bg_entry,
+                          });
+  ASSERT(scene_bind_group != NULL);
+}
+
+static WGPURenderPipeline create_pipeline(wgpu_context_t* wgpu_context,
+                                          const char* label,
+                                          const char* vertex_entry,
+                                          uint32_t buffer_count,
+                                          WGPUVertexBufferLayout* buffers)
+{
+  WGPUPrimitiveState primitive_state = {
+    .topology  = WGPUPrimitiveTopology_TriangleList,
+    .frontFace = WGPUFrontFace_CCW,
+    .cullMode  = WGPUCullMode_None,
+  };
+
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = NULL,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = WGPUTextureFormat_Depth24PlusStencil8,
+      .depth_write_enabled = true,
+    });
+
+  char* shader_wgsl = wgpu_wgsl_preprocess(&(wgpu_wgsl_preprocess_desc_t){
+    .sources = {
+      .count   = (uint32_t)ARRAY_SIZE(scene_shader_wgsl),
+      .entries = scene_shader_wgsl,
+    },
+  });
+  ASSERT(shader_wgsl != NULL);
+
+  WGPUVertexState vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label = "Forward+ vertex shader WGSL",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = vertex_entry,
+                    },
+                    .buffer_count = buffer_count,
+                    .buffers      = buffers,
+                  });
+  WGPUFragmentState fragment_state = wgpu_create_fragment_state(
+    wgpu_context, &(wgpu_fragment_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      .label = "Forward+ fragment shader WGSL",
+                      .wgsl_code.source = shader_wgsl,
+                      .entry            = "fs_main",
+                    },
+                    .target_count = 1,
+                    .targets      = &color_target_state,
+                  });
+  free(shader_wgsl);
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label        = label,
+                            .layout       = pipeline_layout,
+                            .primitive    = primitive_state,
+                            .vertex       = vertex_state,
+                            .fragment     = &fragment_state,
+                            .depthStencil = &depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+  ASSERT(pipeline != NULL);
+
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
+
+  return pipeline;
+}
+
+static void prepare_pipelines(wgpu_context_t* wgpu_context)
+{
+  sphere_mesh_layout_t sphere_mesh_layout = {0};
+  sphere_mesh_layout_init(&sphere_mesh_layout);
+  WGPU_VERTEX_BUFFER_LAYOUT(
+    sphere, sphere_mesh_layout.vertex_stride,
+    // Attribute location 0: Position
+    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x3,
+                       sphere_mesh_layout.positions_offset),
+    // Attribute location 1: Normal
+    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x3,
+                       sphere_mesh_layout.normal_offset))
+
+  sphere_pipeline
+    = create_pipeline(wgpu_context, "Sphere render pipeline", "vs_sphere", 1,
+                      &sphere_vertex_buffer_layout);
+  ground_pipeline = create_pipeline(wgpu_context, "Ground render pipeline",
+                                    "vs_ground", 0, NULL);
+}
+
+static void setup_render_pass(wgpu_context_t* wgpu_context)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, /* Assigned later */
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor) {
+        .r = 0.0f,
+        .g = 0.0f,
+        .b = 0.0f,
+        .a = 1.0f,
+      },
+  };
+
+  // Depth attachment
+  wgpu_setup_deph_stencil(wgpu_context, NULL);
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .label                  = "Render pass descriptor",
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    setup_camera(context);
+    prepare_lights(context->wgpu_context);
+    prepare_sphere_mesh(context->wgpu_context);
+    prepare_uniform_buffer(context->wgpu_context);
+    setup_pipeline_layout(context->wgpu_context);
+    setup_bind_group(context->wgpu_context);
+    prepare_pipelines(context->wgpu_context);
+    setup_render_pass(context->wgpu_context);
+    prepared = true;
+    return EXIT_SUCCESS;
+  }
+
+  return EXIT_FAILURE;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Lights",
+                                 &settings.light_count, 0, MAX_LIGHTS)) {
+      update_light_count((uint32_t)settings.light_count);
+    }
+    imgui_overlay_checkBox(context->imgui_overlay, "Light Heatmap",
+                           &settings.heatmap);
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Lights: %u",
+                       wgpu_light_manager_get_light_count(light_manager));
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+  }
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  camera_t* camera             = context->camera;
+
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Cull the lights into the froxel grid
+  wgpu_light_manager_cull(light_manager, wgpu_context->cmd_enc,
+                          camera->matrices.view, camera->matrices.perspective,
+                          camera->znear, camera->zfar);
+
+  // Render pass
+  {
+    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &render_pass.descriptor);
+    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
+                                      scene_bind_group, 0, 0);
+    wgpuRenderPassEncoderSetBindGroup(
+      wgpu_context->rpass_enc, 1,
+      wgpu_light_manager_get_bind_group(light_manager), 0, 0);
+
+    // Ground plane
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, ground_pipeline);
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 6, 1, 0, 0);
+
+    // Spheres
+    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, sphere_pipeline);
+    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
+                                         sphere.vertices.buffer, 0,
+                                         WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderSetIndexBuffer(wgpu_context->rpass_enc,
+                                        sphere.indices.buffer,
+                                        WGPUIndexFormat_Uint16, 0,
+                                        WGPU_WHOLE_SIZE);
+    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
+                                     sphere.indices.count,
+                                     SPHERE_GRID_SIZE * SPHERE_GRID_SIZE, 0, 0,
+                                     0);
+
+    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  }
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit command buffer to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return EXIT_SUCCESS;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return EXIT_FAILURE;
+  }
+  if (!context->paused) {
+    update_lights(context->run_time);
+  }
+  update_uniform_buffer(context);
+  return example_draw(context);
+}
+
+static void example_on_view_changed(wgpu_example_context_t* context)
+{
+  camera_update_aspect_ratio(context->camera,
+                             context->window_size.aspect_ratio);
+}
+
+// Clean up used resources
+static void example_destroy(wgpu_example_context_t* context)
+{
+  camera_release(context->camera);
+  wgpu_light_manager_destroy(light_manager);
+  light_manager = NULL;
+  light_count   = 0;
+  wgpu_destroy_buffer(&sphere.vertices);
+  wgpu_destroy_buffer(&sphere.indices);
+  wgpu_destroy_buffer(&scene_uniform_buffer);
+  WGPU_RELEASE_RESOURCE(BindGroup, scene_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, scene_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, sphere_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ground_pipeline)
+}
+
+void example_forward_plus_lighting(int argc, char* argv[])
+{
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = true,
+      .gpu_timer = true,
+    },
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_on_view_changed_func = &example_on_view_changed,
+  });
+  // clang-format on
+}
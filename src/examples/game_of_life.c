@@ -1,15 +1,27 @@
 #include "example_base.h"
-#include "meshes.h"
+
+#include <string.h>
+
+#include "../webgpu/imgui_overlay.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Conway's Game of Life
  *
- * This example shows how to make Conway's game of life. First, use compute
- * shader to calculate how cells grow or die. Then use render pipeline to draw
- * cells by using instance mesh.
+ * This example shows how to make Conway's game of life with a bit-packed
+ * engine: every u32 stores 32 cells of a row. The compute shader loads a tile
+ * of the grid including a halo once into workgroup memory and evolves all 32
+ * cells of a word at once with a bit-sliced neighbor count adder. Several
+ * generations can be computed per dispatch, every generation consumes one row
+ * / cell of the halo. The grid is drawn with a fullscreen pass that reads the
+ * packed cells directly, which keeps grids of 16K x 16K cells and beyond
+ * interactive.
+ *
+ * A CPU bitboard implementation of the same algorithm serves as reference to
+ * validate the GPU results and as CPU baseline for benchmarking.
  *
  * Ref:
  * https://github.com/webgpu/webgpu-samples/tree/main/src/sample/gameOfLife
+ * https://conwaylife.com/wiki/Bit-sliced_counting
  * -------------------------------------------------------------------------- */
 
 /* -------------------------------------------------------------------------- *
@@ -17,53 +29,76 @@
  * -------------------------------------------------------------------------- */
 
 static const char* compute_shader_wgsl;
-static const char* fragment_shader_wgsl;
-static const char* vertex_shader_wgsl;
+static const char* graphics_shader_wgsl;
 
 /* -------------------------------------------------------------------------- *
  * Conway's Game of Life example
  * -------------------------------------------------------------------------- */
 
+#define CELLS_PER_WORD 32u
+/* Workgroup tile in words x rows, must match the compute shader */
+#define TILE_WORDS 8u
+#define TILE_ROWS 32u
+/* Maximum number of generations per dispatch (halo rows), see shader */
+#define MAX_STEPS_PER_DISPATCH 8u
+/* Generations computed on the GPU and the CPU for validation */
+#define VALIDATION_GENERATIONS 16u
+
+static const char* grid_size_names[8] = {
+  "256", "512", "1024", "2048", "4096", "8192", "16384", "32768",
+};
+
 static struct {
-  uint32_t width;
-  uint32_t height;
-  uint32_t timestep;
-  uint32_t workgroup_size;
+  int32_t grid_size_index;
+  int32_t steps_per_dispatch;   /* generations per dispatch */
+  int32_t dispatches_per_frame; /* dispatches per rendered frame */
+  bool paused;
+  float zoom; /* log2 of the number of cells per pixel */
 } game_options = {
-  .width          = 128,
-  .height         = 128,
-  .timestep       = 4,
-  .workgroup_size = 8,
+  .grid_size_index      = 6, /* 16384 x 16384 cells */
+  .steps_per_dispatch   = 4,
+  .dispatches_per_frame = 1,
+  .paused               = false,
+  .zoom                 = 3.0f,
 };
 
 static struct {
+  uint32_t width;  /* cells, multiple of CELLS_PER_WORD */
+  uint32_t height; /* cells */
+  uint32_t words_per_row;
+  uint64_t generation;
+  uint32_t current; /* index of the cell buffer holding the generation */
+} grid = {0};
+
+static struct {
+  wgpu_buffer_t cells[2];
   struct {
     wgpu_buffer_t handle;
-  } square;
-  struct {
-    wgpu_buffer_t handle;
-    uint32_t data[2];
-  } size;
-  struct {
-    wgpu_buffer_t handle;
-    uint32_t* data;
-  } buffer0;
+    struct {
+      uint32_t words_per_row;
+      uint32_t height;
+    } data;
+  } grid;
   struct {
     wgpu_buffer_t handle;
-  } buffer1;
+    struct {
+      uint32_t grid_size[2]; /* cells */
+      uint32_t words_per_row;
+      uint32_t padding0;
+      float offset[2]; /* cell at the top left corner of the screen */
+      float cells_per_pixel;
+      float padding1;
+    } data;
+  } view;
 } buffers = {0};
 
-static struct {
-  WGPUBindGroup uniform;
-  WGPUBindGroup bind_group0;
-  WGPUBindGroup bind_group1;
-} bind_groups = {0};
-
 // Resources for the compute part of the example
 static struct {
   WGPUBindGroupLayout bind_group_layout;
   WGPUPipelineLayout pipeline_layout;
-  WGPUComputePipeline pipeline;
+  /* One pipeline per number of generations per dispatch, created on demand */
+  WGPUComputePipeline pipelines[MAX_STEPS_PER_DISPATCH];
+  WGPUBindGroup bind_groups[2]; /* [i]: cells[i] -> cells[1 - i] */
 } compute = {0};
 
 // Resources for the graphics part of the example
@@ -71,6 +106,7 @@ static struct {
   WGPUBindGroupLayout bind_group_layout;
   WGPUPipelineLayout pipeline_layout;
   WGPURenderPipeline pipeline;
+  WGPUBindGroup bind_groups[2]; /* [i]: draws cells[i] */
 } graphics = {0};
 
 // Render pass descriptor for frame buffer writes
@@ -79,121 +115,298 @@ static struct {
   WGPURenderPassDescriptor descriptor;
 } render_pass = {0};
 
-// Used during render step
-static uint32_t whole_time = 0, loop_times = 0;
+// Validation of the GPU results against the CPU reference
+typedef enum validation_state_t {
+  VALIDATION_STATE_IDLE,
+  VALIDATION_STATE_READ_INITIAL,  /* record the readback of the start grid */
+  VALIDATION_STATE_WAIT_INITIAL,  /* waiting for the start grid */
+  VALIDATION_STATE_STEP,          /* evolve the grid and read it back */
+  VALIDATION_STATE_WAIT_EVOLVED,  /* waiting for the evolved grid */
+} validation_state_t;
+
+static struct {
+  validation_state_t state;
+  uint32_t token; /* invalidates pending readbacks when the grid changes */
+  uint32_t* initial_cells;
+  uint32_t generations;
+  /* Results of the last validation */
+  bool validated;
+  bool passed;
+  uint64_t mismatching_words;
+  float cpu_ms_per_generation;
+} validation = {0};
+
+// View state
+static struct {
+  float offset[2]; /* cell at the top left corner of the screen */
+  vec2 last_mouse_position;
+} view = {0};
 
 // Other variables
 static const char* example_title = "Conway's Game of Life";
 static bool prepared             = false;
 
-static uint32_t get_cell_count(void)
+static uint64_t get_word_count(void)
 {
-  return game_options.width * game_options.height;
+  return (uint64_t)grid.words_per_row * grid.height;
 }
 
-static void update_size_uniform_buffer(wgpu_context_t* wgpu_context)
+/* -------------------------------------------------------------------------- *
+ * CPU reference
+ *
+ * Bitboard implementation of the algorithm used by the compute shader,
+ * evolving 32 cells per operation on a torus.
+ * -------------------------------------------------------------------------- */
+
+/* Next generation of the 32 cells in word c, a (above) and b (below) are the
+ * vertical neighbors, the *l / *r words the horizontal neighbors of each row */
+static inline uint32_t life_evolve_word(uint32_t al, uint32_t a, uint32_t ar,
+                                        uint32_t cl, uint32_t c, uint32_t cr,
+                                        uint32_t bl, uint32_t b, uint32_t br)
 {
-  // Update the buffer data
-  buffers.size.data[0] = game_options.width;
-  buffers.size.data[1] = game_options.height;
+  /* Bit i holds cell i of the word, west / east neighbors by shifting */
+  const uint32_t aw = (a << 1) | (al >> 31), ae = (a >> 1) | (ar << 31);
+  const uint32_t cw = (c << 1) | (cl >> 31), ce = (c >> 1) | (cr << 31);
+  const uint32_t bw = (b << 1) | (bl >> 31), be = (b >> 1) | (br << 31);
+
+  /* Bit-sliced adder: neighbor counts per row (above / below 0..3, own 0..2) */
+  const uint32_t a_sum = aw ^ a ^ ae, a_carry = (aw & a) | (ae & (aw ^ a));
+  const uint32_t b_sum = bw ^ b ^ be, b_carry = (bw & b) | (be & (bw ^ b));
+  const uint32_t c_sum = cw ^ ce, c_carry = cw & ce;
+
+  /* Sum of the rows: ones + 2 * twos + 4 * fours (a count of 8 wraps to 0) */
+  const uint32_t ones   = a_sum ^ b_sum ^ c_sum;
+  const uint32_t ones_c = (a_sum & b_sum) | (c_sum & (a_sum ^ b_sum));
+  const uint32_t twos_s = a_carry ^ b_carry ^ c_carry;
+  const uint32_t twos_c = (a_carry & b_carry) | (c_carry & (a_carry ^ b_carry));
+  const uint32_t twos   = twos_s ^ ones_c;
+  const uint32_t fours  = twos_c ^ (twos_s & ones_c);
+
+  /* Alive with 3 neighbors, or alive with 2 neighbors */
+  return twos & ~fours & (ones | c);
+}
 
-  // Map uniform buffer and update it
-  wgpu_queue_write_buffer(wgpu_context, buffers.size.handle.buffer, 0,
-                          buffers.size.data, buffers.size.handle.size);
+static void life_step_cpu(const uint32_t* src, uint32_t* dst,
+                          uint32_t words_per_row, uint32_t height)
+{
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint32_t* a = &src[((y + height - 1) % height) * words_per_row];
+    const uint32_t* c = &src[y * words_per_row];
+    const uint32_t* b = &src[((y + 1) % height) * words_per_row];
+    uint32_t* d       = &dst[y * words_per_row];
+    for (uint32_t x = 0; x < words_per_row; ++x) {
+      const uint32_t l = (x + words_per_row - 1) % words_per_row;
+      const uint32_t r = (x + 1) % words_per_row;
+      d[x] = life_evolve_word(a[l], a[x], a[r], c[l], c[x], c[r], b[l], b[x],
+                              b[r]);
+    }
+  }
 }
 
-static void prepare_static_buffers(wgpu_context_t* wgpu_context)
+/* -------------------------------------------------------------------------- *
+ * Validation
+ * -------------------------------------------------------------------------- */
+
+static void reset_validation(void)
 {
-  /* Square vertex buffer */
-  {
-    // Setup vertices of the square
-    uint32_t square_vertices[8] = {0, 0, 0, 1, 1, 0, 1, 1};
+  ++validation.token;
+  validation.state = VALIDATION_STATE_IDLE;
+  if (validation.initial_cells != NULL) {
+    free(validation.initial_cells);
+    validation.initial_cells = NULL;
+  }
+}
 
-    // Create the vertex buffer
-    buffers.square.handle = wgpu_create_buffer(
-      wgpu_context, &(wgpu_buffer_desc_t){
-                      .label = "Square vertex buffer",
-                      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-                      .size  = sizeof(square_vertices),
-                      .initial.data = square_vertices,
-                    });
+static void read_initial_cells_cb(const wgpu_readback_result_t* result,
+                                  void* user_data)
+{
+  if ((uint32_t)(uintptr_t)user_data != validation.token
+      || validation.state != VALIDATION_STATE_WAIT_INITIAL) {
+    return;
+  }
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS) {
+    log_error("Game of Life: could not read back the grid");
+    reset_validation();
+    return;
   }
 
-  /* Size uniform buffer */
-  {
-    buffers.size.handle = wgpu_create_buffer(
-      wgpu_context,
-      &(wgpu_buffer_desc_t){
-        .label = "Size uniform buffer",
-        .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Uniform
-                 | WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-        .size = sizeof(buffers.size.data),
-      });
+  validation.initial_cells = (uint32_t*)malloc(result->size);
+  memcpy(validation.initial_cells, result->data, result->size);
+  validation.state = VALIDATION_STATE_STEP;
+}
 
-    update_size_uniform_buffer(wgpu_context);
+static void read_evolved_cells_cb(const wgpu_readback_result_t* result,
+                                  void* user_data)
+{
+  if ((uint32_t)(uintptr_t)user_data != validation.token
+      || validation.state != VALIDATION_STATE_WAIT_EVOLVED) {
+    return;
+  }
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS) {
+    log_error("Game of Life: could not read back the grid");
+    reset_validation();
+    return;
+  }
+
+  /* Evolve the start grid on the CPU */
+  const uint64_t word_count = get_word_count();
+  uint32_t* cells[2]        = {
+    validation.initial_cells,
+    (uint32_t*)malloc(word_count * sizeof(uint32_t)),
+  };
+  const uint64_t start_ns = platform_get_timestamp_ns();
+  for (uint32_t i = 0; i < validation.generations; ++i) {
+    life_step_cpu(cells[i % 2], cells[(i + 1) % 2], grid.words_per_row,
+                  grid.height);
+  }
+  const uint64_t end_ns = platform_get_timestamp_ns();
+  const uint32_t* expected = cells[validation.generations % 2];
+
+  /* Compare against the GPU result */
+  const uint32_t* actual       = (const uint32_t*)result->data;
+  validation.mismatching_words = 0;
+  for (uint64_t i = 0; i < word_count; ++i) {
+    if (actual[i] != expected[i]) {
+      ++validation.mismatching_words;
+    }
   }
+  validation.validated = true;
+  validation.passed    = validation.mismatching_words == 0;
+  validation.cpu_ms_per_generation
+    = (float)((double)(end_ns - start_ns) / 1000000.0
+              / validation.generations);
+  if (validation.passed) {
+    log_info("Game of Life: %u generations on %ux%u cells match the CPU "
+             "reference (CPU: %.2f ms / generation)",
+             validation.generations, grid.width, grid.height,
+             validation.cpu_ms_per_generation);
+  }
+  else {
+    log_error("Game of Life: %llu of %llu words differ from the CPU reference "
+              "after %u generations",
+              (unsigned long long)validation.mismatching_words,
+              (unsigned long long)word_count, validation.generations);
+  }
+
+  free(cells[0]);
+  free(cells[1]);
+  validation.initial_cells = NULL;
+  validation.state         = VALIDATION_STATE_IDLE;
 }
 
-static float float_random(float min, float max)
+/* -------------------------------------------------------------------------- *
+ * Grid
+ * -------------------------------------------------------------------------- */
+
+/* Random number generator filling 32 cells at a time, seeded by rand() */
+static uint32_t xorshift32(uint32_t* state)
 {
-  const float scale = rand() / (float)RAND_MAX; /* [0, 1.0]   */
-  return min + scale * (max - min);             /* [min, max] */
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
 }
 
-static void prepare_storage_buffers(wgpu_context_t* wgpu_context)
+static void update_grid_uniform_buffer(wgpu_context_t* wgpu_context)
 {
-  wgpu_destroy_buffer(&buffers.buffer0.handle);
-  wgpu_destroy_buffer(&buffers.buffer1.handle);
+  buffers.grid.data.words_per_row = grid.words_per_row;
+  buffers.grid.data.height        = grid.height;
+  wgpu_queue_write_buffer(wgpu_context, buffers.grid.handle.buffer, 0,
+                          &buffers.grid.data, sizeof(buffers.grid.data));
+}
 
-  if (buffers.buffer0.data) {
-    free(buffers.buffer0.data);
-    buffers.buffer0.data = NULL;
-  }
+static void update_view_uniform_buffer(wgpu_context_t* wgpu_context)
+{
+  buffers.view.data.grid_size[0]    = grid.width;
+  buffers.view.data.grid_size[1]    = grid.height;
+  buffers.view.data.words_per_row   = grid.words_per_row;
+  buffers.view.data.offset[0]       = view.offset[0];
+  buffers.view.data.offset[1]       = view.offset[1];
+  buffers.view.data.cells_per_pixel = powf(2.0f, game_options.zoom);
+  wgpu_queue_write_buffer(wgpu_context, buffers.view.handle.buffer, 0,
+                          &buffers.view.data, sizeof(buffers.view.data));
+}
 
-  // Update the buffer data
-  const uint32_t cell_count = get_cell_count();
-  const uint32_t length     = cell_count * sizeof(uint32_t);
-  buffers.buffer0.data      = (uint32_t*)malloc(length);
-  for (uint32_t i = 0; i < cell_count; ++i) {
-    buffers.buffer0.data[i] = float_random(0.0f, 1.0f) < 0.25f ? 1 : 0;
-  }
+static void prepare_uniform_buffers(wgpu_context_t* wgpu_context)
+{
+  buffers.grid.handle = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Grid uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(buffers.grid.data),
+                  });
+  buffers.view.handle = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "View uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(buffers.view.data),
+                  });
+}
 
-  /* Storage buffer 0 */
-  {
-    buffers.buffer0.handle = wgpu_create_buffer(
-      wgpu_context, &(wgpu_buffer_desc_t){
-                      .label = "Storage buffer 0",
-                      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage
-                               | WGPUBufferUsage_Vertex,
-                      .size         = length,
-                      .initial.data = buffers.buffer0.data,
-                    });
-    ASSERT(buffers.buffer0.handle.buffer != NULL);
+static void prepare_cell_buffers(wgpu_context_t* wgpu_context)
+{
+  wgpu_destroy_buffer(&buffers.cells[0]);
+  wgpu_destroy_buffer(&buffers.cells[1]);
+
+  const uint32_t size
+    = (uint32_t)atoi(grid_size_names[game_options.grid_size_index]);
+  grid.width          = size;
+  grid.height         = size;
+  grid.words_per_row  = size / CELLS_PER_WORD;
+  grid.generation     = 0;
+  grid.current        = 0;
+
+  // Random start grid with 25% living cells
+  const uint64_t word_count = get_word_count();
+  uint32_t* cells = (uint32_t*)malloc(word_count * sizeof(uint32_t));
+  uint32_t state  = (uint32_t)rand() | 1u;
+  for (uint64_t i = 0; i < word_count; ++i) {
+    cells[i] = xorshift32(&state) & xorshift32(&state);
   }
 
-  /* Storage buffer 1 */
-  {
-    buffers.buffer1.handle = wgpu_create_buffer(
+  const uint32_t buffer_size = (uint32_t)(word_count * sizeof(uint32_t));
+  for (uint32_t i = 0; i < 2; ++i) {
+    buffers.cells[i] = wgpu_create_buffer(
       wgpu_context, &(wgpu_buffer_desc_t){
-                      .label = "Storage buffer 1",
-                      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage
-                               | WGPUBufferUsage_Vertex,
-                      .size = length,
+                      .label = "Cell storage buffer",
+                      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_CopySrc
+                               | WGPUBufferUsage_Storage,
+                      .size         = buffer_size,
+                      .initial.data = i == 0 ? cells : NULL,
                     });
-    ASSERT(buffers.buffer1.handle.buffer != NULL);
+    ASSERT(buffers.cells[i].buffer != NULL);
   }
+  free(cells);
+
+  // Center the grid on the screen
+  const float cells_per_pixel = powf(2.0f, game_options.zoom);
+  view.offset[0] = (grid.width - wgpu_context->surface.width * cells_per_pixel)
+                   * 0.5f;
+  view.offset[1]
+    = (grid.height - wgpu_context->surface.height * cells_per_pixel) * 0.5f;
+
+  update_grid_uniform_buffer(wgpu_context);
+  update_view_uniform_buffer(wgpu_context);
+  reset_validation();
+  validation.validated = false;
 }
 
-static void setup_bind_group_layout_compute(wgpu_context_t* wgpu_context)
+/* -------------------------------------------------------------------------- *
+ * Compute
+ * -------------------------------------------------------------------------- */
+
+static void prepare_compute(wgpu_context_t* wgpu_context)
 {
   WGPUBindGroupLayoutEntry bgl_entries[3] = {
     [0] = (WGPUBindGroupLayoutEntry) {
-      /* Binding 0: Storage buffer (size) */
+      /* Binding 0: Uniform buffer (grid) */
       .binding    = 0,
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
-        .type             = WGPUBufferBindingType_ReadOnlyStorage,
-        .minBindingSize   = buffers.size.handle.size,
+        .type             = WGPUBufferBindingType_Uniform,
+        .minBindingSize   = buffers.grid.handle.size,
       },
       .sampler = {0},
     },
@@ -203,7 +416,6 @@ static void setup_bind_group_layout_compute(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_ReadOnlyStorage,
-        .minBindingSize   = buffers.buffer0.handle.size,
       },
       .sampler = {0},
     },
@@ -213,7 +425,6 @@ static void setup_bind_group_layout_compute(wgpu_context_t* wgpu_context)
       .visibility = WGPUShaderStage_Compute,
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_Storage,
-        .minBindingSize   = buffers.buffer1.handle.size,
       },
       .sampler = {0},
     }
@@ -225,87 +436,29 @@ static void setup_bind_group_layout_compute(wgpu_context_t* wgpu_context)
                             .entries    = bgl_entries,
                           });
   ASSERT(compute.bind_group_layout != NULL);
-}
 
-static void setup_bind_groups_compute(wgpu_context_t* wgpu_context)
-{
-  /* Bind group 0 */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .buffer  = buffers.size.handle.buffer,
-        .size    = buffers.size.handle.size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding = 1,
-        .buffer  = buffers.buffer0.handle.buffer,
-        .size    = buffers.buffer0.handle.size,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = buffers.buffer1.handle.buffer,
-        .size    = buffers.buffer1.handle.size,
-      },
-    };
-    bind_groups.bind_group0 = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label      = "Bind group compute 0",
-                              .layout     = compute.bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_groups.bind_group0 != NULL);
-  }
-
-  /* Bind group 1 */
-  {
-    WGPUBindGroupEntry bg_entries[3] = {
-      [0] = (WGPUBindGroupEntry) {
-        .binding = 0,
-        .buffer  = buffers.size.handle.buffer,
-        .size    = buffers.size.handle.size,
-      },
-      [1] = (WGPUBindGroupEntry) {
-        .binding = 1,
-        .buffer  = buffers.buffer1.handle.buffer,
-        .size    = buffers.buffer1.handle.size,
-      },
-      [2] = (WGPUBindGroupEntry) {
-        .binding = 2,
-        .buffer  = buffers.buffer0.handle.buffer,
-        .size    = buffers.buffer0.handle.size,
-      },
-    };
-    bind_groups.bind_group1 = wgpuDeviceCreateBindGroup(
-      wgpu_context->device, &(WGPUBindGroupDescriptor){
-                              .label      = "Bind group compute 0",
-                              .layout     = compute.bind_group_layout,
-                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                              .entries    = bg_entries,
-                            });
-    ASSERT(bind_groups.bind_group1 != NULL);
-  }
-}
-
-static void prepare_pipeline_layout_compute(wgpu_context_t* wgpu_context)
-{
   compute.pipeline_layout = wgpuDeviceCreatePipelineLayout(
     wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
-                            .label                = "Ppeline layout compute",
+                            .label                = "Pipeline layout compute",
                             .bindGroupLayoutCount = 1,
                             .bindGroupLayouts     = &compute.bind_group_layout,
                           });
   ASSERT(compute.pipeline_layout != NULL);
 }
 
-static void prepare_pipeline_compute(wgpu_context_t* wgpu_context)
+static WGPUComputePipeline get_compute_pipeline(wgpu_context_t* wgpu_context,
+                                                uint32_t steps)
 {
+  ASSERT(steps >= 1 && steps <= MAX_STEPS_PER_DISPATCH);
+  if (compute.pipelines[steps - 1] != NULL) {
+    return compute.pipelines[steps - 1];
+  }
+
   // Compute shader constants
   WGPUConstantEntry constant_entries[1] = {
     [0] = (WGPUConstantEntry){
-      .key   = "blockSize",
-      .value = game_options.workgroup_size,
+      .key   = "steps",
+      .value = steps,
     },
   };
 
@@ -324,29 +477,76 @@ static void prepare_pipeline_compute(wgpu_context_t* wgpu_context)
     });
 
   // Compute pipeline
-  compute.pipeline = wgpuDeviceCreateComputePipeline(
+  compute.pipelines[steps - 1] = wgpuDeviceCreateComputePipeline(
     wgpu_context->device,
     &(WGPUComputePipelineDescriptor){
       .label   = "Compute pipeline",
       .layout  = compute.pipeline_layout,
       .compute = compute_shader.programmable_stage_descriptor,
     });
-  ASSERT(compute.pipeline != NULL);
+  ASSERT(compute.pipelines[steps - 1] != NULL);
 
   // Partial clean-up
   wgpu_shader_release(&compute_shader);
+
+  return compute.pipelines[steps - 1];
+}
+
+static void setup_compute_bind_groups(wgpu_context_t* wgpu_context)
+{
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_groups[i])
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = buffers.grid.handle.buffer,
+        .size    = buffers.grid.handle.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = buffers.cells[i].buffer,
+        .size    = buffers.cells[i].size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = buffers.cells[1 - i].buffer,
+        .size    = buffers.cells[1 - i].size,
+      },
+    };
+    compute.bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Compute bind group",
+                              .layout     = compute.bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(compute.bind_groups[i] != NULL);
+  }
 }
 
-static void prepare_bind_group_layout_graphics(wgpu_context_t* wgpu_context)
+/* -------------------------------------------------------------------------- *
+ * Graphics
+ * -------------------------------------------------------------------------- */
+
+static void prepare_graphics(wgpu_context_t* wgpu_context)
 {
-  WGPUBindGroupLayoutEntry bgl_entries[1] = {
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
     [0] = (WGPUBindGroupLayoutEntry) {
-      // Binding 0: Uniform buffer (size)
+      // Binding 0: Uniform buffer (view)
       .binding    = 0,
-      .visibility = WGPUShaderStage_Vertex,
+      .visibility = WGPUShaderStage_Fragment,
       .buffer = (WGPUBufferBindingLayout) {
         .type             = WGPUBufferBindingType_Uniform,
-        .minBindingSize   = buffers.size.handle.size,
+        .minBindingSize   = buffers.view.handle.size,
+      },
+      .sampler = {0},
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Storage buffer (cells)
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_ReadOnlyStorage,
       },
       .sampler = {0},
     },
@@ -358,29 +558,7 @@ static void prepare_bind_group_layout_graphics(wgpu_context_t* wgpu_context)
                             .entries    = bgl_entries,
                           });
   ASSERT(graphics.bind_group_layout != NULL);
-}
-
-static void setup_bind_group_graphics(wgpu_context_t* wgpu_context)
-{
-  WGPUBindGroupEntry bg_entries[1] = {
-    [0] = (WGPUBindGroupEntry) {
-      .binding = 0,
-      .buffer  = buffers.size.handle.buffer,
-      .size    = buffers.size.handle.size,
-    },
-  };
-  bind_groups.uniform = wgpuDeviceCreateBindGroup(
-    wgpu_context->device, &(WGPUBindGroupDescriptor){
-                            .label      = "Uniform bind group",
-                            .layout     = graphics.bind_group_layout,
-                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-                            .entries    = bg_entries,
-                          });
-  ASSERT(bind_groups.uniform != NULL);
-}
 
-static void prepare_pipeline_layout_graphics(wgpu_context_t* wgpu_context)
-{
   graphics.pipeline_layout = wgpuDeviceCreatePipelineLayout(
     wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
                             .label                = "Pipeline layout graphics",
@@ -388,57 +566,41 @@ static void prepare_pipeline_layout_graphics(wgpu_context_t* wgpu_context)
                             .bindGroupLayouts     = &graphics.bind_group_layout,
                           });
   ASSERT(graphics.pipeline_layout != NULL);
-}
 
-static void prepare_pipeline_graphics(wgpu_context_t* wgpu_context)
-{
   // Primitive state
   WGPUPrimitiveState primitive_state = {
-    .topology  = WGPUPrimitiveTopology_TriangleStrip,
+    .topology  = WGPUPrimitiveTopology_TriangleList,
     .frontFace = WGPUFrontFace_CCW,
     .cullMode  = WGPUCullMode_None,
   };
 
   // Color target state
-  WGPUBlendState blend_state              = wgpu_create_blend_state(true);
+  WGPUBlendState blend_state              = wgpu_create_blend_state(false);
   WGPUColorTargetState color_target_state = (WGPUColorTargetState){
     .format    = wgpu_context->swap_chain.format,
     .blend     = &blend_state,
     .writeMask = WGPUColorWriteMask_All,
   };
 
-  // Vertex buffer layouts
-  WGPU_VERTEX_BUFFER_LAYOUT(cell_stride, sizeof(uint32_t),
-                            // Attribute location 0: Cell
-                            WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Uint32, 0))
-  cell_stride_vertex_buffer_layout.stepMode = WGPUVertexStepMode_Instance;
-  WGPU_VERTEX_BUFFER_LAYOUT(square_stride, 2 * sizeof(uint32_t),
-                            // Attribute location 1: Position
-                            WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Uint32x2, 0))
-  WGPUVertexBufferLayout vertex_state_buffers[2]
-    = {cell_stride_vertex_buffer_layout, square_stride_vertex_buffer_layout};
-
-  // Vertex state
+  // Vertex state, fullscreen triangle without vertex buffers
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
     wgpu_context, &(wgpu_vertex_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
                       // Vertex shader WGSL
                       .label            = "Vertex shader WGSL",
-                      .wgsl_code.source = vertex_shader_wgsl,
-                      .entry            = "main",
+                      .wgsl_code.source = graphics_shader_wgsl,
+                      .entry            = "vs_main",
                     },
-                    .buffer_count = (uint32_t)ARRAY_SIZE(vertex_state_buffers),
-                    .buffers      = vertex_state_buffers,
                   });
 
   // Fragment state
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
     wgpu_context, &(wgpu_fragment_state_t){
                     .shader_desc = (wgpu_shader_desc_t){
-                      // Vertex shader WGSL
+                      // Fragment shader WGSL
                       .label            = "Fragment shader WGSL",
-                      .wgsl_code.source = fragment_shader_wgsl,
-                      .entry            = "main",
+                      .wgsl_code.source = graphics_shader_wgsl,
+                      .entry            = "fs_main",
                     },
                     .target_count = 1,
                     .targets      = &color_target_state,
@@ -464,8 +626,35 @@ static void prepare_pipeline_graphics(wgpu_context_t* wgpu_context)
   ASSERT(graphics.pipeline != NULL);
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
+}
+
+static void setup_graphics_bind_groups(wgpu_context_t* wgpu_context)
+{
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, graphics.bind_groups[i])
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = buffers.view.handle.buffer,
+        .size    = buffers.view.handle.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = buffers.cells[i].buffer,
+        .size    = buffers.cells[i].size,
+      },
+    };
+    graphics.bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Graphics bind group",
+                              .layout     = graphics.bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(graphics.bind_groups[i] != NULL);
+  }
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -494,6 +683,128 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   };
 }
 
+/* -------------------------------------------------------------------------- *
+ * Frame
+ * -------------------------------------------------------------------------- */
+
+static void update_view(wgpu_example_context_t* context)
+{
+  const float cells_per_pixel = powf(2.0f, game_options.zoom);
+
+  // Pan by dragging with the left mouse button
+  if (context->mouse_buttons.left
+      && !(context->show_imgui_overlay && imgui_overlay_want_capture_mouse())) {
+    view.offset[0]
+      -= (context->mouse_position[0] - view.last_mouse_position[0])
+         * cells_per_pixel;
+    view.offset[1]
+      -= (context->mouse_position[1] - view.last_mouse_position[1])
+         * cells_per_pixel;
+  }
+  glm_vec2_copy(context->mouse_position, view.last_mouse_position);
+
+  update_view_uniform_buffer(context->wgpu_context);
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  if (imgui_overlay_header("Settings")) {
+    if (imgui_overlay_combo_box(context->imgui_overlay, "Grid size",
+                                &game_options.grid_size_index,
+                                grid_size_names,
+                                (uint32_t)ARRAY_SIZE(grid_size_names))) {
+      prepare_cell_buffers(wgpu_context);
+      setup_compute_bind_groups(wgpu_context);
+      setup_graphics_bind_groups(wgpu_context);
+    }
+    imgui_overlay_slider_int(context->imgui_overlay, "Generations/dispatch",
+                             &game_options.steps_per_dispatch, 1,
+                             (int32_t)MAX_STEPS_PER_DISPATCH);
+    imgui_overlay_slider_int(context->imgui_overlay, "Dispatches/frame",
+                             &game_options.dispatches_per_frame, 0, 16);
+    const float old_cells_per_pixel = powf(2.0f, game_options.zoom);
+    if (imgui_overlay_slider_float(context->imgui_overlay, "Zoom (log2)",
+                                   &game_options.zoom, -4.0f, 8.0f, "%.1f")) {
+      // Zoom around the screen center
+      const float cells_per_pixel = powf(2.0f, game_options.zoom);
+      const float center[2]       = {
+        wgpu_context->surface.width * 0.5f,
+        wgpu_context->surface.height * 0.5f,
+      };
+      view.offset[0] += center[0] * (old_cells_per_pixel - cells_per_pixel);
+      view.offset[1] += center[1] * (old_cells_per_pixel - cells_per_pixel);
+    }
+    imgui_overlay_checkBox(context->imgui_overlay, "Paused",
+                           &game_options.paused);
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Generation: %llu", (unsigned long long)grid.generation);
+    imgui_overlay_text("Cells: %.1f M",
+                       (double)grid.width * grid.height / 1000000.0);
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms / frame",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+  }
+  if (imgui_overlay_header("CPU reference")) {
+    if (validation.state == VALIDATION_STATE_IDLE) {
+      if (imgui_overlay_button(context->imgui_overlay, "Validate")) {
+        validation.state = VALIDATION_STATE_READ_INITIAL;
+      }
+    }
+    else {
+      imgui_overlay_text("Validating...");
+    }
+    if (validation.validated) {
+      imgui_overlay_text("%s, CPU: %.2f ms / generation",
+                         validation.passed ? "Passed" : "FAILED",
+                         validation.cpu_ms_per_generation);
+    }
+  }
+}
+
+static void record_simulation(wgpu_context_t* wgpu_context,
+                              uint32_t dispatch_count)
+{
+  if (dispatch_count == 0) {
+    return;
+  }
+
+  const uint32_t steps = (uint32_t)game_options.steps_per_dispatch;
+  wgpu_context->cpass_enc
+    = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
+                                    get_compute_pipeline(wgpu_context, steps));
+  for (uint32_t i = 0; i < dispatch_count; ++i) {
+    wgpuComputePassEncoderSetBindGroup(
+      wgpu_context->cpass_enc, 0, compute.bind_groups[grid.current], 0, NULL);
+    wgpuComputePassEncoderDispatchWorkgroups(
+      wgpu_context->cpass_enc,
+      (grid.words_per_row + TILE_WORDS - 1) / TILE_WORDS,
+      (grid.height + TILE_ROWS - 1) / TILE_ROWS, 1);
+    grid.current = 1 - grid.current;
+    grid.generation += steps;
+  }
+  wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+}
+
+static void record_validation_readback(wgpu_context_t* wgpu_context,
+                                       wgpu_readback_callback_t callback)
+{
+  wgpu_readback_copy_buffer(
+    wgpu_context->readback, wgpu_context->cmd_enc,
+    &(wgpu_readback_buffer_desc_t){
+      .buffer   = buffers.cells[grid.current].buffer,
+      .size     = get_word_count() * sizeof(uint32_t),
+      .callback = callback,
+      .userdata = (void*)(uintptr_t)validation.token,
+    });
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
@@ -503,20 +814,36 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
   /* Compute pass */
-  {
-    wgpu_context->cpass_enc
-      = wgpuCommandEncoderBeginComputePass(wgpu_context->cmd_enc, NULL);
-    wgpuComputePassEncoderSetPipeline(wgpu_context->cpass_enc,
-                                      compute.pipeline);
-    wgpuComputePassEncoderSetBindGroup(
-      wgpu_context->cpass_enc, 0,
-      loop_times ? bind_groups.bind_group1 : bind_groups.bind_group0, 0, NULL);
-    wgpuComputePassEncoderDispatchWorkgroups(
-      wgpu_context->cpass_enc,
-      ceil((float)game_options.width / game_options.workgroup_size),
-      ceil((float)game_options.height / game_options.workgroup_size), 1);
-    wgpuComputePassEncoderEnd(wgpu_context->cpass_enc);
-    WGPU_RELEASE_RESOURCE(ComputePassEncoder, wgpu_context->cpass_enc)
+  switch (validation.state) {
+    case VALIDATION_STATE_READ_INITIAL:
+      // Read back the current grid as start grid for the CPU reference
+      if (wgpu_readback_can_accept(wgpu_context->readback)) {
+        record_validation_readback(wgpu_context, read_initial_cells_cb);
+        validation.state = VALIDATION_STATE_WAIT_INITIAL;
+      }
+      break;
+    case VALIDATION_STATE_STEP: {
+      // Evolve a fixed number of generations and read back the result
+      const uint32_t steps = (uint32_t)game_options.steps_per_dispatch;
+      const uint32_t dispatch_count
+        = (VALIDATION_GENERATIONS + steps - 1) / steps;
+      if (wgpu_readback_can_accept(wgpu_context->readback)) {
+        record_simulation(wgpu_context, dispatch_count);
+        record_validation_readback(wgpu_context, read_evolved_cells_cb);
+        validation.generations = dispatch_count * steps;
+        validation.state       = VALIDATION_STATE_WAIT_EVOLVED;
+      }
+    } break;
+    case VALIDATION_STATE_WAIT_INITIAL:
+    case VALIDATION_STATE_WAIT_EVOLVED:
+      // The grid must not change until the readback completed
+      break;
+    default:
+      if (!game_options.paused) {
+        record_simulation(wgpu_context,
+                          (uint32_t)game_options.dispatches_per_frame);
+      }
+      break;
   }
 
   /* Graphics render pipeline */
@@ -525,22 +852,17 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
       wgpu_context->cmd_enc, &render_pass.descriptor);
     wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
                                      graphics.pipeline);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                         loop_times ?
-                                           buffers.buffer1.handle.buffer :
-                                           buffers.buffer0.handle.buffer,
-                                         0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 1,
-                                         buffers.square.handle.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
     wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.uniform, 0, NULL);
-    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 4, get_cell_count(), 0,
-                              0);
+                                      graphics.bind_groups[grid.current], 0,
+                                      NULL);
+    wgpuRenderPassEncoderDraw(wgpu_context->rpass_enc, 3, 1, 0, 0);
     wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
     WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
   }
 
+  /* Draw ui overlay */
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
   /* Get command buffer */
   WGPUCommandBuffer command_buffer
     = wgpu_get_command_buffer(wgpu_context->cmd_enc);
@@ -572,18 +894,15 @@ static int example_draw(wgpu_example_context_t* context)
 static int example_initialize(wgpu_example_context_t* context)
 {
   if (context) {
-    prepare_static_buffers(context->wgpu_context);
-    prepare_storage_buffers(context->wgpu_context);
+    wgpu_create_readback(context->wgpu_context);
+    prepare_uniform_buffers(context->wgpu_context);
+    prepare_cell_buffers(context->wgpu_context);
     /* Compute */
-    setup_bind_group_layout_compute(context->wgpu_context);
-    setup_bind_groups_compute(context->wgpu_context);
-    prepare_pipeline_layout_compute(context->wgpu_context);
-    prepare_pipeline_compute(context->wgpu_context);
+    prepare_compute(context->wgpu_context);
+    setup_compute_bind_groups(context->wgpu_context);
     /* Graphics */
-    prepare_bind_group_layout_graphics(context->wgpu_context);
-    setup_bind_group_graphics(context->wgpu_context);
-    prepare_pipeline_layout_graphics(context->wgpu_context);
-    prepare_pipeline_graphics(context->wgpu_context);
+    prepare_graphics(context->wgpu_context);
+    setup_graphics_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
     return EXIT_SUCCESS;
@@ -598,40 +917,32 @@ static int example_render(wgpu_example_context_t* context)
     return EXIT_FAILURE;
   }
 
-  if (game_options.timestep) {
-    whole_time++;
-    if (whole_time >= game_options.timestep) {
-      example_draw(context);
-      whole_time -= game_options.timestep;
-      loop_times = 1 - loop_times;
-    }
-  }
-
-  return EXIT_SUCCESS;
+  update_view(context);
+  return example_draw(context);
 }
 
 // Clean up used resources
 static void example_destroy(wgpu_example_context_t* context)
 {
-  UNUSED_VAR(context);
-
-  if (buffers.buffer0.data) {
-    free(buffers.buffer0.data);
-    buffers.buffer0.data = NULL;
+  // Pending readbacks reference the validation state
+  wgpu_readback_flush(context->wgpu_context->readback);
+  reset_validation();
+
+  wgpu_destroy_buffer(&buffers.grid.handle);
+  wgpu_destroy_buffer(&buffers.view.handle);
+  wgpu_destroy_buffer(&buffers.cells[0]);
+  wgpu_destroy_buffer(&buffers.cells[1]);
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, compute.bind_groups[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, graphics.bind_groups[i])
   }
 
-  wgpu_destroy_buffer(&buffers.square.handle);
-  wgpu_destroy_buffer(&buffers.size.handle);
-  wgpu_destroy_buffer(&buffers.buffer0.handle);
-  wgpu_destroy_buffer(&buffers.buffer1.handle);
-
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.uniform)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.bind_group0)
-  WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.bind_group1)
-
   WGPU_RELEASE_RESOURCE(BindGroupLayout, compute.bind_group_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, compute.pipeline_layout)
-  WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipeline)
+  for (uint32_t i = 0; i < MAX_STEPS_PER_DISPATCH; ++i) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, compute.pipelines[i])
+  }
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, graphics.bind_group_layout)
   WGPU_RELEASE_RESOURCE(PipelineLayout, graphics.pipeline_layout)
@@ -644,6 +955,7 @@ void example_game_of_life(int argc, char* argv[])
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
       .title   = example_title,
+      .overlay = true,
       .vsync   = true,
     },
     .example_initialize_func = &example_initialize,
@@ -659,61 +971,150 @@ void example_game_of_life(int argc, char* argv[])
 
 // clang-format off
 static const char* compute_shader_wgsl = CODE(
-  @binding(0) @group(0) var<storage, read> size: vec2<u32>;
-  @binding(1) @group(0) var<storage, read> current: array<u32>;
-  @binding(2) @group(0) var<storage, read_write> next: array<u32>;
+  struct Grid {
+    wordsPerRow : u32,
+    height : u32,
+  }
+
+  @binding(0) @group(0) var<uniform> grid : Grid;
+  @binding(1) @group(0) var<storage, read> current : array<u32>;
+  @binding(2) @group(0) var<storage, read_write> next : array<u32>;
+
+  // Generations per dispatch, each generation consumes one halo row / cell
+  override steps : u32 = 1u;
+
+  const TILE_WORDS = 8u;
+  const TILE_ROWS = 32u;
+  const MAX_STEPS = 8u;
+  const THREAD_COUNT = 256u; // TILE_WORDS * TILE_ROWS
 
-  override blockSize = 8;
+  // Tile with one halo word left / right and MAX_STEPS halo rows above / below
+  const SHARED_WORDS = 10u; // TILE_WORDS + 2
+  const SHARED_ROWS = 48u;  // TILE_ROWS + 2 * MAX_STEPS
+  const SHARED_SIZE = 480u; // SHARED_WORDS * SHARED_ROWS
 
-  fn getIndex(x: u32, y: u32) -> u32 {
-    let h = size.y;
-    let w = size.x;
+  // Double buffered tile, generations are evolved in workgroup memory
+  var<workgroup> tile : array<u32, 960>; // 2 * SHARED_SIZE
 
-    return (y % h) * w + (x % w);
+  fn tileIndex(buffer : u32, word : u32, row : u32) -> u32 {
+    return buffer * SHARED_SIZE + row * SHARED_WORDS + word;
   }
 
-  fn getCell(x: u32, y: u32) -> u32 {
-    return current[getIndex(x, y)];
+  // Cells outside of the loaded tile are treated as dead
+  fn tileWord(buffer : u32, word : i32, row : i32, rows : i32) -> u32 {
+    if (word < 0 || word >= i32(SHARED_WORDS) || row < 0 || row >= rows) {
+      return 0u;
+    }
+    return tile[tileIndex(buffer, u32(word), u32(row))];
   }
 
-  fn countNeighbors(x: u32, y: u32) -> u32 {
-    return getCell(x - 1, y - 1) + getCell(x, y - 1) + getCell(x + 1, y - 1) +
-           getCell(x - 1, y) +                         getCell(x + 1, y) +
-           getCell(x - 1, y + 1) + getCell(x, y + 1) + getCell(x + 1, y + 1);
+  // Bit-sliced neighbor count: next generation of the 32 cells in word c
+  fn evolve(al : u32, a : u32, ar : u32, cl : u32, c : u32, cr : u32,
+            bl : u32, b : u32, br : u32) -> u32 {
+    let aw = (a << 1u) | (al >> 31u);
+    let ae = (a >> 1u) | (ar << 31u);
+    let cw = (c << 1u) | (cl >> 31u);
+    let ce = (c >> 1u) | (cr << 31u);
+    let bw = (b << 1u) | (bl >> 31u);
+    let be = (b >> 1u) | (br << 31u);
+
+    let aSum = aw ^ a ^ ae;
+    let aCarry = (aw & a) | (ae & (aw ^ a));
+    let bSum = bw ^ b ^ be;
+    let bCarry = (bw & b) | (be & (bw ^ b));
+    let cSum = cw ^ ce;
+    let cCarry = cw & ce;
+
+    let ones = aSum ^ bSum ^ cSum;
+    let onesCarry = (aSum & bSum) | (cSum & (aSum ^ bSum));
+    let twosSum = aCarry ^ bCarry ^ cCarry;
+    let twosCarry = (aCarry & bCarry) | (cCarry & (aCarry ^ bCarry));
+    let twos = twosSum ^ onesCarry;
+    let fours = twosCarry ^ (twosSum & onesCarry);
+
+    return twos & ~fours & (ones | c);
   }
 
-  @compute @workgroup_size(blockSize, blockSize)
-  fn main(@builtin(global_invocation_id) grid: vec3<u32>) {
-    let x = grid.x;
-    let y = grid.y;
-    let n = countNeighbors(x, y);
-    next[getIndex(x, y)] = select(u32(n == 3u), u32(n == 2u || n == 3u), getCell(x, y) == 1u);
- }
-);
+  @compute @workgroup_size(8, 32)
+  fn main(@builtin(workgroup_id) group : vec3<u32>,
+          @builtin(local_invocation_id) local : vec3<u32>,
+          @builtin(local_invocation_index) localIndex : u32) {
+    let halo = min(steps, MAX_STEPS);
+    let rows = TILE_ROWS + 2u * halo;
+    let originWord = group.x * TILE_WORDS;
+    let originRow = group.y * TILE_ROWS;
+
+    // Load the tile and its halo once, wrapping around the torus
+    for (var i = localIndex; i < SHARED_WORDS * rows; i += THREAD_COUNT) {
+      let word = i % SHARED_WORDS;
+      let row = i / SHARED_WORDS;
+      let x = (originWord + word + grid.wordsPerRow - 1u) % grid.wordsPerRow;
+      let y = (originRow + row + grid.height - halo) % grid.height;
+      tile[tileIndex(0u, word, row)] = current[y * grid.wordsPerRow + x];
+    }
+    workgroupBarrier();
+
+    // Evolve the tile, the valid region shrinks by one row / cell per step
+    var src = 0u;
+    for (var step = 0u; step < halo; step++) {
+      let dst = 1u - src;
+      for (var i = localIndex; i < SHARED_WORDS * rows; i += THREAD_COUNT) {
+        let w = i32(i % SHARED_WORDS);
+        let r = i32(i / SHARED_WORDS);
+        let n = i32(rows);
+        tile[tileIndex(dst, u32(w), u32(r))] = evolve(
+          tileWord(src, w - 1, r - 1, n), tileWord(src, w, r - 1, n),
+          tileWord(src, w + 1, r - 1, n), tileWord(src, w - 1, r, n),
+          tileWord(src, w, r, n), tileWord(src, w + 1, r, n),
+          tileWord(src, w - 1, r + 1, n), tileWord(src, w, r + 1, n),
+          tileWord(src, w + 1, r + 1, n));
+      }
+      workgroupBarrier();
+      src = dst;
+    }
 
-static const char* fragment_shader_wgsl = CODE(
-  @fragment
-  fn main(@location(0) cell: f32) -> @location(0) vec4<f32> {
-    return vec4<f32>(cell, cell, cell, 1.);
+    // Write back the interior of the tile
+    let x = originWord + local.x;
+    let y = originRow + local.y;
+    if (x < grid.wordsPerRow && y < grid.height) {
+      next[y * grid.wordsPerRow + x] =
+        tile[tileIndex(src, local.x + 1u, local.y + halo)];
+    }
   }
 );
 
-static const char* vertex_shader_wgsl = CODE(
-  struct Out {
-    @builtin(position) pos: vec4<f32>,
-    @location(0) cell: f32,
+static const char* graphics_shader_wgsl = CODE(
+  struct View {
+    gridSize : vec2<u32>,
+    wordsPerRow : u32,
+    offset : vec2<f32>,
+    cellsPerPixel : f32,
   }
 
-  @binding(0) @group(0) var<uniform> size: vec2<u32>;
+  @binding(0) @group(0) var<uniform> view : View;
+  @binding(1) @group(0) var<storage, read> cells : array<u32>;
 
   @vertex
-  fn main(@builtin(instance_index) i: u32, @location(0) cell: u32, @location(1) pos: vec2<u32>) -> Out {
-    let w = size.x;
-    let h = size.y;
-    let x = (f32(i % w + pos.x) / f32(w) - 0.5) * 2. * f32(w) / f32(max(w, h));
-    let y = (f32((i - (i % w)) / w + pos.y) / f32(h) - 0.5) * 2. * f32(h) / f32(max(w, h));
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32) -> @builtin(position) vec4<f32> {
+    let uv = vec2<f32>(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u));
+    return vec4<f32>(uv * 2.0 - 1.0, 0.0, 1.0);
+  }
 
-    return Out(vec4<f32>(x, y, 0., 1.), f32(cell));
+  @fragment
+  fn fs_main(@builtin(position) position : vec4<f32>) -> @location(0) vec4<f32> {
+    let cell = floor(view.offset + position.xy * view.cellsPerPixel);
+    let size = vec2<f32>(view.gridSize);
+    if (any(cell < vec2<f32>(0.0)) || any(cell >= size)) {
+      return vec4<f32>(0.05, 0.05, 0.08, 1.0);
+    }
+    let c = vec2<u32>(cell);
+    let word = cells[c.y * view.wordsPerRow + c.x / 32u];
+    // Zoomed out: show the density of the word instead of a single cell
+    var value = f32((word >> (c.x % 32u)) & 1u);
+    if (view.cellsPerPixel >= 8.0) {
+      value = min(f32(countOneBits(word)) / 12.0, 1.0);
+    }
+    return vec4<f32>(value, value, value, 1.0);
   }
 );
 // clang-format on
@@ -4,6 +4,7 @@
 
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/texture.h"
+#include "../webgpu/wgsl_preprocessor.h"
 
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - glTF Scene Rendering
@@ -11,7 +12,12 @@
  * Renders a complete scene loaded from an glTF 2.0 file. The sample uses the
  * glTF model loading functions, and adds data structures, functions and shaders
  * required to render a more complex scene using Crytek's Sponza model with
- * per-material pipelines and normal mapping.
+ * normal mapping. The geometry is fetched in the vertex shader (vertex
+ * pulling) and the material textures are packed into texture arrays, so all
+ * materials share one pipeline per cull mode and a single bind group instead
+ * of using one pipeline and one bind group per material. The scene is rendered
+ * through the depth pre-pass, so the fragments of the overlapping geometry are
+ * shaded once.
  *
  * Ref:
  * https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfscenerendering/gltfscenerendering.cpp
@@ -28,23 +34,12 @@ static struct {
   .light_pos = {0.0f, 5.0f, 0.0f, 1.0f},
 };
 
-typedef struct {
-  bool alpha_mask;
-  float alpha_mask_cutoff;
-} ubo_material_consts_t;
-
 static struct {
   wgpu_buffer_t ubo_scene;
-  struct {
-    WGPUBuffer* buffers;
-    uint32_t buffer_count;
-  } ubo_material_consts;
 } ubo_buffers = {0};
 
 static struct {
   WGPUBindGroupLayout ubo_scene;
-  WGPUBindGroupLayout ubo_primitive;
-  WGPUBindGroupLayout textures;
 } bind_group_layouts = {0};
 
 static struct {
@@ -55,6 +50,125 @@ static WGPURenderPassColorAttachment rp_color_att_descriptors[1] = {0};
 static WGPURenderPassDescriptor render_pass_desc                 = {0};
 static WGPUPipelineLayout pipeline_layout                        = NULL;
 
+// Pipeline variants per cull mode (single / double sided) and alpha mode
+// (opaque / mask), the materials are assigned the variants of the current pass
+static wgpu_depth_prepass_pipeline_t pipelines[2][2] = {0};
+
+// Shaders, in chunks below the string length limit of C99
+// clang-format off
+static const char* scene_shader_wgsl[4] = {
+  WGPU_GLTF_VERTEX_PULLING_WGSL(2),
+  WGPU_GLTF_TEXTURE_ARRAYS_WGSL(1),
+  CODE(
+  struct UBOScene {
+    projection : mat4x4<f32>,
+    view : mat4x4<f32>,
+    lightPos : vec4<f32>,
+    viewPos : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> uboScene : UBOScene;
+
+  struct VertexOutput {
+    @builtin(position) @invariant position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+    @location(1) color : vec3<f32>,
+    @location(2) uv : vec2<f32>,
+    @location(3) viewVec : vec3<f32>,
+    @location(4) lightVec : vec3<f32>,
+    @location(5) tangent : vec4<f32>,
+    @location(6) @interpolate(flat) materialIndex : u32,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32,
+             @builtin(instance_index) drawIndex : u32) -> VertexOutput {
+    let draw = gltfDraws[drawIndex];
+    let vertex = gltfFetchVertex(vertexIndex);
+    let model = gltfMeshMatrices[draw.meshIndex];
+    let pos = model * vec4(vertex.position, 1.0);
+    let normalMatrix = mat3x3(model[0].xyz, model[1].xyz, model[2].xyz);
+    var output : VertexOutput;
+    output.position = uboScene.projection * uboScene.view * pos;
+    output.normal = normalMatrix * vertex.normal;
+    output.color = vertex.color.rgb;
+    output.uv = vertex.uv;
+    output.tangent = vec4(normalMatrix * vertex.tangent.xyz, vertex.tangent.w);
+    output.lightVec = uboScene.lightPos.xyz - pos.xyz;
+    output.viewVec = uboScene.viewPos.xyz - pos.xyz;
+    output.materialIndex = draw.materialIndex;
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4<f32> {
+    let material = gltfMaterials[input.materialIndex];
+    // Texture gradients have to be computed in uniform control flow
+    let ddx = dpdx(input.uv);
+    let ddy = dpdy(input.uv);
+    let color = gltfSampleTexture(material.baseColorTexture, input.uv, ddx, ddy,
+                                  vec4(1.0)) * vec4(input.color, 1.0);
+    // Alpha mask
+    if (material.alphaMode == 1u && color.a < material.alphaCutoff) {
+      discard;
+    }
+
+    var N = normalize(input.normal);
+    let T = normalize(input.tangent.xyz);
+    let B = cross(input.normal, input.tangent.xyz) * input.tangent.w;
+    let TBN = mat3x3(T, B, N);
+    let normalSample = gltfSampleTexture(material.normalTexture, input.uv, ddx,
+                                         ddy, vec4(0.5, 0.5, 1.0, 1.0));
+    N = TBN * normalize(normalSample.xyz * 2.0 - vec3(1.0));
+
+    let ambient = 0.1;
+    let L = normalize(input.lightVec);
+    let V = normalize(input.viewVec);
+    let R = reflect(-L, N);
+    let diffuse = vec3(max(dot(N, L), ambient));
+    let specular = pow(max(dot(R, V), 0.0), 32.0);
+    return vec4(diffuse * color.rgb + specular, color.a);
+  }
+  ),
+  /* Depth pre-pass entry points */
+  CODE(
+  struct DepthOutput {
+    @builtin(position) @invariant position : vec4<f32>,
+    @location(0) uv : vec2<f32>,
+    @location(1) @interpolate(flat) materialIndex : u32,
+  }
+
+  // Depth pre-pass, the position has to match vs_main
+  @vertex
+  fn vs_depth(@builtin(vertex_index) vertexIndex : u32,
+              @builtin(instance_index) drawIndex : u32) -> DepthOutput {
+    let draw = gltfDraws[drawIndex];
+    let vertex = gltfFetchVertex(vertexIndex);
+    let model = gltfMeshMatrices[draw.meshIndex];
+    let pos = model * vec4(vertex.position, 1.0);
+    var output : DepthOutput;
+    output.position = uboScene.projection * uboScene.view * pos;
+    output.uv = vertex.uv;
+    output.materialIndex = draw.materialIndex;
+    return output;
+  }
+
+  // Alpha mask of the depth pre-pass, matches the discard of fs_main
+  @fragment
+  fn fs_depth(input : DepthOutput) {
+    let material = gltfMaterials[input.materialIndex];
+    let ddx = dpdx(input.uv);
+    let ddy = dpdy(input.uv);
+    let alpha = gltfSampleTexture(material.baseColorTexture, input.uv, ddx, ddy,
+                                  vec4(1.0)).a;
+    if (alpha < material.alphaCutoff) {
+      discard;
+    }
+  }
+  ),
+};
+// clang-format on
+
 // Other variables
 static const char* example_title = "glTF Scene Rendering";
 static bool prepared             = false;
@@ -72,7 +186,8 @@ static void setup_camera(wgpu_example_context_t* context)
 
 static void load_assets(wgpu_context_t* wgpu_context)
 {
-  const uint32_t gltf_loading_flags = WGPU_GLTF_FileLoadingFlags_None;
+  const uint32_t gltf_loading_flags
+    = WGPU_GLTF_FileLoadingFlags_PackTextureArrays;
   gltf_model = wgpu_gltf_model_load_from_file(&(wgpu_gltf_model_load_options_t){
     .wgpu_context       = wgpu_context,
     .filename           = "models/Sponza/glTF/Sponza.gltf",
@@ -109,98 +224,14 @@ static void setup_pipeline_layout(wgpu_context_t* wgpu_context)
     ASSERT(bind_group_layouts.ubo_scene != NULL);
   }
 
-  // Bind group layout to pass mesh matrix to the shader
-  {
-    WGPUBindGroupLayoutEntry bgl_entry = {
-        // Binding 0: Uniform buffer (Vertex shader) => Primitive
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Vertex,
-        .buffer = (WGPUBufferBindingLayout){
-          .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = sizeof(mat4),
-        },
-        .texture = {0},
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .label      = "Mesh matrix - Bind group layout",
-      .entryCount = 1,
-      .entries    = &bgl_entry,
-    };
-    bind_group_layouts.ubo_primitive
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(bind_group_layouts.ubo_primitive != NULL);
-  }
-
-  // Bind group layout for passing material textures and material constants
-  {
-    WGPUBindGroupLayoutEntry bgl_entries[5] = {
-      [0] = (WGPUBindGroupLayoutEntry) {
-        // Binding 0: texture2D (Fragment shader) => Color map
-        .binding    = 0,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-          .multisampled  = false,
-        },
-        .storageTexture = {0},
-      },
-      [1] = (WGPUBindGroupLayoutEntry) {
-        // Binding 1: sampler (Fragment shader) => Color map
-        .binding    = 1,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      },
-      [2] = (WGPUBindGroupLayoutEntry) {
-        // Binding 2: texture2D (Fragment shader) => Normal map
-        .binding    = 2,
-        .visibility = WGPUShaderStage_Fragment,
-        .texture = (WGPUTextureBindingLayout) {
-          .sampleType    = WGPUTextureSampleType_Float,
-          .viewDimension = WGPUTextureViewDimension_2D,
-          .multisampled  = false,
-        },
-        .storageTexture = {0},
-      },
-      [3] = (WGPUBindGroupLayoutEntry) {
-        // Binding 3: sampler (Fragment shader) => Normal map
-        .binding    = 3,
-        .visibility = WGPUShaderStage_Fragment,
-        .sampler = (WGPUSamplerBindingLayout){
-          .type = WGPUSamplerBindingType_Filtering,
-        },
-        .texture = {0},
-      },
-      [4] = (WGPUBindGroupLayoutEntry) {
-        // Binding 4: Uniform buffer (Fragment shader) => MaterialConsts
-        .binding    = 4,
-        .visibility = WGPUShaderStage_Fragment,
-        .buffer = (WGPUBufferBindingLayout){
-          .type           = WGPUBufferBindingType_Uniform,
-          .minBindingSize = sizeof(ubo_material_consts_t),
-        },
-        .texture = {0},
-      },
-    };
-    WGPUBindGroupLayoutDescriptor bgl_desc = {
-      .label      = "Material - Bind group layout",
-      .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
-      .entries    = bgl_entries,
-    };
-    bind_group_layouts.textures
-      = wgpuDeviceCreateBindGroupLayout(wgpu_context->device, &bgl_desc);
-    ASSERT(bind_group_layouts.textures != NULL);
-  }
-
   // Pipeline layout using the bind group layouts
   {
     WGPUBindGroupLayout bind_group_layout_sets[3] = {
-      bind_group_layouts.ubo_scene,     /* set 0 */
-      bind_group_layouts.textures,      /* set 1 */
-      bind_group_layouts.ubo_primitive, /* set 2 */
+      bind_group_layouts.ubo_scene, /* set 0 */
+      /* set 1: material textures packed into texture arrays */
+      wgpu_gltf_model_get_texture_arrays_bind_group_layout(gltf_model),
+      /* set 2: vertices, indices, draws, mesh matrices and materials */
+      wgpu_gltf_model_get_vertex_pulling_bind_group_layout(gltf_model),
     };
     // Pipeline layout
     WGPUPipelineLayoutDescriptor pipeline_layout_desc = {
@@ -234,60 +265,6 @@ static void setup_bind_groups(wgpu_context_t* wgpu_context)
                             });
     ASSERT(bind_groups.ubo_scene != NULL)
   }
-
-  /* Bind group for glTF model meshes */
-  {
-    wgpu_gltf_model_prepare_nodes_bind_group(gltf_model,
-                                             bind_group_layouts.ubo_primitive);
-  }
-
-  /* Bind group for materials */
-  {
-    wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
-    for (uint32_t i = 0; i < materials.material_count; ++i) {
-      wgpu_gltf_material_t* material = &materials.materials[i];
-      if (material->base_color_texture && material->normal_texture) {
-        WGPUBindGroupEntry bg_entries[5] = {
-            [0] = (WGPUBindGroupEntry) {
-              /* Binding 0: texture2D (Fragment shader) => Color map */
-              .binding     = 0,
-              .textureView = material->base_color_texture->wgpu_texture.view,
-            },
-            [1] = (WGPUBindGroupEntry) {
-              /* Binding 1: sampler (Fragment shader) => Color map */
-              .binding = 1,
-              .sampler = material->base_color_texture->wgpu_texture.sampler,
-            },
-            [2] = (WGPUBindGroupEntry) {
-              /* Binding 2: texture2D (Fragment shader) => Normal map */
-              .binding     = 2,
-              .textureView = material->normal_texture->wgpu_texture.view,
-            },
-            [3] = (WGPUBindGroupEntry) {
-              /* Binding 3: sampler (Fragment shader) => Normal map */
-              .binding = 3,
-              .sampler =  material->normal_texture->wgpu_texture.sampler,
-            },
-            [4] = (WGPUBindGroupEntry) {
-              /* Binding 4: Uniform buffer (Fragment shader) => MaterialConsts */
-              .binding = 4,
-              .buffer  = ubo_buffers.ubo_material_consts.buffers[i],
-              .offset  = 0,
-              .size    = sizeof(ubo_material_consts_t),
-            },
-          };
-        material->bind_group = wgpuDeviceCreateBindGroup(
-          wgpu_context->device,
-          &(WGPUBindGroupDescriptor){
-            .label      = "Materials - Bind group",
-            .layout     = bind_group_layouts.textures,
-            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-            .entries    = bg_entries,
-          });
-        ASSERT(material->bind_group != NULL)
-      }
-    }
-  }
 }
 
 static void setup_render_pass(wgpu_context_t* wgpu_context)
@@ -318,8 +295,10 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   };
 }
 
-static void prepare_pipelines(wgpu_context_t* wgpu_context)
+static void prepare_pipelines(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   /* Primitive state */
   WGPUPrimitiveState primitive_state = {
     .topology  = WGPUPrimitiveTopology_TriangleList,
@@ -342,43 +321,41 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
       .depth_write_enabled = true,
     });
 
-  /* Vertex buffer layout */
-  WGPU_GLTF_VERTEX_BUFFER_LAYOUT(
-    gltf_scene,
-    /* Location 0: Position */
-    WGPU_GLTF_VERTATTR_DESC(0, WGPU_GLTF_VertexComponent_Position),
-    /* Location 1: Vertex normal */
-    WGPU_GLTF_VERTATTR_DESC(1, WGPU_GLTF_VertexComponent_Normal),
-    /* Location 2: Texture coordinates */
-    WGPU_GLTF_VERTATTR_DESC(2, WGPU_GLTF_VertexComponent_UV),
-    /* Location 3: Vertex color */
-    WGPU_GLTF_VERTATTR_DESC(3, WGPU_GLTF_VertexComponent_Color),
-    /* Location 4: Vertex tangent */
-    WGPU_GLTF_VERTATTR_DESC(4, WGPU_GLTF_VertexComponent_Tangent));
-
-  /* Vertex state */
+  /* Shader source */
+  char* shader_wgsl = wgpu_wgsl_preprocess(&(wgpu_wgsl_preprocess_desc_t){
+    .sources = {
+      .count   = (uint32_t)ARRAY_SIZE(scene_shader_wgsl),
+      .entries = scene_shader_wgsl,
+    },
+  });
+  ASSERT(shader_wgsl != NULL);
+
+  /* Vertex state, no vertex buffers as the geometry is pulled from storage */
   WGPUVertexState vertex_state = wgpu_create_vertex_state(
             wgpu_context, &(wgpu_vertex_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              /* Vertex shader SPIR-V */
-              .label = "glTF scene rendering - Vertex shader SPIR-V",
-              .file  = "shaders/gltf_scene_rendering/scene.vert.spv",
+              /* Vertex shader WGSL */
+              .label            = "glTF scene rendering - Vertex shader WGSL",
+              .wgsl_code.source = shader_wgsl,
+              .entry            = "vs_main",
             },
-            .buffer_count = 1,
-            .buffers      = &gltf_scene_vertex_buffer_layout,
+            .buffer_count = 0,
+            .buffers      = NULL,
           });
 
   /* Fragment state */
   WGPUFragmentState fragment_state = wgpu_create_fragment_state(
             wgpu_context, &(wgpu_fragment_state_t){
             .shader_desc = (wgpu_shader_desc_t){
-              /* Fragment shader SPIR-V */
-              .label = "glTF scene rendering - Fragment shader SPIR-V",
-              .file  = "shaders/gltf_scene_rendering/scene.frag.spv",
+              /* Fragment shader WGSL */
+              .label            = "glTF scene rendering - Fragment shader WGSL",
+              .wgsl_code.source = shader_wgsl,
+              .entry            = "fs_main",
             },
             .target_count = 1,
             .targets      = &color_target_state,
           });
+  free(shader_wgsl);
 
   /* Multisample state */
   WGPUMultisampleState multisample_state
@@ -398,24 +375,37 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
     .multisample  = multisample_state,
   };
 
-  // Instead of using a few fixed pipelines, we create one pipeline for each
-  // material using the properties of that material
-  wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
-  for (uint32_t i = 0; i < materials.material_count; ++i) {
-    wgpu_gltf_material_t* material = &materials.materials[i];
-    /* For double sided materials, culling will be disabled */
-    WGPUPrimitiveState* primitive_desc = &render_pipeline_descriptor.primitive;
-    primitive_desc->cullMode
-      = material->double_sided ? WGPUCullMode_None : WGPUCullMode_Back;
-    material->pipeline = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &render_pipeline_descriptor);
-    ASSERT(material->pipeline != NULL)
+  /* Depth pre-pass states: position only, with the alpha mask if needed */
+  WGPUVertexState depth_vertex_state = vertex_state;
+  depth_vertex_state.entryPoint      = "vs_depth";
+  WGPUFragmentState depth_fragment_state = {
+    .module     = fragment_state.module,
+    .entryPoint = "fs_depth",
+  };
+
+  // The material properties are read from the vertex pulling storage
+  // buffers, so only the cull mode requires a different pipeline: one for
+  // single sided and one for double sided materials (culling disabled). The
+  // depth pre-pass additionally needs the alpha mask for masked materials.
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(pipelines); ++i) {
+    render_pipeline_descriptor.primitive.cullMode
+      = (i == 1) ? WGPUCullMode_None : WGPUCullMode_Back;
+    for (uint32_t j = 0; j < (uint32_t)ARRAY_SIZE(pipelines[i]); ++j) {
+      wgpu_depth_prepass_create_pipeline(
+        context->depth_prepass,
+        &(wgpu_depth_prepass_pipeline_desc_t){
+          .descriptor     = &render_pipeline_descriptor,
+          .depth_vertex   = &depth_vertex_state,
+          .depth_fragment = (j == 1) ? &depth_fragment_state : NULL,
+        },
+        &pipelines[i][j]);
+    }
   }
 
   // Shader modules are no longer needed once the graphics pipeline has been
   // created
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -441,24 +431,6 @@ static void prepare_uniform_buffers(wgpu_example_context_t* context)
       });
     update_uniform_buffers(context);
   }
-
-  /* Material constants uniform buffer */
-  {
-    wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
-    ubo_buffers.ubo_material_consts.buffer_count = materials.material_count;
-    ubo_buffers.ubo_material_consts.buffers
-      = (WGPUBuffer*)calloc(materials.material_count, sizeof(WGPUBuffer));
-    for (uint32_t i = 0; i < materials.material_count; ++i) {
-      wgpu_gltf_material_t* material            = &materials.materials[i];
-      ubo_material_consts_t ubo_material_consts = {
-        .alpha_mask        = material->alpha_mode == AlphaMode_MASK,
-        .alpha_mask_cutoff = material->alpha_cutoff,
-      };
-      ubo_buffers.ubo_material_consts.buffers[i] = wgpu_create_buffer_from_data(
-        context->wgpu_context, &ubo_material_consts,
-        sizeof(ubo_material_consts_t), WGPUBufferUsage_Uniform);
-    }
-  }
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -468,7 +440,7 @@ static int example_initialize(wgpu_example_context_t* context)
     load_assets(context->wgpu_context);
     prepare_uniform_buffers(context);
     setup_pipeline_layout(context->wgpu_context);
-    prepare_pipelines(context->wgpu_context);
+    prepare_pipelines(context);
     setup_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
@@ -478,45 +450,79 @@ static int example_initialize(wgpu_example_context_t* context)
   return EXIT_FAILURE;
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+/* Assigns the pipeline variants of the given pass to the materials */
+static void set_material_pipelines(wgpu_depth_prepass_t* depth_prepass,
+                                   wgpu_depth_prepass_stage_t stage)
 {
-  /* Set target frame buffer */
-  rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
+  // The materials borrow the pipelines, see example_destroy
+  wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
+  for (uint32_t i = 0; i < materials.material_count; ++i) {
+    wgpu_gltf_material_t* material = &materials.materials[i];
+    const wgpu_depth_prepass_pipeline_t* pipeline
+      = &pipelines[material->double_sided ? 1 : 0]
+                  [material->alpha_mode == AlphaMode_MASK ? 1 : 0];
+    material->pipeline
+      = wgpu_depth_prepass_get_pipeline(depth_prepass, pipeline, stage);
+  }
+}
 
-  /* Create command encoder */
-  wgpu_context->cmd_enc
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+/* Draws the scene into a pass of the depth pre-pass */
+static void draw_scene(WGPURenderPassEncoder rpass_enc,
+                       wgpu_depth_prepass_stage_t stage, void* user_data)
+{
+  wgpu_example_context_t* context = (wgpu_example_context_t*)user_data;
+  wgpu_context_t* wgpu_context    = context->wgpu_context;
 
-  /* Create render pass encoder for encoding drawing commands */
-  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-    wgpu_context->cmd_enc, &render_pass_desc);
+  // All pipelines write depth and have a variant in every pass
+  set_material_pipelines(context->depth_prepass, stage);
+
+  // The glTF model is drawn into the render pass of the context
+  wgpu_context->rpass_enc = rpass_enc;
 
   /* Set the bind group */
-  wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                    bind_groups.ubo_scene, 0, 0);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.ubo_scene, 0, 0);
 
   /* Set viewport */
   wgpuRenderPassEncoderSetViewport(
-    wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
+    rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
     (float)wgpu_context->surface.height, 0.0f, 1.0f);
 
   /* Set scissor rectangle */
-  wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u,
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
-  /* Draw plane */
+  /* Draw scene */
   static wgpu_gltf_render_flags_enum_t render_flags
     = WGPU_GLTF_RenderFlags_BindImages;
-  wgpu_gltf_model_draw(gltf_model, (wgpu_gltf_model_render_options_t){
-                                     .render_flags        = render_flags,
-                                     .bind_image_set      = 1,
-                                     .bind_mesh_model_set = 2,
-                                   });
+  wgpu_gltf_model_draw_vertex_pulling(gltf_model,
+                                      (wgpu_gltf_model_render_options_t){
+                                        .render_flags        = render_flags,
+                                        .bind_image_set      = 1,
+                                        .bind_mesh_model_set = 2,
+                                        .camera_position = ubo_scene.view_pos,
+                                      });
+
+  wgpu_context->rpass_enc = NULL;
+}
 
-  /* End render pass */
-  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  /* Set target frame buffer */
+  rp_color_att_descriptors[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  /* Create command encoder */
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  /* Record the depth pre-pass (if enabled) and the color pass */
+  wgpu_depth_prepass_render(context->depth_prepass, wgpu_context->cmd_enc,
+                            &render_pass_desc, draw_scene, context);
+
+  /* Draw ui overlay */
+  draw_ui(context, NULL);
 
   /* Get command buffer */
   WGPUCommandBuffer command_buffer
@@ -535,7 +541,7 @@ static int example_draw(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   /* Submit to queue */
   submit_command_buffers(context);
@@ -562,17 +568,21 @@ static void example_on_view_changed(wgpu_example_context_t* context)
 static void example_destroy(wgpu_example_context_t* context)
 {
   camera_release(context->camera);
+
+  // The materials only borrow the pipelines
+  wgpu_gltf_materials_t materials = wgpu_gltf_model_get_materials(gltf_model);
+  for (uint32_t i = 0; i < materials.material_count; ++i) {
+    materials.materials[i].pipeline = NULL;
+  }
   wgpu_gltf_model_destroy(gltf_model);
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(pipelines); ++i) {
+    wgpu_depth_prepass_release_pipeline(&pipelines[i][0]);
+    wgpu_depth_prepass_release_pipeline(&pipelines[i][1]);
+  }
 
   WGPU_RELEASE_RESOURCE(Buffer, ubo_buffers.ubo_scene.buffer)
-  for (uint32_t i = 0; i < ubo_buffers.ubo_material_consts.buffer_count; ++i) {
-    WGPU_RELEASE_RESOURCE(Buffer, ubo_buffers.ubo_material_consts.buffers[i])
-  }
-  free(ubo_buffers.ubo_material_consts.buffers);
 
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_scene)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.ubo_primitive)
-  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.textures)
 
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.ubo_scene)
 
@@ -584,7 +594,9 @@ void example_gltf_scene_rendering(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title = example_title,
+      .title         = example_title,
+      .overlay       = true,
+      .depth_prepass = true,
     },
     .example_initialize_func      = &example_initialize,
     .example_render_func          = &example_render,
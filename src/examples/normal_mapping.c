@@ -405,6 +405,7 @@ void _camera_set_delta_time(_camera_t* this, float delta_time)
  * WGSL Shaders
  * -------------------------------------------------------------------------- */
 static const char* normal_map_vertex_shader_wgsl;
+static const char* normal_map_depth_vertex_shader_wgsl;
 static const char* normal_map_fragment_shader_wgsl;
 
 /* -------------------------------------------------------------------------- *
@@ -460,7 +461,7 @@ static struct {
 } bind_groups = {0};
 
 static struct {
-  WGPURenderPipeline normal_map;
+  wgpu_depth_prepass_pipeline_t normal_map;
 } pipelines = {0};
 
 /* Render pass descriptor for frame buffer writes */
@@ -1002,8 +1003,10 @@ static void setup_bind_group(wgpu_context_t* wgpu_context)
   ASSERT(bind_groups.normal_map != NULL);
 }
 
-static void prepare_normal_map_pipeline(wgpu_context_t* wgpu_context)
+static void prepare_normal_map_pipeline(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   // Primitive state
   WGPUPrimitiveState primitive_state = {
     .topology  = WGPUPrimitiveTopology_TriangleList,
@@ -1135,22 +1138,40 @@ static void prepare_normal_map_pipeline(wgpu_context_t* wgpu_context)
         .sample_count = 1,
       });
 
-  // Create rendering pipeline using the specified states
-  pipelines.normal_map = wgpuDeviceCreateRenderPipeline(
-    wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                            .label        = "Normal map - Render pipeline",
-                            .layout       = pipeline_layouts.normal_map,
-                            .primitive    = primitive_state,
-                            .vertex       = vertex_state,
-                            .fragment     = &fragment_state,
-                            .depthStencil = &depth_stencil_state,
-                            .multisample  = multisample_state,
-                          });
-  ASSERT(pipelines.normal_map != NULL);
+  // Position only vertex state of the depth pre-pass
+  WGPUVertexState depth_vertex_state = wgpu_create_vertex_state(
+    wgpu_context, &(wgpu_vertex_state_t){
+                    .shader_desc = (wgpu_shader_desc_t){
+                      // Vertex shader WGSL
+                      .label            = "Normal map - Depth vertex shader",
+                      .wgsl_code.source = normal_map_depth_vertex_shader_wgsl,
+                      .entry            = "main",
+                    },
+                    .buffer_count = 1,
+                    .buffers      = &normal_map_vertex_buffer_layouts[0],
+                  });
+
+  // Create rendering pipelines using the specified states
+  wgpu_depth_prepass_create_pipeline(
+    context->depth_prepass,
+    &(wgpu_depth_prepass_pipeline_desc_t){
+      .descriptor = &(WGPURenderPipelineDescriptor){
+        .label        = "Normal map - Render pipeline",
+        .layout       = pipeline_layouts.normal_map,
+        .primitive    = primitive_state,
+        .vertex       = vertex_state,
+        .fragment     = &fragment_state,
+        .depthStencil = &depth_stencil_state,
+        .multisample  = multisample_state,
+      },
+      .depth_vertex = &depth_vertex_state,
+    },
+    &pipelines.normal_map);
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, depth_vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static int example_initialize(wgpu_example_context_t* context)
@@ -1164,7 +1185,7 @@ static int example_initialize(wgpu_example_context_t* context)
     setup_bind_group_layout(context->wgpu_context);
     setup_pipeline_layout(context->wgpu_context);
     setup_bind_group(context->wgpu_context);
-    prepare_normal_map_pipeline(context->wgpu_context);
+    prepare_normal_map_pipeline(context);
     setup_render_passes();
     prepared = true;
     return EXIT_SUCCESS;
@@ -1180,74 +1201,69 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
   }
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+/* Draws the meshes into a pass of the depth pre-pass */
+static void draw_meshes(WGPURenderPassEncoder rpass_enc,
+                        wgpu_depth_prepass_stage_t stage, void* user_data)
 {
+  wgpu_example_context_t* context = (wgpu_example_context_t*)user_data;
+
+  WGPURenderPipeline pipeline = wgpu_depth_prepass_get_pipeline(
+    context->depth_prepass, &pipelines.normal_map, stage);
+  if (pipeline == NULL) {
+    return;
+  }
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+
+  /* Render torus knot mesh */
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 0, buffers.torus_knot.vertex.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, 1,
+                                       buffers.torus_knot.uv.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 2, buffers.torus_knot.normal.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 3, buffers.torus_knot.tangent.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 4, buffers.torus_knot.bitangent.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(
+    rpass_enc, buffers.torus_knot.index.buffer, WGPUIndexFormat_Uint32, 0,
+    WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.normal_map, 0, 0);
+  wgpuRenderPassEncoderDrawIndexed(rpass_enc, TORUS_KNOT_INDEX_COUNT, 1, 0, 0,
+                                   0);
+
+  /* Render plane mesh */
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 0, buffers.plane.vertex.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, 1, buffers.plane.uv.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 2, buffers.plane.normal.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 3, buffers.plane.tangent.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetVertexBuffer(
+    rpass_enc, 4, buffers.plane.bitangent.buffer, 0, WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetIndexBuffer(rpass_enc, buffers.plane.index.buffer,
+                                      WGPUIndexFormat_Uint32, 0,
+                                      WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.normal_map, 0, 0);
+  wgpuRenderPassEncoderDrawIndexed(rpass_enc, PLANE_INDEX_COUNT, 1, 0, 0, 0);
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  /* Normap map render pass */
-  {
-    render_pass.normal_map.color_attachments[0].view
-      = wgpu_context->swap_chain.frame_buffer;
-
-    /* Begin render pass */
-    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-      wgpu_context->cmd_enc, &render_pass.normal_map.descriptor);
-
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc,
-                                     pipelines.normal_map);
-
-    /* Render torus knot mesh */
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                         buffers.torus_knot.vertex.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 1,
-                                         buffers.torus_knot.uv.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 2,
-                                         buffers.torus_knot.normal.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 3,
-                                         buffers.torus_knot.tangent.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 4,
-                                         buffers.torus_knot.bitangent.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetIndexBuffer(
-      wgpu_context->rpass_enc, buffers.torus_knot.index.buffer,
-      WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.normal_map, 0, 0);
-    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc,
-                                     TORUS_KNOT_INDEX_COUNT, 1, 0, 0, 0);
-
-    /* Render plane mesh */
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 0,
-                                         buffers.plane.vertex.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(
-      wgpu_context->rpass_enc, 1, buffers.plane.uv.buffer, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 2,
-                                         buffers.plane.normal.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 3,
-                                         buffers.plane.tangent.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetVertexBuffer(wgpu_context->rpass_enc, 4,
-                                         buffers.plane.bitangent.buffer, 0,
-                                         WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetIndexBuffer(
-      wgpu_context->rpass_enc, buffers.plane.index.buffer,
-      WGPUIndexFormat_Uint32, 0, WGPU_WHOLE_SIZE);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.normal_map, 0, 0);
-    wgpuRenderPassEncoderDrawIndexed(wgpu_context->rpass_enc, PLANE_INDEX_COUNT,
-                                     1, 0, 0, 0);
-
-    /* End render pass */
-    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
-  }
+  /* Normap map render pass, preceded by the depth pre-pass if enabled */
+  render_pass.normal_map.color_attachments[0].view
+    = wgpu_context->swap_chain.frame_buffer;
+  wgpu_depth_prepass_render(context->depth_prepass, wgpu_context->cmd_enc,
+                            &render_pass.normal_map.descriptor, draw_meshes,
+                            context);
 
   /* Draw ui overlay */
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -1269,7 +1285,7 @@ static int example_draw(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   /* Submit to queue */
   submit_command_buffers(context);
@@ -1322,7 +1338,7 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.normal_map)
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layouts.normal_map)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.normal_map)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.normal_map)
+  wgpu_depth_prepass_release_pipeline(&pipelines.normal_map);
 }
 
 void example_normal_mapping(int argc, char* argv[])
@@ -1330,9 +1346,10 @@ void example_normal_mapping(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title   = example_title,
-      .overlay = true,
-      .vsync   = true,
+      .title         = example_title,
+      .overlay       = true,
+      .vsync         = true,
+      .depth_prepass = true,
     },
     .example_initialize_func = &example_initialize,
     .example_render_func     = &example_render,
@@ -1362,7 +1379,7 @@ static const char* normal_map_vertex_shader_wgsl = CODE(
   @group(0) @binding(4) var<uniform> uniformsLight : UniformLight;
 
   struct Output {
-     @builtin(position) Position : vec4<f32>,
+     @builtin(position) @invariant Position : vec4<f32>,
      @location(0) fragPosition : vec3<f32>,
      @location(1) fragUV : vec2<f32>,
      // @location(2) fragNormal : vec3<f32>,
@@ -1408,6 +1425,26 @@ static const char* normal_map_vertex_shader_wgsl = CODE(
    }
 );
 
+static const char* normal_map_depth_vertex_shader_wgsl = CODE(
+  struct Uniform {
+    pMatrix : mat4x4<f32>,
+    vMatrix : mat4x4<f32>,
+    mMatrix : mat4x4<f32>,
+  };
+  @group(0) @binding(0) var<uniform> uniforms : Uniform;
+
+  struct Output {
+     @builtin(position) @invariant Position : vec4<f32>,
+  };
+
+  @vertex
+  fn main(@location(0) pos: vec4<f32>) -> Output {
+    var output: Output;
+    output.Position = uniforms.pMatrix * uniforms.vMatrix * uniforms.mMatrix * pos;
+    return output;
+  }
+);
+
 static const char* normal_map_fragment_shader_wgsl = CODE(
   @binding(1) @group(0) var textureSampler : sampler;
   @binding(2) @group(0) var textureData : texture_2d<f32>;
@@ -101,8 +101,8 @@ static struct {
 static struct {
   WGPUQuerySet set;
   WGPUBuffer resolve_buffer;
-  WGPUBuffer result_buffer;
   size_t result_buffer_size;
+  bool readback_pending;
 } occlusion_query = {0};
 
 static struct {
@@ -175,14 +175,9 @@ static void create_occlusion_query_set_buffers(wgpu_context_t* wgpu_context)
       .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
     });
 
+  /* Query results are read back by the readback service */
   occlusion_query.result_buffer_size = CUBE_ID_COUNT * sizeof(uint64_t);
-  occlusion_query.result_buffer      = wgpuDeviceCreateBuffer(
-    wgpu_context->device,
-    &(WGPUBufferDescriptor){
-           .label = "Query set - Result buffer",
-           .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead,
-           .size  = occlusion_query.result_buffer_size,
-    });
+  wgpu_create_readback(wgpu_context);
 }
 
 // Prepare vertex and index buffers for an indexed triangle
@@ -371,8 +366,8 @@ static void prepare_pipeline(wgpu_context_t* wgpu_context)
   ASSERT(render_pipeline != NULL);
 
   /* Partial cleanup */
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static void setup_render_pass(void)
@@ -530,6 +525,23 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
   }
 }
 
+static void
+read_occlusion_query_results_cb(const wgpu_readback_result_t* result,
+                                void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  if (result->status == WGPU_READBACK_STATUS_SUCCESS) {
+    uint64_t const* mapping = (uint64_t const*)result->data;
+    ASSERT(mapping)
+    for (uint32_t i = 0; i < CUBE_ID_COUNT; ++i) {
+      printf("%lu ", mapping[i]);
+    }
+    printf("\n");
+  }
+  occlusion_query.readback_pending = false;
+}
+
 static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
 {
   /* Set color and depth-stencil attachments */
@@ -571,11 +583,14 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpuCommandEncoderResolveQuerySet(wgpu_context->cmd_enc, occlusion_query.set,
                                     0, CUBE_ID_COUNT,
                                     occlusion_query.resolve_buffer, 0);
-  if (wgpuBufferGetMapState(occlusion_query.result_buffer)
-      == WGPUBufferMapState_Unmapped) {
-    wgpuCommandEncoderCopyBufferToBuffer(
-      wgpu_context->cmd_enc, occlusion_query.resolve_buffer, 0,
-      occlusion_query.result_buffer, 0, occlusion_query.result_buffer_size);
+  if (!occlusion_query.readback_pending) {
+    occlusion_query.readback_pending = wgpu_readback_copy_buffer(
+      wgpu_context->readback, wgpu_context->cmd_enc,
+      &(wgpu_readback_buffer_desc_t){
+        .buffer   = occlusion_query.resolve_buffer,
+        .size     = occlusion_query.result_buffer_size,
+        .callback = read_occlusion_query_results_cb,
+      });
   }
 
   /* Get command buffer */
@@ -586,32 +601,6 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   return command_buffer;
 }
 
-static void read_buffer_map_cb(WGPUBufferMapAsyncStatus status, void* user_data)
-{
-  UNUSED_VAR(user_data);
-
-  if (status == WGPUBufferMapAsyncStatus_Success) {
-    uint64_t const* mapping = (uint64_t*)wgpuBufferGetConstMappedRange(
-      occlusion_query.result_buffer, 0, occlusion_query.result_buffer_size);
-    ASSERT(mapping)
-    for (uint32_t i = 0; i < CUBE_ID_COUNT; ++i) {
-      printf("%lu ", mapping[i]);
-    }
-    printf("\n");
-    wgpuBufferUnmap(occlusion_query.result_buffer);
-  }
-}
-
-static void get_occlusion_query_results(void)
-{
-  if (wgpuBufferGetMapState(occlusion_query.result_buffer)
-      == WGPUBufferMapState_Unmapped) {
-    wgpuBufferMapAsync(occlusion_query.result_buffer, WGPUMapMode_Read, 0,
-                       occlusion_query.result_buffer_size, read_buffer_map_cb,
-                       NULL);
-  }
-}
-
 static int example_draw(wgpu_example_context_t* context)
 {
   /* Prepare frame */
@@ -626,9 +615,6 @@ static int example_draw(wgpu_example_context_t* context)
   /* Submit command buffers to queue */
   submit_command_buffers(context);
 
-  /* Map and read results buffer */
-  get_occlusion_query_results();
-
   /* Submit frame */
   submit_frame(context);
 
@@ -655,7 +641,6 @@ static void example_destroy(wgpu_example_context_t* context)
 
   WGPU_RELEASE_RESOURCE(QuerySet, occlusion_query.set)
   WGPU_RELEASE_RESOURCE(Buffer, occlusion_query.resolve_buffer);
-  WGPU_RELEASE_RESOURCE(Buffer, occlusion_query.result_buffer);
 
   wgpu_destroy_buffer(&buffers.vertices);
   wgpu_destroy_buffer(&buffers.indices);
@@ -25,6 +25,7 @@
  * -------------------------------------------------------------------------- */
 
 static const char* pbr_texture_vertex_shader_wgsl;
+static const char* pbr_texture_depth_vertex_shader_wgsl;
 static const char* pbr_texture_functions_fragment_shader_wgsl;
 static const char* pbr_texture_main_fragment_shader_wgsl;
 static const char* skybox_vertex_shader_wgsl;
@@ -80,9 +81,10 @@ static struct {
   .gamma    = 2.2f,
 };
 
+// Variants for rendering with and without the depth pre-pass
 static struct {
-  WGPURenderPipeline pbr;
-  WGPURenderPipeline skybox;
+  wgpu_depth_prepass_pipeline_t pbr;
+  wgpu_depth_prepass_pipeline_t skybox;
 } pipelines = {0};
 
 static struct {
@@ -626,8 +628,10 @@ static void setup_render_pass(wgpu_context_t* wgpu_context)
   };
 }
 
-static void prepare_pipelines(wgpu_context_t* wgpu_context)
+static void prepare_pipelines(wgpu_example_context_t* context)
 {
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
   // Construct the different states making up the pipeline
 
   // Primitive state
@@ -702,22 +706,26 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
             .targets      = &color_target_state_desc,
           });
 
-    // Create rendering pipeline using the specified states
-    pipelines.skybox = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                              .label        = "Skybox - Render pipeline",
-                              .layout       = pipeline_layouts.skybox,
-                              .primitive    = primitive_state_desc,
-                              .vertex       = vertex_state_desc,
-                              .fragment     = &fragment_state_desc,
-                              .depthStencil = &depth_stencil_state_desc,
-                              .multisample  = multisample_state_desc,
-                            });
-    ASSERT(pipelines.skybox != NULL)
+    // Create rendering pipelines using the specified states, the skybox does
+    // not write depth and is left out of the depth pre-pass
+    wgpu_depth_prepass_create_pipeline(
+      context->depth_prepass,
+      &(wgpu_depth_prepass_pipeline_desc_t){
+        .descriptor = &(WGPURenderPipelineDescriptor){
+          .label        = "Skybox - Render pipeline",
+          .layout       = pipeline_layouts.skybox,
+          .primitive    = primitive_state_desc,
+          .vertex       = vertex_state_desc,
+          .fragment     = &fragment_state_desc,
+          .depthStencil = &depth_stencil_state_desc,
+          .multisample  = multisample_state_desc,
+        },
+      },
+      &pipelines.skybox);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
   }
 
   // PBR pipeline
@@ -757,22 +765,40 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
           });
     free(fragment_shader_wgsl);
 
-    // Create rendering pipeline using the specified states
-    pipelines.pbr = wgpuDeviceCreateRenderPipeline(
-      wgpu_context->device, &(WGPURenderPipelineDescriptor){
-                              .label        = "PBR - Render pipeline",
-                              .layout       = pipeline_layouts.pbr,
-                              .primitive    = primitive_state_desc,
-                              .vertex       = vertex_state_desc,
-                              .fragment     = &fragment_state_desc,
-                              .depthStencil = &depth_stencil_state_desc,
-                              .multisample  = multisample_state_desc,
-                            });
-    ASSERT(pipelines.pbr != NULL)
+    // Position only vertex state of the depth pre-pass
+    WGPUVertexState depth_vertex_state_desc = wgpu_create_vertex_state(
+            wgpu_context, &(wgpu_vertex_state_t){
+            .shader_desc = (wgpu_shader_desc_t){
+              // Vertex shader WGSL
+              .label            = "PBR texture - Depth vertex shader",
+              .wgsl_code.source = pbr_texture_depth_vertex_shader_wgsl,
+              .entry            = "main",
+            },
+            .buffer_count = 1,
+            .buffers = &skybox_vertex_buffer_layout,
+          });
+
+    // Create rendering pipelines using the specified states
+    wgpu_depth_prepass_create_pipeline(
+      context->depth_prepass,
+      &(wgpu_depth_prepass_pipeline_desc_t){
+        .descriptor = &(WGPURenderPipelineDescriptor){
+          .label        = "PBR - Render pipeline",
+          .layout       = pipeline_layouts.pbr,
+          .primitive    = primitive_state_desc,
+          .vertex       = vertex_state_desc,
+          .fragment     = &fragment_state_desc,
+          .depthStencil = &depth_stencil_state_desc,
+          .multisample  = multisample_state_desc,
+        },
+        .depth_vertex = &depth_vertex_state_desc,
+      },
+      &pipelines.pbr);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, depth_vertex_state_desc.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
   }
 }
 
@@ -872,7 +898,7 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_uniform_buffers(context);
     setup_bind_group_layouts(context->wgpu_context);
     setup_pipeline_layouts(context->wgpu_context);
-    prepare_pipelines(context->wgpu_context);
+    prepare_pipelines(context);
     setup_bind_groups(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepared = true;
@@ -895,50 +921,66 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     }
     imgui_overlay_checkBox(context->imgui_overlay, "Skybox", &display_skybox);
   }
+
 }
 
-static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
+/* Draws the scene into a pass of the depth pre-pass */
+static void draw_scene(WGPURenderPassEncoder rpass_enc,
+                       wgpu_depth_prepass_stage_t stage, void* user_data)
 {
-  // Set target frame buffer
-  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
-
-  // Create command encoder
-  wgpu_context->cmd_enc
-    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  wgpu_example_context_t* context     = (wgpu_example_context_t*)user_data;
+  wgpu_context_t* wgpu_context        = context->wgpu_context;
+  wgpu_depth_prepass_t* depth_prepass = context->depth_prepass;
 
-  // Create render pass encoder for encoding drawing commands
-  wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
-    wgpu_context->cmd_enc, &render_pass.descriptor);
+  // The glTF models are drawn into the render pass of the context
+  wgpu_context->rpass_enc = rpass_enc;
 
   // Set viewport
   wgpuRenderPassEncoderSetViewport(
-    wgpu_context->rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
+    rpass_enc, 0.0f, 0.0f, (float)wgpu_context->surface.width,
     (float)wgpu_context->surface.height, 0.0f, 1.0f);
 
   // Set scissor rectangle
-  wgpuRenderPassEncoderSetScissorRect(wgpu_context->rpass_enc, 0u, 0u,
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, 0u, 0u,
                                       wgpu_context->surface.width,
                                       wgpu_context->surface.height);
 
   // Skybox
-  if (display_skybox) {
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.skybox);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.skybox, 0, 0);
+  WGPURenderPipeline pipeline
+    = wgpu_depth_prepass_get_pipeline(depth_prepass, &pipelines.skybox, stage);
+  if (display_skybox && pipeline != NULL) {
+    wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.skybox, 0, 0);
     wgpu_gltf_model_draw(models.skybox, (wgpu_gltf_model_render_options_t){0});
   }
 
   // Objects
-  {
-    wgpuRenderPassEncoderSetPipeline(wgpu_context->rpass_enc, pipelines.pbr);
-    wgpuRenderPassEncoderSetBindGroup(wgpu_context->rpass_enc, 0,
-                                      bind_groups.object, 0, NULL);
+  pipeline
+    = wgpu_depth_prepass_get_pipeline(depth_prepass, &pipelines.pbr, stage);
+  if (pipeline != NULL) {
+    wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, bind_groups.object, 0,
+                                      NULL);
     wgpu_gltf_model_draw(models.object, (wgpu_gltf_model_render_options_t){0});
   }
 
-  // End render pass
-  wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
-  WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  wgpu_context->rpass_enc = NULL;
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  // Set target frame buffer
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Record the depth pre-pass (if enabled) and the color pass
+  wgpu_depth_prepass_render(context->depth_prepass, wgpu_context->cmd_enc,
+                            &render_pass.descriptor, draw_scene, context);
 
   // Draw ui overlay
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -960,7 +1002,7 @@ static int example_draw(wgpu_example_context_t* context)
   wgpu_context_t* wgpu_context                   = context->wgpu_context;
   wgpu_context->submit_info.command_buffer_count = 1;
   wgpu_context->submit_info.command_buffers[0]
-    = build_command_buffer(context->wgpu_context);
+    = build_command_buffer(context);
 
   // Submit to queue
   submit_command_buffers(context);
@@ -1001,8 +1043,8 @@ static void example_destroy(wgpu_example_context_t* context)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.object.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.skybox.buffer)
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffers.ubo_params.buffer)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.pbr)
-  WGPU_RELEASE_RESOURCE(RenderPipeline, pipelines.skybox)
+  wgpu_depth_prepass_release_pipeline(&pipelines.pbr);
+  wgpu_depth_prepass_release_pipeline(&pipelines.skybox);
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.object)
   WGPU_RELEASE_RESOURCE(BindGroup, bind_groups.skybox)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layouts.object)
@@ -1016,9 +1058,10 @@ void example_pbr_texture(int argc, char* argv[])
   // clang-format off
   example_run(argc, argv, &(refexport_t){
     .example_settings = (wgpu_example_settings_t){
-      .title   = example_title,
-      .overlay = true,
-      .vsync   = true,
+      .title         = example_title,
+      .overlay       = true,
+      .vsync         = true,
+      .depth_prepass = true,
     },
     .example_initialize_func      = &example_initialize,
     .example_render_func          = &example_render,
@@ -1044,7 +1087,7 @@ static const char* pbr_texture_vertex_shader_wgsl = CODE(
   @group(0) @binding(0) var<uniform> ubo : UBO;
 
   struct Output {
-    @builtin(position) position : vec4<f32>,
+    @builtin(position) @invariant position : vec4<f32>,
     @location(0) worldPos : vec3<f32>,
     @location(1) normal : vec3<f32>,
     @location(2) uv : vec2<f32>,
@@ -1074,6 +1117,31 @@ static const char* pbr_texture_vertex_shader_wgsl = CODE(
   }
 );
 
+static const char* pbr_texture_depth_vertex_shader_wgsl = CODE(
+  struct UBO {
+    projection : mat4x4<f32>,
+    model : mat4x4<f32>,
+    view : mat4x4<f32>,
+    camPos : vec3<f32>,
+  };
+
+  @group(0) @binding(0) var<uniform> ubo : UBO;
+
+  struct Output {
+    @builtin(position) @invariant position : vec4<f32>,
+  };
+
+  @vertex
+  fn main(
+    @location(0) inPos: vec3<f32>
+  ) -> Output {
+    var output: Output;
+    let locPos : vec3<f32> = (ubo.model * vec4<f32>(inPos, 1.0)).xyz;
+    output.position = ubo.projection * ubo.view * vec4<f32>(locPos, 1.0);
+    return output;
+  }
+);
+
 static const char* pbr_texture_functions_fragment_shader_wgsl = CODE(
   struct UBO {
     projection : mat4x4<f32>,
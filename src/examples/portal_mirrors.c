@@ -0,0 +1,611 @@
+#include "example_base.h"
+#include "meshes.h"
+
+#include <string.h>
+
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/portal_system.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Portal Mirrors
+ *
+ * This example shows how to use the portal system module: a room with two
+ * facing mirrors and a portal pair whose exit looks back into the room.
+ * The mirrors reflect each other, so the number of views grows with every
+ * recursion level. The views are restricted to the screen bounds of their
+ * portals and drawn with stencil masking in the frame pass, from the
+ * configurable offscreen level on they are rendered at half resolution into
+ * offscreen targets instead.
+ * -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- *
+ * WGSL Shaders
+ * -------------------------------------------------------------------------- */
+
+static const char* scene_shader_wgsl;
+
+/* -------------------------------------------------------------------------- *
+ * Portal Mirrors example
+ * -------------------------------------------------------------------------- */
+
+#define ORBIT_CUBE_COUNT 12u
+#define MAX_INSTANCE_COUNT 32u
+#define VIEW_UNIFORM_STRIDE 256u
+
+typedef struct view_uniforms_t {
+  mat4 view_projection;
+  uint8_t padding[VIEW_UNIFORM_STRIDE - sizeof(mat4)];
+} view_uniforms_t;
+
+typedef struct instance_t {
+  mat4 model;
+  vec4 color;
+} instance_t;
+
+// Cube mesh
+static cube_mesh_t cube_mesh      = {0};
+static uint32_t cube_vertex_count = 36;
+
+// Scene
+static struct {
+  instance_t instances[MAX_INSTANCE_COUNT];
+  uint32_t instance_count;
+  uint32_t orbit_first; /* first orbiting cube instance */
+  wgpu_buffer_t vertices;
+  wgpu_buffer_t instance_buffer;
+  wgpu_buffer_t view_uniform_buffer;
+  WGPUBindGroup bind_group;
+  WGPURenderPipeline pipelines[2]; /* regular and mirrored winding */
+} scene = {0};
+
+// View projection matrices, one per portal view at a dynamic offset
+static view_uniforms_t view_uniforms[WGPU_PORTAL_MAX_VIEWS] = {0};
+
+// Portal system
+static wgpu_portal_system_t* portal_system = NULL;
+
+// Settings
+static struct {
+  int32_t max_depth;
+  int32_t offscreen_level;
+} settings = {
+  .max_depth       = 4,
+  .offscreen_level = 3,
+};
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass = {0};
+
+// Other variables
+static const char* example_title = "Portal Mirrors";
+static bool prepared             = false;
+
+static void setup_camera(wgpu_example_context_t* context)
+{
+  context->camera       = camera_create();
+  context->camera->type = CameraType_LookAt;
+  camera_set_position(context->camera, (vec3){0.0f, -1.5f, -3.0f});
+  camera_set_rotation(context->camera, (vec3){-5.0f, 20.0f, 0.0f});
+  camera_set_perspective(context->camera, 60.0f,
+                         context->window_size.aspect_ratio, 0.1f, 64.0f);
+}
+
+/* Quad of 2 * half_size centered at position, rotated about the y axis */
+static void make_portal_transform(vec3 position, float angle, vec2 half_size,
+                                  mat4 dest)
+{
+  glm_mat4_identity(dest);
+  glm_translate(dest, position);
+  glm_rotate_y(dest, angle, dest);
+  glm_scale(dest, (vec3){half_size[0], half_size[1], 1.0f});
+}
+
+static void add_instance(mat4 model, vec4 color)
+{
+  ASSERT(scene.instance_count < MAX_INSTANCE_COUNT);
+  instance_t* instance = &scene.instances[scene.instance_count++];
+  glm_mat4_copy(model, instance->model);
+  glm_vec4_copy(color, instance->color);
+}
+
+/* Frame behind the portal surface, clipped away in the views through it */
+static void add_portal_frame(mat4 transform)
+{
+  mat4 model;
+  glm_mat4_copy(transform, model);
+  glm_translate(model, (vec3){0.0f, 0.0f, -0.15f});
+  glm_scale(model, (vec3){1.15f, 1.1f, 0.1f});
+  add_instance(model, (vec4){0.35f, 0.3f, 0.25f, 1.0f});
+}
+
+static void prepare_portals(wgpu_context_t* wgpu_context)
+{
+  portal_system = wgpu_portal_system_create(
+    wgpu_context,
+    &(wgpu_portal_system_desc_t){
+      .color_format         = wgpu_context->swap_chain.format,
+      .depth_stencil_format = WGPUTextureFormat_Depth24PlusStencil8,
+      .max_depth            = (uint32_t)settings.max_depth,
+      .offscreen_level      = (uint32_t)settings.offscreen_level,
+    });
+
+  wgpu_portal_t portal = {.type = WGPU_PORTAL_TYPE_MIRROR};
+
+  // Two mirrors facing each other across the room
+  make_portal_transform((vec3){-4.0f, 1.5f, 0.0f}, PI_2,
+                        (vec2){2.5f, 1.25f}, portal.transform);
+  wgpu_portal_system_add(portal_system, &portal);
+  add_portal_frame(portal.transform);
+  make_portal_transform((vec3){4.0f, 1.5f, 0.0f}, -PI_2,
+                        (vec2){2.5f, 1.25f}, portal.transform);
+  wgpu_portal_system_add(portal_system, &portal);
+  add_portal_frame(portal.transform);
+
+  // Portal in the far wall, its exit looks back into the room
+  portal.type = WGPU_PORTAL_TYPE_PORTAL;
+  make_portal_transform((vec3){0.0f, 1.25f, -5.0f}, 0.0f,
+                        (vec2){1.0f, 1.25f}, portal.transform);
+  make_portal_transform((vec3){0.0f, 1.25f, 5.0f}, PI,
+                        (vec2){1.0f, 1.25f}, portal.destination);
+  wgpu_portal_system_add(portal_system, &portal);
+  add_portal_frame(portal.transform);
+  add_portal_frame(portal.destination);
+}
+
+static void prepare_scene(wgpu_context_t* wgpu_context)
+{
+  cube_mesh_init(&cube_mesh);
+
+  // Floor
+  mat4 model = GLM_MAT4_IDENTITY_INIT;
+  glm_translate(model, (vec3){0.0f, -0.1f, 0.0f});
+  glm_scale(model, (vec3){4.0f, 0.1f, 5.0f});
+  add_instance(model, (vec4){0.45f, 0.45f, 0.5f, 1.0f});
+
+  // Pillars in the corners
+  for (uint32_t i = 0; i < 4; ++i) {
+    glm_mat4_identity(model);
+    glm_translate(model, (vec3){i % 2 ? 3.5f : -3.5f, 1.5f,
+                                i / 2 ? 4.5f : -4.5f});
+    glm_scale(model, (vec3){0.25f, 1.5f, 0.25f});
+    add_instance(model, (vec4){0.8f, 0.75f, 0.6f, 1.0f});
+  }
+
+  // Cubes orbiting the center, updated every frame
+  scene.orbit_first = scene.instance_count;
+  for (uint32_t i = 0; i < ORBIT_CUBE_COUNT; ++i) {
+    add_instance(GLM_MAT4_IDENTITY,
+                 (vec4){0.5f + 0.5f * cosf(i * 0.9f),
+                        0.5f + 0.5f * cosf(i * 0.9f + 2.1f),
+                        0.5f + 0.5f * cosf(i * 0.9f + 4.2f), 1.0f});
+  }
+
+  // Cube vertices
+  scene.vertices = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Cube data - Vertex buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+                    .size  = sizeof(cube_mesh.vertex_array),
+                    .initial.data = cube_mesh.vertex_array,
+                  });
+
+  // Instances
+  scene.instance_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Scene instances - Storage buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = sizeof(scene.instances),
+                  });
+
+  // View projection matrices of the portal views
+  scene.view_uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Portal views - Uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(view_uniforms),
+                  });
+}
+
+static void prepare_pipelines(wgpu_context_t* wgpu_context)
+{
+  // Bind group layout
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: View projection matrix, dynamic offset per view
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_Uniform,
+        .hasDynamicOffset = true,
+        .minBindingSize   = sizeof(mat4),
+      },
+      .sampler = {0},
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      // Binding 1: Instances
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_ReadOnlyStorage,
+        .minBindingSize = sizeof(scene.instances),
+      },
+      .sampler = {0},
+    },
+  };
+  WGPUBindGroupLayout bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label      = "Scene - Bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(bind_group_layout != NULL);
+
+  // Pipeline layout
+  WGPUPipelineLayout pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    wgpu_context->device, &(WGPUPipelineLayoutDescriptor){
+                            .label                = "Scene - Pipeline layout",
+                            .bindGroupLayoutCount = 1,
+                            .bindGroupLayouts     = &bind_group_layout,
+                          });
+  ASSERT(pipeline_layout != NULL);
+
+  // Bind group
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = scene.view_uniform_buffer.buffer,
+      .offset  = 0,
+      .size    = sizeof(mat4),
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = scene.instance_buffer.buffer,
+      .offset  = 0,
+      .size    = scene.instance_buffer.size,
+    },
+  };
+  scene.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Scene - Bind group",
+                            .layout     = bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(scene.bind_group != NULL);
+
+  // Color target state
+  WGPUBlendState blend_state              = wgpu_create_blend_state(false);
+  WGPUColorTargetState color_target_state = (WGPUColorTargetState){
+    .format    = wgpu_context->swap_chain.format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  // Depth stencil state, tests the stencil against the level of the view
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_portal_system_get_depth_stencil_state(portal_system);
+
+  // Vertex buffer layout
+  WGPU_VERTEX_BUFFER_LAYOUT(
+    portal_cube, cube_mesh.vertex_size,
+    // Attribute location 0: Position
+    WGPU_VERTATTR_DESC(0, WGPUVertexFormat_Float32x4,
+                       cube_mesh.position_offset),
+    // Attribute location 1: Color
+    WGPU_VERTATTR_DESC(1, WGPUVertexFormat_Float32x4, cube_mesh.color_offset))
+
+  // Shader module
+  WGPUShaderModule shader_module = wgpu_create_shader_module(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    .wgsl_code.source = scene_shader_wgsl,
+                  });
+  ASSERT(shader_module != NULL);
+
+  // Mirror views flip the triangle winding
+  const WGPUFrontFace front_faces[2] = {WGPUFrontFace_CCW, WGPUFrontFace_CW};
+  for (uint32_t i = 0; i < 2; ++i) {
+    scene.pipelines[i] = wgpuDeviceCreateRenderPipeline(
+      wgpu_context->device,
+      &(WGPURenderPipelineDescriptor){
+        .label  = "Scene - Render pipeline",
+        .layout = pipeline_layout,
+        .primitive = (WGPUPrimitiveState){
+          .topology  = WGPUPrimitiveTopology_TriangleList,
+          .frontFace = front_faces[i],
+          .cullMode  = WGPUCullMode_Back,
+        },
+        .vertex = (WGPUVertexState){
+          .module      = shader_module,
+          .entryPoint  = "vs_main",
+          .bufferCount = 1,
+          .buffers     = &portal_cube_vertex_buffer_layout,
+        },
+        .fragment = &(WGPUFragmentState){
+          .module      = shader_module,
+          .entryPoint  = "fs_main",
+          .targetCount = 1,
+          .targets     = &color_target_state,
+        },
+        .depthStencil = &depth_stencil_state,
+        .multisample  = (WGPUMultisampleState){
+          .count = 1,
+          .mask  = 0xffffffff,
+        },
+      });
+    ASSERT(scene.pipelines[i] != NULL);
+  }
+
+  // Partial cleanup
+  wgpu_release_shader_module(wgpu_context, shader_module);
+  WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+}
+
+static void setup_render_pass(wgpu_context_t* wgpu_context)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, /* Assigned later */
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor) {
+        .r = 0.05f,
+        .g = 0.06f,
+        .b = 0.08f,
+        .a = 1.0f,
+      },
+  };
+
+  // Depth attachment, the portal system needs the stencil cleared to 0
+  wgpu_setup_deph_stencil(wgpu_context, NULL);
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .label                  = "Render pass descriptor",
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    setup_camera(context);
+    prepare_portals(context->wgpu_context);
+    prepare_scene(context->wgpu_context);
+    prepare_pipelines(context->wgpu_context);
+    setup_render_pass(context->wgpu_context);
+    prepared = true;
+    return EXIT_SUCCESS;
+  }
+
+  return EXIT_FAILURE;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Max Depth",
+                                 &settings.max_depth, 0,
+                                 WGPU_PORTAL_MAX_DEPTH)) {
+      wgpu_portal_system_set_max_depth(portal_system,
+                                       (uint32_t)settings.max_depth);
+    }
+    if (imgui_overlay_slider_int(context->imgui_overlay, "Offscreen Level",
+                                 &settings.offscreen_level, 0,
+                                 WGPU_PORTAL_MAX_DEPTH)) {
+      wgpu_portal_system_set_offscreen_level(
+        portal_system, (uint32_t)settings.offscreen_level);
+    }
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Views: %u",
+                       wgpu_portal_system_get_view_count(portal_system));
+    imgui_overlay_text("Culled: %u",
+                       wgpu_portal_system_get_culled_count(portal_system));
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+  }
+}
+
+/* Moves the orbiting cubes and uploads the instances */
+static void update_instances(wgpu_example_context_t* context)
+{
+  const float t = context->run_time * 0.5f;
+  for (uint32_t i = 0; i < ORBIT_CUBE_COUNT; ++i) {
+    const float angle = t + i * 2.0f * PI / ORBIT_CUBE_COUNT;
+    mat4* model       = &scene.instances[scene.orbit_first + i].model;
+    glm_mat4_identity(*model);
+    glm_translate(*model, (vec3){2.0f * cosf(angle),
+                                 1.0f + 0.5f * sinf(angle * 3.0f),
+                                 2.0f * sinf(angle)});
+    glm_rotate(*model, t * 2.0f + i, (vec3){0.3f, 1.0f, 0.5f});
+    glm_scale(*model, (vec3){0.25f, 0.25f, 0.25f});
+  }
+  wgpu_queue_write_buffer(context->wgpu_context, scene.instance_buffer.buffer,
+                          0, scene.instances,
+                          scene.instance_count * sizeof(instance_t));
+}
+
+/* Builds the portal views and uploads their view projection matrices */
+static void update_views(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+  camera_t* camera             = context->camera;
+
+  wgpu_portal_system_update(portal_system, camera->matrices.view,
+                            camera->matrices.perspective,
+                            wgpu_context->surface.width,
+                            wgpu_context->surface.height);
+
+  const uint32_t view_count = wgpu_portal_system_get_view_count(portal_system);
+  for (uint32_t i = 0; i < view_count; ++i) {
+    const wgpu_portal_view_t* view
+      = wgpu_portal_system_get_view(portal_system, i);
+    glm_mat4_mul((vec4*)view->projection, (vec4*)view->view,
+                 view_uniforms[i].view_projection);
+  }
+  wgpu_queue_write_buffer(wgpu_context, scene.view_uniform_buffer.buffer, 0,
+                          view_uniforms, view_count * VIEW_UNIFORM_STRIDE);
+}
+
+/* Draws the scene of a portal view */
+static void draw_scene(WGPURenderPassEncoder rpass_enc,
+                       const wgpu_portal_view_t* view, uint32_t view_index,
+                       void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  const uint32_t dynamic_offset = view_index * VIEW_UNIFORM_STRIDE;
+  wgpuRenderPassEncoderSetPipeline(rpass_enc,
+                                   scene.pipelines[view->mirrored ? 1 : 0]);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, scene.bind_group, 1,
+                                    &dynamic_offset);
+  wgpuRenderPassEncoderSetVertexBuffer(rpass_enc, 0, scene.vertices.buffer, 0,
+                                       WGPU_WHOLE_SIZE);
+  wgpuRenderPassEncoderDraw(rpass_enc, cube_vertex_count,
+                            scene.instance_count, 0, 0);
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  update_instances(context);
+  update_views(context);
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Offscreen passes and frame pass
+  wgpu_portal_system_render(portal_system, wgpu_context->cmd_enc,
+                            &render_pass.descriptor, draw_scene, NULL);
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit command buffer to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return EXIT_SUCCESS;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return EXIT_FAILURE;
+  }
+  return example_draw(context);
+}
+
+static void example_on_view_changed(wgpu_example_context_t* context)
+{
+  camera_update_aspect_ratio(context->camera,
+                             context->window_size.aspect_ratio);
+}
+
+// Clean up used resources
+static void example_destroy(wgpu_example_context_t* context)
+{
+  camera_release(context->camera);
+  wgpu_portal_system_destroy(portal_system);
+  portal_system = NULL;
+  wgpu_destroy_buffer(&scene.vertices);
+  wgpu_destroy_buffer(&scene.instance_buffer);
+  wgpu_destroy_buffer(&scene.view_uniform_buffer);
+  WGPU_RELEASE_RESOURCE(BindGroup, scene.bind_group)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, scene.pipelines[0])
+  WGPU_RELEASE_RESOURCE(RenderPipeline, scene.pipelines[1])
+}
+
+void example_portal_mirrors(int argc, char* argv[])
+{
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = true,
+      .gpu_timer = true,
+    },
+    .example_initialize_func      = &example_initialize,
+    .example_render_func          = &example_render,
+    .example_destroy_func         = &example_destroy,
+    .example_on_view_changed_func = &example_on_view_changed,
+  });
+  // clang-format on
+}
+
+/* -------------------------------------------------------------------------- *
+ * WGSL Shaders
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* scene_shader_wgsl = CODE(
+  struct Instance {
+    model : mat4x4<f32>,
+    color : vec4<f32>,
+  }
+
+  @group(0) @binding(0) var<uniform> viewProjection : mat4x4<f32>;
+  @group(0) @binding(1) var<storage, read> instances : array<Instance>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4<f32>,
+    @location(0) color : vec4<f32>,
+  }
+
+  @vertex
+  fn vs_main(
+    @builtin(instance_index) instanceIndex : u32,
+    @location(0) position : vec4<f32>,
+    @location(1) color : vec4<f32>
+  ) -> VertexOutput {
+    let instance = instances[instanceIndex];
+    var output : VertexOutput;
+    output.position = viewProjection * instance.model * position;
+    // Darken the vertex colors of the cube mesh into a subtle gradient
+    output.color = vec4(instance.color.rgb * (0.6 + 0.4 * color.rgb), 1.0);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(@location(0) color : vec4<f32>) -> @location(0) vec4<f32> {
+    return color;
+  }
+);
+// clang-format on
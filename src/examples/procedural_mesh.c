@@ -1,5 +1,6 @@
 #include "example_base.h"
 
+#include "../core/mesh_processing.h"
 #include "../webgpu/imgui_overlay.h"
 
 #define PAR_SHAPES_IMPLEMENTATION
@@ -144,8 +145,18 @@ static void shape_unweld(shape_t* shape)
 
 static void shape_compute_normals(shape_t* shape)
 {
-  par_shapes_compute_normals(shape->handle);
-  *shape = init_shape(shape->handle);
+  par_shapes_mesh* handle = shape->handle;
+  PAR_FREE(handle->normals);
+  handle->normals = PAR_CALLOC(float, handle->npoints * 3);
+  mesh_compute_normals(&(mesh_desc_t){
+    .vertex_count   = (uint32_t)handle->npoints,
+    .positions.data = handle->points,
+    .normals.data   = handle->normals,
+    .triangle_count = (uint32_t)handle->ntriangles,
+    .indices        = handle->triangles,
+    .index_size     = (uint32_t)sizeof(PAR_SHAPES_T),
+  });
+  *shape = init_shape(handle);
 }
 
 static shape_t init_cylinder(int32_t slices, int32_t stacks)
@@ -824,8 +835,8 @@ static void prepare_rendering_pipeline(wgpu_context_t* wgpu_context)
   ASSERT(demo_state.pipeline != NULL);
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static void update_frame_uniform_buffers(wgpu_example_context_t* context)
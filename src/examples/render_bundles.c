@@ -10,14 +10,21 @@
  *
  * This example shows how to use render bundles. It renders a large number of
  * meshes individually as a proxy for a more complex scene in order to
- * demonstrate the reduction in time spent to issue render commands. (Typically
- * a scene like this would make use of instancing to reduce draw overhead.)
+ * demonstrate the reduction in time spent to issue render commands. The same
+ * scene can also be drawn with instancing: all transforms are stored in a
+ * single storage buffer indexed by the instance index and the asteroids are
+ * drawn with one instanced draw call per mesh variant. The UI shows the CPU
+ * time spent to encode the render bundle / render pass and the GPU time of
+ * both paths.
  *
  * Ref:
  * https://github.com/webgpu/webgpu-samples/tree/main/src/sample/renderBundles
  * -------------------------------------------------------------------------- */
 
-#define MAX_ASTEROID_COUNT 10000u
+#define MAX_ASTEROID_COUNT 1000000u
+/* The per-object path creates a uniform buffer and bind group per asteroid */
+#define MAX_PER_OBJECT_ASTEROID_COUNT 10000u
+#define ASTEROID_MESH_COUNT 5u
 
 // Renderables
 typedef struct renderable_t {
@@ -27,15 +34,39 @@ typedef struct renderable_t {
 
 static struct {
   renderable_t planet;
-  renderable_t asteroids[5];
+  renderable_t asteroids[ASTEROID_MESH_COUNT];
 } scene = {0};
 
+// Transforms of the planet ([0]) and the asteroids ([1..asteroid_count])
+static struct {
+  mat4* data;
+  uint32_t length;
+  uint32_t capacity;
+} transforms = {0};
+
+// Per-object resources
 static struct {
   renderable_t* renderable;
   wgpu_buffer_t uniforms;
   WGPUBindGroup bind_group;
-} renderables[1 + MAX_ASTEROID_COUNT] = {0};
-static uint32_t renderables_length    = 0;
+} renderables[1 + MAX_PER_OBJECT_ASTEROID_COUNT] = {0};
+static uint32_t renderables_length               = 0;
+
+// Instanced resources, all transforms in one storage buffer grouped by mesh:
+// the planet comes first, followed by one fixed size region per asteroid mesh
+static struct {
+  wgpu_buffer_t storage;
+  uint32_t capacity;      /* number of asteroids */
+  uint32_t mesh_capacity; /* number of asteroids per mesh region */
+  uint32_t uploaded;      /* number of asteroids uploaded to the storage */
+  WGPUBindGroup frame_bind_group;
+  WGPUBindGroup planet_bind_group;
+  WGPUBindGroup asteroid_bind_group;
+  struct {
+    uint32_t first_instance;
+    uint32_t instance_count;
+  } asteroid_draws[ASTEROID_MESH_COUNT];
+} instancing = {0};
 
 // Texture
 static struct {
@@ -66,14 +97,26 @@ static WGPUBindGroup frame_bind_group = NULL;
 // Settings
 static struct {
   bool use_render_bundles;
+  bool use_instancing;
   int32_t asteroid_count;
 } settings = {
   .use_render_bundles = true,
+  .use_instancing     = true,
   .asteroid_count     = 500,
 };
 
-// Mesh render pipeline
-static WGPURenderPipeline mesh_render_pipeline = NULL;
+// CPU time spent to encode the draw commands
+static struct {
+  float bundle_encode_ms; /* last render bundle encoding */
+  float pass_encode_ms;   /* render pass encoding, smoothed over frames */
+} timings = {0};
+
+// Mesh render pipelines
+static WGPURenderPipeline mesh_render_pipeline      = NULL;
+static WGPURenderPipeline instanced_render_pipeline = NULL;
+
+// Instanced mesh shader
+static const char* instanced_mesh_shader_wgsl;
 
 // Render bundle
 static WGPURenderBundle render_bundle = NULL;
@@ -197,14 +240,16 @@ static void create_create_frame_bind_group(wgpu_context_t* wgpu_context)
     .offset  = 0,
     .size    = uniform_buffer.size,
   };
+  WGPUBindGroupLayout bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(mesh_render_pipeline, 0);
   frame_bind_group = wgpuDeviceCreateBindGroup(
-    wgpu_context->device,
-    &(WGPUBindGroupDescriptor){
-      .label  = "Frame bind group",
-      .layout = wgpuRenderPipelineGetBindGroupLayout(mesh_render_pipeline, 0),
-      .entryCount = 1,
-      .entries    = &bg_entry,
-    });
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Frame bind group",
+                            .layout     = bind_group_layout,
+                            .entryCount = 1,
+                            .entries    = &bg_entry,
+                          });
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
 }
 
 static void create_sphere_bind_group(wgpu_context_t* wgpu_context,
@@ -238,14 +283,16 @@ static void create_sphere_bind_group(wgpu_context_t* wgpu_context,
       .textureView = texture->view,
     },
   };
+  WGPUBindGroupLayout bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(mesh_render_pipeline, 1);
   renderables[renderable_id].bind_group = wgpuDeviceCreateBindGroup(
-    wgpu_context->device,
-    &(WGPUBindGroupDescriptor){
-      .label  = "Bind group",
-      .layout = wgpuRenderPipelineGetBindGroupLayout(mesh_render_pipeline, 1),
-      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
-      .entries    = bg_entries,
-    });
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Bind group",
+                            .layout     = bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
   ASSERT(renderables[renderable_id].bind_group != NULL);
 }
 
@@ -254,10 +301,6 @@ static void prepare_scene(wgpu_context_t* wgpu_context)
 {
   /* Planet */
   create_sphere_renderable(wgpu_context, &scene.planet, 1.0f, 32, 16, 0.0f);
-  create_sphere_bind_group(wgpu_context, 0, &textures.planet,
-                           view_matrices.transform);
-  renderables[0].renderable = &scene.planet;
-  renderables_length++;
 
   /* Asteroids */
   create_sphere_renderable(wgpu_context, &scene.asteroids[0], 0.01f, 8, 6,
@@ -272,13 +315,31 @@ static void prepare_scene(wgpu_context_t* wgpu_context)
                            0.15f);
 }
 
-static void ensure_enough_asteroids(wgpu_context_t* wgpu_context)
+/* Number of asteroids drawn by the per-object path */
+static uint32_t get_per_object_asteroid_count(void)
+{
+  return MIN((uint32_t)settings.asteroid_count, MAX_PER_OBJECT_ASTEROID_COUNT);
+}
+
+static void ensure_enough_transforms(void)
 {
-  mat4 tmp_mat              = GLM_MAT4_IDENTITY_INIT;
-  uint32_t asteroids_length = (uint32_t)ARRAY_SIZE(scene.asteroids);
+  const uint32_t length = (uint32_t)settings.asteroid_count + 1;
+  if (length > transforms.capacity) {
+    transforms.capacity = MAX(length, transforms.capacity * 2);
+    transforms.data
+      = (mat4*)realloc(transforms.data, transforms.capacity * sizeof(mat4));
+  }
+
+  /* Planet */
+  if (transforms.length == 0) {
+    glm_mat4_identity(transforms.data[0]);
+    transforms.length = 1;
+  }
+
+  /* Asteroids */
+  mat4 tmp_mat = GLM_MAT4_IDENTITY_INIT;
   float radius = 0.0f, angle = 0.0f, x = 0.0f, y = 0.0f, z = 0.0f;
-  for (uint32_t i = renderables_length; i <= (uint32_t)settings.asteroid_count;
-       ++i) {
+  for (uint32_t i = transforms.length; i < length; ++i) {
     /* Place copies of the asteroid in a ring. */
     radius = random_float() * 1.7f + 1.25f;
     angle  = random_float() * PI * 2.0f;
@@ -287,18 +348,168 @@ static void ensure_enough_asteroids(wgpu_context_t* wgpu_context)
     z      = cos(angle) * radius;
 
     glm_mat4_identity(tmp_mat);
-    glm_translate_to(tmp_mat, (vec3){x, y, z}, view_matrices.transform);
-    glm_rotate_x(view_matrices.transform, random_float() * PI,
-                 view_matrices.transform);
-    glm_rotate_y(view_matrices.transform, random_float() * PI,
-                 view_matrices.transform);
-    renderables[i].renderable = &scene.asteroids[i % asteroids_length];
-    create_sphere_bind_group(wgpu_context, i, &textures.moon,
-                             view_matrices.transform);
+    glm_translate_to(tmp_mat, (vec3){x, y, z}, transforms.data[i]);
+    glm_rotate_x(transforms.data[i], random_float() * PI, transforms.data[i]);
+    glm_rotate_y(transforms.data[i], random_float() * PI, transforms.data[i]);
+  }
+  transforms.length = MAX(transforms.length, length);
+}
+
+static void ensure_enough_renderables(wgpu_context_t* wgpu_context)
+{
+  const uint32_t length = get_per_object_asteroid_count() + 1;
+  for (uint32_t i = renderables_length; i < length; ++i) {
+    renderables[i].renderable
+      = i == 0 ? &scene.planet :
+                 &scene.asteroids[i % (uint32_t)ARRAY_SIZE(scene.asteroids)];
+    create_sphere_bind_group(wgpu_context, i,
+                             i == 0 ? &textures.planet : &textures.moon,
+                             transforms.data[i]);
     renderables_length++;
   }
 }
 
+static void create_instanced_bind_groups(wgpu_context_t* wgpu_context)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.frame_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.planet_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.asteroid_bind_group)
+
+  /* Frame bind group */
+  WGPUBindGroupEntry frame_bg_entry = (WGPUBindGroupEntry){
+    .binding = 0,
+    .buffer  = uniform_buffer.buffer,
+    .offset  = 0,
+    .size    = uniform_buffer.size,
+  };
+  WGPUBindGroupLayout bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(instanced_render_pipeline, 0);
+  instancing.frame_bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label      = "Instanced frame bind group",
+                            .layout     = bind_group_layout,
+                            .entryCount = 1,
+                            .entries    = &frame_bg_entry,
+                          });
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+  ASSERT(instancing.frame_bind_group != NULL);
+
+  /* Mesh bind groups, the planet and the asteroids share the transforms */
+  texture_t* mesh_textures[2]   = {&textures.planet, &textures.moon};
+  WGPUBindGroup* bind_groups[2] = {&instancing.planet_bind_group,
+                                   &instancing.asteroid_bind_group};
+  bind_group_layout
+    = wgpuRenderPipelineGetBindGroupLayout(instanced_render_pipeline, 1);
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = instancing.storage.buffer,
+        .offset  = 0,
+        .size    = instancing.storage.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .sampler = textures.sampler,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding     = 2,
+        .textureView = mesh_textures[i]->view,
+      },
+    };
+    *bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .label      = "Instanced mesh bind group",
+                              .layout     = bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+    ASSERT(*bind_groups[i] != NULL);
+  }
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
+}
+
+/* Number of asteroids drawn with mesh m, asteroid i uses mesh i % COUNT */
+static uint32_t get_mesh_asteroid_count(uint32_t asteroid_count, uint32_t m)
+{
+  const uint32_t first = m == 0 ? ASTEROID_MESH_COUNT : m;
+  return asteroid_count < first ?
+           0 :
+           (asteroid_count - first) / ASTEROID_MESH_COUNT + 1;
+}
+
+/**
+ * Uploads the transforms grouped by asteroid mesh. Each mesh owns a fixed
+ * region of the storage buffer, so growing the asteroid count only appends to
+ * the regions and only the asteroids that were not uploaded before are
+ * written. The whole buffer is only rewritten when it has to be reallocated.
+ */
+static void update_instanced_transforms(wgpu_context_t* wgpu_context)
+{
+  const uint32_t asteroid_count = (uint32_t)settings.asteroid_count;
+  if (asteroid_count > instancing.capacity) {
+    wgpu_destroy_buffer(&instancing.storage);
+    instancing.capacity = MAX(asteroid_count, instancing.capacity * 2);
+    instancing.capacity = MIN(instancing.capacity, MAX_ASTEROID_COUNT);
+    instancing.mesh_capacity
+      = (instancing.capacity + ASTEROID_MESH_COUNT - 1) / ASTEROID_MESH_COUNT;
+    instancing.storage = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Transforms storage buffer",
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+        .size  = (1 + ASTEROID_MESH_COUNT * instancing.mesh_capacity)
+                * sizeof(mat4),
+        .initial = {
+          .data = transforms.data[0], /* Planet */
+          .size = sizeof(mat4),
+        },
+      });
+    ASSERT(instancing.storage.buffer != NULL);
+    create_instanced_bind_groups(wgpu_context);
+    instancing.uploaded = 0;
+  }
+
+  mat4* staging = NULL;
+  for (uint32_t m = 0; m < ASTEROID_MESH_COUNT; ++m) {
+    const uint32_t first_instance = 1 + m * instancing.mesh_capacity;
+    const uint32_t instance_count
+      = get_mesh_asteroid_count(asteroid_count, m);
+    const uint32_t uploaded_count
+      = get_mesh_asteroid_count(instancing.uploaded, m);
+    instancing.asteroid_draws[m].first_instance = first_instance;
+    instancing.asteroid_draws[m].instance_count = instance_count;
+    if (instance_count <= uploaded_count) {
+      continue;
+    }
+    if (staging == NULL) {
+      staging = (mat4*)malloc(instancing.mesh_capacity * sizeof(mat4));
+    }
+    const uint32_t first = m == 0 ? ASTEROID_MESH_COUNT : m;
+    for (uint32_t k = uploaded_count; k < instance_count; ++k) {
+      glm_mat4_copy(transforms.data[first + k * ASTEROID_MESH_COUNT],
+                    staging[k - uploaded_count]);
+    }
+    wgpu_queue_write_buffer(wgpu_context, instancing.storage.buffer,
+                            (first_instance + uploaded_count) * sizeof(mat4),
+                            staging,
+                            (instance_count - uploaded_count) * sizeof(mat4));
+  }
+  free(staging);
+  instancing.uploaded = MAX(instancing.uploaded, asteroid_count);
+}
+
+static void ensure_enough_asteroids(wgpu_context_t* wgpu_context)
+{
+  ensure_enough_transforms();
+  if (settings.use_instancing) {
+    update_instanced_transforms(wgpu_context);
+  }
+  else {
+    ensure_enough_renderables(wgpu_context);
+  }
+}
+
 static void setup_render_pass(wgpu_context_t* wgpu_context)
 {
   /* Color attachment */
@@ -420,8 +631,45 @@ static void prepare_pipeline(wgpu_context_t* wgpu_context)
   ASSERT(mesh_render_pipeline != NULL);
 
   /* Partial cleanup */
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
+
+  /* Instanced pipeline, transforms are fetched from a storage buffer */
+  vertex_state = wgpu_create_vertex_state(
+      wgpu_context, &(wgpu_vertex_state_t){
+    .shader_desc = (wgpu_shader_desc_t){
+      /* Vertex shader WGSL */
+      .label            = "Instanced vertex shader WGSL",
+      .wgsl_code.source = instanced_mesh_shader_wgsl,
+      .entry            = "vertexMain"
+    },
+    .buffer_count = 1,
+    .buffers      = &sphere_vertex_buffer_layout,
+  });
+  fragment_state = wgpu_create_fragment_state(
+      wgpu_context, &(wgpu_fragment_state_t){
+    .shader_desc = (wgpu_shader_desc_t){
+        /* Fragment shader WGSL */
+        .label            = "Instanced fragment shader WGSL",
+        .wgsl_code.source = instanced_mesh_shader_wgsl,
+        .entry            = "fragmentMain"
+       },
+      .target_count = 1,
+      .targets = &color_target_state,
+  });
+  instanced_render_pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device, &(WGPURenderPipelineDescriptor){
+                            .label = "Instanced sphere mesh render pipeline",
+                            .primitive    = primitive_state,
+                            .vertex       = vertex_state,
+                            .fragment     = &fragment_state,
+                            .depthStencil = &depth_stencil_state,
+                            .multisample  = multisample_state,
+                          });
+  ASSERT(instanced_render_pipeline != NULL);
+
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static void prepare_view_matrices(wgpu_context_t* wgpu_context)
@@ -469,8 +717,12 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
     imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
     imgui_overlay_checkBox(context->imgui_overlay, "Use Render Bundles",
                            &settings.use_render_bundles);
-    if (imgui_overlay_slider_int(context->imgui_overlay, "Asteroid Count",
-                                 &settings.asteroid_count, 500, 10000)) {
+    bool scene_changed = imgui_overlay_checkBox(
+      context->imgui_overlay, "Use Instancing", &settings.use_instancing);
+    scene_changed |= imgui_overlay_slider_int(
+      context->imgui_overlay, "Asteroid Count", &settings.asteroid_count, 500,
+      (int32_t)MAX_ASTEROID_COUNT);
+    if (scene_changed) {
       /**
        * If the content of the scene changes the render bundle must be
        * recreated.
@@ -478,6 +730,20 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
       ensure_enough_asteroids(context->wgpu_context);
       update_render_bundle(context->wgpu_context);
     }
+    if (!settings.use_instancing
+        && (uint32_t)settings.asteroid_count > MAX_PER_OBJECT_ASTEROID_COUNT) {
+      imgui_overlay_text("Per-object path limited to %u asteroids",
+                         MAX_PER_OBJECT_ASTEROID_COUNT);
+    }
+  }
+  if (imgui_overlay_header("Timings")) {
+    imgui_overlay_text("Bundle encode: %.3f ms", timings.bundle_encode_ms);
+    imgui_overlay_text("Pass encode: %.3f ms", timings.pass_encode_ms);
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
   }
 }
 
@@ -486,7 +752,10 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
  * same code both to render the scene normally and to build the render bundle.
  */
 #define RENDER_SCENE(Type, rpass_enc)                                          \
-  if (rpass_enc) {                                                             \
+  if (rpass_enc && settings.use_instancing) {                                  \
+    RENDER_SCENE_INSTANCED(Type, rpass_enc)                                    \
+  }                                                                            \
+  else if (rpass_enc) {                                                        \
     wgpu##Type##SetPipeline(rpass_enc, mesh_render_pipeline);                  \
     wgpu##Type##SetBindGroup(rpass_enc, 0, frame_bind_group, 0, 0);            \
     /**                                                                        \
@@ -509,12 +778,42 @@ static void example_on_update_ui_overlay(wgpu_example_context_t* context)
                                  WGPUIndexFormat_Uint16, 0, WGPU_WHOLE_SIZE);  \
       wgpu##Type##DrawIndexed(                                                 \
         rpass_enc, renderables[ri].renderable->indices.count, 1, 0, 0, 0);     \
-      if (++count > settings.asteroid_count) {                                 \
+      if (++count > (int32_t)get_per_object_asteroid_count()) {                \
         break;                                                                 \
       }                                                                        \
     }                                                                          \
   }
 
+/**
+ * Instanced variant: the planet and one instanced draw per asteroid mesh. The
+ * vertex shader fetches the transform of each instance from the storage
+ * buffer, the first instance selects the range of transforms of the mesh.
+ */
+#define RENDER_SCENE_INSTANCED(Type, rpass_enc)                                \
+  wgpu##Type##SetPipeline(rpass_enc, instanced_render_pipeline);               \
+  wgpu##Type##SetBindGroup(rpass_enc, 0, instancing.frame_bind_group, 0, 0);   \
+  wgpu##Type##SetBindGroup(rpass_enc, 1, instancing.planet_bind_group, 0, 0);  \
+  wgpu##Type##SetVertexBuffer(rpass_enc, 0, scene.planet.vertices.buffer, 0,   \
+                              WGPU_WHOLE_SIZE);                                \
+  wgpu##Type##SetIndexBuffer(rpass_enc, scene.planet.indices.buffer,           \
+                             WGPUIndexFormat_Uint16, 0, WGPU_WHOLE_SIZE);      \
+  wgpu##Type##DrawIndexed(rpass_enc, scene.planet.indices.count, 1, 0, 0, 0);  \
+  wgpu##Type##SetBindGroup(rpass_enc, 1, instancing.asteroid_bind_group, 0,    \
+                           0);                                                 \
+  for (uint32_t mi = 0; mi < ASTEROID_MESH_COUNT; ++mi) {                      \
+    if (instancing.asteroid_draws[mi].instance_count == 0) {                   \
+      continue;                                                                \
+    }                                                                          \
+    wgpu##Type##SetVertexBuffer(rpass_enc, 0,                                  \
+                                scene.asteroids[mi].vertices.buffer, 0,        \
+                                WGPU_WHOLE_SIZE);                              \
+    wgpu##Type##SetIndexBuffer(rpass_enc, scene.asteroids[mi].indices.buffer,  \
+                               WGPUIndexFormat_Uint16, 0, WGPU_WHOLE_SIZE);    \
+    wgpu##Type##DrawIndexed(rpass_enc, scene.asteroids[mi].indices.count,      \
+                            instancing.asteroid_draws[mi].instance_count, 0,   \
+                            0, instancing.asteroid_draws[mi].first_instance);  \
+  }
+
 /*
  * The render bundle can be encoded once and re-used as many times as needed.
  * Because it encodes all of the commands needed to render at the GPU level,
@@ -532,6 +831,7 @@ static void update_render_bundle(wgpu_context_t* wgpu_context)
 {
   WGPU_RELEASE_RESOURCE(RenderBundle, render_bundle)
 
+  const uint64_t start_ns            = platform_get_timestamp_ns();
   WGPUTextureFormat color_formats[1] = {wgpu_context->swap_chain.format};
   WGPURenderBundleEncoder render_bundle_encoder
     = wgpuDeviceCreateRenderBundleEncoder(
@@ -546,6 +846,8 @@ static void update_render_bundle(wgpu_context_t* wgpu_context)
   RENDER_SCENE(RenderBundleEncoder, render_bundle_encoder)
   render_bundle = wgpuRenderBundleEncoderFinish(render_bundle_encoder, NULL);
   ASSERT(render_bundle != NULL);
+  timings.bundle_encode_ms
+    = (float)(platform_get_timestamp_ns() - start_ns) / 1000000.0f;
 
   WGPU_RELEASE_RESOURCE(RenderBundleEncoder, render_bundle_encoder)
 }
@@ -558,6 +860,7 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
+  const uint64_t start_ns = platform_get_timestamp_ns();
   wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
     wgpu_context->cmd_enc, &render_pass.descriptor);
 
@@ -581,6 +884,10 @@ static WGPUCommandBuffer build_command_buffer(wgpu_context_t* wgpu_context)
   // End render pass
   wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
   WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  const float pass_encode_ms
+    = (float)(platform_get_timestamp_ns() - start_ns) / 1000000.0f;
+  timings.pass_encode_ms
+    = timings.pass_encode_ms * 0.95f + pass_encode_ms * 0.05f;
 
   // Draw ui overlay
   draw_ui(wgpu_context->context, example_on_update_ui_overlay);
@@ -602,10 +909,10 @@ static int example_initialize(wgpu_example_context_t* context)
     prepare_moon_texture(context->wgpu_context);
     prepare_texture_sampler(context->wgpu_context);
     prepare_scene(context->wgpu_context);
+    create_create_frame_bind_group(context->wgpu_context);
     ensure_enough_asteroids(context->wgpu_context);
     setup_render_pass(context->wgpu_context);
     prepare_view_matrices(context->wgpu_context);
-    create_create_frame_bind_group(context->wgpu_context);
     update_render_bundle(context->wgpu_context);
     prepared = true;
     return EXIT_SUCCESS;
@@ -662,11 +969,17 @@ static void example_destroy(wgpu_example_context_t* context)
     WGPU_RELEASE_RESOURCE(BindGroup, renderables[ri].bind_group)
     wgpu_destroy_buffer(&renderables[ri].uniforms);
   }
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.frame_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.planet_bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, instancing.asteroid_bind_group)
+  wgpu_destroy_buffer(&instancing.storage);
+  free(transforms.data);
   WGPU_RELEASE_RESOURCE(Sampler, textures.sampler)
   wgpu_destroy_texture(&textures.moon);
   wgpu_destroy_texture(&textures.planet);
   wgpu_destroy_buffer(&uniform_buffer);
   WGPU_RELEASE_RESOURCE(RenderPipeline, mesh_render_pipeline)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, instanced_render_pipeline)
 }
 
 void example_render_bundles(int argc, char* argv[])
@@ -677,6 +990,7 @@ void example_render_bundles(int argc, char* argv[])
       .title                       = example_title,
       .overlay                     = true,
       .overlay_deph_stencil_format = WGPUTextureFormat_Depth24Plus,
+      .gpu_timer                   = true,
   },
   .example_initialize_func = &example_initialize,
   .example_render_func     = &example_render,
@@ -684,3 +998,60 @@ void example_render_bundles(int argc, char* argv[])
   });
   // clang-format on
 }
+
+/* -------------------------------------------------------------------------- *
+ * WGSL Shaders
+ * -------------------------------------------------------------------------- */
+
+// clang-format off
+static const char* instanced_mesh_shader_wgsl = CODE(
+  struct Uniforms {
+    viewProjectionMatrix : mat4x4f
+  }
+  @group(0) @binding(0) var<uniform> uniforms : Uniforms;
+
+  @group(1) @binding(0) var<storage, read> modelMatrices : array<mat4x4f>;
+
+  struct VertexInput {
+    @builtin(instance_index) instanceIndex : u32,
+    @location(0) position : vec4f,
+    @location(1) normal : vec3f,
+    @location(2) uv : vec2f
+  }
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) normal: vec3f,
+    @location(1) uv : vec2f,
+  }
+
+  @vertex
+  fn vertexMain(input: VertexInput) -> VertexOutput {
+    // The instance index includes the first instance of the draw call
+    let modelMatrix = modelMatrices[input.instanceIndex];
+    var output : VertexOutput;
+    output.position = uniforms.viewProjectionMatrix * modelMatrix * input.position;
+    output.normal = normalize((modelMatrix * vec4(input.normal, 0)).xyz);
+    output.uv = input.uv;
+    return output;
+  }
+
+  @group(1) @binding(1) var meshSampler: sampler;
+  @group(1) @binding(2) var meshTexture: texture_2d<f32>;
+
+  // Static directional lighting
+  const lightDir = vec3f(1, 1, 1);
+  const dirColor = vec3(1);
+  const ambientColor = vec3f(0.05);
+
+  @fragment
+  fn fragmentMain(input: VertexOutput) -> @location(0) vec4f {
+    let textureColor = textureSample(meshTexture, meshSampler, input.uv);
+
+    // Very simplified lighting algorithm.
+    let lightColor = saturate(ambientColor + max(dot(input.normal, lightDir), 0.0) * dirColor);
+
+    return vec4f(textureColor.rgb * lightColor, textureColor.a);
+  }
+);
+// clang-format on
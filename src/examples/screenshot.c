@@ -5,9 +5,6 @@
 #include "../webgpu/gltf_model.h"
 #include "../webgpu/imgui_overlay.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
-
 /* -------------------------------------------------------------------------- *
  * WebGPU Example - Saving Framebuffer To Screenshot
  *
@@ -24,8 +21,6 @@
  * https://github.com/SaschaWillems/Vulkan/tree/master/examples/screenshot
  * -------------------------------------------------------------------------- */
 
-#define COPY_BYTES_PER_ROW_ALIGNMENT 256u
-
 static struct gltf_model_t* dragon;
 static wgpu_buffer_t uniform_buffer;
 
@@ -64,17 +59,11 @@ static struct offscreen_rendering_t {
     WGPURenderPassDepthStencilAttachment depth_stencil_attachment;
     WGPURenderPassDescriptor render_pass_descriptor;
   } render_pass;
-  /* The pixel buffer lets us retrieve the framebuffer data as an array */
-  struct {
-    wgpu_buffer_t buffer;
-    bool buffer_mapped;
-    struct {
-      uint64_t width;
-      uint64_t height;
-      uint64_t unpadded_bytes_per_row;
-      uint64_t padded_bytes_per_row;
-    } buffer_dimensions;
-  } pixel_data;
+  /* Framebuffer dimensions */
+  uint32_t width;
+  uint32_t height;
+  /* Set while the framebuffer data is read back and encoded */
+  bool readback_pending;
 } offscreen_rendering = {0};
 
 static const char* example_title = "Saving Framebuffer To Screenshot";
@@ -103,47 +92,12 @@ static void load_assets(wgpu_context_t* wgpu_context)
   ASSERT(dragon != NULL);
 }
 
-// It is a WebGPU requirement that ImageCopyBuffer.layout.bytes_per_row %
-// wgpu::COPY_BYTES_PER_ROW_ALIGNMENT == 0 So we calculate padded_bytes_per_row
-// by rounding unpadded_bytes_per_row up to the next multiple of
-// wgpu::COPY_BYTES_PER_ROW_ALIGNMENT.
-// https://en.wikipedia.org/wiki/Data_structure_alignment#Computing_padding
-static void calculate_buffer_dimensions(uint32_t width, uint32_t height)
-{
-  const uint32_t bytes_per_pixel        = sizeof(uint8_t) * 4;
-  const uint32_t unpadded_bytes_per_row = width * bytes_per_pixel;
-  const uint32_t align = (uint32_t)COPY_BYTES_PER_ROW_ALIGNMENT;
-  const uint32_t padded_bytes_per_row_padding
-    = (align - unpadded_bytes_per_row % align) % align;
-  const uint32_t padded_bytes_per_row
-    = unpadded_bytes_per_row + padded_bytes_per_row_padding;
-  {
-    offscreen_rendering.pixel_data.buffer_dimensions.width  = width;
-    offscreen_rendering.pixel_data.buffer_dimensions.height = height;
-    offscreen_rendering.pixel_data.buffer_dimensions.unpadded_bytes_per_row
-      = unpadded_bytes_per_row;
-    offscreen_rendering.pixel_data.buffer_dimensions.padded_bytes_per_row
-      = padded_bytes_per_row;
-  }
-}
-
 static void prepare_offscreen(wgpu_context_t* wgpu_context)
 {
-  /* Prepare pixel output buffer */
-  calculate_buffer_dimensions(wgpu_context->surface.width,
-                              wgpu_context->surface.height);
-
-  /* The output buffer lets us retrieve the data as an array */
-  offscreen_rendering.pixel_data.buffer = wgpu_create_buffer(
-    wgpu_context,
-    &(wgpu_buffer_desc_t){
-      .label = "Pixel output buffer",
-      .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
-      .size
-      = (uint64_t)(offscreen_rendering.pixel_data.buffer_dimensions
-                     .padded_bytes_per_row
-                   * offscreen_rendering.pixel_data.buffer_dimensions.height),
-    });
+  /* The readback service retrieves the framebuffer data as an array */
+  wgpu_create_readback(wgpu_context);
+  offscreen_rendering.width  = wgpu_context->surface.width;
+  offscreen_rendering.height = wgpu_context->surface.height;
 
   /* Attachment formats */
   offscreen_rendering.color.format = WGPUTextureFormat_RGBA8UnormSrgb;
@@ -152,8 +106,8 @@ static void prepare_offscreen(wgpu_context_t* wgpu_context)
 
   /* Create the texture */
   WGPUExtent3D texture_extent = {
-    .width  = offscreen_rendering.pixel_data.buffer_dimensions.width,
-    .height = offscreen_rendering.pixel_data.buffer_dimensions.height,
+    .width              = offscreen_rendering.width,
+    .height             = offscreen_rendering.height,
     .depthOrArrayLayers = 1,
   };
 
@@ -437,8 +391,8 @@ static void prepare_pipelines(wgpu_context_t* wgpu_context)
   ASSERT(offscreen_rendering.pipeline != NULL);
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state.module);
 }
 
 static void update_uniform_buffers(wgpu_example_context_t* context)
@@ -531,32 +485,48 @@ build_command_buffer(wgpu_context_t* wgpu_context,
   return command_buffer;
 }
 
+static void screenshot_readback_cb(const wgpu_readback_result_t* result,
+                                   void* user_data)
+{
+  UNUSED_VAR(user_data);
+
+  if (result->status == WGPU_READBACK_STATUS_SUCCESS) {
+    screenshot_requested = false;
+  }
+  offscreen_rendering.readback_pending = false;
+}
+
+static void screenshot_encoded_cb(const char* filename, bool success,
+                                  void* user_data)
+{
+  UNUSED_VAR(filename);
+  UNUSED_VAR(user_data);
+
+  // The image file has been written
+  screenshot_saved = success;
+}
+
 static WGPUCommandBuffer
 build_copy_texture_to_buffer_command_buffer(wgpu_context_t* wgpu_context)
 {
   wgpu_context->cmd_enc
     = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
 
-  wgpuCommandEncoderCopyTextureToBuffer(wgpu_context->cmd_enc,
-    // Source
-    &(WGPUImageCopyTexture){
+  // Copy the framebuffer to a staging buffer, the image is written to disk
+  // on the encoder thread of the readback service
+  offscreen_rendering.readback_pending = wgpu_readback_copy_texture(
+    wgpu_context->readback, wgpu_context->cmd_enc,
+    &(wgpu_readback_texture_desc_t){
       .texture  = offscreen_rendering.color.texture,
-      .mipLevel =0,
-    },
-    // Destination
-    &(WGPUImageCopyBuffer){
-      .buffer  = offscreen_rendering.pixel_data.buffer.buffer,
-      .layout = (WGPUTextureDataLayout) {
-        .offset      = 0,
-        .bytesPerRow = offscreen_rendering.pixel_data.buffer_dimensions.padded_bytes_per_row,
-        .rowsPerImage = offscreen_rendering.pixel_data.buffer_dimensions.height,
+      .format   = offscreen_rendering.color.format,
+      .width    = offscreen_rendering.width,
+      .height   = offscreen_rendering.height,
+      .callback = screenshot_readback_cb,
+      .encoding = {
+        .type     = WGPU_READBACK_ENCODING_PNG,
+        .filename = screenshot_filename,
+        .callback = screenshot_encoded_cb,
       },
-    },
-    // CopySize
-    &(WGPUExtent3D) {
-      .width  = offscreen_rendering.pixel_data.buffer_dimensions.width,
-      .height = offscreen_rendering.pixel_data.buffer_dimensions.height,
-      .depthOrArrayLayers = 1,
     });
 
   // Get command buffer
@@ -567,33 +537,6 @@ build_copy_texture_to_buffer_command_buffer(wgpu_context_t* wgpu_context)
   return command_buffer;
 }
 
-static void read_buffer_map_cb(WGPUBufferMapAsyncStatus status, void* user_data)
-{
-  UNUSED_VAR(user_data);
-
-  if (status == WGPUBufferMapAsyncStatus_Success) {
-    int32_t w = offscreen_rendering.pixel_data.buffer_dimensions.width;
-    int32_t h = offscreen_rendering.pixel_data.buffer_dimensions.height;
-    int32_t channels_num = 4;
-
-    size_t pixels_size     = w * h * channels_num;
-    uint8_t* pixels        = (uint8_t*)malloc(pixels_size);
-    uint8_t const* mapping = (uint8_t*)wgpuBufferGetConstMappedRange(
-      offscreen_rendering.pixel_data.buffer.buffer, 0,
-      sizeof(offscreen_rendering.pixel_data.buffer.size));
-    ASSERT(mapping);
-    memcpy(pixels, mapping, pixels_size);
-    stbi_write_png(screenshot_filename, w, h, channels_num, pixels,
-                   w * sizeof(int));
-    wgpuBufferUnmap(offscreen_rendering.pixel_data.buffer.buffer);
-    free(pixels);
-
-    offscreen_rendering.pixel_data.buffer_mapped = false;
-    screenshot_requested                         = false;
-    screenshot_saved                             = true;
-  }
-}
-
 static int example_draw(wgpu_example_context_t* context)
 {
   wgpu_context_t* wgpu_context = context->wgpu_context;
@@ -608,8 +551,8 @@ static int example_draw(wgpu_example_context_t* context)
     = offscreen_rendering.color.texture_view;
 
   // Command buffer to be submitted to the queue
-  bool buffer_mapped   = offscreen_rendering.pixel_data.buffer_mapped;
-  bool save_screenshot = !buffer_mapped && screenshot_requested;
+  bool save_screenshot
+    = !offscreen_rendering.readback_pending && screenshot_requested;
   wgpu_context->submit_info.command_buffer_count = save_screenshot ? 3 : 1;
   wgpu_context->submit_info.command_buffers[0]   = build_command_buffer(
     wgpu_context, &scene_rendering.render_pass.render_pass_descriptor,
@@ -628,14 +571,6 @@ static int example_draw(wgpu_example_context_t* context)
   // Submit frame
   submit_frame(context);
 
-  // Read query results for displaying in next frame
-  if (save_screenshot) {
-    offscreen_rendering.pixel_data.buffer_mapped = true;
-    wgpuBufferMapAsync(
-      offscreen_rendering.pixel_data.buffer.buffer, WGPUMapMode_Read, 0,
-      offscreen_rendering.pixel_data.buffer.size, read_buffer_map_cb, NULL);
-  }
-
   return EXIT_SUCCESS;
 }
 
@@ -666,7 +601,6 @@ static void example_destroy(wgpu_example_context_t* context)
                         offscreen_rendering.depth_stencil.texture_view)
 
   WGPU_RELEASE_RESOURCE(Buffer, uniform_buffer.buffer)
-  WGPU_RELEASE_RESOURCE(Buffer, offscreen_rendering.pixel_data.buffer.buffer)
 
   WGPU_RELEASE_RESOURCE(PipelineLayout, pipeline_layout)
   WGPU_RELEASE_RESOURCE(BindGroupLayout, bind_group_layout)
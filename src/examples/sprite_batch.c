@@ -0,0 +1,407 @@
+#include "example_base.h"
+
+#include <string.h>
+
+#include "../webgpu/imgui_overlay.h"
+#include "../webgpu/sprite_batch.h"
+#include "../webgpu/texture_atlas.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Example - Sprite Batch
+ *
+ * This example shows how to use the texture atlas and sprite batch modules:
+ * procedurally generated tile and sprite images are packed into the pages of
+ * a texture atlas at startup. A large tile layer is drawn by a sprite batch
+ * that culls the tiles against the view on the GPU, thousands of moving and
+ * rotating sprites in a few depth layers on top of it are drawn back to front
+ * by a second batch. Each batch takes one draw call per atlas page and layer.
+ * -------------------------------------------------------------------------- */
+
+#define TILE_MAP_SIZE 256u
+#define TILE_IMAGE_COUNT 16u
+#define TILE_IMAGE_SIZE 32u
+#define SPRITE_IMAGE_COUNT 48u
+#define SPRITE_COUNT 10000u
+#define SPRITE_LAYER_COUNT 4u
+
+// Atlas and batches
+static wgpu_texture_atlas_t* texture_atlas                    = NULL;
+static wgpu_sprite_batch_t* tile_batch                        = NULL;
+static wgpu_sprite_batch_t* sprite_batch                      = NULL;
+static wgpu_atlas_region_t tile_regions[TILE_IMAGE_COUNT]     = {0};
+static wgpu_atlas_region_t sprite_regions[SPRITE_IMAGE_COUNT] = {0};
+
+// Moving sprites
+static struct {
+  wgpu_sprite_id_t id;
+  wgpu_sprite_t sprite;
+  vec2 velocity;
+  float angular_velocity;
+} sprites[SPRITE_COUNT] = {0};
+
+// Settings
+static struct {
+  float view_height; /* visible world units */
+  bool animate_camera;
+} settings = {
+  .view_height    = 48.0f,
+  .animate_camera = true,
+};
+
+// Camera
+static struct {
+  vec2 center;
+  mat4 view_projection;
+} camera = {
+  .center = {TILE_MAP_SIZE * 0.5f, TILE_MAP_SIZE * 0.5f},
+};
+
+// Render pass descriptor for frame buffer writes
+static struct {
+  WGPURenderPassColorAttachment color_attachments[1];
+  WGPURenderPassDescriptor descriptor;
+} render_pass = {0};
+
+// Other variables
+static const char* example_title = "Sprite Batch";
+static bool prepared             = false;
+
+/* Square tile with a noisy fill and a darker border */
+static void generate_tile_image(uint8_t* pixels, const vec3 color)
+{
+  for (uint32_t y = 0; y < TILE_IMAGE_SIZE; ++y) {
+    for (uint32_t x = 0; x < TILE_IMAGE_SIZE; ++x) {
+      const bool border = x == 0 || y == 0 || x == TILE_IMAGE_SIZE - 1
+                          || y == TILE_IMAGE_SIZE - 1;
+      const float shade = (border ? 0.6f : 0.85f) + 0.15f * random_float();
+      uint8_t* pixel    = &pixels[(y * TILE_IMAGE_SIZE + x) * 4];
+      pixel[0]          = (uint8_t)(color[0] * shade * 255.0f);
+      pixel[1]          = (uint8_t)(color[1] * shade * 255.0f);
+      pixel[2]          = (uint8_t)(color[2] * shade * 255.0f);
+      pixel[3]          = 255;
+    }
+  }
+}
+
+/* Disc, ring or diamond with a soft edge on a transparent background */
+static void generate_sprite_image(uint8_t* pixels, uint32_t size,
+                                  uint32_t shape)
+{
+  const float radius = size * 0.5f;
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      const float dx = (x + 0.5f - radius) / radius;
+      const float dy = (y + 0.5f - radius) / radius;
+      float distance = 0.0f;
+      switch (shape % 3) {
+        case 0: /* disc */
+          distance = sqrtf(dx * dx + dy * dy);
+          break;
+        case 1: /* ring */
+          distance = 0.5f + fabsf(sqrtf(dx * dx + dy * dy) - 0.75f) * 2.0f;
+          break;
+        default: /* diamond */
+          distance = fabsf(dx) + fabsf(dy);
+          break;
+      }
+      const float alpha = MIN(MAX((1.0f - distance) * radius, 0.0f), 1.0f);
+      uint8_t* pixel    = &pixels[(y * size + x) * 4];
+      pixel[0]          = 255;
+      pixel[1]          = (uint8_t)(255.0f * (1.0f - 0.5f * distance));
+      pixel[2]          = (uint8_t)(255.0f * (1.0f - distance * distance));
+      pixel[3]          = (uint8_t)(alpha * 255.0f);
+    }
+  }
+}
+
+static void prepare_texture_atlas(wgpu_context_t* wgpu_context)
+{
+  texture_atlas = wgpu_texture_atlas_create(
+    wgpu_context, &(wgpu_texture_atlas_desc_t){
+                    .label       = "Sprite batch - Texture atlas",
+                    .page_width  = 256,
+                    .page_height = 256,
+                  });
+
+  uint8_t* pixels = (uint8_t*)malloc(64 * 64 * 4);
+  for (uint32_t i = 0; i < TILE_IMAGE_COUNT; ++i) {
+    const vec3 color = {
+      random_float_min_max(0.2f, 0.5f),
+      random_float_min_max(0.4f, 0.8f),
+      random_float_min_max(0.2f, 0.6f),
+    };
+    generate_tile_image(pixels, color);
+    wgpu_texture_atlas_add_image(texture_atlas, pixels, TILE_IMAGE_SIZE,
+                                 TILE_IMAGE_SIZE, &tile_regions[i]);
+  }
+  for (uint32_t i = 0; i < SPRITE_IMAGE_COUNT; ++i) {
+    const uint32_t size = 16 + (i * 7) % 49;
+    generate_sprite_image(pixels, size, i);
+    wgpu_texture_atlas_add_image(texture_atlas, pixels, size, size,
+                                 &sprite_regions[i]);
+  }
+  free(pixels);
+}
+
+static void prepare_sprite_batches(wgpu_context_t* wgpu_context)
+{
+  // Tile layer, culled on the GPU
+  tile_batch = wgpu_sprite_batch_create(
+    wgpu_context, &(wgpu_sprite_batch_desc_t){
+                    .atlas        = texture_atlas,
+                    .capacity     = TILE_MAP_SIZE * TILE_MAP_SIZE,
+                    .color_format = wgpu_context->swap_chain.format,
+                    .depth_format = WGPUTextureFormat_Depth24PlusStencil8,
+                    .gpu_culling  = true,
+                  });
+  for (uint32_t y = 0; y < TILE_MAP_SIZE; ++y) {
+    for (uint32_t x = 0; x < TILE_MAP_SIZE; ++x) {
+      const uint32_t tile = (x / 4 * 7 + y / 4 * 13 + (x ^ y) % 3)
+                            % TILE_IMAGE_COUNT;
+      wgpu_sprite_batch_add(tile_batch,
+                            &(wgpu_sprite_t){
+                              .position = {x + 0.5f, y + 0.5f},
+                              .size     = {1.0f, 1.0f},
+                              .depth    = 1.0f,
+                              .color    = {1.0f, 1.0f, 1.0f, 1.0f},
+                              .region   = tile_regions[tile],
+                            });
+    }
+  }
+
+  // Moving sprites, drawn back to front
+  sprite_batch = wgpu_sprite_batch_create(
+    wgpu_context, &(wgpu_sprite_batch_desc_t){
+                    .atlas        = texture_atlas,
+                    .capacity     = SPRITE_COUNT,
+                    .color_format = wgpu_context->swap_chain.format,
+                    .depth_format = WGPUTextureFormat_Depth24PlusStencil8,
+                  });
+  for (uint32_t i = 0; i < SPRITE_COUNT; ++i) {
+    const wgpu_atlas_region_t* region
+      = &sprite_regions[i % SPRITE_IMAGE_COUNT];
+    const float scale = random_float_min_max(0.02f, 0.04f);
+    sprites[i].sprite = (wgpu_sprite_t){
+      .position = {random_float() * TILE_MAP_SIZE,
+                   random_float() * TILE_MAP_SIZE},
+      .size     = {region->width * scale, region->height * scale},
+      .rotation = random_float() * 2.0f * PI,
+      .depth    = (float)(i % SPRITE_LAYER_COUNT) / SPRITE_LAYER_COUNT,
+      .color    = {random_float_min_max(0.5f, 1.0f),
+                   random_float_min_max(0.5f, 1.0f),
+                   random_float_min_max(0.5f, 1.0f), 1.0f},
+      .region   = *region,
+    };
+    sprites[i].velocity[0]      = random_float_min_max(-2.0f, 2.0f);
+    sprites[i].velocity[1]      = random_float_min_max(-2.0f, 2.0f);
+    sprites[i].angular_velocity = random_float_min_max(-2.0f, 2.0f);
+    sprites[i].id = wgpu_sprite_batch_add(sprite_batch, &sprites[i].sprite);
+  }
+}
+
+static void setup_render_pass(wgpu_context_t* wgpu_context)
+{
+  // Color attachment
+  render_pass.color_attachments[0] = (WGPURenderPassColorAttachment) {
+      .view       = NULL, /* Assigned later */
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor) {
+        .r = 0.025f,
+        .g = 0.025f,
+        .b = 0.025f,
+        .a = 1.0f,
+      },
+  };
+
+  // Depth attachment
+  wgpu_setup_deph_stencil(wgpu_context, NULL);
+
+  // Render pass descriptor
+  render_pass.descriptor = (WGPURenderPassDescriptor){
+    .label                  = "Render pass descriptor",
+    .colorAttachmentCount   = 1,
+    .colorAttachments       = render_pass.color_attachments,
+    .depthStencilAttachment = &wgpu_context->depth_stencil.att_desc,
+  };
+}
+
+static int example_initialize(wgpu_example_context_t* context)
+{
+  if (context) {
+    prepare_texture_atlas(context->wgpu_context);
+    prepare_sprite_batches(context->wgpu_context);
+    setup_render_pass(context->wgpu_context);
+    prepared = true;
+    return EXIT_SUCCESS;
+  }
+
+  return EXIT_FAILURE;
+}
+
+static void example_on_update_ui_overlay(wgpu_example_context_t* context)
+{
+  if (imgui_overlay_header("Settings")) {
+    imgui_overlay_checkBox(context->imgui_overlay, "Paused", &context->paused);
+    imgui_overlay_checkBox(context->imgui_overlay, "Animate Camera",
+                           &settings.animate_camera);
+    imgui_overlay_slider_float(context->imgui_overlay, "View Height",
+                               &settings.view_height, 8.0f, 256.0f, "%.0f");
+  }
+  if (imgui_overlay_header("Statistics")) {
+    imgui_overlay_text("Tiles: %u (%u draws)",
+                       wgpu_sprite_batch_get_count(tile_batch),
+                       wgpu_sprite_batch_get_draw_count(tile_batch));
+    imgui_overlay_text("Sprites: %u (%u draws)",
+                       wgpu_sprite_batch_get_count(sprite_batch),
+                       wgpu_sprite_batch_get_draw_count(sprite_batch));
+    imgui_overlay_text(
+      "Atlas: %u pages, %.0f%% used",
+      wgpu_texture_atlas_get_page_count(texture_atlas),
+      wgpu_texture_atlas_get_occupancy(texture_atlas) * 100.0f);
+    if (context->gpu_timer != NULL
+        && wgpu_gpu_timer_is_supported(context->gpu_timer)) {
+      imgui_overlay_text("GPU: %.3f ms",
+                         wgpu_gpu_timer_get_frame_ms(context->gpu_timer));
+    }
+  }
+}
+
+/* Moves the sprites, bouncing off the edges of the map */
+static void update_sprites(float time_step)
+{
+  for (uint32_t i = 0; i < SPRITE_COUNT; ++i) {
+    wgpu_sprite_t* sprite = &sprites[i].sprite;
+    for (uint32_t axis = 0; axis < 2; ++axis) {
+      sprite->position[axis] += sprites[i].velocity[axis] * time_step;
+      if (sprite->position[axis] < 0.0f
+          || sprite->position[axis] > (float)TILE_MAP_SIZE) {
+        sprites[i].velocity[axis] = -sprites[i].velocity[axis];
+        sprite->position[axis]
+          = MIN(MAX(sprite->position[axis], 0.0f), (float)TILE_MAP_SIZE);
+      }
+    }
+    sprite->rotation += sprites[i].angular_velocity * time_step;
+    wgpu_sprite_batch_set(sprite_batch, sprites[i].id, sprite);
+  }
+}
+
+static void update_camera(wgpu_example_context_t* context)
+{
+  if (settings.animate_camera) {
+    const float t    = context->run_time * 0.05f;
+    camera.center[0] = TILE_MAP_SIZE * (0.5f + 0.35f * cosf(t));
+    camera.center[1] = TILE_MAP_SIZE * (0.5f + 0.35f * sinf(t * 1.3f));
+  }
+
+  const float half_height = settings.view_height * 0.5f;
+  const float half_width  = half_height * context->window_size.aspect_ratio;
+  glm_ortho(camera.center[0] - half_width,  /* left   */
+            camera.center[0] + half_width,  /* right  */
+            camera.center[1] - half_height, /* bottom */
+            camera.center[1] + half_height, /* top    */
+            -1.0f,                          /* near   */
+            1.0f,                           /* far    */
+            camera.view_projection);
+}
+
+static WGPUCommandBuffer build_command_buffer(wgpu_example_context_t* context)
+{
+  wgpu_context_t* wgpu_context = context->wgpu_context;
+
+  render_pass.color_attachments[0].view = wgpu_context->swap_chain.frame_buffer;
+
+  if (!context->paused) {
+    update_sprites(MIN(context->frame_timer, 0.1f));
+  }
+  update_camera(context);
+
+  // Create command encoder
+  wgpu_context->cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+
+  // Upload the changed sprites and cull the tiles
+  wgpu_sprite_batch_update(tile_batch, wgpu_context->cmd_enc,
+                           camera.view_projection);
+  wgpu_sprite_batch_update(sprite_batch, wgpu_context->cmd_enc,
+                           camera.view_projection);
+
+  // Render pass
+  {
+    wgpu_context->rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      wgpu_context->cmd_enc, &render_pass.descriptor);
+    wgpu_sprite_batch_draw(tile_batch, wgpu_context->rpass_enc);
+    wgpu_sprite_batch_draw(sprite_batch, wgpu_context->rpass_enc);
+    wgpuRenderPassEncoderEnd(wgpu_context->rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, wgpu_context->rpass_enc)
+  }
+
+  // Draw ui overlay
+  draw_ui(wgpu_context->context, example_on_update_ui_overlay);
+
+  // Get command buffer
+  WGPUCommandBuffer command_buffer
+    = wgpu_get_command_buffer(wgpu_context->cmd_enc);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, wgpu_context->cmd_enc)
+
+  return command_buffer;
+}
+
+static int example_draw(wgpu_example_context_t* context)
+{
+  // Prepare frame
+  prepare_frame(context);
+
+  // Command buffer to be submitted to the queue
+  wgpu_context_t* wgpu_context                   = context->wgpu_context;
+  wgpu_context->submit_info.command_buffer_count = 1;
+  wgpu_context->submit_info.command_buffers[0] = build_command_buffer(context);
+
+  // Submit command buffer to queue
+  submit_command_buffers(context);
+
+  // Submit frame
+  submit_frame(context);
+
+  return EXIT_SUCCESS;
+}
+
+static int example_render(wgpu_example_context_t* context)
+{
+  if (!prepared) {
+    return EXIT_FAILURE;
+  }
+  return example_draw(context);
+}
+
+// Clean up used resources
+static void example_destroy(wgpu_example_context_t* context)
+{
+  UNUSED_VAR(context);
+
+  wgpu_sprite_batch_destroy(sprite_batch);
+  wgpu_sprite_batch_destroy(tile_batch);
+  wgpu_texture_atlas_destroy(texture_atlas);
+  sprite_batch  = NULL;
+  tile_batch    = NULL;
+  texture_atlas = NULL;
+}
+
+void example_sprite_batch(int argc, char* argv[])
+{
+  // clang-format off
+  example_run(argc, argv, &(refexport_t){
+    .example_settings = (wgpu_example_settings_t){
+      .title     = example_title,
+      .overlay   = true,
+      .vsync     = true,
+      .gpu_timer = true,
+    },
+    .example_initialize_func = &example_initialize,
+    .example_render_func     = &example_render,
+    .example_destroy_func    = &example_destroy,
+  });
+  // clang-format on
+}
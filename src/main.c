@@ -8,13 +8,23 @@
 #include "core/argparse.h"
 #include "examples/examples.h"
 
+#include "../lib/wgpu_native/wgpu_native.h"
+
 int main(int argc, char* argv[])
 {
-  srand((unsigned int)time(NULL));
   initialize_default_path();
 
   const char* example_name = NULL;
-  int demo_mode = 0, window_width = 0, window_height = 0;
+  int demo_mode = 0, list_examples = 0, window_width = 0, window_height = 0;
+  int seed = -1, frames = 0, golden_update = 0, cpu_adapter = 0;
+  float golden_tolerance   = 0.0f;
+  const char* golden_image = NULL;
+  int capture = 0, capture_interval = 0, capture_frames = 0;
+  const char* capture_output = NULL;
+  int list_adapters = 0, adapter_index = -1;
+  const char* backend        = NULL;
+  const char* trace_file     = NULL;
+  const char* benchmark_file = NULL;
   struct argparse_option options[] = {
     OPT_BOOLEAN('?', "help", NULL, "show this help message and exit",
                 argparse_help_cb, 0, OPT_NONEG),
@@ -25,6 +35,56 @@ int main(int argc, char* argv[])
     OPT_BOOLEAN('d', "demo-mode", &demo_mode,
                 "demo mode, this mode runs every example for 10 seconds", NULL,
                 0, 0),
+    OPT_BOOLEAN('l', "list", &list_examples, "list the available examples",
+                NULL, 0, 0),
+    OPT_GROUP("Deterministic run options"),
+    OPT_INTEGER(0, "seed", &seed,
+                "seed of the random number generator (default: time based)",
+                NULL, 0, 0),
+    OPT_INTEGER(0, "frames", &frames,
+                "render N frames with a fixed time step and exit", NULL, 0, 0),
+    OPT_STRING(0, "golden", &golden_image,
+               "compare the final frame against a golden PNG image, the exit "
+               "code reports the result",
+               NULL, 0, 0),
+    OPT_BOOLEAN(0, "golden-update", &golden_update,
+                "store the final frame as golden image", NULL, 0, 0),
+    OPT_FLOAT(0, "golden-tolerance", &golden_tolerance,
+              "perceptual per-pixel tolerance (default: 0.02)", NULL, 0, 0),
+    OPT_BOOLEAN(0, "cpu-adapter", &cpu_adapter,
+                "use the CPU (SwiftShader) adapter", NULL, 0, 0),
+    OPT_GROUP("Adapter options"),
+    OPT_BOOLEAN(0, "list-adapters", &list_adapters,
+                "list the available adapters (index, backend, type, name)",
+                NULL, 0, 0),
+    OPT_STRING(0, "backend", &backend,
+               "WebGPU backend: vulkan, opengl, opengles, d3d11, d3d12, metal, "
+               "null or swiftshader (default: platform dependent)",
+               NULL, 0, 0),
+    OPT_INTEGER(0, "adapter-index", &adapter_index,
+                "adapter index as listed by --list-adapters, overrides "
+                "--backend",
+                NULL, 0, 0),
+    OPT_GROUP("Frame capture options"),
+    OPT_BOOLEAN(0, "capture", &capture,
+                "capture frames to an image sequence or video", NULL, 0, 0),
+    OPT_INTEGER(0, "capture-interval", &capture_interval,
+                "capture every Nth frame (default: 1)", NULL, 0, 0),
+    OPT_INTEGER(0, "capture-frames", &capture_frames,
+                "stop the example after capturing N frames", NULL, 0, 0),
+    OPT_STRING(0, "capture-output", &capture_output,
+               "PNG file name prefix or video file (.mp4, .mkv, ...) encoded "
+               "with ffmpeg (default: frame)",
+               NULL, 0, 0),
+    OPT_GROUP("Profiling options"),
+    OPT_STRING(0, "trace", &trace_file,
+               "write a CPU / GPU timeline (chrome://tracing, Perfetto JSON) "
+               "to the given file",
+               NULL, 0, 0),
+    OPT_STRING(0, "benchmark", &benchmark_file,
+               "append frame time statistics of the run to the given CSV file "
+               "(default: 600 frames with a fixed time step)",
+               NULL, 0, 0),
     OPT_END(),
   };
 
@@ -42,6 +102,23 @@ int main(int argc, char* argv[])
   int argparse_argc = argparse_parse(&argparse, argc, (const char**)argv_cpy);
   free(argv_cpy);
 
+  /* Seed the random number generator, a fixed seed gives reproducible runs */
+  srand(seed >= 0 ? (unsigned int)seed : (unsigned int)time(NULL));
+
+  if (list_examples != 0) {
+    examplecase_t* examples = get_examples();
+    uint32_t example_count  = get_number_of_examples();
+    for (uint32_t i = 0; i < example_count; ++i) {
+      printf("%s\n", examples[i].example_name);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (list_adapters != 0) {
+    wgpu_print_adapter_list();
+    return EXIT_SUCCESS;
+  }
+
   if (argc == 0) {
     examplecase_t* example = get_random_example();
     printf("Randomly selected example: %s\n", example->example_name);
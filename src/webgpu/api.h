@@ -5,7 +5,20 @@
 
 #include "buffer.h"
 #include "context.h"
+#include "depth_prepass.h"
+#include "frame_capture.h"
+#include "golden_image.h"
+#include "gpu_timer.h"
+#include "light_manager.h"
+#include "particle_system.h"
+#include "portal_system.h"
+#include "quality_governor.h"
+#include "readback.h"
 #include "shader.h"
+#include "sprite_batch.h"
 #include "texture.h"
+#include "texture_atlas.h"
+#include "wgsl_preprocessor.h"
+#include "workgroup_tuner.h"
 
 #endif
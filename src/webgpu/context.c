@@ -5,8 +5,11 @@
 
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "../core/trace.h"
 #include "../core/window.h"
 
+#include "../webgpu/readback.h"
+#include "../webgpu/shader.h"
 #include "../webgpu/texture.h"
 
 #include "../../lib/wgpu_native/wgpu_native.h"
@@ -21,6 +24,17 @@ wgpu_context_t* wgpu_context_create(wgpu_context_create_options_t* options)
     = options ?
         (options->vsync ? WGPUPresentMode_Fifo : WGPUPresentMode_Mailbox) :
         WGPUPresentMode_Mailbox;
+  context->swap_chain.usage = WGPUTextureUsage_RenderAttachment;
+  if (options && options->swap_chain_readback) {
+    context->swap_chain.usage |= WGPUTextureUsage_CopySrc;
+  }
+  if (options) {
+    context->adapter_selection.force_fallback_adapter
+      = options->force_fallback_adapter;
+    context->adapter_selection.backend_type      = options->backend_type;
+    context->adapter_selection.use_adapter_index = options->use_adapter_index;
+    context->adapter_selection.adapter_index     = options->adapter_index;
+  }
 
   return context;
 }
@@ -32,6 +46,16 @@ void wgpu_context_release(wgpu_context_t* wgpu_context)
     wgpu_context->texture_client = NULL;
   }
 
+  if (wgpu_context->readback != NULL) {
+    wgpu_readback_destroy(wgpu_context->readback);
+    wgpu_context->readback = NULL;
+  }
+
+  if (wgpu_context->shader_cache != NULL) {
+    wgpu_shader_cache_destroy(wgpu_context->shader_cache);
+    wgpu_context->shader_cache = NULL;
+  }
+
   WGPU_RELEASE_RESOURCE(TextureView, wgpu_context->depth_stencil.texture_view);
   WGPU_RELEASE_RESOURCE(Texture, wgpu_context->depth_stencil.texture);
   WGPU_RELEASE_RESOURCE(SwapChain, wgpu_context->swap_chain.instance);
@@ -67,17 +91,46 @@ void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context)
   wgpu_log_available_adapters();
 
   /* WebGPU adapter creation */
-  wgpu_context->adapter = wgpu_request_adapter(&(WGPURequestAdapterOptions){
-    .powerPreference = WGPUPowerPreference_HighPerformance,
-  });
+  if (wgpu_context->adapter_selection.use_adapter_index) {
+    wgpu_context->adapter = wgpu_request_adapter_by_index(
+      wgpu_context->adapter_selection.adapter_index);
+  }
+  else {
+    wgpu_context->adapter = wgpu_request_adapter(&(WGPURequestAdapterOptions){
+      .powerPreference = WGPUPowerPreference_HighPerformance,
+      .backendType     = wgpu_context->adapter_selection.backend_type,
+      .forceFallbackAdapter
+      = wgpu_context->adapter_selection.force_fallback_adapter,
+    });
+  }
+  if (wgpu_context->adapter == NULL) {
+    log_error("No matching WebGPU adapter found");
+  }
+  ASSERT(wgpu_context->adapter != NULL);
 
   /* WebGPU device creation */
-  WGPUFeatureName required_features[2] = {
+  WGPUFeatureName required_features[5] = {
     WGPUFeatureName_TextureCompressionBC,
     WGPUFeatureName_BGRA8UnormStorage,
   };
+  uint32_t required_feature_count = 2;
+  /* Optional features, enabled when supported by the adapter */
+  if (wgpuAdapterHasFeature(wgpu_context->adapter,
+                            WGPUFeatureName_TimestampQuery)) {
+    required_features[required_feature_count++]
+      = WGPUFeatureName_TimestampQuery;
+  }
+  if (wgpuAdapterHasFeature(wgpu_context->adapter,
+                            WGPUFeatureName_ChromiumExperimentalSubgroups)) {
+    required_features[required_feature_count++]
+      = WGPUFeatureName_ChromiumExperimentalSubgroups;
+  }
+  if (wgpuAdapterHasFeature(wgpu_context->adapter,
+                            WGPUFeatureName_ShaderF16)) {
+    required_features[required_feature_count++] = WGPUFeatureName_ShaderF16;
+  }
   WGPUDeviceDescriptor deviceDescriptor = {
-    .requiredFeatureCount = (uint32_t)ARRAY_SIZE(required_features),
+    .requiredFeatureCount = required_feature_count,
     .requiredFeatures     = required_features,
   };
   wgpu_context->device
@@ -98,6 +151,7 @@ void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context)
     WGPUFeatureName_ShaderF16,
     WGPUFeatureName_DawnInternalUsages,
     WGPUFeatureName_DawnMultiPlanarFormats,
+    WGPUFeatureName_ChromiumExperimentalSubgroups,
   };
   for (uint32_t i = 0; i < WGPU_FEATURE_COUNT; ++i) {
     wgpu_context->features[i].feature_name = feature_names[i];
@@ -105,6 +159,24 @@ void wgpu_create_device_and_queue(wgpu_context_t* wgpu_context)
       = wgpuDeviceHasFeature(wgpu_context->device, feature_names[i]);
   }
 
+  /* Query the subgroup sizes, compute kernels select their subgroup variants
+   * based on them */
+  if (wgpu_has_feature(wgpu_context,
+                       WGPUFeatureName_ChromiumExperimentalSubgroups)) {
+    WGPUDawnExperimentalSubgroupLimits subgroup_limits = {
+      .chain.sType = WGPUSType_DawnExperimentalSubgroupLimits,
+    };
+    WGPUSupportedLimits limits = {
+      .nextInChain = (WGPUChainedStructOut*)&subgroup_limits,
+    };
+    if (wgpuDeviceGetLimits(wgpu_context->device, &limits)) {
+      wgpu_context->subgroups.min_size = subgroup_limits.minSubgroupSize;
+      wgpu_context->subgroups.max_size = subgroup_limits.maxSubgroupSize;
+      log_debug("Subgroup sizes: %u - %u", subgroup_limits.minSubgroupSize,
+                subgroup_limits.maxSubgroupSize);
+    }
+  }
+
   /* Get the default queue from the device */
   wgpu_context->queue = wgpuDeviceGetQueue(wgpu_context->device);
 }
@@ -192,7 +264,7 @@ void wgpu_setup_swap_chain(wgpu_context_t* wgpu_context)
 {
   /* Create the swap chain */
   WGPUSwapChainDescriptor swap_chain_descriptor = {
-    .usage       = WGPUTextureUsage_RenderAttachment,
+    .usage       = wgpu_context->swap_chain.usage,
     .format      = WGPUTextureFormat_BGRA8Unorm,
     .width       = wgpu_context->surface.width,
     .height      = wgpu_context->surface.height,
@@ -241,6 +313,7 @@ void wgpu_queue_write_buffer(wgpu_context_t* wgpu_context, WGPUBuffer buffer,
                              uint64_t buffer_offset, void const* data,
                              size_t size)
 {
+  TRACE_SCOPE("Upload");
   wgpuQueueWriteBuffer(wgpu_context->queue, buffer, buffer_offset, data, size);
 }
 
@@ -269,6 +342,11 @@ void wgpu_flush_command_buffers(wgpu_context_t* wgpu_context,
   /* Submit to the queue */
   wgpuQueueSubmit(wgpu_context->queue, command_buffer_count, command_buffers);
 
+  /* The readback copies recorded so far can be mapped */
+  if (wgpu_context->readback != NULL) {
+    wgpu_readback_mark_submitted(wgpu_context->readback);
+  }
+
   /* Release command buffer */
   for (uint32_t i = 0; i < command_buffer_count; ++i) {
     WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffers[i])
@@ -290,6 +368,14 @@ void wgpu_create_texture_client(wgpu_context_t* wgpu_context)
   }
 }
 
+/* Readback service creation */
+void wgpu_create_readback(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->readback == NULL) {
+    wgpu_context->readback = wgpu_readback_create(wgpu_context);
+  }
+}
+
 /* Pipeline state factories */
 WGPUBlendState wgpu_create_blend_state(bool enable_blend)
 {
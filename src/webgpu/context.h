@@ -49,15 +49,28 @@
 /* Forward declarations */
 struct wgpu_buffer_t;
 struct wgpu_texture_client_t;
+struct wgpu_readback;
+struct wgpu_shader_cache;
 
 /* WebGPU context create options */
 typedef struct wgpu_context_create_options_t {
   bool vsync;
+  bool swap_chain_readback; /* allow copying from the swap chain images */
+  bool force_fallback_adapter; /* use the CPU (SwiftShader) adapter */
+  WGPUBackendType backend_type; /* Undefined selects the default backend */
+  bool use_adapter_index;       /* select the adapter by its index */
+  uint32_t adapter_index;       /* see wgpu_print_adapter_list() */
 } wgpu_context_create_options_t;
 
 /* WebGPU context */
 typedef struct wgpu_context_t {
   void* context;
+  struct {
+    bool force_fallback_adapter;
+    WGPUBackendType backend_type;
+    bool use_adapter_index;
+    uint32_t adapter_index;
+  } adapter_selection;
   WGPUAdapter adapter;
   WGPUDevice device;
   WGPUQueue queue;
@@ -66,6 +79,10 @@ typedef struct wgpu_context_t {
     WGPUFeatureName feature_name;
     bool is_supported;
   } features[WGPU_FEATURE_COUNT];
+  struct {
+    uint32_t min_size;
+    uint32_t max_size;
+  } subgroups; /* subgroup sizes, 0 without subgroup support */
   struct {
     void* instance;
     uint32_t width;
@@ -76,6 +93,7 @@ typedef struct wgpu_context_t {
     WGPUTextureFormat format;
     WGPUTextureView frame_buffer;
     WGPUPresentMode present_mode;
+    WGPUTextureUsageFlags usage;
   } swap_chain;
   WGPUCommandEncoder cmd_enc;       /* Command encoder */
   WGPURenderPassEncoder rpass_enc;  /* Render pass encoder */
@@ -90,6 +108,8 @@ typedef struct wgpu_context_t {
     WGPUCommandBuffer command_buffers[MAX_COMMAND_BUFFER_COUNT];
   } submit_info;
   struct wgpu_texture_client_t* texture_client;
+  struct wgpu_readback* readback;
+  struct wgpu_shader_cache* shader_cache;
 } wgpu_context_t;
 
 /* WebGPU context creating/releasing */
@@ -135,6 +155,9 @@ void wgpu_swap_chain_present(wgpu_context_t* wgpu_context);
 /* Texture client creation */
 void wgpu_create_texture_client(wgpu_context_t* wgpu_context);
 
+/* Readback service creation */
+void wgpu_create_readback(wgpu_context_t* wgpu_context);
+
 /* Pipeline state factories */
 WGPUBlendState wgpu_create_blend_state(bool enable_blend);
 
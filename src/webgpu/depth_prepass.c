@@ -0,0 +1,526 @@
+#include "depth_prepass.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+#include "buffer.h"
+#include "readback.h"
+#include "shader.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Depth Pre-pass
+ * -------------------------------------------------------------------------- */
+
+/* Blendable format the shaded fragments are counted in */
+#define DEPTH_PREPASS_COUNT_FORMAT WGPUTextureFormat_R16Float
+
+/* Must match Stats in the shader */
+typedef struct depth_prepass_stats_t {
+  uint32_t fragments;
+  uint32_t pixels;
+} depth_prepass_stats_t;
+
+struct wgpu_depth_prepass {
+  wgpu_context_t* wgpu_context;
+  WGPUTextureFormat color_format;
+  bool enabled;
+  bool overdraw;
+  /* Fragment counts of the overdraw visualization */
+  struct {
+    WGPUTexture texture;
+    WGPUTextureView view;
+    uint32_t width;
+    uint32_t height;
+  } counts;
+  /* Heat map */
+  WGPUShaderModule shader_module;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUBindGroup bind_group;
+  WGPURenderPipeline heat_map_pipeline;
+  /* Overdraw measurement */
+  wgpu_buffer_t stats_buffer;
+  bool readback_pending;
+  float average_overdraw;
+};
+
+// clang-format off
+static const char* depth_prepass_shader_wgsl = CODE(
+  struct Stats {
+    fragments : atomic<u32>,
+    pixels : atomic<u32>,
+  }
+
+  @group(0) @binding(0) var countTexture : texture_2d<f32>;
+  @group(0) @binding(1) var<storage, read_write> stats : Stats;
+
+  // Counts the shaded fragments of a pixel with additive blending
+  @fragment
+  fn fs_count() -> @location(0) vec4f {
+    return vec4f(1.0, 0.0, 0.0, 0.0);
+  }
+
+  @vertex
+  fn vs_fullscreen(@builtin(vertex_index) vertexIndex : u32)
+    -> @builtin(position) vec4f {
+    let uv = vec2f(f32((vertexIndex << 1u) & 2u), f32(vertexIndex & 2u));
+    return vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+  }
+
+  @fragment
+  fn fs_heat_map(@builtin(position) position : vec4f) -> @location(0) vec4f {
+    let count = u32(textureLoad(countTexture, vec2u(position.xy), 0).r + 0.5);
+    if (count > 0u) {
+      atomicAdd(&stats.fragments, count);
+      atomicAdd(&stats.pixels, 1u);
+    }
+    var colors = array<vec3f, 8>(
+      vec3f(0.0, 0.0, 0.0), // not covered
+      vec3f(0.0, 0.1, 0.5), // shaded once
+      vec3f(0.0, 0.5, 0.9),
+      vec3f(0.0, 0.8, 0.3),
+      vec3f(0.9, 0.9, 0.0),
+      vec3f(1.0, 0.5, 0.0),
+      vec3f(1.0, 0.0, 0.0),
+      vec3f(1.0, 1.0, 1.0)  // shaded 7 times or more
+    );
+    return vec4f(colors[min(count, 7u)], 1.0);
+  }
+);
+// clang-format on
+
+/* -------------------------------------------------------------------------- *
+ * Overdraw visualization
+ * -------------------------------------------------------------------------- */
+
+static void depth_prepass_prepare_heat_map(wgpu_depth_prepass_t* dp)
+{
+  WGPUDevice device = dp->wgpu_context->device;
+
+  dp->stats_buffer = wgpu_create_buffer(
+    dp->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "Depth pre-pass - Overdraw stats buffer",
+      .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc
+               | WGPUBufferUsage_CopyDst,
+      .size = sizeof(depth_prepass_stats_t),
+    });
+
+  WGPUBindGroupLayoutEntry bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Storage,
+        .minBindingSize = sizeof(depth_prepass_stats_t),
+      },
+    },
+  };
+  dp->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Depth pre-pass - Heat map bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(dp->bind_group_layout != NULL);
+
+  dp->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Depth pre-pass - Heat map layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &dp->bind_group_layout,
+            });
+  ASSERT(dp->pipeline_layout != NULL);
+
+  WGPUColorTargetState color_target_state = {
+    .format    = dp->color_format,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  dp->heat_map_pipeline = wgpuDeviceCreateRenderPipeline(
+    device, &(WGPURenderPipelineDescriptor){
+              .label  = "Depth pre-pass - Heat map pipeline",
+              .layout = dp->pipeline_layout,
+              .primitive = {
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .cullMode = WGPUCullMode_None,
+              },
+              .vertex = {
+                .module     = dp->shader_module,
+                .entryPoint = "vs_fullscreen",
+              },
+              .fragment = &(WGPUFragmentState){
+                .module      = dp->shader_module,
+                .entryPoint  = "fs_heat_map",
+                .targetCount = 1,
+                .targets     = &color_target_state,
+              },
+              .multisample = {
+                .count = 1,
+                .mask  = 0xffffffff,
+              },
+            });
+  ASSERT(dp->heat_map_pipeline != NULL);
+}
+
+/* (Re)creates the fragment count texture for the frame size */
+static void depth_prepass_prepare_counts(wgpu_depth_prepass_t* dp)
+{
+  const uint32_t width  = MAX(dp->wgpu_context->surface.width, 1u);
+  const uint32_t height = MAX(dp->wgpu_context->surface.height, 1u);
+  if (dp->counts.texture != NULL && dp->counts.width == width
+      && dp->counts.height == height) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(BindGroup, dp->bind_group)
+  WGPU_RELEASE_RESOURCE(TextureView, dp->counts.view)
+  WGPU_RELEASE_RESOURCE(Texture, dp->counts.texture)
+  dp->counts.width  = width;
+  dp->counts.height = height;
+
+  dp->counts.texture = wgpuDeviceCreateTexture(
+    dp->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label = "Depth pre-pass - Fragment count texture",
+      .usage = WGPUTextureUsage_RenderAttachment
+               | WGPUTextureUsage_TextureBinding,
+      .dimension = WGPUTextureDimension_2D,
+      .size = (WGPUExtent3D){
+        .width              = width,
+        .height             = height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = DEPTH_PREPASS_COUNT_FORMAT,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(dp->counts.texture != NULL);
+  dp->counts.view = wgpuTextureCreateView(dp->counts.texture, NULL);
+  ASSERT(dp->counts.view != NULL);
+
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding     = 0,
+      .textureView = dp->counts.view,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = dp->stats_buffer.buffer,
+      .size    = dp->stats_buffer.size,
+    },
+  };
+  dp->bind_group = wgpuDeviceCreateBindGroup(
+    dp->wgpu_context->device,
+    &(WGPUBindGroupDescriptor){
+      .label      = "Depth pre-pass - Heat map bind group",
+      .layout     = dp->bind_group_layout,
+      .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+      .entries    = bg_entries,
+    });
+  ASSERT(dp->bind_group != NULL);
+}
+
+static void depth_prepass_readback_cb(const wgpu_readback_result_t* result,
+                                      void* user_data)
+{
+  wgpu_depth_prepass_t* dp = (wgpu_depth_prepass_t*)user_data;
+  dp->readback_pending     = false;
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS
+      || result->size < sizeof(depth_prepass_stats_t)) {
+    return;
+  }
+
+  depth_prepass_stats_t stats;
+  memcpy(&stats, result->data, sizeof(stats));
+  dp->average_overdraw
+    = stats.pixels > 0 ? (float)stats.fragments / (float)stats.pixels : 0.0f;
+}
+
+/* Draws the fragment counts as heat map into the frame and measures them */
+static void depth_prepass_draw_heat_map(
+  wgpu_depth_prepass_t* dp, WGPUCommandEncoder cmd_enc,
+  const WGPURenderPassColorAttachment* color_attachment)
+{
+  wgpuCommandEncoderClearBuffer(cmd_enc, dp->stats_buffer.buffer, 0,
+                                dp->stats_buffer.size);
+
+  WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+    cmd_enc, &(WGPURenderPassDescriptor){
+               .label                = "Depth pre-pass - Heat map pass",
+               .colorAttachmentCount = 1,
+               .colorAttachments     = color_attachment,
+             });
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, dp->heat_map_pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, dp->bind_group, 0, NULL);
+  wgpuRenderPassEncoderDraw(rpass_enc, 3, 1, 0, 0);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+  /* One measurement in flight at a time */
+  if (!dp->readback_pending) {
+    dp->readback_pending = wgpu_readback_copy_buffer(
+      dp->wgpu_context->readback, cmd_enc,
+      &(wgpu_readback_buffer_desc_t){
+        .buffer   = dp->stats_buffer.buffer,
+        .size     = sizeof(depth_prepass_stats_t),
+        .callback = depth_prepass_readback_cb,
+        .userdata = dp,
+      });
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Depth pre-pass
+ * -------------------------------------------------------------------------- */
+
+wgpu_depth_prepass_t*
+wgpu_depth_prepass_create(wgpu_context_t* wgpu_context,
+                          const wgpu_depth_prepass_desc_t* desc)
+{
+  wgpu_depth_prepass_t* dp
+    = (wgpu_depth_prepass_t*)calloc(1, sizeof(wgpu_depth_prepass_t));
+  dp->wgpu_context = wgpu_context;
+  dp->color_format = desc->color_format;
+  dp->enabled      = desc->enabled;
+  dp->overdraw     = desc->overdraw;
+
+  wgpu_create_readback(wgpu_context);
+  dp->shader_module = wgpu_create_shader_module(
+    wgpu_context, &(wgpu_shader_desc_t){
+                    .wgsl_code.source = depth_prepass_shader_wgsl,
+                  });
+  ASSERT(dp->shader_module != NULL);
+  depth_prepass_prepare_heat_map(dp);
+
+  return dp;
+}
+
+void wgpu_depth_prepass_destroy(wgpu_depth_prepass_t* dp)
+{
+  if (dp == NULL) {
+    return;
+  }
+
+  /* The pending readback references the depth pre-pass */
+  if (dp->readback_pending && dp->wgpu_context->readback != NULL) {
+    wgpu_readback_flush(dp->wgpu_context->readback);
+  }
+
+  WGPU_RELEASE_RESOURCE(BindGroup, dp->bind_group)
+  WGPU_RELEASE_RESOURCE(TextureView, dp->counts.view)
+  WGPU_RELEASE_RESOURCE(Texture, dp->counts.texture)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, dp->heat_map_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, dp->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, dp->bind_group_layout)
+  wgpu_release_shader_module(dp->wgpu_context, dp->shader_module);
+  wgpu_destroy_buffer(&dp->stats_buffer);
+  free(dp);
+}
+
+static WGPURenderPipeline
+depth_prepass_create_variant(WGPUDevice device,
+                             WGPURenderPipelineDescriptor* descriptor,
+                             const char* label, const char* suffix)
+{
+  char variant_label[STRMAX];
+  snprintf(variant_label, sizeof(variant_label), "%s (%s)",
+           label ? label : "Render pipeline", suffix);
+  descriptor->label           = variant_label;
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(device,
+                                                               descriptor);
+  ASSERT(pipeline != NULL);
+  return pipeline;
+}
+
+void wgpu_depth_prepass_create_pipeline(
+  wgpu_depth_prepass_t* dp, const wgpu_depth_prepass_pipeline_desc_t* desc,
+  wgpu_depth_prepass_pipeline_t* pipeline)
+{
+  WGPUDevice device                        = dp->wgpu_context->device;
+  const WGPURenderPipelineDescriptor* base = desc->descriptor;
+  memset(pipeline, 0, sizeof(*pipeline));
+
+  pipeline->forward = wgpuDeviceCreateRenderPipeline(device, base);
+  ASSERT(pipeline->forward != NULL);
+
+  /* Pipelines that do not write depth are drawn in the color pass only and
+   * keep their depth state */
+  const bool prepass
+    = base->depthStencil != NULL && base->depthStencil->depthWriteEnabled;
+  WGPUDepthStencilState equal_state = {0};
+  if (prepass) {
+    WGPURenderPipelineDescriptor depth_desc = *base;
+    if (desc->depth_vertex != NULL) {
+      depth_desc.vertex = *desc->depth_vertex;
+    }
+    depth_desc.fragment = desc->depth_fragment;
+    pipeline->depth     = depth_prepass_create_variant(device, &depth_desc,
+                                                       base->label, "depth");
+
+    equal_state                   = *base->depthStencil;
+    equal_state.depthCompare      = WGPUCompareFunction_Equal;
+    equal_state.depthWriteEnabled = false;
+    WGPURenderPipelineDescriptor equal_desc = *base;
+    equal_desc.depthStencil                 = &equal_state;
+    pipeline->equal = depth_prepass_create_variant(device, &equal_desc,
+                                                   base->label, "equal");
+  }
+
+  /* The color target is replaced by the fragment count */
+  WGPUBlendState blend_state = {
+    .color = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = WGPUBlendFactor_One,
+    },
+    .alpha = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = WGPUBlendFactor_One,
+    },
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = DEPTH_PREPASS_COUNT_FORMAT,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+  WGPUFragmentState fragment_state = {
+    .module      = dp->shader_module,
+    .entryPoint  = "fs_count",
+    .targetCount = 1,
+    .targets     = &color_target_state,
+  };
+  WGPURenderPipelineDescriptor overdraw_desc = *base;
+  overdraw_desc.fragment                     = &fragment_state;
+  pipeline->overdraw[0] = depth_prepass_create_variant(
+    device, &overdraw_desc, base->label, "overdraw");
+  if (prepass) {
+    overdraw_desc.depthStencil = &equal_state;
+    pipeline->overdraw[1]      = depth_prepass_create_variant(
+      device, &overdraw_desc, base->label, "overdraw equal");
+  }
+}
+
+void wgpu_depth_prepass_release_pipeline(
+  wgpu_depth_prepass_pipeline_t* pipeline)
+{
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline->forward)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline->depth)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline->equal)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline->overdraw[0])
+  WGPU_RELEASE_RESOURCE(RenderPipeline, pipeline->overdraw[1])
+}
+
+WGPURenderPipeline
+wgpu_depth_prepass_get_pipeline(wgpu_depth_prepass_t* dp,
+                                const wgpu_depth_prepass_pipeline_t* pipeline,
+                                wgpu_depth_prepass_stage_t stage)
+{
+  if (stage == WGPU_DEPTH_PREPASS_STAGE_DEPTH) {
+    return dp->enabled ? pipeline->depth : NULL;
+  }
+  const bool equal = dp->enabled && pipeline->depth != NULL;
+  if (dp->overdraw) {
+    return pipeline->overdraw[equal ? 1 : 0];
+  }
+  return equal ? pipeline->equal : pipeline->forward;
+}
+
+void wgpu_depth_prepass_set_enabled(wgpu_depth_prepass_t* dp, bool enabled)
+{
+  dp->enabled = enabled;
+}
+
+bool wgpu_depth_prepass_is_enabled(wgpu_depth_prepass_t* dp)
+{
+  return dp->enabled;
+}
+
+void wgpu_depth_prepass_set_overdraw(wgpu_depth_prepass_t* dp, bool overdraw)
+{
+  dp->overdraw = overdraw;
+}
+
+bool wgpu_depth_prepass_is_overdraw(wgpu_depth_prepass_t* dp)
+{
+  return dp->overdraw;
+}
+
+float wgpu_depth_prepass_get_overdraw(wgpu_depth_prepass_t* dp)
+{
+  return dp->average_overdraw;
+}
+
+void wgpu_depth_prepass_render(wgpu_depth_prepass_t* dp,
+                               WGPUCommandEncoder cmd_enc,
+                               const WGPURenderPassDescriptor* rpass_desc,
+                               wgpu_depth_prepass_draw_func_t draw_func,
+                               void* user_data)
+{
+  WGPURenderPassDescriptor color_pass_desc = *rpass_desc;
+  WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {0};
+
+  /* Depth only pre-pass, clears the depth stencil attachment */
+  if (dp->enabled && rpass_desc->depthStencilAttachment != NULL) {
+    depth_stencil_attachment              = *rpass_desc->depthStencilAttachment;
+    depth_stencil_attachment.depthStoreOp = WGPUStoreOp_Store;
+    if (depth_stencil_attachment.stencilLoadOp != WGPULoadOp_Undefined) {
+      depth_stencil_attachment.stencilStoreOp = WGPUStoreOp_Store;
+    }
+    WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      cmd_enc, &(WGPURenderPassDescriptor){
+                 .label                  = "Depth pre-pass - Depth pass",
+                 .depthStencilAttachment = &depth_stencil_attachment,
+               });
+    draw_func(rpass_enc, WGPU_DEPTH_PREPASS_STAGE_DEPTH, user_data);
+    wgpuRenderPassEncoderEnd(rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+    /* The color pass tests against the depth of the pre-pass */
+    depth_stencil_attachment.depthLoadOp  = WGPULoadOp_Load;
+    depth_stencil_attachment.depthStoreOp
+      = rpass_desc->depthStencilAttachment->depthStoreOp;
+    if (depth_stencil_attachment.stencilLoadOp != WGPULoadOp_Undefined) {
+      depth_stencil_attachment.stencilLoadOp = WGPULoadOp_Load;
+      depth_stencil_attachment.stencilStoreOp
+        = rpass_desc->depthStencilAttachment->stencilStoreOp;
+    }
+    color_pass_desc.depthStencilAttachment = &depth_stencil_attachment;
+  }
+
+  /* The overdraw visualization counts the fragments instead of shading */
+  WGPURenderPassColorAttachment count_attachment = {0};
+  if (dp->overdraw) {
+    depth_prepass_prepare_counts(dp);
+    count_attachment = (WGPURenderPassColorAttachment){
+      .view       = dp->counts.view,
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = (WGPUColor){0.0, 0.0, 0.0, 0.0},
+    };
+    color_pass_desc.colorAttachmentCount = 1;
+    color_pass_desc.colorAttachments     = &count_attachment;
+  }
+
+  WGPURenderPassEncoder rpass_enc
+    = wgpuCommandEncoderBeginRenderPass(cmd_enc, &color_pass_desc);
+  draw_func(rpass_enc, WGPU_DEPTH_PREPASS_STAGE_COLOR, user_data);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+
+  if (dp->overdraw) {
+    depth_prepass_draw_heat_map(dp, cmd_enc, &rpass_desc->colorAttachments[0]);
+  }
+}
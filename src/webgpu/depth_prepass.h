@@ -0,0 +1,117 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Depth Pre-pass
+ *
+ * Renders a frame either in a single forward pass or with a depth pre-pass:
+ * a depth only pass without color writes lays down the nearest depth of the
+ * opaque geometry, the following color pass tests against it with depth
+ * compare Equal and depth writes disabled, so that expensive fragment shaders
+ * run once per pixel instead of once per overlapping fragment.
+ * The example describes each of its pipelines once, the pre-pass creates the
+ * variants of all modes from the description and selects the one to bind for
+ * the current mode and pass. Pipelines without depth writes (skyboxes,
+ * blended geometry) are left out of the pre-pass and keep their depth state.
+ * For debugging, the color pass can instead count the shaded fragments of
+ * every pixel. The counts are shown as a heat map and their average over the
+ * covered pixels is read back a few frames later.
+ * -------------------------------------------------------------------------- */
+
+/* Pass of the frame that the scene is drawn into */
+typedef enum wgpu_depth_prepass_stage_t {
+  WGPU_DEPTH_PREPASS_STAGE_DEPTH = 0, /* depth only pre-pass */
+  WGPU_DEPTH_PREPASS_STAGE_COLOR = 1, /* shading pass */
+} wgpu_depth_prepass_stage_t;
+
+typedef struct wgpu_depth_prepass_desc_t {
+  WGPUTextureFormat color_format; /* format of the frame */
+  bool enabled;                   /* depth pre-pass initially enabled */
+  bool overdraw;                  /* overdraw visualization initially shown */
+} wgpu_depth_prepass_desc_t;
+
+typedef struct wgpu_depth_prepass_pipeline_desc_t {
+  /* Single pass pipeline, single sampled with one color target */
+  const WGPURenderPipelineDescriptor* descriptor;
+  /* Optional position only vertex state of the pre-pass. Its position has to
+   * be computed exactly as in the vertex state of the descriptor, declare it
+   * @invariant in both shaders. */
+  const WGPUVertexState* depth_vertex;
+  /* Optional fragment state of the pre-pass without color targets, e.g. to
+   * discard alpha tested fragments */
+  const WGPUFragmentState* depth_fragment;
+} wgpu_depth_prepass_pipeline_desc_t;
+
+/* Variants of a pipeline, NULL where a variant is not needed */
+typedef struct wgpu_depth_prepass_pipeline_t {
+  WGPURenderPipeline forward;     /* single pass, as described */
+  WGPURenderPipeline depth;       /* depth only pre-pass */
+  WGPURenderPipeline equal;       /* color pass after the pre-pass */
+  WGPURenderPipeline overdraw[2]; /* fragment counting without / with */
+} wgpu_depth_prepass_pipeline_t;
+
+/**
+ * @brief Draws the scene into the given pass of the frame. The pipelines have
+ * to be selected with wgpu_depth_prepass_get_pipeline(), draws without a
+ * pipeline in the pass are skipped. All pass state (viewport, scissor, bind
+ * groups, buffers) has to be set in every pass.
+ */
+typedef void (*wgpu_depth_prepass_draw_func_t)(
+  WGPURenderPassEncoder rpass_enc, wgpu_depth_prepass_stage_t stage,
+  void* user_data);
+
+typedef struct wgpu_depth_prepass wgpu_depth_prepass_t;
+
+/* Depth pre-pass construction / destruction */
+wgpu_depth_prepass_t*
+wgpu_depth_prepass_create(wgpu_context_t* wgpu_context,
+                          const wgpu_depth_prepass_desc_t* desc);
+void wgpu_depth_prepass_destroy(wgpu_depth_prepass_t* depth_prepass);
+
+/* Pipeline variants */
+void wgpu_depth_prepass_create_pipeline(
+  wgpu_depth_prepass_t* depth_prepass,
+  const wgpu_depth_prepass_pipeline_desc_t* desc,
+  wgpu_depth_prepass_pipeline_t* pipeline);
+void wgpu_depth_prepass_release_pipeline(
+  wgpu_depth_prepass_pipeline_t* pipeline);
+
+/**
+ * @brief Returns the variant to bind in the given pass for the current mode,
+ * NULL if the pipeline does not draw in that pass.
+ */
+WGPURenderPipeline
+wgpu_depth_prepass_get_pipeline(wgpu_depth_prepass_t* depth_prepass,
+                                const wgpu_depth_prepass_pipeline_t* pipeline,
+                                wgpu_depth_prepass_stage_t stage);
+
+/* Mode */
+void wgpu_depth_prepass_set_enabled(wgpu_depth_prepass_t* depth_prepass,
+                                    bool enabled);
+bool wgpu_depth_prepass_is_enabled(wgpu_depth_prepass_t* depth_prepass);
+void wgpu_depth_prepass_set_overdraw(wgpu_depth_prepass_t* depth_prepass,
+                                     bool overdraw);
+bool wgpu_depth_prepass_is_overdraw(wgpu_depth_prepass_t* depth_prepass);
+
+/**
+ * @brief Average number of shaded fragments per covered pixel, measured with
+ * the overdraw visualization. Lags a few frames behind, 0 if not measured.
+ */
+float wgpu_depth_prepass_get_overdraw(wgpu_depth_prepass_t* depth_prepass);
+
+/**
+ * @brief Records the passes of the frame: the depth pre-pass if enabled, the
+ * color pass and, with the overdraw visualization, the heat map pass. The
+ * color pass uses the color attachment of the render pass descriptor, or the
+ * fragment counts for the overdraw visualization. The pre-pass uses its depth
+ * stencil attachment.
+ */
+void wgpu_depth_prepass_render(wgpu_depth_prepass_t* depth_prepass,
+                               WGPUCommandEncoder cmd_enc,
+                               const WGPURenderPassDescriptor* rpass_desc,
+                               wgpu_depth_prepass_draw_func_t draw_func,
+                               void* user_data);
+
+#endif /* DEPTH_PREPASS_H */
@@ -0,0 +1,365 @@
+#include "frame_capture.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/file.h"
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "readback.h"
+
+#include <stb_image_write.h>
+
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Frame Capture
+ * -------------------------------------------------------------------------- */
+
+#define FRAME_CAPTURE_MAX_THREADS 8u
+
+typedef struct frame_capture_job_t {
+  uint64_t index;
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row;
+  uint8_t* pixels;
+} frame_capture_job_t;
+
+struct wgpu_frame_capture {
+  wgpu_context_t* wgpu_context;
+  wgpu_frame_capture_mode_t mode;
+  char output[STRMAX];
+  uint32_t interval;
+  uint32_t max_frames;
+  uint32_t fps;
+  uint64_t capture_index;
+  /* Bounded encoder queue (ring buffer) */
+  struct {
+    frame_capture_job_t* jobs;
+    uint32_t capacity;
+    uint32_t first;
+    uint32_t count;
+  } queue;
+  struct {
+    pthread_t threads[FRAME_CAPTURE_MAX_THREADS];
+    uint32_t thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool quit;
+  } worker;
+  /* ffmpeg process, opened with the first frame */
+  FILE* ffmpeg_pipe;
+  wgpu_frame_capture_stats_t stats;
+};
+
+static bool is_video_output(const char* output)
+{
+  static const char* video_extensions[5] = {"mp4", "mkv", "webm", "mov", "avi"};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(video_extensions); ++i) {
+    if (filename_has_extension(output, video_extensions[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool is_bgra_format(WGPUTextureFormat format)
+{
+  return format == WGPUTextureFormat_BGRA8Unorm
+         || format == WGPUTextureFormat_BGRA8UnormSrgb;
+}
+
+static void write_png_frame(wgpu_frame_capture_t* frame_capture,
+                            frame_capture_job_t* job)
+{
+  if (is_bgra_format(job->format)) {
+    for (uint32_t i = 0; i < job->width * job->height; ++i) {
+      uint8_t* p = &job->pixels[i * 4];
+      uint8_t b  = p[0];
+      p[0]       = p[2];
+      p[2]       = b;
+    }
+  }
+
+  char filename[STRMAX];
+  snprintf(filename, sizeof(filename), "%s_%06llu.png", frame_capture->output,
+           (unsigned long long)job->index);
+  if (!stbi_write_png(filename, (int)job->width, (int)job->height, 4,
+                      job->pixels, (int)job->bytes_per_row)) {
+    log_error("Frame capture: failed to write %s", filename);
+  }
+}
+
+static bool open_ffmpeg_pipe(wgpu_frame_capture_t* frame_capture,
+                             frame_capture_job_t* job)
+{
+  char command[STRMAX * 2];
+  snprintf(command, sizeof(command),
+           "ffmpeg -loglevel error -y -f rawvideo -pix_fmt %s -s %ux%u -r %u "
+           "-i - -pix_fmt yuv420p \"%s\"",
+           is_bgra_format(job->format) ? "bgra" : "rgba", job->width,
+           job->height, frame_capture->fps, frame_capture->output);
+#if defined(_WIN32)
+  frame_capture->ffmpeg_pipe = popen(command, "wb");
+#else
+  frame_capture->ffmpeg_pipe = popen(command, "w");
+#endif
+  if (frame_capture->ffmpeg_pipe == NULL) {
+    log_error("Frame capture: could not start ffmpeg: %s", command);
+    return false;
+  }
+  return true;
+}
+
+static void write_video_frame(wgpu_frame_capture_t* frame_capture,
+                              frame_capture_job_t* job)
+{
+  if (frame_capture->ffmpeg_pipe == NULL
+      && !open_ffmpeg_pipe(frame_capture, job)) {
+    return;
+  }
+  const size_t size = (size_t)job->bytes_per_row * job->height;
+  if (fwrite(job->pixels, 1, size, frame_capture->ffmpeg_pipe) != size) {
+    log_error("Frame capture: failed to write frame %llu to ffmpeg",
+              (unsigned long long)job->index);
+  }
+}
+
+static void* frame_capture_thread_main(void* arg)
+{
+  wgpu_frame_capture_t* frame_capture = (wgpu_frame_capture_t*)arg;
+
+  pthread_mutex_lock(&frame_capture->worker.mutex);
+  while (true) {
+    while (frame_capture->queue.count == 0 && !frame_capture->worker.quit) {
+      pthread_cond_wait(&frame_capture->worker.cond,
+                        &frame_capture->worker.mutex);
+    }
+    if (frame_capture->queue.count == 0 && frame_capture->worker.quit) {
+      break;
+    }
+    frame_capture_job_t job
+      = frame_capture->queue.jobs[frame_capture->queue.first];
+    frame_capture->queue.first
+      = (frame_capture->queue.first + 1) % frame_capture->queue.capacity;
+    --frame_capture->queue.count;
+    pthread_mutex_unlock(&frame_capture->worker.mutex);
+
+    if (frame_capture->mode == WGPU_FRAME_CAPTURE_MODE_FFMPEG) {
+      write_video_frame(frame_capture, &job);
+    }
+    else {
+      write_png_frame(frame_capture, &job);
+    }
+    free(job.pixels);
+
+    pthread_mutex_lock(&frame_capture->worker.mutex);
+    ++frame_capture->stats.frames_written;
+  }
+  pthread_mutex_unlock(&frame_capture->worker.mutex);
+
+  return NULL;
+}
+
+wgpu_frame_capture_t*
+wgpu_frame_capture_create(wgpu_context_t* wgpu_context,
+                          const wgpu_frame_capture_desc_t* desc)
+{
+  wgpu_frame_capture_t* frame_capture
+    = (wgpu_frame_capture_t*)calloc(1, sizeof(wgpu_frame_capture_t));
+  frame_capture->wgpu_context = wgpu_context;
+
+  snprintf(frame_capture->output, sizeof(frame_capture->output), "%s",
+           desc->output ? desc->output : "frame");
+  frame_capture->mode       = is_video_output(frame_capture->output) ?
+                                WGPU_FRAME_CAPTURE_MODE_FFMPEG :
+                                WGPU_FRAME_CAPTURE_MODE_PNG_SEQUENCE;
+  frame_capture->interval   = MAX(1u, desc->interval);
+  frame_capture->max_frames = desc->max_frames;
+  frame_capture->fps        = desc->fps > 0 ? desc->fps : 60u;
+
+  frame_capture->queue.capacity = desc->queue_depth > 0 ? desc->queue_depth : 8u;
+  frame_capture->queue.jobs     = (frame_capture_job_t*)calloc(
+    frame_capture->queue.capacity, sizeof(frame_capture_job_t));
+
+  /* Frames written to ffmpeg must stay ordered, use a single writer thread */
+  uint32_t thread_count = desc->thread_count > 0 ? desc->thread_count : 2u;
+  if (frame_capture->mode == WGPU_FRAME_CAPTURE_MODE_FFMPEG) {
+    thread_count = 1;
+  }
+  thread_count = MIN(thread_count, FRAME_CAPTURE_MAX_THREADS);
+
+  pthread_mutex_init(&frame_capture->worker.mutex, NULL);
+  pthread_cond_init(&frame_capture->worker.cond, NULL);
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    if (pthread_create(&frame_capture->worker.threads[i], NULL,
+                       frame_capture_thread_main, frame_capture)
+        != 0) {
+      log_error("Frame capture: could not create encoder thread %u", i);
+      break;
+    }
+    ++frame_capture->worker.thread_count;
+  }
+
+  wgpu_create_readback(wgpu_context);
+
+  log_info("Frame capture: capturing every %u frame(s) to %s (%s)",
+           frame_capture->interval, frame_capture->output,
+           frame_capture->mode == WGPU_FRAME_CAPTURE_MODE_FFMPEG ?
+             "ffmpeg" :
+             "PNG sequence");
+
+  return frame_capture;
+}
+
+void wgpu_frame_capture_destroy(wgpu_frame_capture_t* frame_capture)
+{
+  if (frame_capture == NULL) {
+    return;
+  }
+
+  /* Deliver the frames still in flight to the encoder queue */
+  if (frame_capture->wgpu_context->readback != NULL) {
+    wgpu_readback_flush(frame_capture->wgpu_context->readback);
+  }
+
+  pthread_mutex_lock(&frame_capture->worker.mutex);
+  frame_capture->worker.quit = true;
+  pthread_cond_broadcast(&frame_capture->worker.cond);
+  pthread_mutex_unlock(&frame_capture->worker.mutex);
+  for (uint32_t i = 0; i < frame_capture->worker.thread_count; ++i) {
+    pthread_join(frame_capture->worker.threads[i], NULL);
+  }
+  pthread_cond_destroy(&frame_capture->worker.cond);
+  pthread_mutex_destroy(&frame_capture->worker.mutex);
+
+  if (frame_capture->ffmpeg_pipe != NULL) {
+    pclose(frame_capture->ffmpeg_pipe);
+  }
+
+  wgpu_frame_capture_stats_t* stats = &frame_capture->stats;
+  log_info("Frame capture: %llu frames requested, %llu written, %llu dropped, "
+           "%llu failed",
+           (unsigned long long)stats->frames_requested,
+           (unsigned long long)stats->frames_written,
+           (unsigned long long)stats->frames_dropped,
+           (unsigned long long)stats->frames_failed);
+
+  /* Release the frames that were not processed */
+  for (uint32_t i = 0; i < frame_capture->queue.count; ++i) {
+    uint32_t index
+      = (frame_capture->queue.first + i) % frame_capture->queue.capacity;
+    free(frame_capture->queue.jobs[index].pixels);
+  }
+  free(frame_capture->queue.jobs);
+  free(frame_capture);
+}
+
+static void frame_capture_readback_cb(const wgpu_readback_result_t* result,
+                                      void* user_data)
+{
+  wgpu_frame_capture_t* frame_capture = (wgpu_frame_capture_t*)user_data;
+
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS) {
+    pthread_mutex_lock(&frame_capture->worker.mutex);
+    ++frame_capture->stats.frames_failed;
+    pthread_mutex_unlock(&frame_capture->worker.mutex);
+    return;
+  }
+
+  pthread_mutex_lock(&frame_capture->worker.mutex);
+  if (frame_capture->queue.count == frame_capture->queue.capacity
+      || frame_capture->worker.thread_count == 0) {
+    /* Encoder queue is full, drop the frame instead of stalling */
+    ++frame_capture->stats.frames_dropped;
+    pthread_mutex_unlock(&frame_capture->worker.mutex);
+    return;
+  }
+  uint32_t index = (frame_capture->queue.first + frame_capture->queue.count)
+                   % frame_capture->queue.capacity;
+  frame_capture_job_t* job = &frame_capture->queue.jobs[index];
+  job->index               = frame_capture->capture_index++;
+  job->format              = result->format;
+  job->width               = result->width;
+  job->height              = result->height;
+  job->bytes_per_row       = result->bytes_per_row;
+  job->pixels              = (uint8_t*)malloc(result->size);
+  memcpy(job->pixels, result->data, result->size);
+  ++frame_capture->queue.count;
+  pthread_cond_signal(&frame_capture->worker.cond);
+  pthread_mutex_unlock(&frame_capture->worker.mutex);
+}
+
+void wgpu_frame_capture_on_frame(wgpu_frame_capture_t* frame_capture,
+                                 uint64_t frame_index)
+{
+  if ((frame_index % frame_capture->interval) != 0
+      || wgpu_frame_capture_is_finished(frame_capture)) {
+    return;
+  }
+
+  wgpu_context_t* wgpu_context = frame_capture->wgpu_context;
+  ++frame_capture->stats.frames_seen;
+
+  if (!wgpu_readback_can_accept(wgpu_context->readback)) {
+    pthread_mutex_lock(&frame_capture->worker.mutex);
+    ++frame_capture->stats.frames_dropped;
+    pthread_mutex_unlock(&frame_capture->worker.mutex);
+    return;
+  }
+
+  WGPUTexture texture
+    = wgpuSwapChainGetCurrentTexture(wgpu_context->swap_chain.instance);
+  if (texture == NULL) {
+    return;
+  }
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  bool recorded = wgpu_readback_copy_texture(
+    wgpu_context->readback, cmd_enc,
+    &(wgpu_readback_texture_desc_t){
+      .texture  = texture,
+      .format   = wgpu_context->swap_chain.format,
+      .width    = wgpu_context->surface.width,
+      .height   = wgpu_context->surface.height,
+      .callback = frame_capture_readback_cb,
+      .userdata = frame_capture,
+    });
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpu_flush_command_buffers(wgpu_context, &command_buffer, 1);
+  WGPU_RELEASE_RESOURCE(Texture, texture)
+
+  if (recorded) {
+    ++frame_capture->stats.frames_requested;
+  }
+  else {
+    pthread_mutex_lock(&frame_capture->worker.mutex);
+    ++frame_capture->stats.frames_dropped;
+    pthread_mutex_unlock(&frame_capture->worker.mutex);
+  }
+}
+
+bool wgpu_frame_capture_is_finished(wgpu_frame_capture_t* frame_capture)
+{
+  return frame_capture->max_frames > 0
+         && frame_capture->stats.frames_requested
+              >= frame_capture->max_frames;
+}
+
+void wgpu_frame_capture_get_stats(wgpu_frame_capture_t* frame_capture,
+                                  wgpu_frame_capture_stats_t* stats)
+{
+  pthread_mutex_lock(&frame_capture->worker.mutex);
+  *stats = frame_capture->stats;
+  pthread_mutex_unlock(&frame_capture->worker.mutex);
+}
@@ -0,0 +1,63 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Frame Capture
+ *
+ * Records every Nth presented frame through the readback service. Frames are
+ * handed to background threads through a bounded queue and written either as
+ * a PNG image sequence or piped as raw video frames into a local ffmpeg
+ * process. Capture never stalls the render loop: when the readback pool or the
+ * encoder queue is full, the frame is dropped and accounted for.
+ * -------------------------------------------------------------------------- */
+
+typedef enum wgpu_frame_capture_mode_t {
+  WGPU_FRAME_CAPTURE_MODE_PNG_SEQUENCE,
+  WGPU_FRAME_CAPTURE_MODE_FFMPEG,
+} wgpu_frame_capture_mode_t;
+
+typedef struct wgpu_frame_capture_desc_t {
+  /* PNG sequence: file name prefix, e.g. "capture/frame" writes
+   * "capture/frame_000000.png". Video files (.mp4, .mkv, .webm, .mov, .avi)
+   * are encoded by piping the raw frames to ffmpeg. */
+  const char* output;
+  uint32_t interval;     /* capture every Nth frame, default 1 */
+  uint32_t max_frames;   /* stop after max_frames captures, 0 = unlimited */
+  uint32_t queue_depth;  /* bounded encoder queue size, default 8 */
+  uint32_t thread_count; /* PNG encoder threads, default 2 */
+  uint32_t fps;          /* video frame rate, default 60 */
+} wgpu_frame_capture_desc_t;
+
+typedef struct wgpu_frame_capture_stats_t {
+  uint64_t frames_seen;
+  uint64_t frames_requested;
+  uint64_t frames_written;
+  uint64_t frames_dropped; /* readback pool or encoder queue full */
+  uint64_t frames_failed;
+} wgpu_frame_capture_stats_t;
+
+typedef struct wgpu_frame_capture wgpu_frame_capture_t;
+
+/* Frame capture construction / destruction */
+wgpu_frame_capture_t*
+wgpu_frame_capture_create(wgpu_context_t* wgpu_context,
+                          const wgpu_frame_capture_desc_t* desc);
+void wgpu_frame_capture_destroy(wgpu_frame_capture_t* frame_capture);
+
+/**
+ * @brief Captures the current swap chain image if the frame index matches the
+ * capture interval. Must be called after the frame was rendered and before it
+ * is presented. The swap chain must be created with WGPUTextureUsage_CopySrc.
+ */
+void wgpu_frame_capture_on_frame(wgpu_frame_capture_t* frame_capture,
+                                 uint64_t frame_index);
+
+/* Returns true once max_frames frames were captured */
+bool wgpu_frame_capture_is_finished(wgpu_frame_capture_t* frame_capture);
+
+void wgpu_frame_capture_get_stats(wgpu_frame_capture_t* frame_capture,
+                                  wgpu_frame_capture_stats_t* stats);
+
+#endif /* FRAME_CAPTURE_H */
@@ -9,6 +9,7 @@
 #include "../core/file.h"
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "../core/mesh_processing.h"
 
 /*
  * Forward declarations
@@ -231,6 +232,11 @@ static void gltf_material_init(gltf_material_t* material,
   glm_vec3_zero(material->extension.specular_factor);
   material->pbr_workflows.metallic_roughness  = true;
   material->pbr_workflows.specular_glossiness = false;
+  material->texture_slots.base_color          = WGPU_GLTF_TEXTURE_SLOT_NONE;
+  material->texture_slots.metallic_roughness  = WGPU_GLTF_TEXTURE_SLOT_NONE;
+  material->texture_slots.normal              = WGPU_GLTF_TEXTURE_SLOT_NONE;
+  material->texture_slots.occlusion           = WGPU_GLTF_TEXTURE_SLOT_NONE;
+  material->texture_slots.emissive            = WGPU_GLTF_TEXTURE_SLOT_NONE;
   material->bind_group                        = NULL;
   material->pipeline                          = NULL;
 }
@@ -489,6 +495,7 @@ static void gltf_node_update(wgpu_context_t* wgpu_context, gltf_node_t* node)
         &node->mesh->uniform_block, sizeof(node->mesh->uniform_buffer));
     }
     else {
+      glm_mat4_copy(m, node->mesh->uniform_block.matrix);
       wgpu_queue_write_buffer(wgpu_context,
                               node->mesh->uniform_buffer.buffer.buffer, 0, &m,
                               sizeof(mat4));
@@ -689,6 +696,39 @@ typedef struct gltf_model_t {
     vec3 max;
   } dimensions;
 
+  /* Render queue: flattened draws, sorted by pass, state and depth */
+  struct {
+    struct gltf_draw_t* draws;
+    uint32_t draw_count;
+    uint64_t* keys;
+    uint32_t* items; /* sorted draw indices */
+    uint64_t* scratch_keys;
+    uint32_t* scratch_items;
+    uint32_t item_count;
+    /* Pipeline id of each material, ids are assigned per distinct pipeline */
+    WGPURenderPipeline* material_pipelines;
+    uint32_t* pipeline_ids;
+  } render_queue;
+
+  /* Material textures packed into texture arrays, see
+   * WGPU_GLTF_FileLoadingFlags_PackTextureArrays */
+  struct {
+    texture_t arrays[WGPU_GLTF_MAX_TEXTURE_ARRAYS];
+    uint32_t array_count;
+    uint32_t* texture_slots; /* array index << 16 | layer, per texture */
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUBindGroup bind_group;
+  } texture_arrays;
+
+  /* Storage buffers and bind group for vertex pulling, created on demand */
+  struct {
+    WGPUBindGroupLayout bind_group_layout;
+    WGPUBindGroup bind_group;
+    wgpu_buffer_t draws;
+    wgpu_buffer_t mesh_matrices;
+    wgpu_buffer_t materials;
+  } vertex_pulling;
+
   bool buffers_bound;
   char path[STRMAX];
 } gltf_model_t;
@@ -771,6 +811,29 @@ void wgpu_gltf_model_destroy(gltf_model_t* model)
   WGPU_RELEASE_RESOURCE(Buffer, model->vertices.buffer);
   WGPU_RELEASE_RESOURCE(Buffer, model->indices.buffer);
 
+  for (uint32_t i = 0; i < WGPU_GLTF_MAX_TEXTURE_ARRAYS; ++i) {
+    wgpu_destroy_texture(&model->texture_arrays.arrays[i]);
+  }
+  free(model->texture_arrays.texture_slots);
+  WGPU_RELEASE_RESOURCE(BindGroup, model->texture_arrays.bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        model->texture_arrays.bind_group_layout)
+
+  WGPU_RELEASE_RESOURCE(BindGroup, model->vertex_pulling.bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout,
+                        model->vertex_pulling.bind_group_layout)
+  wgpu_destroy_buffer(&model->vertex_pulling.draws);
+  wgpu_destroy_buffer(&model->vertex_pulling.mesh_matrices);
+  wgpu_destroy_buffer(&model->vertex_pulling.materials);
+
+  free(model->render_queue.draws);
+  free(model->render_queue.keys);
+  free(model->render_queue.items);
+  free(model->render_queue.scratch_keys);
+  free(model->render_queue.scratch_items);
+  free(model->render_queue.material_pipelines);
+  free(model->render_queue.pipeline_ids);
+
   if (model->skin_count > 0) {
     for (uint32_t i = 0; i < model->skin_count; ++i) {
       gltf_skin_destroy(&model->skins[i]);
@@ -882,6 +945,9 @@ static void gltf_model_load_node(gltf_model_t* model, cgltf_node* parent,
       vec3 pos_min               = GLM_VEC3_ZERO_INIT;
       vec3 pos_max               = GLM_VEC3_ZERO_INIT;
       bool has_skin              = false;
+      bool has_normals           = false;
+      bool has_texcoords         = false;
+      bool has_tangents          = false;
 
       // Vertices
       {
@@ -978,7 +1044,10 @@ static void gltf_model_load_node(gltf_model_t* model, cgltf_node* parent,
           }
         }
 
-        has_skin = (buffer_joints != NULL && buffer_weights != NULL);
+        has_skin      = (buffer_joints != NULL && buffer_weights != NULL);
+        has_normals   = (buffer_normals != NULL);
+        has_texcoords = (buffer_texcoords != NULL);
+        has_tangents  = (buffer_tangents != NULL);
 
         // Position attribute is required
         ASSERT(pos_accessor != NULL);
@@ -1088,6 +1157,33 @@ static void gltf_model_load_node(gltf_model_t* model, cgltf_node* parent,
           }
         }
       }
+
+      // Generate missing normals and tangents, tangents require texture
+      // coordinates
+      if (primitive->type == cgltf_primitive_type_triangles
+          && prim_vertex_count > 0
+          && (!has_normals || (!has_tangents && has_texcoords))) {
+        gltf_vertex_t* prim_vertices = &(*vertices)[vertex_start];
+        const uint32_t stride        = (uint32_t)sizeof(gltf_vertex_t);
+        mesh_desc_t mesh_desc        = {
+          .vertex_count   = prim_vertex_count,
+          .positions      = {prim_vertices->pos, stride},
+          .normals        = {prim_vertices->normal, stride},
+          .uvs            = {prim_vertices->uv, stride},
+          .tangents       = {prim_vertices->tangent, stride},
+          .triangle_count = prim_index_count / 3,
+          .indices        = &(*indices)[index_start],
+          .index_size     = (uint32_t)sizeof(**indices),
+          .base_vertex    = vertex_start,
+        };
+        if (!has_normals) {
+          mesh_compute_normals(&mesh_desc);
+        }
+        if (!has_tangents && has_texcoords) {
+          mesh_compute_tangents(&mesh_desc);
+        }
+      }
+
       gltf_primitive_t new_primitive = {0};
       gltf_primitive_init(
         &new_primitive, index_start, prim_index_count,
@@ -1267,6 +1363,218 @@ static void gltf_model_load_materials(gltf_model_t* model, cgltf_data* data)
                      model->wgpu_context);
 }
 
+/*
+ * Texture arrays
+ *
+ * Textures of the same format are packed into one texture array, the most
+ * common size of the group becomes the array size and other textures are
+ * resized. All material textures can then be bound with a single bind group
+ * and are selected in the shader with the per material texture slots.
+ */
+#define GLTF_TEXTURE_ARRAY_MAX_LAYERS 256u
+
+static bool gltf_texture_is_packable(gltf_texture_t* texture)
+{
+  if (texture->wgpu_texture.texture == NULL
+      || texture->wgpu_texture.dimension != WGPUTextureDimension_2D) {
+    return false;
+  }
+  // The layers are blitted, so only renderable formats can be packed
+  switch (texture->wgpu_texture.format) {
+    case WGPUTextureFormat_RGBA8Unorm:
+    case WGPUTextureFormat_RGBA8UnormSrgb:
+    case WGPUTextureFormat_BGRA8Unorm:
+    case WGPUTextureFormat_BGRA8UnormSrgb:
+    case WGPUTextureFormat_RGBA16Float:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static uint32_t gltf_model_get_texture_slot(gltf_model_t* model,
+                                            gltf_texture_t* texture)
+{
+  if (texture == NULL || model->texture_arrays.texture_slots == NULL
+      || texture < model->textures
+      || texture >= model->textures + model->texture_count) {
+    return WGPU_GLTF_TEXTURE_SLOT_NONE;
+  }
+  return model->texture_arrays.texture_slots[texture - model->textures];
+}
+
+/* Returns the slot of a material texture, the pointer is cleared if the
+ * texture was packed as the individual texture has been released */
+static uint32_t gltf_model_take_texture_slot(gltf_model_t* model,
+                                             gltf_texture_t** texture)
+{
+  const uint32_t slot = gltf_model_get_texture_slot(model, *texture);
+  if (slot != WGPU_GLTF_TEXTURE_SLOT_NONE) {
+    *texture = NULL;
+  }
+  return slot;
+}
+
+static void gltf_model_pack_texture_arrays(gltf_model_t* model)
+{
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+  const uint32_t texture_count = model->texture_count;
+
+  model->texture_arrays.texture_slots
+    = malloc(MAX(texture_count, 1) * sizeof(uint32_t));
+  memset(model->texture_arrays.texture_slots, 0xFF,
+         MAX(texture_count, 1) * sizeof(uint32_t));
+
+  uint32_t* group    = calloc(MAX(texture_count, 1), sizeof(uint32_t));
+  texture_t** layers = calloc(MAX(texture_count, 1), sizeof(texture_t*));
+  for (uint32_t i = 0; i < texture_count; ++i) {
+    gltf_texture_t* first = &model->textures[i];
+    if (!gltf_texture_is_packable(first)
+        || model->texture_arrays.texture_slots[i]
+             != WGPU_GLTF_TEXTURE_SLOT_NONE) {
+      continue;
+    }
+    if (model->texture_arrays.array_count == WGPU_GLTF_MAX_TEXTURE_ARRAYS) {
+      log_warn("glTF texture arrays: more than %u arrays required, remaining "
+               "textures are not packed",
+               WGPU_GLTF_MAX_TEXTURE_ARRAYS);
+      break;
+    }
+
+    // Group all remaining textures with the same format
+    uint32_t group_size = 0;
+    for (uint32_t j = i; j < texture_count
+                         && group_size < GLTF_TEXTURE_ARRAY_MAX_LAYERS;
+         ++j) {
+      gltf_texture_t* texture = &model->textures[j];
+      if (gltf_texture_is_packable(texture)
+          && texture->wgpu_texture.format == first->wgpu_texture.format
+          && model->texture_arrays.texture_slots[j]
+               == WGPU_GLTF_TEXTURE_SLOT_NONE) {
+        group[group_size++] = j;
+      }
+    }
+
+    // The most common size in the group becomes the array size
+    WGPUExtent3D array_size = first->wgpu_texture.size;
+    uint32_t best_count     = 0;
+    for (uint32_t j = 0; j < group_size; ++j) {
+      WGPUExtent3D size = model->textures[group[j]].wgpu_texture.size;
+      uint32_t count    = 0;
+      for (uint32_t k = 0; k < group_size; ++k) {
+        WGPUExtent3D other = model->textures[group[k]].wgpu_texture.size;
+        count += (other.width == size.width && other.height == size.height);
+      }
+      if (count > best_count) {
+        best_count = count;
+        array_size = size;
+      }
+    }
+
+    const uint32_t array_index = model->texture_arrays.array_count++;
+    for (uint32_t j = 0; j < group_size; ++j) {
+      layers[j] = &model->textures[group[j]].wgpu_texture;
+      model->texture_arrays.texture_slots[group[j]] = (array_index << 16) | j;
+    }
+    model->texture_arrays.arrays[array_index]
+      = wgpu_create_texture_array_from_textures(
+        wgpu_context, layers, group_size, array_size.width, array_size.height);
+    log_info("glTF texture arrays: packed %u textures into a %ux%u array "
+             "(%u resized)",
+             group_size, array_size.width, array_size.height,
+             group_size - best_count);
+
+    // The packed textures are no longer needed, only their size and format
+    // are kept
+    for (uint32_t j = 0; j < group_size; ++j) {
+      wgpu_destroy_texture(layers[j]);
+    }
+  }
+  free(group);
+  free(layers);
+
+  // The materials reference the packed textures by slot from now on
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    gltf_material_t* material = &model->materials[i];
+    material->texture_slots.base_color
+      = gltf_model_take_texture_slot(model, &material->base_color_texture);
+    material->texture_slots.metallic_roughness = gltf_model_take_texture_slot(
+      model, &material->metallic_roughness_texture);
+    material->texture_slots.normal
+      = gltf_model_take_texture_slot(model, &material->normal_texture);
+    material->texture_slots.occlusion
+      = gltf_model_take_texture_slot(model, &material->occlusion_texture);
+    material->texture_slots.emissive
+      = gltf_model_take_texture_slot(model, &material->emissive_texture);
+    gltf_model_take_texture_slot(
+      model, &material->extension.specular_glossiness_texture);
+    gltf_model_take_texture_slot(model, &material->extension.diffuse_texture);
+  }
+
+  // Unused array bindings are bound to a 1x1 array
+  for (uint32_t i = model->texture_arrays.array_count;
+       i < WGPU_GLTF_MAX_TEXTURE_ARRAYS; ++i) {
+    texture_t empty_texture = wgpu_create_empty_texture(wgpu_context);
+    texture_t* layer        = &empty_texture;
+    model->texture_arrays.arrays[i]
+      = wgpu_create_texture_array_from_textures(wgpu_context, &layer, 1, 1, 1);
+    wgpu_destroy_texture(&empty_texture);
+  }
+
+  // Bind group layout
+  WGPUBindGroupLayoutEntry bgl_entries[1 + WGPU_GLTF_MAX_TEXTURE_ARRAYS] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      // Binding 0: Sampler
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout){
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+  };
+  for (uint32_t i = 0; i < WGPU_GLTF_MAX_TEXTURE_ARRAYS; ++i) {
+    // Binding 1..n: Texture arrays
+    bgl_entries[1 + i] = (WGPUBindGroupLayoutEntry){
+      .binding    = 1 + i,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2DArray,
+        .multisampled  = false,
+      },
+    };
+  }
+  model->texture_arrays.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "glTF texture arrays - Bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(model->texture_arrays.bind_group_layout != NULL);
+
+  // Bind group
+  WGPUBindGroupEntry bg_entries[1 + WGPU_GLTF_MAX_TEXTURE_ARRAYS] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .sampler = model->texture_arrays.arrays[0].sampler,
+    },
+  };
+  for (uint32_t i = 0; i < WGPU_GLTF_MAX_TEXTURE_ARRAYS; ++i) {
+    bg_entries[1 + i] = (WGPUBindGroupEntry){
+      .binding     = 1 + i,
+      .textureView = model->texture_arrays.arrays[i].view,
+    };
+  }
+  model->texture_arrays.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label  = "glTF texture arrays - Bind group",
+                            .layout = model->texture_arrays.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(model->texture_arrays.bind_group != NULL);
+}
+
 /*
  * Load the animations from the glTF model
  */
@@ -1461,6 +1769,13 @@ gltf_model_t* wgpu_gltf_model_load_from_file(
       // Load materials
       gltf_model_load_materials(gltf_model, gltf_data);
 
+      // Pack the material textures into texture arrays
+      if ((file_loading_flags & WGPU_GLTF_FileLoadingFlags_PackTextureArrays)
+          && !(file_loading_flags
+               & WGPU_GLTF_FileLoadingFlags_DontLoadImages)) {
+        gltf_model_pack_texture_arrays(gltf_model);
+      }
+
       // If there is no default scene specified, then the default is the first
       // one. It is not an error for a glTF file to have zero scenes.
       const cgltf_scene* scene
@@ -1576,15 +1891,17 @@ gltf_model_t* wgpu_gltf_model_load_from_file(
 
   assert((vertex_buffer_size > 0) && (index_buffer_size > 0));
 
-  // Create vertex buffer
-  gltf_model->vertices.buffer
-    = wgpu_create_buffer_from_data(load_options->wgpu_context, vertices,
-                                   vertex_buffer_size, WGPUBufferUsage_Vertex);
+  // Create vertex buffer, also bound as storage buffer for vertex pulling
+  gltf_model->vertices.buffer = wgpu_create_buffer_from_data(
+    load_options->wgpu_context, vertices, vertex_buffer_size,
+    WGPUBufferUsage_Vertex | WGPUBufferUsage_Storage);
+  gltf_model->vertices.size = (uint32_t)vertex_buffer_size;
 
-  // Create index buffer
-  gltf_model->indices.buffer
-    = wgpu_create_buffer_from_data(load_options->wgpu_context, indices,
-                                   index_buffer_size, WGPUBufferUsage_Index);
+  // Create index buffer, also bound as storage buffer for vertex pulling
+  gltf_model->indices.buffer = wgpu_create_buffer_from_data(
+    load_options->wgpu_context, indices, index_buffer_size,
+    WGPUBufferUsage_Index | WGPUBufferUsage_Storage);
+  gltf_model->indices.size = (uint32_t)index_buffer_size;
 
   if (vertices != NULL) {
     free(vertices);
@@ -1613,55 +1930,251 @@ static void gltf_model_bind_buffers(gltf_model_t* model)
   // model->buffers_bound = true;
 }
 
-static void
-gltf_model_draw_node(gltf_model_t* model, gltf_node_t* node,
-                     wgpu_gltf_model_render_options_t render_options)
+/* Returns true if the material is filtered out by the alpha mode flags */
+static bool gltf_material_skip(gltf_material_t* material, uint32_t render_flags)
+{
+  bool skip = false;
+  if (render_flags & WGPU_GLTF_RenderFlags_RenderOpaqueNodes) {
+    skip = (material->alpha_mode != AlphaMode_OPAQUE);
+  }
+  if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes) {
+    skip = (material->alpha_mode != AlphaMode_MASK);
+  }
+  if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes) {
+    skip = (material->alpha_mode != AlphaMode_BLEND);
+  }
+  return skip;
+}
+
+/*
+ * Render queue
+ *
+ * The primitives of all nodes are flattened into a draw list once. Every draw
+ * call the visible draws get a 64 bit sort key and are radix sorted:
+ *
+ *   opaque / mask : pass (2) | pipeline (12) | material (16) | depth (32)
+ *   blend         : pass (2) | inverted depth (32) | pipeline | material
+ *
+ * i.e. opaque geometry is grouped by state (and front to back within the same
+ * state), blended geometry is sorted back to front. Encoding the sorted queue
+ * only sets pipelines and bind groups that differ from the bound ones.
+ */
+typedef struct gltf_draw_t {
+  gltf_primitive_t* primitive;
+  gltf_mesh_t* mesh;
+} gltf_draw_t;
+
+static void gltf_model_prepare_render_queue(gltf_model_t* model)
 {
-  uint32_t render_flags = render_options.render_flags;
+  if (model->render_queue.draws != NULL) {
+    return;
+  }
 
-  if (node->mesh && node->mesh->primitive_count > 0) {
-    if (node->mesh->uniform_buffer.bind_group) {
-      wgpuRenderPassEncoderSetBindGroup(
-        model->wgpu_context->rpass_enc, render_options.bind_mesh_model_set,
-        node->mesh->uniform_buffer.bind_group, 0, 0);
+  // Every node with a mesh is visited once
+  uint32_t draw_count = 0;
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_node_t* node = model->linear_nodes[i];
+    if (node->mesh != NULL) {
+      draw_count += node->mesh->primitive_count;
     }
-    for (uint32_t i = 0; i < node->mesh->primitive_count; ++i) {
-      gltf_primitive_t* primitive = &node->mesh->primitives[i];
-      bool skip                   = false;
-      gltf_material_t* material   = primitive->material;
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderOpaqueNodes) {
-        skip = (material->alpha_mode != AlphaMode_OPAQUE);
-      }
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaMaskedNodes) {
-        skip = (material->alpha_mode != AlphaMode_MASK);
-      }
-      if (render_flags & WGPU_GLTF_RenderFlags_RenderAlphaBlendedNodes) {
-        skip = (material->alpha_mode != AlphaMode_BLEND);
-      }
-      if (!skip) {
-        // Bind the pipeline for the node's material if present
-        if (material->pipeline) {
-          wgpuRenderPassEncoderSetPipeline(model->wgpu_context->rpass_enc,
-                                           material->pipeline);
-        }
-        if ((render_flags & WGPU_GLTF_RenderFlags_BindImages)
-            && material->bind_group) {
-          wgpuRenderPassEncoderSetBindGroup(model->wgpu_context->rpass_enc,
-                                            render_options.bind_image_set,
-                                            material->bind_group, 0, 0);
-        }
-        wgpuRenderPassEncoderDrawIndexed(model->wgpu_context->rpass_enc,
-                                         primitive->index_count, 1,
-                                         primitive->first_index, 0, 0);
+  }
+  const uint32_t capacity           = MAX(draw_count, 1);
+  model->render_queue.draws         = calloc(capacity, sizeof(gltf_draw_t));
+  model->render_queue.keys          = calloc(capacity, sizeof(uint64_t));
+  model->render_queue.items         = calloc(capacity, sizeof(uint32_t));
+  model->render_queue.scratch_keys  = calloc(capacity, sizeof(uint64_t));
+  model->render_queue.scratch_items = calloc(capacity, sizeof(uint32_t));
+  for (uint32_t i = 0; i < model->linear_node_count; ++i) {
+    gltf_mesh_t* mesh = model->linear_nodes[i]->mesh;
+    for (uint32_t p = 0; mesh != NULL && p < mesh->primitive_count; ++p) {
+      model->render_queue.draws[model->render_queue.draw_count++]
+        = (gltf_draw_t){
+          .primitive = &mesh->primitives[p],
+          .mesh      = mesh,
+        };
+    }
+  }
+
+  model->render_queue.material_pipelines
+    = calloc(model->material_count, sizeof(WGPURenderPipeline));
+  model->render_queue.pipeline_ids
+    = calloc(model->material_count, sizeof(uint32_t));
+}
+
+/* Assigns an id to every distinct material pipeline, only recomputed when the
+ * material pipelines changed */
+static void gltf_model_update_pipeline_ids(gltf_model_t* model)
+{
+  bool changed = false;
+  for (uint32_t i = 0; i < model->material_count && !changed; ++i) {
+    changed = model->render_queue.material_pipelines[i]
+              != model->materials[i].pipeline;
+  }
+  if (!changed) {
+    return;
+  }
+
+  WGPURenderPipeline* pipelines = model->render_queue.material_pipelines;
+  uint32_t* pipeline_ids        = model->render_queue.pipeline_ids;
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    pipelines[i]    = model->materials[i].pipeline;
+    pipeline_ids[i] = i;
+    for (uint32_t j = 0; j < i; ++j) {
+      if (pipelines[j] == pipelines[i]) {
+        pipeline_ids[i] = pipeline_ids[j];
+        break;
       }
     }
   }
-  for (uint32_t i = 0; i < node->child_count; ++i) {
-    gltf_model_draw_node(model, node->children[i], render_options);
+}
+
+/* LSD radix sort of the keys and items with 8 bit digits, passes in which all
+ * keys share the same digit are skipped */
+static void gltf_radix_sort(uint64_t* keys, uint32_t* items,
+                            uint64_t* scratch_keys, uint32_t* scratch_items,
+                            uint32_t count)
+{
+  if (count < 2) {
+    return;
+  }
+  uint64_t* src_keys  = keys;
+  uint32_t* src_items = items;
+  uint64_t* dst_keys  = scratch_keys;
+  uint32_t* dst_items = scratch_items;
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    uint32_t histogram[256] = {0};
+    for (uint32_t i = 0; i < count; ++i) {
+      ++histogram[(src_keys[i] >> shift) & 0xFF];
+    }
+    if (histogram[(src_keys[0] >> shift) & 0xFF] == count) {
+      continue;
+    }
+    uint32_t offset = 0;
+    for (uint32_t b = 0; b < 256; ++b) {
+      const uint32_t bucket_count = histogram[b];
+      histogram[b]                = offset;
+      offset += bucket_count;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t pos = histogram[(src_keys[i] >> shift) & 0xFF]++;
+      dst_keys[pos]      = src_keys[i];
+      dst_items[pos]     = src_items[i];
+    }
+    uint64_t* tmp_keys  = src_keys;
+    uint32_t* tmp_items = src_items;
+    src_keys            = dst_keys;
+    src_items           = dst_items;
+    dst_keys            = tmp_keys;
+    dst_items           = tmp_items;
+  }
+  if (src_keys != keys) {
+    memcpy(keys, src_keys, count * sizeof(uint64_t));
+    memcpy(items, src_items, count * sizeof(uint32_t));
   }
 }
 
-// Draw the glTF scene starting at the top-level-nodes
+static void
+gltf_model_build_render_queue(gltf_model_t* model,
+                              wgpu_gltf_model_render_options_t* render_options)
+{
+  gltf_model_prepare_render_queue(model);
+  gltf_model_update_pipeline_ids(model);
+
+  const float* camera_position = render_options->camera_position;
+  uint32_t item_count          = 0;
+  for (uint32_t i = 0; i < model->render_queue.draw_count; ++i) {
+    gltf_draw_t* draw         = &model->render_queue.draws[i];
+    gltf_material_t* material = draw->primitive->material;
+    if (gltf_material_skip(material, render_options->render_flags)) {
+      continue;
+    }
+
+    // Squared distance of the primitive center to the camera, positive floats
+    // sort like their bit patterns
+    uint32_t depth = 0;
+    if (camera_position != NULL) {
+      bounding_box_t* bb = &draw->primitive->bb;
+      vec4 center = {(bb->min[0] + bb->max[0]) * 0.5f,
+                     (bb->min[1] + bb->max[1]) * 0.5f,
+                     (bb->min[2] + bb->max[2]) * 0.5f, 1.0f};
+      glm_mat4_mulv(draw->mesh->uniform_block.matrix, center, center);
+      vec3 camera = {camera_position[0], camera_position[1],
+                     camera_position[2]};
+      const float distance2 = glm_vec3_distance2(center, camera);
+      memcpy(&depth, &distance2, sizeof(depth));
+    }
+
+    const uint32_t material_index = (uint32_t)(material - model->materials);
+    const uint64_t pass           = (uint64_t)material->alpha_mode & 0x3;
+    const uint64_t pipeline_id
+      = (uint64_t)model->render_queue.pipeline_ids[material_index] & 0xFFF;
+    const uint64_t material_id = (uint64_t)material_index & 0xFFFF;
+    uint64_t key               = pass << 62;
+    if (material->alpha_mode == AlphaMode_BLEND) {
+      key |= ((uint64_t)(~depth) << 30) | (pipeline_id << 18)
+             | (material_id << 2);
+    }
+    else {
+      key |= (pipeline_id << 50) | (material_id << 34) | ((uint64_t)depth << 2);
+    }
+    model->render_queue.keys[item_count]  = key;
+    model->render_queue.items[item_count] = i;
+    ++item_count;
+  }
+  model->render_queue.item_count = item_count;
+
+  gltf_radix_sort(model->render_queue.keys, model->render_queue.items,
+                  model->render_queue.scratch_keys,
+                  model->render_queue.scratch_items, item_count);
+}
+
+/* Encodes the sorted render queue, redundant state changes are skipped */
+static void
+gltf_model_encode_render_queue(gltf_model_t* model,
+                               wgpu_gltf_model_render_options_t* render_options,
+                               bool bind_material_images, bool vertex_pulling)
+{
+  WGPURenderPassEncoder rpass_enc   = model->wgpu_context->rpass_enc;
+  WGPURenderPipeline bound_pipeline = NULL;
+  WGPUBindGroup bound_mesh          = NULL;
+  WGPUBindGroup bound_material      = NULL;
+  for (uint32_t i = 0; i < model->render_queue.item_count; ++i) {
+    const uint32_t draw_index   = model->render_queue.items[i];
+    gltf_draw_t* draw           = &model->render_queue.draws[draw_index];
+    gltf_primitive_t* primitive   = draw->primitive;
+    gltf_material_t* material     = primitive->material;
+    WGPUBindGroup mesh_bind_group = draw->mesh->uniform_buffer.bind_group;
+    if (!vertex_pulling && mesh_bind_group && mesh_bind_group != bound_mesh) {
+      wgpuRenderPassEncoderSetBindGroup(rpass_enc,
+                                        render_options->bind_mesh_model_set,
+                                        mesh_bind_group, 0, 0);
+      bound_mesh = mesh_bind_group;
+    }
+    // Bind the pipeline for the node's material if present
+    if (material->pipeline && material->pipeline != bound_pipeline) {
+      wgpuRenderPassEncoderSetPipeline(rpass_enc, material->pipeline);
+      bound_pipeline = material->pipeline;
+    }
+    if (bind_material_images && material->bind_group
+        && material->bind_group != bound_material) {
+      wgpuRenderPassEncoderSetBindGroup(rpass_enc,
+                                        render_options->bind_image_set,
+                                        material->bind_group, 0, 0);
+      bound_material = material->bind_group;
+    }
+    if (vertex_pulling) {
+      // The draw index is passed as first instance
+      wgpuRenderPassEncoderDraw(rpass_enc, primitive->index_count, 1,
+                                primitive->first_index, draw_index);
+    }
+    else {
+      wgpuRenderPassEncoderDrawIndexed(rpass_enc, primitive->index_count, 1,
+                                       primitive->first_index, 0, 0);
+    }
+  }
+}
+
+// Draw the glTF scene, all nodes are drawn through the sorted render queue
 void wgpu_gltf_model_draw(gltf_model_t* model,
                           wgpu_gltf_model_render_options_t render_options)
 {
@@ -1670,10 +2183,232 @@ void wgpu_gltf_model_draw(gltf_model_t* model,
     // bind once
     gltf_model_bind_buffers(model);
   }
-  // Render all nodes at top-level
-  for (uint32_t i = 0; i < model->node_count; ++i) {
-    gltf_model_draw_node(model, &model->nodes[i], render_options);
+  gltf_model_build_render_queue(model, &render_options);
+  gltf_model_encode_render_queue(
+    model, &render_options,
+    render_options.render_flags & WGPU_GLTF_RenderFlags_BindImages, false);
+}
+
+/*
+ * Vertex pulling
+ *
+ * Per draw metadata, mesh matrices and material constants are stored in
+ * storage buffers next to the vertex and index buffers. The draw index is
+ * passed as first instance, so the vertex shader can look up everything it
+ * needs from the built-in vertex and instance indices.
+ */
+typedef struct gltf_draw_data_t {
+  uint32_t mesh_index;
+  uint32_t material_index;
+  uint32_t first_index;
+  uint32_t index_count;
+} gltf_draw_data_t;
+
+typedef struct gltf_material_data_t {
+  vec4 base_color_factor;
+  vec4 emissive_factor;
+  float metallic_factor;
+  float roughness_factor;
+  float alpha_cutoff;
+  uint32_t alpha_mode;
+  /* Texture array slots, WGPU_GLTF_TEXTURE_SLOT_NONE if not available */
+  uint32_t base_color_texture;
+  uint32_t metallic_roughness_texture;
+  uint32_t normal_texture;
+  uint32_t occlusion_texture;
+  uint32_t emissive_texture;
+  uint32_t padding[3];
+} gltf_material_data_t;
+
+static void gltf_model_update_mesh_matrices(gltf_model_t* model)
+{
+  if (model->vertex_pulling.mesh_matrices.buffer == NULL) {
+    return;
+  }
+  mat4* matrices = calloc(model->mesh_count, sizeof(mat4));
+  for (uint32_t i = 0; i < model->mesh_count; ++i) {
+    glm_mat4_copy(model->meshes[i].uniform_block.matrix, matrices[i]);
+  }
+  wgpu_queue_write_buffer(model->wgpu_context,
+                          model->vertex_pulling.mesh_matrices.buffer, 0,
+                          matrices, model->mesh_count * sizeof(mat4));
+  free(matrices);
+}
+
+static void gltf_model_prepare_vertex_pulling(gltf_model_t* model)
+{
+  if (model->vertex_pulling.bind_group != NULL) {
+    return;
+  }
+
+  wgpu_context_t* wgpu_context = model->wgpu_context;
+
+  // The vertex shader fetches the vertices as 24 floats, see
+  // WGPU_GLTF_VERTEX_PULLING_WGSL
+  ASSERT(sizeof(gltf_vertex_t) == 24 * sizeof(float));
+
+  // Per draw metadata, in the order of the render queue draw list
+  gltf_model_prepare_render_queue(model);
+  const uint32_t draw_count = model->render_queue.draw_count;
+  gltf_draw_data_t* draws   = calloc(MAX(draw_count, 1), sizeof(*draws));
+  for (uint32_t i = 0; i < draw_count; ++i) {
+    gltf_draw_t* draw           = &model->render_queue.draws[i];
+    gltf_primitive_t* primitive = draw->primitive;
+    draws[i]                    = (gltf_draw_data_t){
+      .mesh_index     = (uint32_t)(draw->mesh - model->meshes),
+      .material_index = (uint32_t)(primitive->material - model->materials),
+      .first_index    = primitive->first_index,
+      .index_count    = primitive->index_count,
+    };
+  }
+  model->vertex_pulling.draws = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "glTF vertex pulling - Draws buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = MAX(draw_count, 1) * sizeof(*draws),
+                    .initial.data = draws,
+                  });
+  free(draws);
+
+  // Material constants
+  gltf_material_data_t* materials
+    = calloc(model->material_count, sizeof(*materials));
+  for (uint32_t i = 0; i < model->material_count; ++i) {
+    gltf_material_t* material = &model->materials[i];
+    glm_vec4_copy(material->base_color_factor, materials[i].base_color_factor);
+    glm_vec4_copy(material->emissive_factor, materials[i].emissive_factor);
+    materials[i].metallic_factor  = material->metallic_factor;
+    materials[i].roughness_factor = material->roughness_factor;
+    materials[i].alpha_cutoff     = material->alpha_cutoff;
+    materials[i].alpha_mode       = (uint32_t)material->alpha_mode;
+    materials[i].base_color_texture = material->texture_slots.base_color;
+    materials[i].metallic_roughness_texture
+      = material->texture_slots.metallic_roughness;
+    materials[i].normal_texture    = material->texture_slots.normal;
+    materials[i].occlusion_texture = material->texture_slots.occlusion;
+    materials[i].emissive_texture  = material->texture_slots.emissive;
+  }
+  model->vertex_pulling.materials = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "glTF vertex pulling - Materials buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = model->material_count * sizeof(*materials),
+                    .initial.data = materials,
+                  });
+  free(materials);
+
+  // Mesh matrices, kept up to date by the animation update
+  model->vertex_pulling.mesh_matrices = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "glTF vertex pulling - Mesh matrices buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = MAX(model->mesh_count, 1) * sizeof(mat4),
+                  });
+  gltf_model_update_mesh_matrices(model);
+
+  // Bind group layout
+  WGPUBindGroupLayoutEntry bgl_entries[5] = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(bgl_entries); ++i) {
+    bgl_entries[i] = (WGPUBindGroupLayoutEntry){
+      .binding    = i,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer     = (WGPUBufferBindingLayout){
+        .type = WGPUBufferBindingType_ReadOnlyStorage,
+      },
+    };
   }
+  // Binding 4: Material constants are also available to the fragment shader
+  bgl_entries[4].visibility |= WGPUShaderStage_Fragment;
+  model->vertex_pulling.bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    wgpu_context->device, &(WGPUBindGroupLayoutDescriptor){
+                            .label = "glTF vertex pulling - Bind group layout",
+                            .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+                            .entries    = bgl_entries,
+                          });
+  ASSERT(model->vertex_pulling.bind_group_layout != NULL);
+
+  // Bind group
+  WGPUBindGroupEntry bg_entries[5] = {
+    [0] = (WGPUBindGroupEntry) {
+      // Binding 0: Vertices
+      .binding = 0,
+      .buffer  = model->vertices.buffer,
+      .size    = model->vertices.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      // Binding 1: Indices
+      .binding = 1,
+      .buffer  = model->indices.buffer,
+      .size    = model->indices.size,
+    },
+    [2] = (WGPUBindGroupEntry) {
+      // Binding 2: Per draw metadata
+      .binding = 2,
+      .buffer  = model->vertex_pulling.draws.buffer,
+      .size    = model->vertex_pulling.draws.size,
+    },
+    [3] = (WGPUBindGroupEntry) {
+      // Binding 3: Mesh matrices
+      .binding = 3,
+      .buffer  = model->vertex_pulling.mesh_matrices.buffer,
+      .size    = model->vertex_pulling.mesh_matrices.size,
+    },
+    [4] = (WGPUBindGroupEntry) {
+      // Binding 4: Material constants
+      .binding = 4,
+      .buffer  = model->vertex_pulling.materials.buffer,
+      .size    = model->vertex_pulling.materials.size,
+    },
+  };
+  model->vertex_pulling.bind_group = wgpuDeviceCreateBindGroup(
+    wgpu_context->device, &(WGPUBindGroupDescriptor){
+                            .label  = "glTF vertex pulling - Bind group",
+                            .layout = model->vertex_pulling.bind_group_layout,
+                            .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                            .entries    = bg_entries,
+                          });
+  ASSERT(model->vertex_pulling.bind_group != NULL);
+}
+
+WGPUBindGroupLayout
+wgpu_gltf_model_get_texture_arrays_bind_group_layout(gltf_model_t* model)
+{
+  return model->texture_arrays.bind_group_layout;
+}
+
+WGPUBindGroupLayout
+wgpu_gltf_model_get_vertex_pulling_bind_group_layout(gltf_model_t* model)
+{
+  gltf_model_prepare_vertex_pulling(model);
+  return model->vertex_pulling.bind_group_layout;
+}
+
+void wgpu_gltf_model_draw_vertex_pulling(
+  gltf_model_t* model, wgpu_gltf_model_render_options_t render_options)
+{
+  gltf_model_prepare_vertex_pulling(model);
+
+  WGPURenderPassEncoder rpass_enc = model->wgpu_context->rpass_enc;
+  const uint32_t render_flags     = render_options.render_flags;
+
+  // No vertex and index buffers, all geometry is fetched in the vertex shader
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc,
+                                    render_options.bind_mesh_model_set,
+                                    model->vertex_pulling.bind_group, 0, 0);
+
+  // With texture arrays all material textures are bound once
+  const bool bind_material_images
+    = (render_flags & WGPU_GLTF_RenderFlags_BindImages)
+      && model->texture_arrays.bind_group == NULL;
+  if ((render_flags & WGPU_GLTF_RenderFlags_BindImages)
+      && model->texture_arrays.bind_group != NULL) {
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, render_options.bind_image_set,
+                                      model->texture_arrays.bind_group, 0, 0);
+  }
+
+  gltf_model_build_render_queue(model, &render_options);
+  gltf_model_encode_render_queue(model, &render_options, bind_material_images,
+                                 true);
 }
 
 wgpu_gltf_materials_t wgpu_gltf_model_get_materials(void* model)
@@ -1877,6 +2612,7 @@ void gltf_model_update_animation(gltf_model_t* model, uint32_t index,
     for (uint32_t i = 0; i < model->node_count; ++i) {
       gltf_node_update(model->wgpu_context, &model->nodes[i]);
     }
+    gltf_model_update_mesh_matrices(model);
   }
 }
 
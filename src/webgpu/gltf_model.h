@@ -13,6 +13,10 @@ struct wgpu_context_t;
 // Changing this value here also requires changing it in the vertex shader
 #define WGPU_GLTF_MAX_NUM_JOINTS 128u
 
+// Changing this value here also requires changing WGPU_GLTF_TEXTURE_ARRAYS_WGSL
+#define WGPU_GLTF_MAX_TEXTURE_ARRAYS 4u
+#define WGPU_GLTF_TEXTURE_SLOT_NONE 0xFFFFFFFFu
+
 #define WGPU_GLTF_VERTATTR_DESC(l, c)                                          \
   wgpu_gltf_get_vertex_attribute_description(l, c)
 
@@ -30,7 +34,12 @@ typedef enum wgpu_gltf_file_loading_flags_enum_t {
   WGPU_GLTF_FileLoadingFlags_PreTransformVertices    = 0x00000001,
   WGPU_GLTF_FileLoadingFlags_PreMultiplyVertexColors = 0x00000002,
   WGPU_GLTF_FileLoadingFlags_FlipY                   = 0x00000004,
-  WGPU_GLTF_FileLoadingFlags_DontLoadImages          = 0x00000008
+  WGPU_GLTF_FileLoadingFlags_DontLoadImages          = 0x00000008,
+  /* Packs the material textures into texture arrays (one per format) and
+   * releases the individual textures, the material texture pointers of packed
+   * textures are set to NULL, see
+   * wgpu_gltf_model_get_texture_arrays_bind_group_layout */
+  WGPU_GLTF_FileLoadingFlags_PackTextureArrays       = 0x00000010,
 } wgpu_gltf_file_loading_flags_enum_t;
 
 /*
@@ -106,6 +115,15 @@ typedef struct wgpu_gltf_material_t {
     bool metallic_roughness;
     bool specular_glossiness;
   } pbr_workflows;
+  /* Texture array slots (array index << 16 | layer) of the packed textures,
+   * WGPU_GLTF_TEXTURE_SLOT_NONE if the texture was not packed */
+  struct {
+    uint32_t base_color;
+    uint32_t metallic_roughness;
+    uint32_t normal;
+    uint32_t occlusion;
+    uint32_t emissive;
+  } texture_slots;
   WGPUBindGroup bind_group;
   WGPURenderPipeline pipeline;
 } wgpu_gltf_material_t;
@@ -149,15 +167,147 @@ void wgpu_gltf_model_prepare_skins_bind_group(
 
 /**
  *  @brief glTF model rendering
+ *
+ *  The primitives are drawn from a render queue sorted by alpha mode, pipeline,
+ *  material and depth, pipelines and bind groups are only set on change.
  */
 typedef struct wgpu_gltf_model_render_options_t {
   uint32_t render_flags;
   uint32_t bind_mesh_model_set;
   uint32_t bind_image_set;
+  /* Optional world space camera position: opaque primitives are then drawn
+   * front to back within the same state, blended ones back to front */
+  const float* camera_position;
 } wgpu_gltf_model_render_options_t;
 void wgpu_gltf_model_draw(struct gltf_model_t* model,
                           wgpu_gltf_model_render_options_t render_options);
 void gltf_model_update_animation(struct gltf_model_t* model, uint32_t index,
                                  float time);
 
+/**
+ * @brief glTF model rendering with vertex pulling
+ *
+ * Vertices, indices, per draw metadata, mesh matrices and material constants
+ * are bound as storage buffers in a single bind group (bind_mesh_model_set)
+ * and fetched in the vertex shader, no vertex buffer layout is needed. As the
+ * materials then only differ in their texture bind group, materials sharing a
+ * shader can share a pipeline; pipelines and bind groups are only set when
+ * they change. Skinning is not supported on this path.
+ */
+WGPUBindGroupLayout wgpu_gltf_model_get_vertex_pulling_bind_group_layout(
+  struct gltf_model_t* model);
+/* Layout of the texture arrays bind group, NULL if the textures were not packed
+ * (WGPU_GLTF_FileLoadingFlags_PackTextureArrays). When available, the vertex
+ * pulling path binds it once at bind_image_set instead of the per material bind
+ * groups. */
+WGPUBindGroupLayout wgpu_gltf_model_get_texture_arrays_bind_group_layout(
+  struct gltf_model_t* model);
+void wgpu_gltf_model_draw_vertex_pulling(
+  struct gltf_model_t* model, wgpu_gltf_model_render_options_t render_options);
+
+/*
+ * WGSL declarations of the vertex pulling bind group at the given group index,
+ * to be prepended to the shader code. gltfFetchVertex(vertex_index) returns the
+ * vertex, gltfDraws[instance_index] the mesh and material of the draw.
+ */
+#define WGPU_GLTF_VERTEX_PULLING_WGSL(group)                                   \
+  "struct GltfVertex {\n"                                                      \
+  "  position : vec3<f32>,\n"                                                  \
+  "  normal : vec3<f32>,\n"                                                    \
+  "  uv : vec2<f32>,\n"                                                        \
+  "  color : vec4<f32>,\n"                                                     \
+  "  joint0 : vec4<f32>,\n"                                                    \
+  "  weight0 : vec4<f32>,\n"                                                   \
+  "  tangent : vec4<f32>,\n"                                                   \
+  "}\n"                                                                        \
+  "struct GltfDraw {\n"                                                        \
+  "  meshIndex : u32,\n"                                                       \
+  "  materialIndex : u32,\n"                                                   \
+  "  firstIndex : u32,\n"                                                      \
+  "  indexCount : u32,\n"                                                      \
+  "}\n"                                                                        \
+  "struct GltfMaterial {\n"                                                    \
+  "  baseColorFactor : vec4<f32>,\n"                                           \
+  "  emissiveFactor : vec4<f32>,\n"                                            \
+  "  metallicFactor : f32,\n"                                                  \
+  "  roughnessFactor : f32,\n"                                                 \
+  "  alphaCutoff : f32,\n"                                                     \
+  "  alphaMode : u32,\n"                                                       \
+  "  baseColorTexture : u32,\n"                                                \
+  "  metallicRoughnessTexture : u32,\n"                                        \
+  "  normalTexture : u32,\n"                                                   \
+  "  occlusionTexture : u32,\n"                                                \
+  "  emissiveTexture : u32,\n"                                                 \
+  "}\n"                                                                        \
+  "@group(" #group ") @binding(0) var<storage, read> gltfVertices : "          \
+  "array<f32>;\n"                                                              \
+  "@group(" #group ") @binding(1) var<storage, read> gltfIndices : "           \
+  "array<u32>;\n"                                                              \
+  "@group(" #group ") @binding(2) var<storage, read> gltfDraws : "             \
+  "array<GltfDraw>;\n"                                                         \
+  "@group(" #group ") @binding(3) var<storage, read> gltfMeshMatrices : "      \
+  "array<mat4x4<f32>>;\n"                                                      \
+  "@group(" #group ") @binding(4) var<storage, read> gltfMaterials : "         \
+  "array<GltfMaterial>;\n"                                                     \
+  "fn gltfFetchVec4(base : u32) -> vec4<f32> {\n"                              \
+  "  return vec4<f32>(gltfVertices[base], gltfVertices[base + 1u],\n"          \
+  "                   gltfVertices[base + 2u], gltfVertices[base + 3u]);\n"    \
+  "}\n"                                                                        \
+  "fn gltfFetchVertex(vertexIndex : u32) -> GltfVertex {\n"                    \
+  "  let base = gltfIndices[vertexIndex] * 24u;\n"                             \
+  "  var v : GltfVertex;\n"                                                    \
+  "  v.position = gltfFetchVec4(base).xyz;\n"                                  \
+  "  v.normal = vec3<f32>(gltfVertices[base + 3u], gltfVertices[base + 4u],\n" \
+  "                       gltfVertices[base + 5u]);\n"                         \
+  "  v.uv = vec2<f32>(gltfVertices[base + 6u], gltfVertices[base + 7u]);\n"    \
+  "  v.color = gltfFetchVec4(base + 8u);\n"                                    \
+  "  v.joint0 = gltfFetchVec4(base + 12u);\n"                                  \
+  "  v.weight0 = gltfFetchVec4(base + 16u);\n"                                 \
+  "  v.tangent = gltfFetchVec4(base + 20u);\n"                                 \
+  "  return v;\n"                                                              \
+  "}\n"
+
+/*
+ * WGSL declarations of the texture arrays bind group at the given group index.
+ * gltfSampleTexture(slot, uv, ddx, ddy, fallback) samples the material texture
+ * slot (e.g. GltfMaterial.baseColorTexture) with explicit gradients, as the
+ * slot is not uniform, and returns fallback for WGPU_GLTF_TEXTURE_SLOT_NONE.
+ */
+#define WGPU_GLTF_TEXTURE_ARRAYS_WGSL(group)                                   \
+  "@group(" #group ") @binding(0) var gltfSampler : sampler;\n"                \
+  "@group(" #group ") @binding(1) var gltfTextures0 : "                        \
+  "texture_2d_array<f32>;\n"                                                   \
+  "@group(" #group ") @binding(2) var gltfTextures1 : "                        \
+  "texture_2d_array<f32>;\n"                                                   \
+  "@group(" #group ") @binding(3) var gltfTextures2 : "                        \
+  "texture_2d_array<f32>;\n"                                                   \
+  "@group(" #group ") @binding(4) var gltfTextures3 : "                        \
+  "texture_2d_array<f32>;\n"                                                   \
+  "fn gltfSampleTexture(slot : u32, uv : vec2<f32>, ddx : vec2<f32>,\n"        \
+  "                     ddy : vec2<f32>, fallback : vec4<f32>)\n"              \
+  "                     -> vec4<f32> {\n"                                      \
+  "  let layer = slot & 0xFFFFu;\n"                                            \
+  "  switch (slot >> 16u) {\n"                                                 \
+  "    case 0u: {\n"                                                           \
+  "      return textureSampleGrad(gltfTextures0, gltfSampler, uv, layer,\n"    \
+  "                               ddx, ddy);\n"                                \
+  "    }\n"                                                                    \
+  "    case 1u: {\n"                                                           \
+  "      return textureSampleGrad(gltfTextures1, gltfSampler, uv, layer,\n"    \
+  "                               ddx, ddy);\n"                                \
+  "    }\n"                                                                    \
+  "    case 2u: {\n"                                                           \
+  "      return textureSampleGrad(gltfTextures2, gltfSampler, uv, layer,\n"    \
+  "                               ddx, ddy);\n"                                \
+  "    }\n"                                                                    \
+  "    case 3u: {\n"                                                           \
+  "      return textureSampleGrad(gltfTextures3, gltfSampler, uv, layer,\n"    \
+  "                               ddx, ddy);\n"                                \
+  "    }\n"                                                                    \
+  "    default: {\n"                                                           \
+  "      return fallback;\n"                                                   \
+  "    }\n"                                                                    \
+  "  }\n"                                                                      \
+  "}\n"
+
 #endif
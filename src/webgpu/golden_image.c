@@ -0,0 +1,264 @@
+#include "golden_image.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "readback.h"
+
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Golden Image Comparison
+ * -------------------------------------------------------------------------- */
+
+struct wgpu_golden_image {
+  wgpu_context_t* wgpu_context;
+  char filename[STRMAX];
+  bool update;
+  float tolerance;
+  float max_mismatch_fraction;
+  /* Captured frame, tightly packed RGBA8 */
+  struct {
+    uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    bool requested;
+    bool received;
+  } frame;
+};
+
+wgpu_golden_image_t*
+wgpu_golden_image_create(wgpu_context_t* wgpu_context,
+                         const wgpu_golden_image_desc_t* desc)
+{
+  ASSERT(desc->filename != NULL);
+
+  wgpu_golden_image_t* golden_image
+    = (wgpu_golden_image_t*)calloc(1, sizeof(wgpu_golden_image_t));
+  golden_image->wgpu_context = wgpu_context;
+  snprintf(golden_image->filename, sizeof(golden_image->filename), "%s",
+           desc->filename);
+  golden_image->update    = desc->update;
+  golden_image->tolerance = desc->tolerance > 0.0f ? desc->tolerance : 0.02f;
+  golden_image->max_mismatch_fraction
+    = desc->max_mismatch_fraction > 0.0f ? desc->max_mismatch_fraction :
+                                           0.001f;
+
+  wgpu_create_readback(wgpu_context);
+
+  return golden_image;
+}
+
+void wgpu_golden_image_destroy(wgpu_golden_image_t* golden_image)
+{
+  if (golden_image == NULL) {
+    return;
+  }
+  free(golden_image->frame.pixels);
+  free(golden_image);
+}
+
+static void golden_image_readback_cb(const wgpu_readback_result_t* result,
+                                     void* user_data)
+{
+  wgpu_golden_image_t* golden_image = (wgpu_golden_image_t*)user_data;
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS) {
+    return;
+  }
+
+  const uint32_t pixel_count = result->width * result->height;
+  free(golden_image->frame.pixels);
+  golden_image->frame.pixels = (uint8_t*)malloc(pixel_count * 4);
+  memcpy(golden_image->frame.pixels, result->data, pixel_count * 4);
+  /* Normalize BGRA swap chain images to RGBA */
+  if (result->format == WGPUTextureFormat_BGRA8Unorm
+      || result->format == WGPUTextureFormat_BGRA8UnormSrgb) {
+    for (uint32_t i = 0; i < pixel_count; ++i) {
+      uint8_t* p = &golden_image->frame.pixels[i * 4];
+      uint8_t b  = p[0];
+      p[0]       = p[2];
+      p[2]       = b;
+    }
+  }
+  golden_image->frame.width    = result->width;
+  golden_image->frame.height   = result->height;
+  golden_image->frame.received = true;
+}
+
+void wgpu_golden_image_capture(wgpu_golden_image_t* golden_image)
+{
+  wgpu_context_t* wgpu_context = golden_image->wgpu_context;
+
+  WGPUTexture texture
+    = wgpuSwapChainGetCurrentTexture(wgpu_context->swap_chain.instance);
+  if (texture == NULL) {
+    return;
+  }
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  golden_image->frame.requested = wgpu_readback_copy_texture(
+    wgpu_context->readback, cmd_enc,
+    &(wgpu_readback_texture_desc_t){
+      .texture  = texture,
+      .format   = wgpu_context->swap_chain.format,
+      .width    = wgpu_context->surface.width,
+      .height   = wgpu_context->surface.height,
+      .callback = golden_image_readback_cb,
+      .userdata = golden_image,
+    });
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+  wgpu_flush_command_buffers(wgpu_context, &command_buffer, 1);
+  WGPU_RELEASE_RESOURCE(Texture, texture)
+}
+
+/* sRGB to linear conversion of an 8-bit channel value */
+static float srgb_to_linear(uint8_t value)
+{
+  const float c = value / 255.0f;
+  return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+/* Convert linear RGB to the perceptually uniform Oklab color space */
+static void linear_rgb_to_oklab(const float rgb[3], float lab[3])
+{
+  const float l = cbrtf(0.4122214708f * rgb[0] + 0.5363325363f * rgb[1]
+                        + 0.0514459929f * rgb[2]);
+  const float m = cbrtf(0.2119034982f * rgb[0] + 0.6806995451f * rgb[1]
+                        + 0.1073969566f * rgb[2]);
+  const float s = cbrtf(0.0883024619f * rgb[0] + 0.2817188376f * rgb[1]
+                        + 0.6299787005f * rgb[2]);
+  lab[0] = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+  lab[1] = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+  lab[2] = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+}
+
+void wgpu_golden_image_compare(const uint8_t* image, const uint8_t* golden,
+                               uint32_t width, uint32_t height,
+                               float tolerance, uint8_t* diff,
+                               wgpu_golden_image_result_t* result)
+{
+  /* Lookup table for the sRGB transfer function */
+  float srgb_lut[256];
+  for (uint32_t i = 0; i < 256; ++i) {
+    srgb_lut[i] = srgb_to_linear((uint8_t)i);
+  }
+
+  result->pixel_count    = (uint64_t)width * height;
+  result->mismatch_count = 0;
+  result->max_difference = 0.0f;
+  for (uint64_t i = 0; i < result->pixel_count; ++i) {
+    const uint8_t* a = &image[i * 4];
+    const uint8_t* b = &golden[i * 4];
+    float lab_a[3], lab_b[3];
+    linear_rgb_to_oklab((float[3]){srgb_lut[a[0]], srgb_lut[a[1]],
+                                   srgb_lut[a[2]]},
+                        lab_a);
+    linear_rgb_to_oklab((float[3]){srgb_lut[b[0]], srgb_lut[b[1]],
+                                   srgb_lut[b[2]]},
+                        lab_b);
+    /* Euclidean distance in Oklab approximates the perceived difference */
+    const float dl = lab_a[0] - lab_b[0], da = lab_a[1] - lab_b[1],
+                db = lab_a[2] - lab_b[2];
+    const float difference = sqrtf(dl * dl + da * da + db * db);
+    result->max_difference = MAX(result->max_difference, difference);
+    const bool mismatch    = difference > tolerance;
+    if (mismatch) {
+      ++result->mismatch_count;
+    }
+    if (diff != NULL) {
+      /* Mismatches in red over a dimmed grayscale copy of the golden image */
+      const uint8_t gray = (uint8_t)((b[0] + b[1] + b[2]) / 12);
+      diff[i * 4 + 0]    = mismatch ? 255 : gray;
+      diff[i * 4 + 1]    = mismatch ? 0 : gray;
+      diff[i * 4 + 2]    = mismatch ? 0 : gray;
+      diff[i * 4 + 3]    = 255;
+    }
+  }
+}
+
+bool wgpu_golden_image_finish(wgpu_golden_image_t* golden_image,
+                              wgpu_golden_image_result_t* result)
+{
+  memset(result, 0, sizeof(*result));
+
+  if (golden_image->frame.requested) {
+    wgpu_readback_flush(golden_image->wgpu_context->readback);
+  }
+  if (!golden_image->frame.received) {
+    log_error("Golden image: no frame was captured");
+    return false;
+  }
+  result->captured = true;
+
+  const uint32_t w = golden_image->frame.width;
+  const uint32_t h = golden_image->frame.height;
+
+  if (golden_image->update) {
+    result->passed = stbi_write_png(golden_image->filename, (int)w, (int)h, 4,
+                                    golden_image->frame.pixels, (int)w * 4)
+                     != 0;
+    if (result->passed) {
+      log_info("Golden image: updated %s", golden_image->filename);
+    }
+    else {
+      log_error("Golden image: could not write %s", golden_image->filename);
+    }
+    return result->passed;
+  }
+
+  int gw = 0, gh = 0, channels = 0;
+  uint8_t* golden
+    = stbi_load(golden_image->filename, &gw, &gh, &channels, STBI_rgb_alpha);
+  if (golden == NULL) {
+    log_error("Golden image: could not load %s", golden_image->filename);
+    return false;
+  }
+  if ((uint32_t)gw != w || (uint32_t)gh != h) {
+    log_error("Golden image: size mismatch, expected %dx%d got %ux%u", gw, gh,
+              w, h);
+    stbi_image_free(golden);
+    return false;
+  }
+
+  uint8_t* diff = (uint8_t*)malloc((size_t)w * h * 4);
+  wgpu_golden_image_compare(golden_image->frame.pixels, golden, w, h,
+                            golden_image->tolerance, diff, result);
+  const float mismatch_fraction
+    = (float)result->mismatch_count / (float)result->pixel_count;
+  result->passed = mismatch_fraction <= golden_image->max_mismatch_fraction;
+
+  if (result->passed) {
+    log_info("Golden image: PASSED %s (%.4f%% mismatching pixels, max "
+             "difference %.4f)",
+             golden_image->filename, mismatch_fraction * 100.0f,
+             result->max_difference);
+  }
+  else {
+    /* Store the captured frame and the difference image for inspection */
+    char filename[STRMAX];
+    snprintf(filename, sizeof(filename), "%s.actual.png",
+             golden_image->filename);
+    stbi_write_png(filename, (int)w, (int)h, 4, golden_image->frame.pixels,
+                   (int)w * 4);
+    snprintf(filename, sizeof(filename), "%s.diff.png",
+             golden_image->filename);
+    stbi_write_png(filename, (int)w, (int)h, 4, diff, (int)w * 4);
+    log_error("Golden image: FAILED %s (%.4f%% mismatching pixels, max "
+              "difference %.4f), see %s",
+              golden_image->filename, mismatch_fraction * 100.0f,
+              result->max_difference, filename);
+  }
+
+  free(diff);
+  stbi_image_free(golden);
+
+  return result->passed;
+}
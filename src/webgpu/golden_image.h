@@ -0,0 +1,65 @@
+#ifndef GOLDEN_IMAGE_H
+#define GOLDEN_IMAGE_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Golden Image Comparison
+ *
+ * Reads back the final frame of a deterministic example run and compares it
+ * against a stored golden PNG image with a perceptual tolerance, or replaces
+ * the golden image when updating.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_golden_image_desc_t {
+  const char* filename; /* golden PNG image */
+  bool update;          /* write the captured frame as new golden image */
+  /* Maximum perceptual difference of a pixel in the range [0, 1], pixels
+   * above the threshold count as mismatches, default 0.02 */
+  float tolerance;
+  /* Maximum fraction of mismatching pixels, default 0.001 */
+  float max_mismatch_fraction;
+} wgpu_golden_image_desc_t;
+
+typedef struct wgpu_golden_image_result_t {
+  bool captured;
+  bool passed;
+  uint64_t pixel_count;
+  uint64_t mismatch_count;
+  float max_difference;
+} wgpu_golden_image_result_t;
+
+typedef struct wgpu_golden_image wgpu_golden_image_t;
+
+/* Golden image construction / destruction */
+wgpu_golden_image_t*
+wgpu_golden_image_create(wgpu_context_t* wgpu_context,
+                         const wgpu_golden_image_desc_t* desc);
+void wgpu_golden_image_destroy(wgpu_golden_image_t* golden_image);
+
+/**
+ * @brief Records a readback of the current swap chain image. Must be called
+ * after the frame was rendered and before it is presented. The swap chain must
+ * be created with WGPUTextureUsage_CopySrc.
+ */
+void wgpu_golden_image_capture(wgpu_golden_image_t* golden_image);
+
+/**
+ * @brief Waits for the captured frame and compares it against, or stores it
+ * as, the golden image.
+ * @return true if the frame matches the golden image or the golden image was
+ * updated
+ */
+bool wgpu_golden_image_finish(wgpu_golden_image_t* golden_image,
+                              wgpu_golden_image_result_t* result);
+
+/**
+ * @brief Perceptual difference between two RGBA8 images in sRGB color space.
+ * @param diff optional RGBA8 output image highlighting mismatching pixels
+ */
+void wgpu_golden_image_compare(const uint8_t* image, const uint8_t* golden,
+                               uint32_t width, uint32_t height,
+                               float tolerance, uint8_t* diff,
+                               wgpu_golden_image_result_t* result);
+
+#endif /* GOLDEN_IMAGE_H */
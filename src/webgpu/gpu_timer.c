@@ -0,0 +1,240 @@
+#include "gpu_timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+#include "../core/platform.h"
+#include "../core/trace.h"
+
+#include "readback.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU GPU Timer
+ * -------------------------------------------------------------------------- */
+
+/* Begin and end timestamp of a frame */
+#define GPU_TIMER_QUERY_COUNT 2u
+
+typedef enum gpu_timer_slot_state_t {
+  GPU_TIMER_SLOT_STATE_FREE,
+  GPU_TIMER_SLOT_STATE_RECORDING,
+  GPU_TIMER_SLOT_STATE_PENDING, /* waiting for the readback */
+} gpu_timer_slot_state_t;
+
+typedef struct gpu_timer_slot_t {
+  struct wgpu_gpu_timer* gpu_timer;
+  gpu_timer_slot_state_t state;
+  WGPUQuerySet query_set;
+  WGPUBuffer resolve_buffer;
+  uint64_t cpu_submit_ns; /* CPU time at which the frame was submitted */
+} gpu_timer_slot_t;
+
+struct wgpu_gpu_timer {
+  wgpu_context_t* wgpu_context;
+  bool supported;
+  gpu_timer_slot_t slots[WGPU_GPU_TIMER_FRAME_COUNT];
+  uint32_t slot_index;
+  gpu_timer_slot_t* current_slot;
+  /* Offset mapping GPU timestamps into the CPU timeline */
+  int64_t gpu_to_cpu_offset_ns;
+  bool calibrated;
+  float frame_ms;
+  wgpu_gpu_timer_stats_t stats;
+};
+
+wgpu_gpu_timer_t* wgpu_gpu_timer_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_gpu_timer_t* gpu_timer
+    = (wgpu_gpu_timer_t*)calloc(1, sizeof(wgpu_gpu_timer_t));
+  gpu_timer->wgpu_context = wgpu_context;
+  gpu_timer->supported
+    = wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery);
+  if (!gpu_timer->supported) {
+    log_warn("GPU timer: timestamp queries are not supported by the device");
+    return gpu_timer;
+  }
+
+  wgpu_create_readback(wgpu_context);
+
+  for (uint32_t i = 0; i < WGPU_GPU_TIMER_FRAME_COUNT; ++i) {
+    gpu_timer_slot_t* slot = &gpu_timer->slots[i];
+    slot->gpu_timer        = gpu_timer;
+    slot->state            = GPU_TIMER_SLOT_STATE_FREE;
+    slot->query_set        = wgpuDeviceCreateQuerySet(
+      wgpu_context->device, &(WGPUQuerySetDescriptor){
+                              .label = "GPU timer - Query set",
+                              .type  = WGPUQueryType_Timestamp,
+                              .count = GPU_TIMER_QUERY_COUNT,
+                            });
+    slot->resolve_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "GPU timer - Resolve buffer",
+        .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        .size  = GPU_TIMER_QUERY_COUNT * sizeof(uint64_t),
+      });
+  }
+
+  return gpu_timer;
+}
+
+void wgpu_gpu_timer_destroy(wgpu_gpu_timer_t* gpu_timer)
+{
+  if (gpu_timer == NULL) {
+    return;
+  }
+
+  /* Pending readbacks reference the slots */
+  if (gpu_timer->supported && gpu_timer->wgpu_context->readback != NULL) {
+    wgpu_readback_flush(gpu_timer->wgpu_context->readback);
+  }
+
+  for (uint32_t i = 0; i < WGPU_GPU_TIMER_FRAME_COUNT; ++i) {
+    WGPU_RELEASE_RESOURCE(QuerySet, gpu_timer->slots[i].query_set)
+    WGPU_RELEASE_RESOURCE(Buffer, gpu_timer->slots[i].resolve_buffer)
+  }
+  free(gpu_timer);
+}
+
+bool wgpu_gpu_timer_is_supported(wgpu_gpu_timer_t* gpu_timer)
+{
+  return gpu_timer->supported;
+}
+
+static void gpu_timer_readback_cb(const wgpu_readback_result_t* result,
+                                  void* user_data)
+{
+  gpu_timer_slot_t* slot      = (gpu_timer_slot_t*)user_data;
+  wgpu_gpu_timer_t* gpu_timer = slot->gpu_timer;
+  slot->state                 = GPU_TIMER_SLOT_STATE_FREE;
+
+  if (result->status != WGPU_READBACK_STATUS_SUCCESS
+      || result->size < GPU_TIMER_QUERY_COUNT * sizeof(uint64_t)) {
+    return;
+  }
+
+  uint64_t timestamps[GPU_TIMER_QUERY_COUNT];
+  memcpy(timestamps, result->data, sizeof(timestamps));
+  /* Timestamps can be zero or out of order, e.g. after a power state change */
+  if (timestamps[0] == 0 || timestamps[1] < timestamps[0]) {
+    return;
+  }
+  gpu_timer->frame_ms = (float)(timestamps[1] - timestamps[0]) / 1000000.0f;
+
+  /* Accumulate statistics */
+  wgpu_gpu_timer_stats_t* stats = &gpu_timer->stats;
+
+  stats->min_ms = stats->frame_count == 0 ?
+                    gpu_timer->frame_ms :
+                    MIN(stats->min_ms, gpu_timer->frame_ms);
+  stats->max_ms = MAX(stats->max_ms, gpu_timer->frame_ms);
+  stats->total_ms += gpu_timer->frame_ms;
+  ++stats->frame_count;
+
+  if (!trace_is_enabled()) {
+    return;
+  }
+
+  /* The GPU clock domain is unrelated to the CPU clock. Map the GPU timestamps
+   * so that the GPU work never starts before it was submitted; the offset is
+   * only ever increased, which keeps the mapping stable while absorbing
+   * drift. */
+  const int64_t offset
+    = (int64_t)slot->cpu_submit_ns - (int64_t)timestamps[0];
+  if (!gpu_timer->calibrated || offset > gpu_timer->gpu_to_cpu_offset_ns) {
+    gpu_timer->gpu_to_cpu_offset_ns = offset;
+    gpu_timer->calibrated           = true;
+  }
+  trace_add_gpu_event(
+    "GPU frame",
+    (uint64_t)((int64_t)timestamps[0] + gpu_timer->gpu_to_cpu_offset_ns),
+    (uint64_t)((int64_t)timestamps[1] + gpu_timer->gpu_to_cpu_offset_ns));
+}
+
+/* Writes a timestamp through an empty compute pass, encoder level timestamp
+ * writes are not part of core WebGPU */
+static void gpu_timer_write_timestamp(WGPUCommandEncoder cmd_enc,
+                                      WGPUQuerySet query_set,
+                                      uint32_t query_index)
+{
+  WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(
+    cmd_enc, &(WGPUComputePassDescriptor){
+               .label           = "GPU timer - Timestamp pass",
+               .timestampWrites = &(WGPUComputePassTimestampWrites){
+                 .querySet                  = query_set,
+                 .beginningOfPassWriteIndex = query_index,
+                 .endOfPassWriteIndex       = WGPU_QUERY_SET_INDEX_UNDEFINED,
+               },
+             });
+  wgpuComputePassEncoderEnd(pass);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, pass)
+}
+
+WGPUCommandBuffer wgpu_gpu_timer_begin_frame(wgpu_gpu_timer_t* gpu_timer)
+{
+  gpu_timer->current_slot = NULL;
+  if (!gpu_timer->supported) {
+    return NULL;
+  }
+
+  /* Skip timing this frame if all slots are still waiting for results */
+  gpu_timer_slot_t* slot = &gpu_timer->slots[gpu_timer->slot_index];
+  if (slot->state != GPU_TIMER_SLOT_STATE_FREE
+      || !wgpu_readback_can_accept(gpu_timer->wgpu_context->readback)) {
+    return NULL;
+  }
+  gpu_timer->slot_index
+    = (gpu_timer->slot_index + 1) % WGPU_GPU_TIMER_FRAME_COUNT;
+  slot->state             = GPU_TIMER_SLOT_STATE_RECORDING;
+  slot->cpu_submit_ns     = platform_get_timestamp_ns();
+  gpu_timer->current_slot = slot;
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(gpu_timer->wgpu_context->device, NULL);
+  gpu_timer_write_timestamp(cmd_enc, slot->query_set, 0);
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+
+  return command_buffer;
+}
+
+WGPUCommandBuffer wgpu_gpu_timer_end_frame(wgpu_gpu_timer_t* gpu_timer)
+{
+  gpu_timer_slot_t* slot = gpu_timer->current_slot;
+  ASSERT(slot != NULL);
+  gpu_timer->current_slot = NULL;
+
+  WGPUCommandEncoder cmd_enc
+    = wgpuDeviceCreateCommandEncoder(gpu_timer->wgpu_context->device, NULL);
+  gpu_timer_write_timestamp(cmd_enc, slot->query_set, 1);
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, slot->query_set, 0,
+                                    GPU_TIMER_QUERY_COUNT,
+                                    slot->resolve_buffer, 0);
+  const bool recorded = wgpu_readback_copy_buffer(
+    gpu_timer->wgpu_context->readback, cmd_enc,
+    &(wgpu_readback_buffer_desc_t){
+      .buffer   = slot->resolve_buffer,
+      .size     = GPU_TIMER_QUERY_COUNT * sizeof(uint64_t),
+      .callback = gpu_timer_readback_cb,
+      .userdata = slot,
+    });
+  slot->state = recorded ? GPU_TIMER_SLOT_STATE_PENDING :
+                           GPU_TIMER_SLOT_STATE_FREE;
+  WGPUCommandBuffer command_buffer = wgpu_get_command_buffer(cmd_enc);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_enc)
+
+  return command_buffer;
+}
+
+float wgpu_gpu_timer_get_frame_ms(wgpu_gpu_timer_t* gpu_timer)
+{
+  return gpu_timer->frame_ms;
+}
+
+void wgpu_gpu_timer_get_stats(wgpu_gpu_timer_t* gpu_timer,
+                              wgpu_gpu_timer_stats_t* stats)
+{
+  *stats = gpu_timer->stats;
+}
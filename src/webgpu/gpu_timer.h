@@ -0,0 +1,59 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU GPU Timer
+ *
+ * Measures the GPU time of the work submitted per frame with timestamp queries
+ * written by empty compute passes before and after the frame's command
+ * buffers. Query results are resolved and read back through the readback
+ * service, i.e. they become available a few frames later without stalling the
+ * CPU. Measured ranges are mapped into the CPU timeline and added to the trace
+ * when tracing is enabled.
+ * Requires WGPUFeatureName_TimestampQuery, all functions are no-ops otherwise.
+ * -------------------------------------------------------------------------- */
+
+/* Number of frames that can be timed concurrently */
+#define WGPU_GPU_TIMER_FRAME_COUNT 4u
+
+typedef struct wgpu_gpu_timer_stats_t {
+  uint64_t frame_count; /* number of resolved frames */
+  double total_ms;
+  float min_ms;
+  float max_ms;
+} wgpu_gpu_timer_stats_t;
+
+typedef struct wgpu_gpu_timer wgpu_gpu_timer_t;
+
+/* GPU timer construction / destruction */
+wgpu_gpu_timer_t* wgpu_gpu_timer_create(wgpu_context_t* wgpu_context);
+void wgpu_gpu_timer_destroy(wgpu_gpu_timer_t* gpu_timer);
+
+/* Returns true if the device supports timestamp queries */
+bool wgpu_gpu_timer_is_supported(wgpu_gpu_timer_t* gpu_timer);
+
+/**
+ * @brief Creates a command buffer writing the frame begin timestamp, to be
+ * submitted before the frame's command buffers.
+ * @return the command buffer or NULL if the frame is not timed
+ */
+WGPUCommandBuffer wgpu_gpu_timer_begin_frame(wgpu_gpu_timer_t* gpu_timer);
+
+/**
+ * @brief Creates a command buffer writing the frame end timestamp and
+ * recording the query readback, to be submitted after the frame's command
+ * buffers. Must only be called if wgpu_gpu_timer_begin_frame() returned a
+ * command buffer.
+ */
+WGPUCommandBuffer wgpu_gpu_timer_end_frame(wgpu_gpu_timer_t* gpu_timer);
+
+/* GPU time of the most recently resolved frame in milliseconds, 0 if none */
+float wgpu_gpu_timer_get_frame_ms(wgpu_gpu_timer_t* gpu_timer);
+
+/* Accumulated GPU frame times of all resolved frames */
+void wgpu_gpu_timer_get_stats(wgpu_gpu_timer_t* gpu_timer,
+                              wgpu_gpu_timer_stats_t* stats);
+
+#endif /* GPU_TIMER_H */
@@ -406,8 +406,8 @@ static void imgui_overlay_prepare_pipeline(imgui_overlay_t* imgui_overlay)
                           });
 
   // Partial cleanup
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
 }
 
 static void imgui_overlay_prepare_uniform_buffer(imgui_overlay_t* imgui_overlay)
@@ -0,0 +1,590 @@
+#include "light_manager.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "buffer.h"
+#include "shader.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Light Manager
+ * -------------------------------------------------------------------------- */
+
+/* Must match the workgroup size of the culling shader */
+#define LIGHT_MANAGER_WORKGROUP_SIZE 64u
+
+#define LIGHT_MANAGER_DEFAULT_MAX_LIGHTS 1024u
+#define LIGHT_MANAGER_DEFAULT_MAX_LIGHTS_PER_FROXEL 64u
+
+static const uint32_t light_manager_default_grid_size[3] = {16u, 9u, 24u};
+
+/* Light in the storage buffer, must match LightManagerLight in the shader */
+typedef struct light_manager_gpu_light_t {
+  float position[3];
+  float range;
+  float direction[3];
+  uint32_t type;
+  float color[3];
+  float intensity;
+  float spot_scale;
+  float spot_offset;
+  float padding[2];
+} light_manager_gpu_light_t;
+
+/* Must match LightManagerUniforms in the shader */
+typedef struct light_manager_uniforms_t {
+  mat4 view;
+  mat4 inverse_projection;
+  float screen_size[2];
+  float z_near;
+  float z_far;
+  uint32_t grid_size[3];
+  uint32_t light_count;
+  uint32_t max_lights_per_froxel;
+  float slice_scale;
+  float slice_bias;
+  float padding;
+} light_manager_uniforms_t;
+
+struct wgpu_light_manager {
+  wgpu_context_t* wgpu_context;
+  uint32_t max_lights;
+  uint32_t grid_size[3];
+  uint32_t froxel_count;
+  uint32_t max_lights_per_froxel;
+  /* Lights are kept densely packed, ids map to positions in the dense array
+   * and stay valid when other lights are removed */
+  light_manager_gpu_light_t* lights;
+  uint32_t light_count;
+  uint32_t* id_to_index;
+  uint32_t* index_to_id;
+  uint32_t* free_ids;
+  uint32_t free_id_count;
+  /* Dense range [dirty_begin, dirty_end) to upload on the next cull */
+  uint32_t dirty_begin;
+  uint32_t dirty_end;
+  /* Buffers */
+  wgpu_buffer_t light_buffer;
+  wgpu_buffer_t uniform_buffer;
+  wgpu_buffer_t froxel_counts;
+  wgpu_buffer_t froxel_lights;
+  /* Culling */
+  WGPUBindGroupLayout cull_bind_group_layout;
+  WGPUPipelineLayout cull_pipeline_layout;
+  WGPUComputePipeline cull_pipeline;
+  WGPUBindGroup cull_bind_group;
+  /* Shading */
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroup bind_group;
+};
+
+// clang-format off
+static const char* light_manager_cull_shader_wgsl = CODE(
+  struct Light {
+    position : vec3f,
+    range : f32,
+    direction : vec3f,
+    lightType : u32,
+    color : vec3f,
+    intensity : f32,
+    spotScale : f32,
+    spotOffset : f32,
+  }
+
+  struct Uniforms {
+    view : mat4x4f,
+    inverseProjection : mat4x4f,
+    screenSize : vec2f,
+    zNear : f32,
+    zFar : f32,
+    gridSize : vec3u,
+    lightCount : u32,
+    maxLightsPerFroxel : u32,
+    sliceScale : f32,
+    sliceBias : f32,
+  }
+
+  const WORKGROUP_SIZE = 64u;
+  const DIRECTIONAL = 2u;
+
+  @group(0) @binding(0) var<uniform> params : Uniforms;
+  @group(0) @binding(1) var<storage, read> lights : array<Light>;
+  @group(0) @binding(2) var<storage, read_write> froxelCounts : array<u32>;
+  @group(0) @binding(3) var<storage, read_write> froxelLights : array<u32>;
+
+  // View space bounding spheres of a batch of lights, a negative radius marks
+  // directional lights which affect every froxel
+  var<workgroup> sharedSpheres : array<vec4f, WORKGROUP_SIZE>;
+
+  // Point at the given view space depth on the view ray through ndc
+  fn viewPointAtDepth(ndc : vec2f, depth : f32) -> vec3f {
+    let p = params.inverseProjection * vec4f(ndc, 0.5, 1.0);
+    let v = p.xyz / p.w;
+    return v * (depth / -v.z);
+  }
+
+  // One invocation per froxel, every workgroup loads the lights in batches
+  // into workgroup memory and tests them against its froxels
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn cull(@builtin(global_invocation_id) globalId : vec3u,
+          @builtin(local_invocation_index) localIndex : u32) {
+    let grid = params.gridSize;
+    let froxelCount = grid.x * grid.y * grid.z;
+    // No early return, all invocations take part in loading the batches
+    let valid = globalId.x < froxelCount;
+    let froxel = min(globalId.x, froxelCount - 1u);
+    let x = froxel % grid.x;
+    let y = (froxel / grid.x) % grid.y;
+    let z = froxel / (grid.x * grid.y);
+
+    // Froxel bounds in view space, tile rows go down the screen
+    let tileSize = 2.0 / vec2f(grid.xy);
+    let ndcMin = vec2f(-1.0 + f32(x) * tileSize.x,
+                       1.0 - f32(y + 1u) * tileSize.y);
+    let ndcMax = ndcMin + tileSize;
+    let depthRatio = params.zFar / params.zNear;
+    let depthNear = params.zNear * pow(depthRatio, f32(z) / f32(grid.z));
+    let depthFar = params.zNear * pow(depthRatio, f32(z + 1u) / f32(grid.z));
+    var aabbMin = vec3f(3.402823e38);
+    var aabbMax = vec3f(-3.402823e38);
+    for (var i = 0u; i < 4u; i++) {
+      let ndc = vec2f(select(ndcMin.x, ndcMax.x, (i & 1u) != 0u),
+                      select(ndcMin.y, ndcMax.y, (i & 2u) != 0u));
+      let pNear = viewPointAtDepth(ndc, depthNear);
+      let pFar = viewPointAtDepth(ndc, depthFar);
+      aabbMin = min(aabbMin, min(pNear, pFar));
+      aabbMax = max(aabbMax, max(pNear, pFar));
+    }
+
+    let base = froxel * params.maxLightsPerFroxel;
+    var count = 0u;
+    for (var first = 0u; first < params.lightCount; first += WORKGROUP_SIZE) {
+      let lightIndex = first + localIndex;
+      if (lightIndex < params.lightCount) {
+        let light = lights[lightIndex];
+        var sphere = vec4f(0.0, 0.0, 0.0, -1.0);
+        if (light.lightType != DIRECTIONAL) {
+          // Spot lights are culled by their range sphere (conservative)
+          let center = params.view * vec4f(light.position, 1.0);
+          sphere = vec4f(center.xyz, light.range);
+        }
+        sharedSpheres[localIndex] = sphere;
+      }
+      workgroupBarrier();
+
+      let batchSize = min(WORKGROUP_SIZE, params.lightCount - first);
+      for (var i = 0u; i < batchSize; i++) {
+        let sphere = sharedSpheres[i];
+        let d = clamp(sphere.xyz, aabbMin, aabbMax) - sphere.xyz;
+        let overlaps = sphere.w < 0.0 || dot(d, d) <= sphere.w * sphere.w;
+        if (valid && overlaps && count < params.maxLightsPerFroxel) {
+          froxelLights[base + count] = first + i;
+          count++;
+        }
+      }
+      workgroupBarrier();
+    }
+
+    if (valid) {
+      froxelCounts[froxel] = count;
+    }
+  }
+);
+// clang-format on
+
+static void light_manager_prepare_buffers(wgpu_light_manager_t* lm)
+{
+  wgpu_context_t* wgpu_context = lm->wgpu_context;
+
+  lm->light_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Light manager - Lights buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+                    .size  = lm->max_lights * sizeof(light_manager_gpu_light_t),
+                  });
+  lm->uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Light manager - Uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(light_manager_uniforms_t),
+                  });
+  lm->froxel_counts = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Light manager - Froxel counts buffer",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = lm->froxel_count * sizeof(uint32_t),
+                  });
+  lm->froxel_lights = wgpu_create_buffer(
+    wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "Light manager - Froxel lights buffer",
+      .usage = WGPUBufferUsage_Storage,
+      .size = lm->froxel_count * lm->max_lights_per_froxel * sizeof(uint32_t),
+    });
+}
+
+static void light_manager_prepare_bind_groups(wgpu_light_manager_t* lm)
+{
+  WGPUDevice device = lm->wgpu_context->device;
+
+  const wgpu_buffer_t* buffers[4] = {
+    &lm->uniform_buffer,
+    &lm->light_buffer,
+    &lm->froxel_counts,
+    &lm->froxel_lights,
+  };
+  WGPUBindGroupEntry bg_entries[4] = {0};
+  for (uint32_t b = 0; b < (uint32_t)ARRAY_SIZE(bg_entries); ++b) {
+    bg_entries[b] = (WGPUBindGroupEntry){
+      .binding = b,
+      .buffer  = buffers[b]->buffer,
+      .offset  = 0,
+      .size    = buffers[b]->size,
+    };
+  }
+
+  /* Culling: the froxel grid is written */
+  WGPUBindGroupLayoutEntry bgl_entries[4] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(light_manager_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_ReadOnlyStorage,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_Storage,
+      },
+    },
+    [3] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 3,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_Storage,
+      },
+    },
+  };
+  lm->cull_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Light manager - Culling bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(lm->cull_bind_group_layout != NULL);
+
+  lm->cull_bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Light manager - Culling bind group",
+              .layout     = lm->cull_bind_group_layout,
+              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+              .entries    = bg_entries,
+            });
+  ASSERT(lm->cull_bind_group != NULL);
+
+  /* Shading: everything is read only */
+  for (uint32_t b = 0; b < (uint32_t)ARRAY_SIZE(bgl_entries); ++b) {
+    bgl_entries[b].visibility
+      = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+    if (b > 0) {
+      bgl_entries[b].buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+    }
+  }
+  lm->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Light manager - Bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(lm->bind_group_layout != NULL);
+
+  lm->bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Light manager - Bind group",
+              .layout     = lm->bind_group_layout,
+              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+              .entries    = bg_entries,
+            });
+  ASSERT(lm->bind_group != NULL);
+}
+
+static void light_manager_prepare_pipeline(wgpu_light_manager_t* lm)
+{
+  WGPUDevice device = lm->wgpu_context->device;
+
+  lm->cull_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Light manager - Culling pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &lm->cull_bind_group_layout,
+            });
+  ASSERT(lm->cull_pipeline_layout != NULL);
+
+  WGPUShaderModule shader_module = wgpu_create_shader_module(
+    lm->wgpu_context, &(wgpu_shader_desc_t){
+                        .wgsl_code.source = light_manager_cull_shader_wgsl,
+                      });
+  lm->cull_pipeline = wgpuDeviceCreateComputePipeline(
+    device, &(WGPUComputePipelineDescriptor){
+              .label   = "Light manager - Culling pipeline",
+              .layout  = lm->cull_pipeline_layout,
+              .compute = {
+                .module     = shader_module,
+                .entryPoint = "cull",
+              },
+            });
+  ASSERT(lm->cull_pipeline != NULL);
+  wgpu_release_shader_module(lm->wgpu_context, shader_module);
+}
+
+wgpu_light_manager_t*
+wgpu_light_manager_create(wgpu_context_t* wgpu_context,
+                          const wgpu_light_manager_desc_t* desc)
+{
+  wgpu_light_manager_t* lm
+    = (wgpu_light_manager_t*)calloc(1, sizeof(wgpu_light_manager_t));
+  lm->wgpu_context = wgpu_context;
+  lm->max_lights            = desc->max_lights > 0 ?
+                                desc->max_lights :
+                                LIGHT_MANAGER_DEFAULT_MAX_LIGHTS;
+  lm->max_lights_per_froxel = desc->max_lights_per_froxel > 0 ?
+                                desc->max_lights_per_froxel :
+                                LIGHT_MANAGER_DEFAULT_MAX_LIGHTS_PER_FROXEL;
+  lm->froxel_count = 1;
+  for (uint32_t i = 0; i < 3; ++i) {
+    lm->grid_size[i] = desc->grid_size[i] > 0 ?
+                         desc->grid_size[i] :
+                         light_manager_default_grid_size[i];
+    lm->froxel_count *= lm->grid_size[i];
+  }
+
+  lm->lights = (light_manager_gpu_light_t*)calloc(
+    lm->max_lights, sizeof(light_manager_gpu_light_t));
+  lm->id_to_index = (uint32_t*)malloc(lm->max_lights * sizeof(uint32_t));
+  lm->index_to_id = (uint32_t*)malloc(lm->max_lights * sizeof(uint32_t));
+  lm->free_ids    = (uint32_t*)malloc(lm->max_lights * sizeof(uint32_t));
+  wgpu_light_manager_clear(lm);
+
+  light_manager_prepare_buffers(lm);
+  light_manager_prepare_bind_groups(lm);
+  light_manager_prepare_pipeline(lm);
+
+  return lm;
+}
+
+void wgpu_light_manager_destroy(wgpu_light_manager_t* lm)
+{
+  if (lm == NULL) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(BindGroup, lm->bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, lm->cull_bind_group)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, lm->cull_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, lm->cull_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, lm->cull_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, lm->bind_group_layout)
+  wgpu_destroy_buffer(&lm->light_buffer);
+  wgpu_destroy_buffer(&lm->uniform_buffer);
+  wgpu_destroy_buffer(&lm->froxel_counts);
+  wgpu_destroy_buffer(&lm->froxel_lights);
+  free(lm->lights);
+  free(lm->id_to_index);
+  free(lm->index_to_id);
+  free(lm->free_ids);
+  free(lm);
+}
+
+static void light_manager_mark_dirty(wgpu_light_manager_t* lm, uint32_t index)
+{
+  if (lm->dirty_begin >= lm->dirty_end) {
+    lm->dirty_begin = index;
+    lm->dirty_end   = index + 1;
+  }
+  else {
+    lm->dirty_begin = MIN(lm->dirty_begin, index);
+    lm->dirty_end   = MAX(lm->dirty_end, index + 1);
+  }
+}
+
+/* Converts a light into the storage buffer layout */
+static void light_manager_pack_light(const wgpu_light_t* light,
+                                     light_manager_gpu_light_t* gpu_light)
+{
+  vec3 direction = {0.0f, -1.0f, 0.0f};
+  if (glm_vec3_norm2((float*)light->direction) > 0.0f) {
+    glm_vec3_normalize_to((float*)light->direction, direction);
+  }
+
+  /* Spot cone falloff: clamp(cos_angle * scale + offset, 0, 1) */
+  const float cos_outer = cosf(light->outer_cone_angle);
+  const float cos_inner = cosf(MIN(light->inner_cone_angle,
+                                   light->outer_cone_angle));
+  const float spot_scale = 1.0f / MAX(cos_inner - cos_outer, 1e-4f);
+
+  *gpu_light = (light_manager_gpu_light_t){
+    .position    = {light->position[0], light->position[1],
+                    light->position[2]},
+    .range       = MAX(light->range, 1e-4f),
+    .direction   = {direction[0], direction[1], direction[2]},
+    .type        = (uint32_t)light->type,
+    .color       = {light->color[0], light->color[1], light->color[2]},
+    .intensity   = light->intensity,
+    .spot_scale  = spot_scale,
+    .spot_offset = -cos_outer * spot_scale,
+  };
+}
+
+uint32_t wgpu_light_manager_add_light(wgpu_light_manager_t* lm,
+                                      const wgpu_light_t* light)
+{
+  if (lm->free_id_count == 0) {
+    log_warn("Light manager: the maximum number of lights (%u) is reached",
+             lm->max_lights);
+    return WGPU_LIGHT_MANAGER_INVALID_LIGHT;
+  }
+
+  const uint32_t id      = lm->free_ids[--lm->free_id_count];
+  const uint32_t index   = lm->light_count++;
+  lm->id_to_index[id]    = index;
+  lm->index_to_id[index] = id;
+  light_manager_pack_light(light, &lm->lights[index]);
+  light_manager_mark_dirty(lm, index);
+
+  return id;
+}
+
+void wgpu_light_manager_update_light(wgpu_light_manager_t* lm,
+                                     uint32_t light_id,
+                                     const wgpu_light_t* light)
+{
+  /* Ids of lights that could not be added or were removed are ignored */
+  if (light_id >= lm->max_lights
+      || lm->id_to_index[light_id] >= lm->light_count) {
+    return;
+  }
+
+  const uint32_t index = lm->id_to_index[light_id];
+  light_manager_pack_light(light, &lm->lights[index]);
+  light_manager_mark_dirty(lm, index);
+}
+
+void wgpu_light_manager_remove_light(wgpu_light_manager_t* lm,
+                                     uint32_t light_id)
+{
+  if (light_id >= lm->max_lights
+      || lm->id_to_index[light_id] >= lm->light_count) {
+    return;
+  }
+
+  /* Move the last light into the gap to keep the lights densely packed */
+  const uint32_t index = lm->id_to_index[light_id];
+  const uint32_t last  = --lm->light_count;
+  if (index != last) {
+    const uint32_t last_id   = lm->index_to_id[last];
+    lm->lights[index]        = lm->lights[last];
+    lm->index_to_id[index]   = last_id;
+    lm->id_to_index[last_id] = index;
+    light_manager_mark_dirty(lm, index);
+  }
+  lm->id_to_index[light_id]         = WGPU_LIGHT_MANAGER_INVALID_LIGHT;
+  lm->free_ids[lm->free_id_count++] = light_id;
+}
+
+void wgpu_light_manager_clear(wgpu_light_manager_t* lm)
+{
+  lm->light_count   = 0;
+  lm->free_id_count = lm->max_lights;
+  for (uint32_t i = 0; i < lm->max_lights; ++i) {
+    /* Hand out the lowest ids first */
+    lm->free_ids[i]    = lm->max_lights - 1 - i;
+    lm->id_to_index[i] = WGPU_LIGHT_MANAGER_INVALID_LIGHT;
+  }
+  lm->dirty_begin = lm->dirty_end = 0;
+}
+
+uint32_t wgpu_light_manager_get_light_count(wgpu_light_manager_t* lm)
+{
+  return lm->light_count;
+}
+
+uint32_t wgpu_light_manager_get_max_lights(wgpu_light_manager_t* lm)
+{
+  return lm->max_lights;
+}
+
+void wgpu_light_manager_cull(wgpu_light_manager_t* lm,
+                             WGPUCommandEncoder cmd_enc, mat4 view,
+                             mat4 projection, float z_near, float z_far)
+{
+  wgpu_context_t* wgpu_context = lm->wgpu_context;
+
+  /* Upload the lights changed since the last cull */
+  const uint32_t dirty_end = MIN(lm->dirty_end, lm->light_count);
+  if (lm->dirty_begin < dirty_end) {
+    wgpu_queue_write_buffer(
+      wgpu_context, lm->light_buffer.buffer,
+      lm->dirty_begin * sizeof(light_manager_gpu_light_t),
+      &lm->lights[lm->dirty_begin],
+      (dirty_end - lm->dirty_begin) * sizeof(light_manager_gpu_light_t));
+  }
+  lm->dirty_begin = lm->dirty_end = 0;
+
+  /* Depth slice of a view depth z: log(z) * slice_scale - slice_bias */
+  const float depth_ratio_log = logf(z_far / z_near);
+  light_manager_uniforms_t uniforms = {
+    .screen_size           = {(float)wgpu_context->surface.width,
+                              (float)wgpu_context->surface.height},
+    .z_near                = z_near,
+    .z_far                 = z_far,
+    .grid_size             = {lm->grid_size[0], lm->grid_size[1],
+                              lm->grid_size[2]},
+    .light_count           = lm->light_count,
+    .max_lights_per_froxel = lm->max_lights_per_froxel,
+    .slice_scale           = (float)lm->grid_size[2] / depth_ratio_log,
+    .slice_bias
+    = (float)lm->grid_size[2] * logf(z_near) / depth_ratio_log,
+  };
+  glm_mat4_copy(view, uniforms.view);
+  glm_mat4_inv(projection, uniforms.inverse_projection);
+  wgpu_queue_write_buffer(wgpu_context, lm->uniform_buffer.buffer, 0,
+                          &uniforms, sizeof(uniforms));
+
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, lm->cull_pipeline);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, lm->cull_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (lm->froxel_count + LIGHT_MANAGER_WORKGROUP_SIZE - 1)
+      / LIGHT_MANAGER_WORKGROUP_SIZE,
+    1, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+WGPUBindGroupLayout
+wgpu_light_manager_get_bind_group_layout(wgpu_light_manager_t* lm)
+{
+  return lm->bind_group_layout;
+}
+
+WGPUBindGroup wgpu_light_manager_get_bind_group(wgpu_light_manager_t* lm)
+{
+  return lm->bind_group;
+}
@@ -0,0 +1,176 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Light Manager
+ *
+ * Keeps the point, spot and directional lights of a scene in a storage buffer
+ * and culls them into a froxel grid for forward+ (clustered) shading: the view
+ * frustum is divided into screen space tiles and exponentially distributed
+ * depth slices, a compute pass tests every light against the bounds of every
+ * froxel and writes the indices of the overlapping lights into a fixed size
+ * list per froxel. Fragment shaders then only loop over the lights of their
+ * froxel, which bounds the per pixel cost by max_lights_per_froxel no matter
+ * how many lights the scene holds.
+ * -------------------------------------------------------------------------- */
+
+#define WGPU_LIGHT_MANAGER_INVALID_LIGHT 0xFFFFFFFFu
+
+typedef enum wgpu_light_type_t {
+  WGPU_LIGHT_TYPE_POINT       = 0,
+  WGPU_LIGHT_TYPE_SPOT        = 1,
+  WGPU_LIGHT_TYPE_DIRECTIONAL = 2,
+} wgpu_light_type_t;
+
+typedef struct wgpu_light_t {
+  wgpu_light_type_t type;
+  vec3 position;  /* world space, point and spot lights */
+  vec3 direction; /* world space, spot and directional lights */
+  vec3 color;
+  float intensity;
+  float range;            /* radius of influence, point and spot lights */
+  float inner_cone_angle; /* half angles in radians, spot lights */
+  float outer_cone_angle;
+} wgpu_light_t;
+
+typedef struct wgpu_light_manager_desc_t {
+  uint32_t max_lights;            /* defaults to 1024 */
+  uint32_t grid_size[3];          /* froxels in x, y and z, 16x9x24 default */
+  uint32_t max_lights_per_froxel; /* defaults to 64 */
+} wgpu_light_manager_desc_t;
+
+typedef struct wgpu_light_manager wgpu_light_manager_t;
+
+/* Light manager construction / destruction */
+wgpu_light_manager_t*
+wgpu_light_manager_create(wgpu_context_t* wgpu_context,
+                          const wgpu_light_manager_desc_t* desc);
+void wgpu_light_manager_destroy(wgpu_light_manager_t* light_manager);
+
+/**
+ * @brief Adds a light to the scene.
+ * @return stable id of the light, WGPU_LIGHT_MANAGER_INVALID_LIGHT if the
+ * manager is full
+ */
+uint32_t wgpu_light_manager_add_light(wgpu_light_manager_t* light_manager,
+                                      const wgpu_light_t* light);
+/* Updating or removing an invalid or removed light id has no effect */
+void wgpu_light_manager_update_light(wgpu_light_manager_t* light_manager,
+                                     uint32_t light_id,
+                                     const wgpu_light_t* light);
+void wgpu_light_manager_remove_light(wgpu_light_manager_t* light_manager,
+                                     uint32_t light_id);
+void wgpu_light_manager_clear(wgpu_light_manager_t* light_manager);
+
+uint32_t
+wgpu_light_manager_get_light_count(wgpu_light_manager_t* light_manager);
+uint32_t wgpu_light_manager_get_max_lights(wgpu_light_manager_t* light_manager);
+
+/**
+ * @brief Uploads the changed lights and records the froxel culling compute
+ * pass into the given command encoder. Must be called every frame the camera
+ * or the lights change, before the render pass shading against the lights.
+ * The froxel grid covers the surface of the wgpu context.
+ * @param z_near near plane distance of the projection
+ * @param z_far far plane distance, the last depth slice ends here
+ */
+void wgpu_light_manager_cull(wgpu_light_manager_t* light_manager,
+                             WGPUCommandEncoder cmd_enc, mat4 view,
+                             mat4 projection, float z_near, float z_far);
+
+/* Bind group with the lights and the froxel grid for fragment shaders, see
+ * WGPU_LIGHT_MANAGER_WGSL */
+WGPUBindGroupLayout
+wgpu_light_manager_get_bind_group_layout(wgpu_light_manager_t* light_manager);
+WGPUBindGroup
+wgpu_light_manager_get_bind_group(wgpu_light_manager_t* light_manager);
+
+/*
+ * WGSL declarations of the light manager bind group at the given group index,
+ * to be prepended to the shader code. A fragment shader looks up its froxel
+ * once and loops over the lights of the froxel:
+ *
+ *   let froxel = lightManagerFroxel(in.position.xy, in.worldPos);
+ *   for (var i = 0u; i < froxel.y; i++) {
+ *     let s = lightManagerSampleLight(lightManagerGetLight(froxel, i),
+ *                                     in.worldPos);
+ *     // s.direction: surface to light, s.radiance: attenuated light color
+ *   }
+ */
+#define WGPU_LIGHT_MANAGER_WGSL(group)                                         \
+  "struct LightManagerLight {\n"                                               \
+  "  position : vec3<f32>,\n"                                                  \
+  "  range : f32,\n"                                                           \
+  "  direction : vec3<f32>,\n"                                                 \
+  "  lightType : u32,\n"                                                       \
+  "  color : vec3<f32>,\n"                                                     \
+  "  intensity : f32,\n"                                                       \
+  "  spotScale : f32,\n"                                                       \
+  "  spotOffset : f32,\n"                                                      \
+  "}\n"                                                                        \
+  "struct LightManagerUniforms {\n"                                            \
+  "  view : mat4x4<f32>,\n"                                                    \
+  "  inverseProjection : mat4x4<f32>,\n"                                       \
+  "  screenSize : vec2<f32>,\n"                                                \
+  "  zNear : f32,\n"                                                           \
+  "  zFar : f32,\n"                                                            \
+  "  gridSize : vec3<u32>,\n"                                                  \
+  "  lightCount : u32,\n"                                                      \
+  "  maxLightsPerFroxel : u32,\n"                                              \
+  "  sliceScale : f32,\n"                                                      \
+  "  sliceBias : f32,\n"                                                       \
+  "}\n"                                                                        \
+  "struct LightManagerSample {\n"                                              \
+  "  direction : vec3<f32>,\n"                                                 \
+  "  radiance : vec3<f32>,\n"                                                  \
+  "}\n"                                                                        \
+  "@group(" #group ") @binding(0) var<uniform> lightManager : "                \
+  "LightManagerUniforms;\n"                                                    \
+  "@group(" #group ") @binding(1) var<storage, read> lightManagerLights : "    \
+  "array<LightManagerLight>;\n"                                                \
+  "@group(" #group ") @binding(2) var<storage, read> "                         \
+  "lightManagerFroxelCounts : array<u32>;\n"                                   \
+  "@group(" #group ") @binding(3) var<storage, read> "                         \
+  "lightManagerFroxelLights : array<u32>;\n"                                   \
+  "fn lightManagerFroxel(fragCoord : vec2<f32>, worldPos : vec3<f32>)\n"       \
+  "                      -> vec2<u32> {\n"                                     \
+  "  let grid = lightManager.gridSize;\n"                                      \
+  "  let viewPos = lightManager.view * vec4<f32>(worldPos, 1.0);\n"            \
+  "  let viewZ = max(-viewPos.z, lightManager.zNear);\n"                       \
+  "  let slice = clamp(log(viewZ) * lightManager.sliceScale\n"                 \
+  "                    - lightManager.sliceBias, 0.0, f32(grid.z - 1u));\n"    \
+  "  let tile = min(vec2<u32>(fragCoord / lightManager.screenSize\n"           \
+  "                           * vec2<f32>(grid.xy)), grid.xy - 1u);\n"         \
+  "  let index = tile.x + grid.x * (tile.y + grid.y * u32(slice));\n"          \
+  "  return vec2<u32>(index * lightManager.maxLightsPerFroxel,\n"              \
+  "                   lightManagerFroxelCounts[index]);\n"                     \
+  "}\n"                                                                        \
+  "fn lightManagerGetLight(froxel : vec2<u32>, i : u32)\n"                     \
+  "                        -> LightManagerLight {\n"                           \
+  "  return lightManagerLights[lightManagerFroxelLights[froxel.x + i]];\n"     \
+  "}\n"                                                                        \
+  "fn lightManagerSampleLight(light : LightManagerLight,\n"                    \
+  "                           worldPos : vec3<f32>) -> LightManagerSample {\n" \
+  "  let radiance = light.color * light.intensity;\n"                          \
+  "  if (light.lightType == 2u) {\n"                                           \
+  "    return LightManagerSample(-light.direction, radiance);\n"               \
+  "  }\n"                                                                      \
+  "  let toLight = light.position - worldPos;\n"                               \
+  "  let distanceSq = max(dot(toLight, toLight), 1e-4);\n"                     \
+  "  let direction = toLight * inverseSqrt(distanceSq);\n"                     \
+  "  let ratioSq = distanceSq / (light.range * light.range);\n"                \
+  "  let window = clamp(1.0 - ratioSq * ratioSq, 0.0, 1.0);\n"                 \
+  "  var attenuation = window * window / distanceSq;\n"                        \
+  "  if (light.lightType == 1u) {\n"                                           \
+  "    let cone = clamp(dot(light.direction, -direction) * light.spotScale\n"  \
+  "                     + light.spotOffset, 0.0, 1.0);\n"                      \
+  "    attenuation *= cone * cone;\n"                                          \
+  "  }\n"                                                                      \
+  "  return LightManagerSample(direction, radiance * attenuation);\n"          \
+  "}\n"
+
+#endif /* LIGHT_MANAGER_H */
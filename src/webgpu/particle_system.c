@@ -0,0 +1,1256 @@
+#include "particle_system.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "buffer.h"
+#include "readback.h"
+#include "shader.h"
+#include "wgsl_preprocessor.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Particle System
+ * -------------------------------------------------------------------------- */
+
+/* Must match the workgroup size of the compute shaders */
+#define PARTICLE_WORKGROUP_SIZE 64u
+
+/* Size of a particle in the storage buffer (see StoredParticle in the
+ * shader), with f32 and with f16 storage */
+#define PARTICLE_SIZE 32u
+#define PARTICLE_SIZE_F16 24u
+
+/* Slots of the counters buffer */
+#define COUNTER_DEAD 0u
+#define COUNTER_ALIVE 1u
+#define COUNTER_ALIVE_NEXT 2u
+#define COUNTER_EMIT 3u
+#define COUNTER_SORT_SIZE 4u
+#define COUNTER_COUNT 5u
+
+/* Offsets into the indirect arguments buffers (in u32) */
+#define INDIRECT_EMIT 0u
+#define INDIRECT_SIMULATE 3u
+#define INDIRECT_SORT_INIT 6u
+#define INDIRECT_SORT_STEP 9u
+#define INDIRECT_DRAW 12u
+#define INDIRECT_COUNT 16u
+
+/* Dynamic uniform buffer offset alignment of the sort step parameters */
+#define SORT_STEP_STRIDE 256u
+
+typedef enum particle_pipeline_t {
+  PARTICLE_PIPELINE_KICKOFF,
+  PARTICLE_PIPELINE_EMIT,
+  PARTICLE_PIPELINE_SIMULATE,
+  PARTICLE_PIPELINE_FINISH,
+  PARTICLE_PIPELINE_SORT_INIT,
+  PARTICLE_PIPELINE_SORT_STEP,
+  PARTICLE_PIPELINE_COUNT,
+} particle_pipeline_t;
+
+/* Shader permutation keys, bit i defines particle_shader_keys[i] */
+typedef enum particle_shader_key_t {
+  PARTICLE_SHADER_SUBGROUPS      = 1 << 0, /* subgroup compaction */
+  PARTICLE_SHADER_RENDER         = 1 << 1, /* render instead of compute */
+  PARTICLE_SHADER_HALF_PRECISION = 1 << 2, /* f16 particle storage */
+} particle_shader_key_t;
+
+static const char* particle_shader_keys[3] = {
+  "SUBGROUPS",      /* */
+  "RENDER",         /* */
+  "HALF_PRECISION", /* */
+};
+
+static const char* particle_pipeline_entries[PARTICLE_PIPELINE_COUNT] = {
+  "kickoff",  /* */
+  "emit",     /* */
+  "simulate", /* */
+  "finish",   /* */
+  "sortInit", /* */
+  "sortStep", /* */
+};
+
+/* Simulation parameters, must match SimParams in the shader */
+typedef struct particle_sim_params_t {
+  float emitter_position[3];
+  uint32_t emit_count;
+  float emitter_velocity[3];
+  float velocity_spread;
+  float gravity[3];
+  float delta_time;
+  float camera_position[3];
+  uint32_t seed;
+  float lifetime_min;
+  float lifetime_max;
+  float emitter_radius;
+  float drag;
+  uint32_t sort;
+  uint32_t padding[3];
+} particle_sim_params_t;
+
+/* Render parameters, must match RenderParams in the shader */
+typedef struct particle_render_params_t {
+  mat4 view_projection;
+  float camera_right[3];
+  float size;
+  float camera_up[3];
+  float padding;
+  vec4 color_begin;
+  vec4 color_end;
+} particle_render_params_t;
+
+struct wgpu_particle_system {
+  wgpu_context_t* wgpu_context;
+  uint32_t capacity;
+  uint32_t sort_capacity; /* capacity rounded up to a power of two */
+  bool sort;
+  bool half_precision; /* f16 particle storage and sort keys */
+  wgpu_particle_emitter_t emitter;
+  float emit_accumulator;
+  uint32_t burst_count;
+  uint32_t seed;
+  uint32_t parity; /* alive list holding the live particles */
+  uint32_t live_count;
+  bool live_count_pending;
+  /* Buffers */
+  wgpu_buffer_t particles;
+  wgpu_buffer_t counters;
+  wgpu_buffer_t dead_list;
+  wgpu_buffer_t alive_lists[2];
+  wgpu_buffer_t indirect;      /* written by the simulation */
+  wgpu_buffer_t indirect_args; /* copy of it, used for indirect commands */
+  wgpu_buffer_t sort_keys;
+  wgpu_buffer_t sim_params;
+  wgpu_buffer_t sort_steps;
+  wgpu_buffer_t render_params;
+  uint32_t sort_step_count;
+  /* Simulation */
+  WGPUBindGroupLayout sim_bind_group_layout;
+  WGPUBindGroupLayout sort_bind_group_layout;
+  WGPUPipelineLayout compute_pipeline_layout;
+  WGPUComputePipeline pipelines[PARTICLE_PIPELINE_COUNT];
+  WGPUBindGroup sim_bind_groups[2]; /* [i]: alive list i is current */
+  WGPUBindGroup sort_bind_group;
+  /* Rendering */
+  WGPURenderPipeline render_pipeline;
+  WGPUBindGroup render_bind_groups[2]; /* [i]: draws alive list i */
+};
+
+// clang-format off
+// Particle state while simulated / rendered, stored with f32 precision
+static const char* particle_storage_f32_wgsl = CODE(
+  struct Particle {
+    position : vec3f,
+    age : f32,
+    velocity : vec3f,
+    lifetime : f32,
+  }
+
+  alias StoredParticle = Particle;
+  alias SortKey = f32;
+
+  fn unpackParticle(stored : StoredParticle) -> Particle {
+    return stored;
+  }
+
+  fn packParticle(particle : Particle) -> StoredParticle {
+    return particle;
+  }
+
+  fn toSortKey(distanceSquared : f32) -> SortKey {
+    return distanceSquared;
+  }
+);
+
+// Particle state stored in 24 instead of 32 bytes, with f16 sort keys. The
+// position and age keep f32 precision: f16 increments of a few milliseconds
+// stall once the values grow. Squared distances saturate at the f16 maximum,
+// i.e. particles beyond 256 units are not ordered among each other.
+static const char* particle_storage_f16_wgsl = CODE(
+  struct Particle {
+    position : vec3f,
+    age : f32,
+    velocity : vec3f,
+    lifetime : f32,
+  }
+
+  struct StoredParticle {
+    position : array<f32, 3>,
+    age : f32,
+    velocity : vec3<f16>,
+    lifetime : f16,
+  }
+
+  alias SortKey = f16;
+
+  fn unpackParticle(stored : StoredParticle) -> Particle {
+    return Particle(
+      vec3f(stored.position[0], stored.position[1], stored.position[2]),
+      stored.age, vec3f(stored.velocity), f32(stored.lifetime));
+  }
+
+  fn packParticle(particle : Particle) -> StoredParticle {
+    let position = particle.position;
+    return StoredParticle(array<f32, 3>(position.x, position.y, position.z),
+                          particle.age, vec3<f16>(particle.velocity),
+                          f16(particle.lifetime));
+  }
+
+  fn toSortKey(distanceSquared : f32) -> SortKey {
+    return SortKey(min(distanceSquared, 65504.0));
+  }
+);
+
+static const char* particle_compute_shader_wgsl = CODE(
+  struct SimParams {
+    emitterPosition : vec3f,
+    emitCount : u32,
+    emitterVelocity : vec3f,
+    velocitySpread : f32,
+    gravity : vec3f,
+    deltaTime : f32,
+    cameraPosition : vec3f,
+    seed : u32,
+    lifetimeMin : f32,
+    lifetimeMax : f32,
+    emitterRadius : f32,
+    drag : f32,
+    sort : u32,
+  }
+
+  struct SortStep {
+    k : u32,
+    j : u32,
+  }
+
+  const WORKGROUP_SIZE = 64u;
+
+  // Counter slots
+  const DEAD = 0u;
+  const ALIVE = 1u;
+  const ALIVE_NEXT = 2u;
+  const EMIT = 3u;
+  const SORT_SIZE = 4u;
+
+  // Indirect argument offsets
+  const INDIRECT_EMIT = 0u;
+  const INDIRECT_SIMULATE = 3u;
+  const INDIRECT_SORT_INIT = 6u;
+  const INDIRECT_SORT_STEP = 9u;
+  const INDIRECT_DRAW = 12u;
+
+  @group(0) @binding(0) var<uniform> params : SimParams;
+  @group(0) @binding(1) var<storage, read_write> particles : array<StoredParticle>;
+  @group(0) @binding(2) var<storage, read_write> counters : array<atomic<u32>>;
+  @group(0) @binding(3) var<storage, read_write> deadList : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> aliveList : array<u32>;
+  @group(0) @binding(5) var<storage, read_write> aliveListNext : array<u32>;
+  @group(0) @binding(6) var<storage, read_write> indirect : array<u32>;
+  @group(0) @binding(7) var<storage, read_write> sortKeys : array<SortKey>;
+  @group(1) @binding(0) var<uniform> sortParams : SortStep;
+
+  fn pcgHash(input : u32) -> u32 {
+    let state = input * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+  }
+
+  fn random(state : ptr<function, u32>) -> f32 {
+    *state = pcgHash(*state);
+    return f32(*state) / 4294967295.0;
+  }
+
+  fn setDispatch(offset : u32, threads : u32) {
+    indirect[offset + 0u] = (threads + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE;
+    indirect[offset + 1u] = 1u;
+    indirect[offset + 2u] = 1u;
+  }
+
+  // Sizes the emission and simulation dispatches
+  @compute @workgroup_size(1)
+  fn kickoff() {
+    let emitCount = min(params.emitCount, atomicLoad(&counters[DEAD]));
+    atomicStore(&counters[EMIT], emitCount);
+    atomicStore(&counters[ALIVE_NEXT], 0u);
+    setDispatch(INDIRECT_EMIT, emitCount);
+    setDispatch(INDIRECT_SIMULATE, atomicLoad(&counters[ALIVE]) + emitCount);
+  }
+
+  // New particle of emission invocation id
+  fn newParticle(id : u32) -> Particle {
+    var rng = pcgHash(params.seed ^ pcgHash(id));
+    let direction = normalize(vec3f(random(&rng), random(&rng), random(&rng)) * 2.0 - 1.0 + 1e-4);
+    let spread = (vec3f(random(&rng), random(&rng), random(&rng)) * 2.0 - 1.0) * params.velocitySpread;
+    var particle : Particle;
+    particle.position = params.emitterPosition + direction * params.emitterRadius * random(&rng);
+    particle.velocity = params.emitterVelocity + spread;
+    particle.age = 0.0;
+    particle.lifetime = mix(params.lifetimeMin, params.lifetimeMax, random(&rng));
+    return particle;
+  }
+
+  // Advances the particle, returns false if it expired
+  fn updateParticle(particle : ptr<function, Particle>) -> bool {
+    (*particle).age += params.deltaTime;
+    if ((*particle).age >= (*particle).lifetime) {
+      return false;
+    }
+
+    (*particle).velocity += params.gravity * params.deltaTime;
+    (*particle).velocity *= max(1.0 - params.drag * params.deltaTime, 0.0);
+    (*particle).position += (*particle).velocity * params.deltaTime;
+    return true;
+  }
+
+  // Sizes the draw and sort for the live particles
+  @compute @workgroup_size(1)
+  fn finish() {
+    let aliveCount = atomicLoad(&counters[ALIVE_NEXT]);
+    atomicStore(&counters[ALIVE], aliveCount);
+    indirect[INDIRECT_DRAW + 0u] = 6u;
+    indirect[INDIRECT_DRAW + 1u] = aliveCount;
+    indirect[INDIRECT_DRAW + 2u] = 0u;
+    indirect[INDIRECT_DRAW + 3u] = 0u;
+
+    // The bitonic sort operates on the next power of two
+    var sortSize = 0u;
+    if (params.sort != 0u && aliveCount > 1u) {
+      sortSize = 1u << (32u - countLeadingZeros(aliveCount - 1u));
+    }
+    atomicStore(&counters[SORT_SIZE], sortSize);
+    setDispatch(INDIRECT_SORT_INIT, sortSize);
+    setDispatch(INDIRECT_SORT_STEP, sortSize / 2u);
+  }
+);
+
+// Bitonic sort of the alive list by camera distance, appended to the
+// simulation source (split to stay below the C99 string length limit)
+static const char* particle_sort_shader_wgsl = CODE(
+  // Sort keys are the squared camera distances, padding sorts to the end
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn sortInit(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= atomicLoad(&counters[SORT_SIZE])) {
+      return;
+    }
+
+    if (id.x < atomicLoad(&counters[ALIVE])) {
+      let particle = unpackParticle(particles[aliveListNext[id.x]]);
+      let offset = particle.position - params.cameraPosition;
+      sortKeys[id.x] = toSortKey(dot(offset, offset));
+    }
+    else {
+      sortKeys[id.x] = SortKey(-1.0);
+      aliveListNext[id.x] = 0u;
+    }
+  }
+
+  // One step of a bitonic sort, ordering far to near
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn sortStep(@builtin(global_invocation_id) id : vec3u) {
+    let sortSize = atomicLoad(&counters[SORT_SIZE]);
+    if (sortParams.k > sortSize || id.x >= sortSize / 2u) {
+      return;
+    }
+
+    let j = sortParams.j;
+    let i = 2u * j * (id.x / j) + id.x % j;
+    let l = i + j;
+    let descending = (i & sortParams.k) == 0u;
+    let keyI = sortKeys[i];
+    let keyL = sortKeys[l];
+    if ((keyI < keyL) == descending) {
+      sortKeys[i] = keyL;
+      sortKeys[l] = keyI;
+      let index = aliveListNext[i];
+      aliveListNext[i] = aliveListNext[l];
+      aliveListNext[l] = index;
+    }
+  }
+);
+
+// Emission and simulation with one atomic operation per appended particle
+static const char* particle_append_atomics_wgsl = CODE(
+  // Takes free slots from the dead list and appends them to the alive list
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn emit(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= atomicLoad(&counters[EMIT])) {
+      return;
+    }
+
+    let slot = atomicSub(&counters[DEAD], 1u) - 1u;
+    let index = deadList[slot];
+    particles[index] = packParticle(newParticle(id.x));
+    aliveList[atomicAdd(&counters[ALIVE], 1u)] = index;
+  }
+
+  // Updates the alive particles, survivors are compacted into the next list
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn simulate(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= atomicLoad(&counters[ALIVE])) {
+      return;
+    }
+
+    let index = aliveList[id.x];
+    var particle = unpackParticle(particles[index]);
+    if (!updateParticle(&particle)) {
+      deadList[atomicAdd(&counters[DEAD], 1u)] = index;
+      return;
+    }
+
+    particles[index] = packParticle(particle);
+    aliveListNext[atomicAdd(&counters[ALIVE_NEXT], 1u)] = index;
+  }
+);
+
+// Emission and simulation with one atomic operation per subgroup: the lanes
+// appending to a list are counted with ballots, the first lane reserves the
+// slots of the subgroup and broadcasts the base, every lane adds its rank.
+// Requires full subgroups, so that lane 0 is always active.
+static const char* particle_append_subgroups_wgsl = CODE(
+  // Lanes for which active is true, the ballots of both branches are combined
+  // so that every lane gets the mask
+  fn subgroupMask(active : bool) -> vec4u {
+    let activeLanes = subgroupBallot();
+    var mask : vec4u;
+    if (active) {
+      mask = subgroupBallot();
+    }
+    else {
+      mask = activeLanes & ~subgroupBallot();
+    }
+    return mask;
+  }
+
+  // Number of lanes of the mask below the lane
+  fn subgroupRank(mask : vec4u, lane : u32) -> u32 {
+    var rank = 0u;
+    for (var i = 0u; i < 4u; i++) {
+      if (i < lane / 32u) {
+        rank += countOneBits(mask[i]);
+      }
+      else if (i == lane / 32u) {
+        rank += countOneBits(mask[i] & ((1u << (lane % 32u)) - 1u));
+      }
+    }
+    return rank;
+  }
+
+  fn subgroupCount(mask : vec4u) -> u32 {
+    let counts = countOneBits(mask);
+    return counts.x + counts.y + counts.z + counts.w;
+  }
+
+  // atomicAdd(&counters[counter], 1u) of every active lane
+  fn subgroupAtomicInc(counter : u32, active : bool, lane : u32) -> u32 {
+    let mask = subgroupMask(active);
+    var base = 0u;
+    if (lane == 0u) {
+      base = atomicAdd(&counters[counter], subgroupCount(mask));
+    }
+    return subgroupBroadcast(base, 0u) + subgroupRank(mask, lane);
+  }
+
+  // atomicSub(&counters[counter], 1u) of every active lane
+  fn subgroupAtomicDec(counter : u32, active : bool, lane : u32) -> u32 {
+    let mask = subgroupMask(active);
+    var base = 0u;
+    if (lane == 0u) {
+      base = atomicSub(&counters[counter], subgroupCount(mask));
+    }
+    return subgroupBroadcast(base, 0u) - subgroupRank(mask, lane);
+  }
+
+  // Takes free slots from the dead list and appends them to the alive list,
+  // all lanes take part in the subgroup operations
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn emit(@builtin(global_invocation_id) id : vec3u,
+          @builtin(subgroup_invocation_id) lane : u32) {
+    let active = id.x < atomicLoad(&counters[EMIT]);
+    let slot = subgroupAtomicDec(DEAD, active, lane) - 1u;
+    let next = subgroupAtomicInc(ALIVE, active, lane);
+    if (active) {
+      let index = deadList[slot];
+      particles[index] = packParticle(newParticle(id.x));
+      aliveList[next] = index;
+    }
+  }
+
+  // Updates the alive particles, survivors are compacted into the next list
+  @compute @workgroup_size(WORKGROUP_SIZE)
+  fn simulate(@builtin(global_invocation_id) id : vec3u,
+              @builtin(subgroup_invocation_id) lane : u32) {
+    let active = id.x < atomicLoad(&counters[ALIVE]);
+    var index = 0u;
+    var alive = false;
+    if (active) {
+      index = aliveList[id.x];
+      var particle = unpackParticle(particles[index]);
+      alive = updateParticle(&particle);
+      if (alive) {
+        particles[index] = packParticle(particle);
+      }
+    }
+    let dead = subgroupAtomicInc(DEAD, active && !alive, lane);
+    let next = subgroupAtomicInc(ALIVE_NEXT, alive, lane);
+    if (active && !alive) {
+      deadList[dead] = index;
+    }
+    if (alive) {
+      aliveListNext[next] = index;
+    }
+  }
+);
+
+static const char* particle_render_shader_wgsl = CODE(
+  struct RenderParams {
+    viewProjection : mat4x4f,
+    cameraRight : vec3f,
+    size : f32,
+    cameraUp : vec3f,
+    colorBegin : vec4f,
+    colorEnd : vec4f,
+  }
+
+  @group(0) @binding(0) var<uniform> params : RenderParams;
+  @group(0) @binding(1) var<storage, read> particles : array<StoredParticle>;
+  @group(0) @binding(2) var<storage, read> aliveList : array<u32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) uv : vec2f,
+    @location(1) color : vec4f,
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32,
+             @builtin(instance_index) instanceIndex : u32) -> VertexOutput {
+    var corners = array<vec2f, 6>(
+      vec2f(-1.0, -1.0), vec2f(1.0, -1.0), vec2f(-1.0, 1.0),
+      vec2f(-1.0, 1.0), vec2f(1.0, -1.0), vec2f(1.0, 1.0)
+    );
+    let corner = corners[vertexIndex];
+    let particle = unpackParticle(particles[aliveList[instanceIndex]]);
+    let position = particle.position
+                   + (params.cameraRight * corner.x + params.cameraUp * corner.y) * params.size;
+
+    var output : VertexOutput;
+    output.position = params.viewProjection * vec4f(position, 1.0);
+    output.uv = corner;
+    output.color = mix(params.colorBegin, params.colorEnd, particle.age / particle.lifetime);
+    return output;
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4f {
+    let alpha = input.color.a * smoothstep(1.0, 0.0, length(input.uv));
+    // Premultiplied alpha, blended additively or with "over"
+    return vec4f(input.color.rgb * alpha, alpha);
+  }
+);
+// clang-format on
+
+static uint32_t next_power_of_two(uint32_t value)
+{
+  uint32_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+/* Permutation key bits selected by the configuration of the system */
+static uint64_t
+particle_system_get_shader_key(const wgpu_particle_system_t* ps)
+{
+  return ps->half_precision ? PARTICLE_SHADER_HALF_PRECISION : 0;
+}
+
+static void particle_system_prepare_buffers(wgpu_particle_system_t* ps)
+{
+  wgpu_context_t* wgpu_context = ps->wgpu_context;
+
+  ps->particles = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Particles buffer",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = ps->capacity
+                            * (ps->half_precision ? PARTICLE_SIZE_F16 :
+                                                    PARTICLE_SIZE),
+                  });
+
+  /* All particle slots start on the dead list */
+  uint32_t* dead_list = (uint32_t*)malloc(ps->capacity * sizeof(uint32_t));
+  for (uint32_t i = 0; i < ps->capacity; ++i) {
+    dead_list[i] = ps->capacity - 1 - i;
+  }
+  ps->dead_list = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Dead list buffer",
+                    .usage = WGPUBufferUsage_Storage,
+                    .size  = ps->capacity * sizeof(uint32_t),
+                    .initial.data = dead_list,
+                  });
+  free(dead_list);
+
+  const uint32_t counters[COUNTER_COUNT] = {
+    [COUNTER_DEAD] = ps->capacity,
+  };
+  ps->counters = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Counters buffer",
+                    .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc,
+                    .size  = sizeof(counters),
+                    .initial.data = counters,
+                  });
+
+  /* Alive lists are padded to a power of two for sorting */
+  for (uint32_t i = 0; i < 2; ++i) {
+    ps->alive_lists[i] = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .label = "Particle system - Alive list buffer",
+                      .usage = WGPUBufferUsage_Storage,
+                      .size  = ps->sort_capacity * sizeof(uint32_t),
+                    });
+  }
+  /* f16 sort keys halve the traffic of the bitonic sort, the buffer size stays
+   * a multiple of 4 bytes */
+  const uint32_t sort_key_size
+    = ps->half_precision ? sizeof(uint16_t) : sizeof(float);
+  ps->sort_keys = wgpu_create_buffer(
+    wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "Particle system - Sort keys buffer",
+      .usage = WGPUBufferUsage_Storage,
+      .size  = MAX((ps->sort ? ps->sort_capacity : 1) * sort_key_size,
+                   sizeof(float)),
+    });
+
+  const uint32_t indirect[INDIRECT_COUNT] = {
+    [INDIRECT_EMIT + 1] = 1,      [INDIRECT_EMIT + 2] = 1,
+    [INDIRECT_SIMULATE + 1] = 1,  [INDIRECT_SIMULATE + 2] = 1,
+    [INDIRECT_SORT_INIT + 1] = 1, [INDIRECT_SORT_INIT + 2] = 1,
+    [INDIRECT_SORT_STEP + 1] = 1, [INDIRECT_SORT_STEP + 2] = 1,
+    [INDIRECT_DRAW] = 6,
+  };
+  ps->indirect = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Indirect buffer",
+                    .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc,
+                    .size  = sizeof(indirect),
+                    .initial.data = indirect,
+                  });
+  /* The indirect buffer is bound as storage in the simulation bind group, a
+   * buffer cannot be both writable storage and indirect arguments in the same
+   * dispatch, so the arguments are copied between the compute passes */
+  ps->indirect_args = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Indirect arguments buffer",
+                    .usage = WGPUBufferUsage_Indirect | WGPUBufferUsage_CopyDst,
+                    .size  = sizeof(indirect),
+                    .initial.data = indirect,
+                  });
+
+  ps->sim_params = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Simulation uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(particle_sim_params_t),
+                  });
+  ps->render_params = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Render uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(particle_render_params_t),
+                  });
+
+  /* Parameters (k, j) of every bitonic sort step for the full capacity, steps
+   * beyond the current sort size are skipped on the GPU */
+  ps->sort_step_count = 0;
+  for (uint32_t k = 2; k <= ps->sort_capacity; k <<= 1) {
+    for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+      ++ps->sort_step_count;
+    }
+  }
+  const uint32_t step_count = ps->sort ? MAX(ps->sort_step_count, 1u) : 1u;
+  uint8_t* sort_steps       = (uint8_t*)calloc(step_count, SORT_STEP_STRIDE);
+  uint32_t step             = 0;
+  for (uint32_t k = 2; ps->sort && k <= ps->sort_capacity; k <<= 1) {
+    for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+      uint32_t* params = (uint32_t*)(sort_steps + step++ * SORT_STEP_STRIDE);
+      params[0]        = k;
+      params[1]        = j;
+    }
+  }
+  ps->sort_steps = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Particle system - Sort steps buffer",
+                    .usage = WGPUBufferUsage_Uniform,
+                    .size  = step_count * SORT_STEP_STRIDE,
+                    .initial.data = sort_steps,
+                  });
+  free(sort_steps);
+}
+
+static void
+particle_system_prepare_compute(wgpu_particle_system_t* ps,
+                                wgpu_shader_permutations_t* shaders)
+{
+  wgpu_context_t* wgpu_context = ps->wgpu_context;
+  WGPUDevice device            = wgpu_context->device;
+
+  /* Simulation bind group layout: uniform + 7 storage buffers */
+  WGPUBindGroupLayoutEntry sim_bgl_entries[8] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(particle_sim_params_t),
+      },
+    },
+  };
+  for (uint32_t i = 1; i < (uint32_t)ARRAY_SIZE(sim_bgl_entries); ++i) {
+    sim_bgl_entries[i] = (WGPUBindGroupLayoutEntry) {
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_Storage,
+      },
+    };
+  }
+  ps->sim_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Particle system - Simulation bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(sim_bgl_entries),
+              .entries    = sim_bgl_entries,
+            });
+  ASSERT(ps->sim_bind_group_layout != NULL);
+
+  /* Sort step parameters with dynamic offset */
+  WGPUBindGroupLayoutEntry sort_bgl_entry = {
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Compute,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type             = WGPUBufferBindingType_Uniform,
+      .hasDynamicOffset = true,
+      .minBindingSize   = 2 * sizeof(uint32_t),
+    },
+  };
+  ps->sort_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Particle system - Sort bind group layout",
+              .entryCount = 1,
+              .entries    = &sort_bgl_entry,
+            });
+  ASSERT(ps->sort_bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts[2]
+    = {ps->sim_bind_group_layout, ps->sort_bind_group_layout};
+  ps->compute_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label = "Particle system - Compute pipeline layout",
+              .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+              .bindGroupLayouts     = bind_group_layouts,
+            });
+  ASSERT(ps->compute_pipeline_layout != NULL);
+
+  /* The subgroup variant of emission and simulation requires full subgroups,
+   * i.e. a workgroup size that is a multiple of the subgroup size */
+  const bool use_subgroups
+    = wgpu_has_feature(wgpu_context,
+                       WGPUFeatureName_ChromiumExperimentalSubgroups)
+      && wgpu_context->subgroups.max_size > 0
+      && PARTICLE_WORKGROUP_SIZE % wgpu_context->subgroups.max_size == 0;
+  log_debug("Particle system: %s compaction",
+            use_subgroups ? "subgroup" : "atomic");
+
+  /* All compute entry points share one shader module */
+  WGPUShaderModule shader_module = wgpu_shader_permutations_get_module(
+    shaders, particle_system_get_shader_key(ps)
+               | (use_subgroups ? PARTICLE_SHADER_SUBGROUPS : 0));
+  ASSERT(shader_module != NULL);
+  WGPUDawnComputePipelineFullSubgroups full_subgroups = {
+    .chain.sType           = WGPUSType_DawnComputePipelineFullSubgroups,
+    .requiresFullSubgroups = true,
+  };
+  for (uint32_t i = 0; i < PARTICLE_PIPELINE_COUNT; ++i) {
+    const bool subgroup_pipeline
+      = use_subgroups
+        && (i == PARTICLE_PIPELINE_EMIT || i == PARTICLE_PIPELINE_SIMULATE);
+    ps->pipelines[i] = wgpuDeviceCreateComputePipeline(
+      device, &(WGPUComputePipelineDescriptor){
+                .nextInChain = subgroup_pipeline ? &full_subgroups.chain : NULL,
+                .label       = "Particle system - Compute pipeline",
+                .layout      = ps->compute_pipeline_layout,
+                .compute     = {
+                  .module     = shader_module,
+                  .entryPoint = particle_pipeline_entries[i],
+                },
+              });
+    ASSERT(ps->pipelines[i] != NULL);
+  }
+
+  /* Simulation bind groups, the current and next alive lists alternate */
+  for (uint32_t i = 0; i < 2; ++i) {
+    const wgpu_buffer_t* buffers[8] = {
+      &ps->sim_params,         &ps->particles, &ps->counters,
+      &ps->dead_list,          &ps->alive_lists[i],
+      &ps->alive_lists[1 - i], &ps->indirect,  &ps->sort_keys,
+    };
+    WGPUBindGroupEntry bg_entries[8] = {0};
+    for (uint32_t b = 0; b < (uint32_t)ARRAY_SIZE(bg_entries); ++b) {
+      bg_entries[b] = (WGPUBindGroupEntry){
+        .binding = b,
+        .buffer  = buffers[b]->buffer,
+        .offset  = 0,
+        .size    = buffers[b]->size,
+      };
+    }
+    ps->sim_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      device, &(WGPUBindGroupDescriptor){
+                .label      = "Particle system - Simulation bind group",
+                .layout     = ps->sim_bind_group_layout,
+                .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                .entries    = bg_entries,
+              });
+    ASSERT(ps->sim_bind_groups[i] != NULL);
+  }
+
+  WGPUBindGroupEntry sort_bg_entry = {
+    .binding = 0,
+    .buffer  = ps->sort_steps.buffer,
+    .offset  = 0,
+    .size    = 2 * sizeof(uint32_t),
+  };
+  ps->sort_bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Particle system - Sort bind group",
+              .layout     = ps->sort_bind_group_layout,
+              .entryCount = 1,
+              .entries    = &sort_bg_entry,
+            });
+  ASSERT(ps->sort_bind_group != NULL);
+}
+
+static void
+particle_system_prepare_render(wgpu_particle_system_t* ps,
+                               const wgpu_particle_system_desc_t* desc,
+                               wgpu_shader_permutations_t* shaders)
+{
+  wgpu_context_t* wgpu_context = ps->wgpu_context;
+
+  /* Premultiplied alpha: "over" for sorted particles, additive otherwise */
+  WGPUBlendState blend_state = {
+    .color = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = ps->sort ? WGPUBlendFactor_OneMinusSrcAlpha :
+                              WGPUBlendFactor_One,
+    },
+    .alpha = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+    },
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = desc->color_format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  /* Depth test against the scene without writing depth */
+  WGPUDepthStencilState depth_stencil_state = {0};
+  if (desc->depth_format != WGPUTextureFormat_Undefined) {
+    depth_stencil_state
+      = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+        .format              = desc->depth_format,
+        .depth_write_enabled = false,
+      });
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Less;
+  }
+
+  WGPUShaderModule shader_module = wgpu_shader_permutations_get_module(
+    shaders, particle_system_get_shader_key(ps) | PARTICLE_SHADER_RENDER);
+  ASSERT(shader_module != NULL);
+  WGPUMultisampleState multisample_state
+    = wgpu_create_multisample_state_descriptor(
+      &(create_multisample_state_desc_t){
+        .sample_count = 1,
+      });
+
+  ps->render_pipeline = wgpuDeviceCreateRenderPipeline(
+    wgpu_context->device,
+    &(WGPURenderPipelineDescriptor){
+      .label     = "Particle system - Render pipeline",
+      .primitive = {
+        .topology = WGPUPrimitiveTopology_TriangleList,
+        .cullMode = WGPUCullMode_None,
+      },
+      .vertex = {
+        .module     = shader_module,
+        .entryPoint = "vs_main",
+      },
+      .fragment = &(WGPUFragmentState){
+        .module      = shader_module,
+        .entryPoint  = "fs_main",
+        .targetCount = 1,
+        .targets     = &color_target_state,
+      },
+      .depthStencil
+      = desc->depth_format != WGPUTextureFormat_Undefined ?
+          &depth_stencil_state :
+          NULL,
+      .multisample = multisample_state,
+    });
+  ASSERT(ps->render_pipeline != NULL);
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPUBindGroupEntry bg_entries[3] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .buffer  = ps->render_params.buffer,
+        .size    = ps->render_params.size,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding = 1,
+        .buffer  = ps->particles.buffer,
+        .size    = ps->particles.size,
+      },
+      [2] = (WGPUBindGroupEntry) {
+        .binding = 2,
+        .buffer  = ps->alive_lists[i].buffer,
+        .size    = ps->alive_lists[i].size,
+      },
+    };
+    ps->render_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .label = "Particle system - Render bind group",
+        .layout
+        = wgpuRenderPipelineGetBindGroupLayout(ps->render_pipeline, 0),
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(ps->render_bind_groups[i] != NULL);
+  }
+}
+
+wgpu_particle_system_t*
+wgpu_particle_system_create(wgpu_context_t* wgpu_context,
+                            const wgpu_particle_system_desc_t* desc)
+{
+  ASSERT(desc->capacity > 0);
+
+  wgpu_particle_system_t* ps
+    = (wgpu_particle_system_t*)calloc(1, sizeof(wgpu_particle_system_t));
+  ps->wgpu_context  = wgpu_context;
+  ps->capacity      = desc->capacity;
+  ps->sort_capacity = next_power_of_two(desc->capacity);
+  ps->sort          = desc->sort;
+  ps->half_precision
+    = desc->half_precision
+      && wgpu_has_feature(wgpu_context, WGPUFeatureName_ShaderF16);
+  ps->seed          = 0x9E3779B9u;
+  ps->emitter       = (wgpu_particle_emitter_t){
+    .velocity     = {0.0f, 1.0f, 0.0f},
+    .rate         = 1000.0f,
+    .lifetime_min = 1.0f,
+    .lifetime_max = 2.0f,
+    .size         = 0.05f,
+    .color_begin  = {1.0f, 1.0f, 1.0f, 1.0f},
+    .color_end    = {1.0f, 1.0f, 1.0f, 0.0f},
+  };
+
+  if (desc->half_precision && !ps->half_precision) {
+    log_warn("Particle system: ShaderF16 not supported, using f32 storage");
+  }
+
+  /* One source for all shader variants: the enable directives, the particle
+   * storage, then the render or the compute entry points */
+  const char* shader_sources[] = {
+    "#ifdef HALF_PRECISION",
+    "enable f16;",
+    "#endif",
+    "#ifdef SUBGROUPS",
+    "enable chromium_experimental_subgroups;",
+    "#endif",
+    "#ifdef HALF_PRECISION",
+    particle_storage_f16_wgsl,
+    "#else",
+    particle_storage_f32_wgsl,
+    "#endif",
+    "#ifdef RENDER",
+    particle_render_shader_wgsl,
+    "#else",
+    particle_compute_shader_wgsl,
+    particle_sort_shader_wgsl,
+    "#ifdef SUBGROUPS",
+    particle_append_subgroups_wgsl,
+    "#else",
+    particle_append_atomics_wgsl,
+    "#endif",
+    "#endif",
+  };
+  wgpu_shader_permutations_t* shaders = wgpu_shader_permutations_create(
+    wgpu_context, &(wgpu_shader_permutations_desc_t){
+                    .label  = "Particle system - Shader WGSL",
+                    .source = {
+                      .sources = {
+                        .count   = (uint32_t)ARRAY_SIZE(shader_sources),
+                        .entries = shader_sources,
+                      },
+                    },
+                    .keys      = particle_shader_keys,
+                    .key_count = (uint32_t)ARRAY_SIZE(particle_shader_keys),
+                  });
+
+  wgpu_create_readback(wgpu_context);
+  particle_system_prepare_buffers(ps);
+  particle_system_prepare_compute(ps, shaders);
+  particle_system_prepare_render(ps, desc, shaders);
+
+  /* The pipelines hold on to the shader modules */
+  wgpu_shader_permutations_destroy(shaders);
+
+  return ps;
+}
+
+void wgpu_particle_system_destroy(wgpu_particle_system_t* ps)
+{
+  if (ps == NULL) {
+    return;
+  }
+
+  /* A pending live count readback references the particle system */
+  if (ps->live_count_pending && ps->wgpu_context->readback != NULL) {
+    wgpu_readback_flush(ps->wgpu_context->readback);
+  }
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, ps->sim_bind_groups[i])
+    WGPU_RELEASE_RESOURCE(BindGroup, ps->render_bind_groups[i])
+    wgpu_destroy_buffer(&ps->alive_lists[i]);
+  }
+  WGPU_RELEASE_RESOURCE(BindGroup, ps->sort_bind_group)
+  for (uint32_t i = 0; i < PARTICLE_PIPELINE_COUNT; ++i) {
+    WGPU_RELEASE_RESOURCE(ComputePipeline, ps->pipelines[i])
+  }
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ps->render_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ps->compute_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->sim_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->sort_bind_group_layout)
+  wgpu_destroy_buffer(&ps->particles);
+  wgpu_destroy_buffer(&ps->counters);
+  wgpu_destroy_buffer(&ps->dead_list);
+  wgpu_destroy_buffer(&ps->indirect);
+  wgpu_destroy_buffer(&ps->indirect_args);
+  wgpu_destroy_buffer(&ps->sort_keys);
+  wgpu_destroy_buffer(&ps->sim_params);
+  wgpu_destroy_buffer(&ps->sort_steps);
+  wgpu_destroy_buffer(&ps->render_params);
+  free(ps);
+}
+
+void wgpu_particle_system_set_emitter(wgpu_particle_system_t* ps,
+                                      const wgpu_particle_emitter_t* emitter)
+{
+  ps->emitter = *emitter;
+}
+
+void wgpu_particle_system_burst(wgpu_particle_system_t* ps, uint32_t count)
+{
+  ps->burst_count += count;
+}
+
+static void live_count_readback_cb(const wgpu_readback_result_t* result,
+                                   void* user_data)
+{
+  wgpu_particle_system_t* ps = (wgpu_particle_system_t*)user_data;
+  ps->live_count_pending     = false;
+  if (result->status == WGPU_READBACK_STATUS_SUCCESS
+      && result->size >= sizeof(uint32_t)) {
+    memcpy(&ps->live_count, result->data, sizeof(uint32_t));
+  }
+}
+
+static uint32_t xorshift32(uint32_t* state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* Compute pass with the simulation and sort bind groups of the frame */
+static WGPUComputePassEncoder
+particle_system_begin_compute_pass(wgpu_particle_system_t* ps,
+                                   WGPUCommandEncoder cmd_enc)
+{
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  const uint32_t zero_offset = 0;
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0,
+                                     ps->sim_bind_groups[ps->parity], 0, NULL);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, ps->sort_bind_group, 1,
+                                     &zero_offset);
+  return cpass_enc;
+}
+
+/* Copies the arguments [begin, end) written by the simulation to the buffer
+ * used by the indirect commands */
+static void particle_system_copy_indirect_args(wgpu_particle_system_t* ps,
+                                               WGPUCommandEncoder cmd_enc,
+                                               uint32_t begin, uint32_t end)
+{
+  wgpuCommandEncoderCopyBufferToBuffer(
+    cmd_enc, ps->indirect.buffer, begin * sizeof(uint32_t),
+    ps->indirect_args.buffer, begin * sizeof(uint32_t),
+    (end - begin) * sizeof(uint32_t));
+}
+
+void wgpu_particle_system_update(wgpu_particle_system_t* ps,
+                                 WGPUCommandEncoder cmd_enc, float delta_time,
+                                 vec3 camera_position)
+{
+  const wgpu_particle_emitter_t* emitter = &ps->emitter;
+
+  /* Number of particles to emit, fractions carry over to the next update */
+  ps->emit_accumulator += MAX(emitter->rate, 0.0f) * delta_time;
+  const float emit_count = floorf(ps->emit_accumulator);
+  ps->emit_accumulator -= emit_count;
+  const uint32_t count
+    = (uint32_t)MIN(emit_count + (float)ps->burst_count, (float)ps->capacity);
+  ps->burst_count = 0;
+
+  particle_sim_params_t params = {
+    .emitter_position = {emitter->position[0], emitter->position[1],
+                         emitter->position[2]},
+    .emit_count       = count,
+    .emitter_velocity = {emitter->velocity[0], emitter->velocity[1],
+                         emitter->velocity[2]},
+    .velocity_spread  = emitter->velocity_spread,
+    .gravity = {emitter->gravity[0], emitter->gravity[1], emitter->gravity[2]},
+    .delta_time      = delta_time,
+    .camera_position = {camera_position[0], camera_position[1],
+                        camera_position[2]},
+    .seed            = xorshift32(&ps->seed),
+    .lifetime_min    = emitter->lifetime_min,
+    .lifetime_max    = MAX(emitter->lifetime_min, emitter->lifetime_max),
+    .emitter_radius  = emitter->radius,
+    .drag            = emitter->drag,
+    .sort            = ps->sort ? 1 : 0,
+  };
+  wgpu_queue_write_buffer(ps->wgpu_context, ps->sim_params.buffer, 0, &params,
+                          sizeof(params));
+
+  /* Size the emission and simulation dispatches */
+  WGPUComputePassEncoder cpass_enc
+    = particle_system_begin_compute_pass(ps, cmd_enc);
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    ps->pipelines[PARTICLE_PIPELINE_KICKOFF]);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  particle_system_copy_indirect_args(ps, cmd_enc, INDIRECT_EMIT,
+                                     INDIRECT_SORT_INIT);
+
+  /* Emit into and simulate the current alive list, size the draw and sort */
+  cpass_enc = particle_system_begin_compute_pass(ps, cmd_enc);
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    ps->pipelines[PARTICLE_PIPELINE_EMIT]);
+  wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+    cpass_enc, ps->indirect_args.buffer, INDIRECT_EMIT * sizeof(uint32_t));
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    ps->pipelines[PARTICLE_PIPELINE_SIMULATE]);
+  wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+    cpass_enc, ps->indirect_args.buffer, INDIRECT_SIMULATE * sizeof(uint32_t));
+  wgpuComputePassEncoderSetPipeline(cpass_enc,
+                                    ps->pipelines[PARTICLE_PIPELINE_FINISH]);
+  wgpuComputePassEncoderDispatchWorkgroups(cpass_enc, 1, 1, 1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  particle_system_copy_indirect_args(ps, cmd_enc, INDIRECT_SORT_INIT,
+                                     INDIRECT_COUNT);
+
+  /* Sort the compacted alive list, steps beyond the live count are no-ops */
+  if (ps->sort) {
+    cpass_enc = particle_system_begin_compute_pass(ps, cmd_enc);
+    wgpuComputePassEncoderSetPipeline(
+      cpass_enc, ps->pipelines[PARTICLE_PIPELINE_SORT_INIT]);
+    wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+      cpass_enc, ps->indirect_args.buffer,
+      INDIRECT_SORT_INIT * sizeof(uint32_t));
+    wgpuComputePassEncoderSetPipeline(
+      cpass_enc, ps->pipelines[PARTICLE_PIPELINE_SORT_STEP]);
+    for (uint32_t i = 0; i < ps->sort_step_count; ++i) {
+      const uint32_t offset = i * SORT_STEP_STRIDE;
+      wgpuComputePassEncoderSetBindGroup(cpass_enc, 1, ps->sort_bind_group, 1,
+                                         &offset);
+      wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+        cpass_enc, ps->indirect_args.buffer,
+        INDIRECT_SORT_STEP * sizeof(uint32_t));
+    }
+    wgpuComputePassEncoderEnd(cpass_enc);
+    WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+  }
+
+  /* The survivors are in the other alive list now */
+  ps->parity = 1 - ps->parity;
+
+  /* Read back the live count without waiting for the GPU */
+  if (!ps->live_count_pending
+      && wgpu_readback_can_accept(ps->wgpu_context->readback)) {
+    ps->live_count_pending = wgpu_readback_copy_buffer(
+      ps->wgpu_context->readback, cmd_enc,
+      &(wgpu_readback_buffer_desc_t){
+        .buffer   = ps->counters.buffer,
+        .offset   = COUNTER_ALIVE * sizeof(uint32_t),
+        .size     = sizeof(uint32_t),
+        .callback = live_count_readback_cb,
+        .userdata = ps,
+      });
+  }
+}
+
+void wgpu_particle_system_draw(wgpu_particle_system_t* ps,
+                               WGPURenderPassEncoder rpass_enc, mat4 view,
+                               mat4 projection)
+{
+  /* Billboard axes are the rows of the view rotation */
+  particle_render_params_t params = {
+    .camera_right = {view[0][0], view[1][0], view[2][0]},
+    .size         = ps->emitter.size,
+    .camera_up    = {view[0][1], view[1][1], view[2][1]},
+  };
+  glm_mat4_mul(projection, view, params.view_projection);
+  glm_vec4_copy(ps->emitter.color_begin, params.color_begin);
+  glm_vec4_copy(ps->emitter.color_end, params.color_end);
+  wgpu_queue_write_buffer(ps->wgpu_context, ps->render_params.buffer, 0,
+                          &params, sizeof(params));
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, ps->render_pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0,
+                                    ps->render_bind_groups[ps->parity], 0,
+                                    NULL);
+  wgpuRenderPassEncoderDrawIndirect(rpass_enc, ps->indirect_args.buffer,
+                                    INDIRECT_DRAW * sizeof(uint32_t));
+}
+
+uint32_t wgpu_particle_system_get_capacity(wgpu_particle_system_t* ps)
+{
+  return ps->capacity;
+}
+
+uint32_t wgpu_particle_system_get_live_count(wgpu_particle_system_t* ps)
+{
+  return ps->live_count;
+}
@@ -402,8 +402,8 @@ texture_t pbr_generate_brdf_lut(wgpu_context_t* wgpu_context)
     ASSERT(pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state.module);
   }
 
   /* Create the actual renderpass */
@@ -953,8 +953,8 @@ texture_t pbr_generate_cubemap(wgpu_context_t* wgpu_context,
     ASSERT(pipeline != NULL);
 
     // Partial cleanup
-    WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state.module);
+    wgpu_release_shader_module(wgpu_context, vertex_state.module);
+    wgpu_release_shader_module(wgpu_context, fragment_state.module);
   }
 
   /* Create the actual renderpass */
@@ -0,0 +1,969 @@
+#include "portal_system.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+#include "buffer.h"
+#include "shader.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Portal System
+ * -------------------------------------------------------------------------- */
+
+/* Views select their portal uniforms with dynamic offsets */
+#define PORTAL_UNIFORM_STRIDE 256u
+
+/* Clip space w below which the portal quad is clipped */
+#define PORTAL_MIN_CLIP_W 1e-4f
+
+/* Must match Uniforms in the shader */
+typedef struct portal_uniforms_t {
+  mat4 view_projection; /* of the view the portal is seen from */
+  mat4 model;           /* portal quad */
+  vec2 inverse_frame_size;
+  vec2 padding;
+} portal_uniforms_t;
+
+/* Offscreen color and depth stencil target */
+typedef struct portal_target_t {
+  WGPUTexture color_texture;
+  WGPUTextureView color_view;
+  WGPUTexture depth_stencil_texture;
+  WGPUTextureView depth_stencil_view;
+  WGPUBindGroup bind_group;
+  uint32_t width;
+  uint32_t height;
+} portal_target_t;
+
+/* Render pass the views are rendered into */
+typedef struct portal_pass_t {
+  uint32_t base_level; /* level drawn with stencil reference 0 */
+  float scale;         /* resolution relative to the frame */
+  uint32_t width;
+  uint32_t height;
+} portal_pass_t;
+
+struct wgpu_portal_system {
+  wgpu_context_t* wgpu_context;
+  WGPUTextureFormat color_format;
+  WGPUTextureFormat depth_stencil_format;
+  /* Budget */
+  uint32_t max_depth;
+  uint32_t max_views;
+  uint32_t offscreen_level;
+  float offscreen_scale;
+  float min_pixel_size;
+  /* Portals */
+  wgpu_portal_t portals[WGPU_PORTAL_MAX_PORTALS];
+  uint32_t portal_count;
+  /* Views of the frame, breadth first */
+  wgpu_portal_view_t views[WGPU_PORTAL_MAX_VIEWS];
+  uint32_t view_targets[WGPU_PORTAL_MAX_VIEWS]; /* UINT32_MAX: frame */
+  uint32_t view_count;
+  uint32_t culled_count;
+  uint32_t width;
+  uint32_t height;
+  mat4 projection;
+  /* Offscreen targets */
+  portal_target_t targets[WGPU_PORTAL_MAX_TARGETS];
+  uint32_t target_count;
+  /* Portal surface rendering */
+  uint8_t uniform_data[WGPU_PORTAL_MAX_VIEWS * PORTAL_UNIFORM_STRIDE];
+  wgpu_buffer_t uniform_buffer;
+  WGPUSampler sampler;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroupLayout target_bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPUPipelineLayout composite_pipeline_layout;
+  WGPUBindGroup bind_group;
+  struct {
+    WGPURenderPipeline mark;
+    WGPURenderPipeline clear_depth;
+    WGPURenderPipeline unmark;
+    WGPURenderPipeline composite;
+  } pipelines;
+};
+
+// clang-format off
+static const char* portal_shader_wgsl = CODE(
+  struct Uniforms {
+    viewProjection : mat4x4f,
+    model : mat4x4f,
+    inverseFrameSize : vec2f,
+  }
+
+  @group(0) @binding(0) var<uniform> uniforms : Uniforms;
+  @group(1) @binding(0) var targetSampler : sampler;
+  @group(1) @binding(1) var targetTexture : texture_2d<f32>;
+
+  fn quadPosition(vertexIndex : u32) -> vec4f {
+    var corners = array<vec2f, 6>(
+      vec2f(-1.0, -1.0), vec2f(1.0, -1.0), vec2f(-1.0, 1.0),
+      vec2f(-1.0, 1.0), vec2f(1.0, -1.0), vec2f(1.0, 1.0)
+    );
+    let position = vec4f(corners[vertexIndex], 0.0, 1.0);
+    return uniforms.viewProjection * uniforms.model * position;
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32)
+    -> @builtin(position) vec4f {
+    return quadPosition(vertexIndex);
+  }
+
+  // The portal quad on the far plane, clears the depth behind the portal
+  @vertex
+  fn vs_far(@builtin(vertex_index) vertexIndex : u32)
+    -> @builtin(position) vec4f {
+    let position = quadPosition(vertexIndex);
+    return vec4f(position.xy, position.w, position.w);
+  }
+
+  @fragment
+  fn fs_none() -> @location(0) vec4f {
+    return vec4f(0.0);
+  }
+
+  // The offscreen target covers the frame at a lower resolution
+  @fragment
+  fn fs_composite(@builtin(position) position : vec4f) -> @location(0) vec4f {
+    let uv = position.xy * uniforms.inverseFrameSize;
+    return textureSample(targetTexture, targetSampler, uv);
+  }
+);
+// clang-format on
+
+/* -------------------------------------------------------------------------- *
+ * Views
+ * -------------------------------------------------------------------------- */
+
+/* Plane of a portal quad, the normal points to its visible side */
+static void portal_get_plane(mat4 transform, vec4 plane)
+{
+  vec3 normal;
+  glm_vec3_normalize_to(transform[2], normal);
+  plane[0] = normal[0];
+  plane[1] = normal[1];
+  plane[2] = normal[2];
+  plane[3] = -glm_vec3_dot(normal, transform[3]);
+}
+
+/* Clips a convex polygon of homogeneous points to dot(plane, p) >= offset */
+static uint32_t portal_clip_polygon(vec4* points, uint32_t count,
+                                    const vec4 plane, float offset,
+                                    vec4* clipped)
+{
+  uint32_t clipped_count = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    float* a       = points[i];
+    float* b       = points[(i + 1) % count];
+    const float da = glm_vec4_dot(a, (float*)plane) - offset;
+    const float db = glm_vec4_dot(b, (float*)plane) - offset;
+    if (da >= 0.0f) {
+      glm_vec4_copy(a, clipped[clipped_count++]);
+    }
+    if ((da >= 0.0f) != (db >= 0.0f)) {
+      glm_vec4_lerp(a, b, da / (da - db), clipped[clipped_count++]);
+    }
+  }
+  return clipped_count;
+}
+
+/* Pixel bounds of the portal in the parent view, false if it is culled */
+static bool portal_system_get_scissor(wgpu_portal_system_t* ps,
+                                      const wgpu_portal_view_t* parent,
+                                      const wgpu_portal_t* portal,
+                                      uint32_t scissor[4])
+{
+  /* The portal must face the eye of the parent view */
+  mat4 inverse_view, transform;
+  vec4 plane;
+  glm_mat4_inv((vec4*)parent->view, inverse_view);
+  glm_mat4_copy((vec4*)portal->transform, transform);
+  portal_get_plane(transform, plane);
+  if (glm_vec3_dot(plane, inverse_view[3]) + plane[3] <= 0.0f) {
+    return false;
+  }
+
+  /* Quad clipped to the space in front of the parent portal */
+  vec4 points[8], clipped[8];
+  const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f},
+                               {1.0f, 1.0f},   {-1.0f, 1.0f}};
+  for (uint32_t i = 0; i < 4; ++i) {
+    glm_mat4_mulv(transform, (vec4){corners[i][0], corners[i][1], 0.0f, 1.0f},
+                  points[i]);
+  }
+  uint32_t count = 4;
+  if (parent->level > 0) {
+    count = portal_clip_polygon(points, count, parent->clip_plane, 0.0f,
+                                clipped);
+    memcpy(points, clipped, count * sizeof(vec4));
+  }
+
+  /* Then to the space in front of the eye */
+  mat4 view_projection;
+  glm_mat4_mul((vec4*)parent->projection, (vec4*)parent->view,
+               view_projection);
+  for (uint32_t i = 0; i < count; ++i) {
+    glm_mat4_mulv(view_projection, points[i], points[i]);
+  }
+  count = portal_clip_polygon(points, count, (vec4){0.0f, 0.0f, 0.0f, 1.0f},
+                              PORTAL_MIN_CLIP_W, clipped);
+  if (count == 0) {
+    return false;
+  }
+
+  /* Normalized device coordinate bounds to pixels, y points down */
+  vec2 ndc_min = {FLT_MAX, FLT_MAX}, ndc_max = {-FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t axis = 0; axis < 2; ++axis) {
+      const float ndc = clipped[i][axis] / clipped[i][3];
+      ndc_min[axis]   = MIN(ndc_min[axis], ndc);
+      ndc_max[axis]   = MAX(ndc_max[axis], ndc);
+    }
+  }
+  const float x0 = floorf((ndc_min[0] * 0.5f + 0.5f) * ps->width);
+  const float x1 = ceilf((ndc_max[0] * 0.5f + 0.5f) * ps->width);
+  const float y0 = floorf((0.5f - ndc_max[1] * 0.5f) * ps->height);
+  const float y1 = ceilf((0.5f - ndc_min[1] * 0.5f) * ps->height);
+  const uint32_t* bounds = parent->scissor;
+  const float left       = MAX(x0, (float)bounds[0]);
+  const float top        = MAX(y0, (float)bounds[1]);
+  const float right      = MIN(x1, (float)(bounds[0] + bounds[2]));
+  const float bottom     = MIN(y1, (float)(bounds[1] + bounds[3]));
+  if (right - left < ps->min_pixel_size || bottom - top < ps->min_pixel_size) {
+    return false;
+  }
+
+  scissor[0] = (uint32_t)left;
+  scissor[1] = (uint32_t)top;
+  scissor[2] = (uint32_t)(right - left);
+  scissor[3] = (uint32_t)(bottom - top);
+  return true;
+}
+
+/**
+ * @brief Replaces the near plane of the projection with the clip plane, the
+ * far plane is kept and the depth range is [0, 1].
+ * @ref Lengyel, "Oblique View Frustum Depth Projection and Clipping"
+ */
+static void portal_oblique_projection(mat4 projection, mat4 view,
+                                      vec4 clip_plane, mat4 dest)
+{
+  /* Clip plane in view space */
+  mat4 inverse_view, inverse_projection;
+  vec4 plane, corner;
+  glm_mat4_inv(view, inverse_view);
+  glm_mat4_transpose(inverse_view);
+  glm_mat4_mulv(inverse_view, clip_plane, plane);
+
+  /* Far corner of the frustum opposite to the plane */
+  glm_mat4_inv(projection, inverse_projection);
+  glm_mat4_mulv(inverse_projection,
+                (vec4){plane[0] >= 0.0f ? 1.0f : -1.0f,
+                       plane[1] >= 0.0f ? 1.0f : -1.0f, 1.0f, 1.0f},
+                corner);
+
+  const float scale = 1.0f / glm_vec4_dot(plane, corner);
+  glm_mat4_copy(projection, dest);
+  for (uint32_t column = 0; column < 4; ++column) {
+    dest[column][2] = plane[column] * scale;
+  }
+}
+
+/* Frustum of the view restricted to its scissor rectangle */
+static void portal_system_update_frustum(wgpu_portal_system_t* ps,
+                                         wgpu_portal_view_t* view)
+{
+  const float x0 = 2.0f * view->scissor[0] / ps->width - 1.0f;
+  const float x1
+    = 2.0f * (view->scissor[0] + view->scissor[2]) / ps->width - 1.0f;
+  const float y0
+    = 1.0f - 2.0f * (view->scissor[1] + view->scissor[3]) / ps->height;
+  const float y1 = 1.0f - 2.0f * view->scissor[1] / ps->height;
+
+  mat4 bounds = GLM_MAT4_IDENTITY_INIT, matrix;
+  bounds[0][0] = 2.0f / (x1 - x0);
+  bounds[3][0] = -(x1 + x0) / (x1 - x0);
+  bounds[1][1] = 2.0f / (y1 - y0);
+  bounds[3][1] = -(y1 + y0) / (y1 - y0);
+  glm_mat4_mul(bounds, view->projection, matrix);
+  glm_mat4_mul(matrix, view->view, matrix);
+  frustum_update(&view->frustum, matrix);
+
+  /* The near plane of an oblique projection is the clip plane */
+  if (view->level > 0) {
+    glm_vec4_copy(view->clip_plane,
+                  view->frustum.planes[Frustum_Side_Back]);
+  }
+}
+
+static void portal_system_add_view(wgpu_portal_system_t* ps,
+                                   uint32_t parent_index,
+                                   uint32_t portal_index)
+{
+  const wgpu_portal_view_t* parent = &ps->views[parent_index];
+  const wgpu_portal_t* portal      = &ps->portals[portal_index];
+
+  /* A mirror does not see itself */
+  if (portal->type == WGPU_PORTAL_TYPE_MIRROR
+      && parent->portal == portal_index) {
+    return;
+  }
+
+  uint32_t scissor[4] = {0};
+  if (!portal_system_get_scissor(ps, parent, portal, scissor)
+      || ps->view_count >= ps->max_views) {
+    ++ps->culled_count;
+    return;
+  }
+
+  /* The first offscreen level gets a target, the levels seen through it
+   * are rendered into the same target */
+  const uint32_t level = parent->level + 1;
+  uint32_t target      = ps->view_targets[parent_index];
+  if (target == UINT32_MAX && ps->offscreen_level > 0
+      && level >= ps->offscreen_level) {
+    if (ps->target_count >= WGPU_PORTAL_MAX_TARGETS) {
+      ++ps->culled_count;
+      return;
+    }
+    target = ps->target_count++;
+  }
+
+  const uint32_t index     = ps->view_count++;
+  wgpu_portal_view_t* view = &ps->views[index];
+  *view                    = (wgpu_portal_view_t){
+    .scissor          = {scissor[0], scissor[1], scissor[2], scissor[3]},
+    .level            = level,
+    .parent           = parent_index,
+    .portal           = portal_index,
+    .mirrored         = parent->mirrored,
+    .resolution_scale = target == UINT32_MAX ? 1.0f : ps->offscreen_scale,
+  };
+  ps->view_targets[index] = target;
+
+  mat4 transform, matrix;
+  glm_mat4_copy((vec4*)portal->transform, transform);
+  if (portal->type == WGPU_PORTAL_TYPE_MIRROR) {
+    /* Reflection about the mirror plane */
+    vec4 plane;
+    mat4 reflection = GLM_MAT4_IDENTITY_INIT;
+    portal_get_plane(transform, plane);
+    for (uint32_t column = 0; column < 3; ++column) {
+      for (uint32_t row = 0; row < 3; ++row) {
+        reflection[column][row] -= 2.0f * plane[row] * plane[column];
+      }
+      reflection[3][column] = -2.0f * plane[3] * plane[column];
+    }
+    glm_mat4_mul((vec4*)parent->view, reflection, view->view);
+    glm_vec4_copy(plane, view->clip_plane);
+    view->mirrored = !parent->mirrored;
+  }
+  else {
+    /* Looking into the portal is looking out of the destination */
+    mat4 half_turn = GLM_MAT4_IDENTITY_INIT, inverse_destination;
+    half_turn[0][0] = -1.0f;
+    half_turn[2][2] = -1.0f;
+    glm_mat4_inv((vec4*)portal->destination, inverse_destination);
+    glm_mat4_mul((vec4*)parent->view, transform, matrix);
+    glm_mat4_mul(matrix, half_turn, matrix);
+    glm_mat4_mul(matrix, inverse_destination, view->view);
+    glm_mat4_copy((vec4*)portal->destination, matrix);
+    portal_get_plane(matrix, view->clip_plane);
+  }
+
+  portal_oblique_projection(ps->projection, view->view, view->clip_plane,
+                            view->projection);
+  portal_system_update_frustum(ps, view);
+}
+
+/* Portal surface uniforms of every view */
+static void portal_system_update_uniforms(wgpu_portal_system_t* ps)
+{
+  for (uint32_t i = 1; i < ps->view_count; ++i) {
+    const wgpu_portal_view_t* view   = &ps->views[i];
+    const wgpu_portal_view_t* parent = &ps->views[view->parent];
+    portal_uniforms_t* uniforms
+      = (portal_uniforms_t*)&ps->uniform_data[i * PORTAL_UNIFORM_STRIDE];
+    glm_mat4_mul((vec4*)parent->projection, (vec4*)parent->view,
+                 uniforms->view_projection);
+    glm_mat4_copy(ps->portals[view->portal].transform, uniforms->model);
+    uniforms->inverse_frame_size[0] = 1.0f / ps->width;
+    uniforms->inverse_frame_size[1] = 1.0f / ps->height;
+  }
+  if (ps->view_count > 1) {
+    wgpu_queue_write_buffer(ps->wgpu_context, ps->uniform_buffer.buffer, 0,
+                            ps->uniform_data,
+                            ps->view_count * PORTAL_UNIFORM_STRIDE);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * GPU resources
+ * -------------------------------------------------------------------------- */
+
+static void portal_target_release(portal_target_t* target)
+{
+  WGPU_RELEASE_RESOURCE(BindGroup, target->bind_group)
+  WGPU_RELEASE_RESOURCE(TextureView, target->color_view)
+  WGPU_RELEASE_RESOURCE(Texture, target->color_texture)
+  WGPU_RELEASE_RESOURCE(TextureView, target->depth_stencil_view)
+  WGPU_RELEASE_RESOURCE(Texture, target->depth_stencil_texture)
+}
+
+/* (Re)creates the target for the frame size */
+static void portal_system_prepare_target(wgpu_portal_system_t* ps,
+                                         portal_target_t* target)
+{
+  WGPUDevice device     = ps->wgpu_context->device;
+  const uint32_t width  = MAX((uint32_t)ceilf(ps->width * ps->offscreen_scale),
+                              1u);
+  const uint32_t height = MAX(
+    (uint32_t)ceilf(ps->height * ps->offscreen_scale), 1u);
+  if (target->color_texture != NULL && target->width == width
+      && target->height == height) {
+    return;
+  }
+
+  portal_target_release(target);
+  target->width  = width;
+  target->height = height;
+
+  WGPUExtent3D size = {
+    .width              = width,
+    .height             = height,
+    .depthOrArrayLayers = 1,
+  };
+  target->color_texture = wgpuDeviceCreateTexture(
+    device, &(WGPUTextureDescriptor){
+              .label = "Portal system - Offscreen color texture",
+              .usage = WGPUTextureUsage_RenderAttachment
+                       | WGPUTextureUsage_TextureBinding,
+              .dimension     = WGPUTextureDimension_2D,
+              .size          = size,
+              .format        = ps->color_format,
+              .mipLevelCount = 1,
+              .sampleCount   = 1,
+            });
+  ASSERT(target->color_texture != NULL);
+  target->color_view = wgpuTextureCreateView(target->color_texture, NULL);
+  ASSERT(target->color_view != NULL);
+
+  target->depth_stencil_texture = wgpuDeviceCreateTexture(
+    device, &(WGPUTextureDescriptor){
+              .label = "Portal system - Offscreen depth stencil texture",
+              .usage         = WGPUTextureUsage_RenderAttachment,
+              .dimension     = WGPUTextureDimension_2D,
+              .size          = size,
+              .format        = ps->depth_stencil_format,
+              .mipLevelCount = 1,
+              .sampleCount   = 1,
+            });
+  ASSERT(target->depth_stencil_texture != NULL);
+  target->depth_stencil_view
+    = wgpuTextureCreateView(target->depth_stencil_texture, NULL);
+  ASSERT(target->depth_stencil_view != NULL);
+
+  WGPUBindGroupEntry bg_entries[2] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .sampler = ps->sampler,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding     = 1,
+      .textureView = target->color_view,
+    },
+  };
+  target->bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Portal system - Offscreen target bind group",
+              .layout     = ps->target_bind_group_layout,
+              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+              .entries    = bg_entries,
+            });
+  ASSERT(target->bind_group != NULL);
+}
+
+static WGPUDepthStencilState
+portal_depth_stencil_state(WGPUTextureFormat format, bool depth_write_enabled,
+                           WGPUCompareFunction depth_compare,
+                           WGPUStencilOperation stencil_pass_op)
+{
+  WGPUDepthStencilState depth_stencil_state
+    = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+      .format              = format,
+      .depth_write_enabled = depth_write_enabled,
+    });
+  depth_stencil_state.depthCompare = depth_compare;
+  depth_stencil_state.stencilFront = (WGPUStencilFaceState){
+    .compare     = WGPUCompareFunction_Equal,
+    .failOp      = WGPUStencilOperation_Keep,
+    .depthFailOp = WGPUStencilOperation_Keep,
+    .passOp      = stencil_pass_op,
+  };
+  depth_stencil_state.stencilBack      = depth_stencil_state.stencilFront;
+  depth_stencil_state.stencilReadMask  = 0xff;
+  depth_stencil_state.stencilWriteMask = 0xff;
+  return depth_stencil_state;
+}
+
+static WGPURenderPipeline portal_system_create_pipeline(
+  wgpu_portal_system_t* ps, const char* label, WGPUShaderModule shader_module,
+  const char* vertex_entry_point, const char* fragment_entry_point,
+  WGPUPipelineLayout pipeline_layout, WGPUDepthStencilState depth_stencil_state)
+{
+  const bool color_write = strcmp(fragment_entry_point, "fs_none") != 0;
+  WGPUColorTargetState color_target_state = {
+    .format    = ps->color_format,
+    .writeMask = color_write ? WGPUColorWriteMask_All : WGPUColorWriteMask_None,
+  };
+
+  WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(
+    ps->wgpu_context->device,
+    &(WGPURenderPipelineDescriptor){
+      .label  = label,
+      .layout = pipeline_layout,
+      .primitive = {
+        .topology = WGPUPrimitiveTopology_TriangleList,
+        .cullMode = WGPUCullMode_None,
+      },
+      .vertex = {
+        .module     = shader_module,
+        .entryPoint = vertex_entry_point,
+      },
+      .fragment = &(WGPUFragmentState){
+        .module      = shader_module,
+        .entryPoint  = fragment_entry_point,
+        .targetCount = 1,
+        .targets     = &color_target_state,
+      },
+      .depthStencil = &depth_stencil_state,
+      .multisample  = {
+        .count = 1,
+        .mask  = 0xffffffff,
+      },
+    });
+  ASSERT(pipeline != NULL);
+  return pipeline;
+}
+
+static void portal_system_prepare_pipelines(wgpu_portal_system_t* ps)
+{
+  WGPUDevice device = ps->wgpu_context->device;
+
+  ps->uniform_buffer = wgpu_create_buffer(
+    ps->wgpu_context,
+    &(wgpu_buffer_desc_t){
+      .label = "Portal system - Uniform buffer",
+      .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+      .size  = sizeof(ps->uniform_data),
+    });
+
+  ps->sampler = wgpuDeviceCreateSampler(
+    device, &(WGPUSamplerDescriptor){
+              .label         = "Portal system - Sampler",
+              .addressModeU  = WGPUAddressMode_ClampToEdge,
+              .addressModeV  = WGPUAddressMode_ClampToEdge,
+              .addressModeW  = WGPUAddressMode_ClampToEdge,
+              .minFilter     = WGPUFilterMode_Linear,
+              .magFilter     = WGPUFilterMode_Linear,
+              .mipmapFilter  = WGPUMipmapFilterMode_Nearest,
+              .lodMinClamp   = 0.0f,
+              .lodMaxClamp   = 1.0f,
+              .maxAnisotropy = 1,
+            });
+  ASSERT(ps->sampler != NULL);
+
+  /* Portal uniforms of a view */
+  WGPUBindGroupLayoutEntry bgl_entry = {
+    .binding    = 0,
+    .visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment,
+    .buffer = (WGPUBufferBindingLayout) {
+      .type             = WGPUBufferBindingType_Uniform,
+      .hasDynamicOffset = true,
+      .minBindingSize   = sizeof(portal_uniforms_t),
+    },
+  };
+  ps->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Portal system - Bind group layout",
+              .entryCount = 1,
+              .entries    = &bgl_entry,
+            });
+  ASSERT(ps->bind_group_layout != NULL);
+
+  /* Sampler and color texture of an offscreen target */
+  WGPUBindGroupLayoutEntry target_bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+  };
+  ps->target_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Portal system - Target bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(target_bgl_entries),
+              .entries    = target_bgl_entries,
+            });
+  ASSERT(ps->target_bind_group_layout != NULL);
+
+  ps->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Portal system - Pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &ps->bind_group_layout,
+            });
+  ASSERT(ps->pipeline_layout != NULL);
+  WGPUBindGroupLayout bind_group_layouts[2]
+    = {ps->bind_group_layout, ps->target_bind_group_layout};
+  ps->composite_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label = "Portal system - Composite pipeline layout",
+              .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+              .bindGroupLayouts     = bind_group_layouts,
+            });
+  ASSERT(ps->composite_pipeline_layout != NULL);
+
+  WGPUBindGroupEntry bg_entry = {
+    .binding = 0,
+    .buffer  = ps->uniform_buffer.buffer,
+    .size    = sizeof(portal_uniforms_t),
+  };
+  ps->bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Portal system - Bind group",
+              .layout     = ps->bind_group_layout,
+              .entryCount = 1,
+              .entries    = &bg_entry,
+            });
+  ASSERT(ps->bind_group != NULL);
+
+  WGPUShaderModule shader_module = wgpu_create_shader_module(
+    ps->wgpu_context, &(wgpu_shader_desc_t){
+                        .wgsl_code.source = portal_shader_wgsl,
+                      });
+  const WGPUTextureFormat format = ps->depth_stencil_format;
+
+  /* Increments the stencil where the portal surface is visible */
+  ps->pipelines.mark = portal_system_create_pipeline(
+    ps, "Portal system - Mark pipeline", shader_module, "vs_main", "fs_none",
+    ps->pipeline_layout,
+    portal_depth_stencil_state(format, false, WGPUCompareFunction_Less,
+                               WGPUStencilOperation_IncrementClamp));
+  /* Clears the depth behind the marked surface */
+  ps->pipelines.clear_depth = portal_system_create_pipeline(
+    ps, "Portal system - Clear depth pipeline", shader_module, "vs_far",
+    "fs_none", ps->pipeline_layout,
+    portal_depth_stencil_state(format, true, WGPUCompareFunction_Always,
+                               WGPUStencilOperation_Keep));
+  /* Restores the stencil and the depth of the surface */
+  ps->pipelines.unmark = portal_system_create_pipeline(
+    ps, "Portal system - Unmark pipeline", shader_module, "vs_main",
+    "fs_none", ps->pipeline_layout,
+    portal_depth_stencil_state(format, true, WGPUCompareFunction_Always,
+                               WGPUStencilOperation_DecrementClamp));
+  /* Draws an offscreen target onto the surface */
+  ps->pipelines.composite = portal_system_create_pipeline(
+    ps, "Portal system - Composite pipeline", shader_module, "vs_main",
+    "fs_composite", ps->composite_pipeline_layout,
+    portal_depth_stencil_state(format, true, WGPUCompareFunction_Less,
+                               WGPUStencilOperation_Keep));
+
+  wgpu_release_shader_module(ps->wgpu_context, shader_module);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Rendering
+ * -------------------------------------------------------------------------- */
+
+/* Scissor rectangle of the view in the pass */
+static void portal_set_scissor(WGPURenderPassEncoder rpass_enc,
+                               const uint32_t scissor[4],
+                               const portal_pass_t* pass)
+{
+  const uint32_t right
+    = MIN((uint32_t)ceilf((scissor[0] + scissor[2]) * pass->scale),
+          pass->width);
+  const uint32_t bottom
+    = MIN((uint32_t)ceilf((scissor[1] + scissor[3]) * pass->scale),
+          pass->height);
+  const uint32_t left = MIN((uint32_t)(scissor[0] * pass->scale), right);
+  const uint32_t top  = MIN((uint32_t)(scissor[1] * pass->scale), bottom);
+  wgpuRenderPassEncoderSetScissorRect(rpass_enc, left, top, right - left,
+                                      bottom - top);
+}
+
+static void portal_draw_surface(wgpu_portal_system_t* ps,
+                                WGPURenderPassEncoder rpass_enc,
+                                WGPURenderPipeline pipeline,
+                                uint32_t view_index, uint32_t reference)
+{
+  const uint32_t offset = view_index * PORTAL_UNIFORM_STRIDE;
+  wgpuRenderPassEncoderSetStencilReference(rpass_enc, reference);
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, pipeline);
+  wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, ps->bind_group, 1, &offset);
+  wgpuRenderPassEncoderDraw(rpass_enc, 6, 1, 0, 0);
+}
+
+/* Draws the view, then recursively the views seen through its portals */
+static void portal_system_render_view(wgpu_portal_system_t* ps,
+                                      WGPURenderPassEncoder rpass_enc,
+                                      uint32_t index,
+                                      const portal_pass_t* pass,
+                                      wgpu_portal_draw_func_t draw_func,
+                                      void* user_data)
+{
+  const wgpu_portal_view_t* view = &ps->views[index];
+  const uint32_t reference       = view->level - pass->base_level;
+  portal_set_scissor(rpass_enc, view->scissor, pass);
+  wgpuRenderPassEncoderSetStencilReference(rpass_enc, reference);
+  draw_func(rpass_enc, view, index, user_data);
+
+  for (uint32_t child = index + 1; child < ps->view_count; ++child) {
+    if (ps->views[child].parent != index) {
+      continue;
+    }
+
+    portal_set_scissor(rpass_enc, ps->views[child].scissor, pass);
+    const uint32_t target = ps->view_targets[child];
+    if (target != ps->view_targets[index]) {
+      /* Rendered offscreen */
+      wgpuRenderPassEncoderSetBindGroup(
+        rpass_enc, 1, ps->targets[target].bind_group, 0, NULL);
+      portal_draw_surface(ps, rpass_enc, ps->pipelines.composite, child,
+                          reference);
+      continue;
+    }
+
+    portal_draw_surface(ps, rpass_enc, ps->pipelines.mark, child, reference);
+    portal_draw_surface(ps, rpass_enc, ps->pipelines.clear_depth, child,
+                        reference + 1);
+    portal_system_render_view(ps, rpass_enc, child, pass, draw_func,
+                              user_data);
+    portal_set_scissor(rpass_enc, ps->views[child].scissor, pass);
+    portal_draw_surface(ps, rpass_enc, ps->pipelines.unmark, child,
+                        reference + 1);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Portal system
+ * -------------------------------------------------------------------------- */
+
+wgpu_portal_system_t*
+wgpu_portal_system_create(wgpu_context_t* wgpu_context,
+                          const wgpu_portal_system_desc_t* desc)
+{
+  wgpu_portal_system_t* ps
+    = (wgpu_portal_system_t*)calloc(1, sizeof(wgpu_portal_system_t));
+  ps->wgpu_context         = wgpu_context;
+  ps->color_format         = desc->color_format;
+  ps->depth_stencil_format = desc->depth_stencil_format;
+  ps->max_depth
+    = MIN(desc->max_depth > 0 ? desc->max_depth : 2u, WGPU_PORTAL_MAX_DEPTH);
+  ps->max_views = desc->max_views > 0 ?
+                    MIN(desc->max_views, WGPU_PORTAL_MAX_VIEWS) :
+                    WGPU_PORTAL_MAX_VIEWS;
+  ps->offscreen_level = desc->offscreen_level;
+  ps->offscreen_scale
+    = desc->offscreen_scale > 0.0f ? MIN(desc->offscreen_scale, 1.0f) : 0.5f;
+  ps->min_pixel_size
+    = desc->min_pixel_size > 0.0f ? desc->min_pixel_size : 4.0f;
+  ps->width  = 1;
+  ps->height = 1;
+
+  portal_system_prepare_pipelines(ps);
+
+  return ps;
+}
+
+void wgpu_portal_system_destroy(wgpu_portal_system_t* ps)
+{
+  if (ps == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < WGPU_PORTAL_MAX_TARGETS; ++i) {
+    portal_target_release(&ps->targets[i]);
+  }
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ps->pipelines.mark)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ps->pipelines.clear_depth)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ps->pipelines.unmark)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, ps->pipelines.composite)
+  WGPU_RELEASE_RESOURCE(BindGroup, ps->bind_group)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ps->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, ps->composite_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, ps->target_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, ps->sampler)
+  wgpu_destroy_buffer(&ps->uniform_buffer);
+  free(ps);
+}
+
+uint32_t wgpu_portal_system_add(wgpu_portal_system_t* ps,
+                                const wgpu_portal_t* portal)
+{
+  ASSERT(ps->portal_count < WGPU_PORTAL_MAX_PORTALS);
+  ps->portals[ps->portal_count] = *portal;
+  return ps->portal_count++;
+}
+
+void wgpu_portal_system_set(wgpu_portal_system_t* ps, uint32_t index,
+                            const wgpu_portal_t* portal)
+{
+  ASSERT(index < ps->portal_count);
+  ps->portals[index] = *portal;
+}
+
+void wgpu_portal_system_set_max_depth(wgpu_portal_system_t* ps,
+                                      uint32_t max_depth)
+{
+  ps->max_depth = MIN(max_depth, WGPU_PORTAL_MAX_DEPTH);
+}
+
+void wgpu_portal_system_set_offscreen_level(wgpu_portal_system_t* ps,
+                                            uint32_t offscreen_level)
+{
+  ps->offscreen_level = offscreen_level;
+}
+
+WGPUDepthStencilState
+wgpu_portal_system_get_depth_stencil_state(wgpu_portal_system_t* ps)
+{
+  return portal_depth_stencil_state(ps->depth_stencil_format, true,
+                                    WGPUCompareFunction_LessEqual,
+                                    WGPUStencilOperation_Keep);
+}
+
+void wgpu_portal_system_update(wgpu_portal_system_t* ps, mat4 view,
+                               mat4 projection, uint32_t width,
+                               uint32_t height)
+{
+  ps->width        = MAX(width, 1u);
+  ps->height       = MAX(height, 1u);
+  ps->view_count   = 1;
+  ps->culled_count = 0;
+  ps->target_count = 0;
+  glm_mat4_copy(projection, ps->projection);
+
+  /* The camera */
+  wgpu_portal_view_t* camera_view = &ps->views[0];
+  *camera_view                    = (wgpu_portal_view_t){
+    .scissor          = {0, 0, ps->width, ps->height},
+    .parent           = UINT32_MAX,
+    .portal           = UINT32_MAX,
+    .resolution_scale = 1.0f,
+  };
+  glm_mat4_copy(view, camera_view->view);
+  glm_mat4_copy(projection, camera_view->projection);
+  portal_system_update_frustum(ps, camera_view);
+  ps->view_targets[0] = UINT32_MAX;
+
+  /* Breadth first, so that the budget is spent on the lower levels */
+  for (uint32_t i = 0; i < ps->view_count; ++i) {
+    if (ps->views[i].level >= ps->max_depth) {
+      break;
+    }
+    for (uint32_t p = 0; p < ps->portal_count; ++p) {
+      portal_system_add_view(ps, i, p);
+    }
+  }
+
+  portal_system_update_uniforms(ps);
+}
+
+uint32_t wgpu_portal_system_get_view_count(wgpu_portal_system_t* ps)
+{
+  return ps->view_count;
+}
+
+const wgpu_portal_view_t*
+wgpu_portal_system_get_view(wgpu_portal_system_t* ps, uint32_t index)
+{
+  return index < ps->view_count ? &ps->views[index] : NULL;
+}
+
+uint32_t wgpu_portal_system_get_culled_count(wgpu_portal_system_t* ps)
+{
+  return ps->culled_count;
+}
+
+void wgpu_portal_system_render(wgpu_portal_system_t* ps,
+                               WGPUCommandEncoder cmd_enc,
+                               const WGPURenderPassDescriptor* rpass_desc,
+                               wgpu_portal_draw_func_t draw_func,
+                               void* user_data)
+{
+  /* Offscreen views first, each into its own target */
+  for (uint32_t i = 1; i < ps->view_count; ++i) {
+    const uint32_t target_index = ps->view_targets[i];
+    if (target_index == UINT32_MAX
+        || ps->view_targets[ps->views[i].parent] == target_index) {
+      continue;
+    }
+
+    portal_target_t* target = &ps->targets[target_index];
+    portal_system_prepare_target(ps, target);
+    WGPURenderPassColorAttachment color_attachment = {
+      .view       = target->color_view,
+      .depthSlice = ~0,
+      .loadOp     = WGPULoadOp_Clear,
+      .storeOp    = WGPUStoreOp_Store,
+      .clearValue = rpass_desc->colorAttachments[0].clearValue,
+    };
+    WGPURenderPassDepthStencilAttachment depth_stencil_attachment = {
+      .view              = target->depth_stencil_view,
+      .depthLoadOp       = WGPULoadOp_Clear,
+      .depthStoreOp      = WGPUStoreOp_Discard,
+      .depthClearValue   = 1.0f,
+      .stencilLoadOp     = WGPULoadOp_Clear,
+      .stencilStoreOp    = WGPUStoreOp_Discard,
+      .stencilClearValue = 0,
+    };
+    WGPURenderPassEncoder rpass_enc = wgpuCommandEncoderBeginRenderPass(
+      cmd_enc, &(WGPURenderPassDescriptor){
+                 .label                  = "Portal system - Offscreen pass",
+                 .colorAttachmentCount   = 1,
+                 .colorAttachments       = &color_attachment,
+                 .depthStencilAttachment = &depth_stencil_attachment,
+               });
+    const portal_pass_t pass = {
+      .base_level = ps->views[i].level,
+      .scale      = ps->offscreen_scale,
+      .width      = target->width,
+      .height     = target->height,
+    };
+    portal_system_render_view(ps, rpass_enc, i, &pass, draw_func, user_data);
+    wgpuRenderPassEncoderEnd(rpass_enc);
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+  }
+
+  /* The frame */
+  WGPURenderPassEncoder rpass_enc
+    = wgpuCommandEncoderBeginRenderPass(cmd_enc, rpass_desc);
+  const portal_pass_t pass = {
+    .base_level = 0,
+    .scale      = 1.0f,
+    .width      = ps->width,
+    .height     = ps->height,
+  };
+  portal_system_render_view(ps, rpass_enc, 0, &pass, draw_func, user_data);
+  wgpuRenderPassEncoderEnd(rpass_enc);
+  WGPU_RELEASE_RESOURCE(RenderPassEncoder, rpass_enc)
+}
@@ -0,0 +1,128 @@
+#ifndef PORTAL_SYSTEM_H
+#define PORTAL_SYSTEM_H
+
+#include <cglm/cglm.h>
+
+#include "../core/frustum.h"
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Portal System
+ *
+ * Renders the views seen through planar mirrors and portals, recursively up to
+ * a depth budget. Every frame the views are built breadth first: a mirror or
+ * portal gets a view if it faces the viewer, lies in front of the clip plane
+ * of the view it is seen from and covers at least a few pixels of the screen
+ * bounds of that view. The view is restricted to these bounds with a scissor
+ * rectangle and to the space behind the portal with an oblique near plane.
+ * The views are rendered into the frame with stencil masking: the portal
+ * surface increments the stencil, the scene of the view is drawn where the
+ * stencil equals its level, then the surface restores the stencil and depth.
+ * From an optional level on, a view and everything seen through it are
+ * rendered into an offscreen target at a lower resolution instead, which is
+ * then drawn onto the portal surface.
+ * -------------------------------------------------------------------------- */
+
+#define WGPU_PORTAL_MAX_PORTALS 16u
+#define WGPU_PORTAL_MAX_VIEWS 32u
+#define WGPU_PORTAL_MAX_DEPTH 8u
+#define WGPU_PORTAL_MAX_TARGETS 4u
+
+typedef enum wgpu_portal_type_t {
+  WGPU_PORTAL_TYPE_MIRROR = 0,
+  WGPU_PORTAL_TYPE_PORTAL = 1,
+} wgpu_portal_type_t;
+
+typedef struct wgpu_portal_t {
+  wgpu_portal_type_t type;
+  mat4 transform;   /* quad [-1, 1] in the xy plane, visible from +z */
+  mat4 destination; /* portals only: exit quad, looking out along its +z */
+} wgpu_portal_t;
+
+typedef struct wgpu_portal_view_t {
+  mat4 view;
+  mat4 projection; /* oblique near plane on the portal for levels > 0 */
+  vec4 clip_plane; /* world space, geometry behind it is clipped */
+  frustum_t frustum;   /* restricted to the scissor rectangle */
+  uint32_t scissor[4]; /* x, y, width, height in frame pixels */
+  uint32_t level;      /* 0 is the camera */
+  uint32_t parent;     /* view the portal is seen from */
+  uint32_t portal;     /* portal looked through */
+  bool mirrored;       /* odd number of mirrors, flips the triangle winding */
+  float resolution_scale;
+} wgpu_portal_view_t;
+
+typedef struct wgpu_portal_system_desc_t {
+  WGPUTextureFormat color_format;
+  WGPUTextureFormat depth_stencil_format; /* must have a stencil aspect */
+  uint32_t max_depth;       /* recursion levels, defaults to 2 */
+  uint32_t max_views;       /* defaults to WGPU_PORTAL_MAX_VIEWS */
+  uint32_t offscreen_level; /* first offscreen level, 0 if none */
+  float offscreen_scale;    /* offscreen resolution, defaults to 0.5 */
+  float min_pixel_size;     /* smaller portals are culled, defaults to 4 */
+} wgpu_portal_system_desc_t;
+
+/**
+ * @brief Draws the scene of a view. The render pass has the scissor rectangle
+ * and the stencil reference of the view set. The scene pipelines must use the
+ * depth stencil state of wgpu_portal_system_get_depth_stencil_state() and
+ * select their bind groups by view index.
+ */
+typedef void (*wgpu_portal_draw_func_t)(WGPURenderPassEncoder rpass_enc,
+                                        const wgpu_portal_view_t* view,
+                                        uint32_t view_index, void* user_data);
+
+typedef struct wgpu_portal_system wgpu_portal_system_t;
+
+/* Portal system construction / destruction */
+wgpu_portal_system_t*
+wgpu_portal_system_create(wgpu_context_t* wgpu_context,
+                          const wgpu_portal_system_desc_t* desc);
+void wgpu_portal_system_destroy(wgpu_portal_system_t* portal_system);
+
+/* Portals */
+uint32_t wgpu_portal_system_add(wgpu_portal_system_t* portal_system,
+                                const wgpu_portal_t* portal);
+void wgpu_portal_system_set(wgpu_portal_system_t* portal_system,
+                            uint32_t index, const wgpu_portal_t* portal);
+
+/* Budget */
+void wgpu_portal_system_set_max_depth(wgpu_portal_system_t* portal_system,
+                                      uint32_t max_depth);
+void wgpu_portal_system_set_offscreen_level(
+  wgpu_portal_system_t* portal_system, uint32_t offscreen_level);
+
+/* Depth stencil state for the scene pipelines */
+WGPUDepthStencilState
+wgpu_portal_system_get_depth_stencil_state(wgpu_portal_system_t* portal_system);
+
+/**
+ * @brief Builds the views of the frame from the camera.
+ * @param width width of the frame in pixels
+ * @param height height of the frame in pixels
+ */
+void wgpu_portal_system_update(wgpu_portal_system_t* portal_system,
+                               mat4 view, mat4 projection, uint32_t width,
+                               uint32_t height);
+
+/* Views of the frame, view 0 is the camera */
+uint32_t wgpu_portal_system_get_view_count(wgpu_portal_system_t* portal_system);
+const wgpu_portal_view_t*
+wgpu_portal_system_get_view(wgpu_portal_system_t* portal_system,
+                            uint32_t index);
+
+/* Number of portal views culled or dropped by the budget in the last update */
+uint32_t
+wgpu_portal_system_get_culled_count(wgpu_portal_system_t* portal_system);
+
+/**
+ * @brief Records the offscreen passes and the frame pass. The frame pass must
+ * clear the stencil to 0.
+ */
+void wgpu_portal_system_render(wgpu_portal_system_t* portal_system,
+                               WGPUCommandEncoder cmd_enc,
+                               const WGPURenderPassDescriptor* rpass_desc,
+                               wgpu_portal_draw_func_t draw_func,
+                               void* user_data);
+
+#endif /* PORTAL_SYSTEM_H */
@@ -0,0 +1,201 @@
+#include "quality_governor.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Quality Governor
+ * -------------------------------------------------------------------------- */
+
+/* Fast sample windows in a row required before raising the quality */
+#define QUALITY_GOVERNOR_UPGRADE_WINDOWS 4u
+
+struct wgpu_quality_governor {
+  wgpu_gpu_timer_t* gpu_timer;
+  wgpu_quality_governor_desc_t desc;
+  bool enabled;
+  bool changed;
+  /* Steps from the highest quality: the render scale steps come first, then
+   * the quality levels */
+  uint32_t step;
+  uint32_t scale_step_count;
+  uint32_t max_step;
+  /* GPU frame time samples */
+  uint64_t last_frame_count;
+  uint32_t skip_count; /* samples still measuring the previous settings */
+  uint32_t window_count;
+  float window_total_ms;
+  float average_ms;
+  uint32_t fast_windows;
+};
+
+wgpu_quality_governor_t*
+wgpu_quality_governor_create(wgpu_gpu_timer_t* gpu_timer,
+                             const wgpu_quality_governor_desc_t* desc)
+{
+  ASSERT(gpu_timer != NULL);
+
+  wgpu_quality_governor_t* governor
+    = (wgpu_quality_governor_t*)calloc(1, sizeof(wgpu_quality_governor_t));
+  governor->gpu_timer = gpu_timer;
+  governor->enabled   = wgpu_gpu_timer_is_supported(gpu_timer);
+
+  wgpu_quality_governor_desc_t* d = &governor->desc;
+  if (desc != NULL) {
+    *d = *desc;
+  }
+  d->target_ms   = d->target_ms > 0.0f ? d->target_ms : 16.0f;
+  d->hysteresis  = d->hysteresis > 0.0f ? MIN(d->hysteresis, 0.9f) : 0.15f;
+  d->level_count = MAX(d->level_count, 1u);
+  d->min_render_scale
+    = d->min_render_scale > 0.0f ? MIN(d->min_render_scale, 1.0f) : 0.5f;
+  d->render_scale_step
+    = d->render_scale_step > 0.0f ? d->render_scale_step : 0.125f;
+  d->sample_count = d->sample_count > 0 ? d->sample_count : 8u;
+
+  governor->scale_step_count = (uint32_t)floorf(
+    (1.0f - d->min_render_scale) / d->render_scale_step + 0.5f);
+  governor->max_step = governor->scale_step_count + d->level_count - 1;
+
+  if (!wgpu_gpu_timer_is_supported(gpu_timer)) {
+    log_warn("Quality governor: GPU frame times are not available, the "
+             "governor stays disabled");
+  }
+
+  return governor;
+}
+
+void wgpu_quality_governor_destroy(wgpu_quality_governor_t* governor)
+{
+  if (governor == NULL) {
+    return;
+  }
+  free(governor);
+}
+
+static void quality_governor_reset_samples(wgpu_quality_governor_t* governor)
+{
+  /* Frames in flight were recorded with the previous settings */
+  governor->skip_count      = WGPU_GPU_TIMER_FRAME_COUNT;
+  governor->window_count    = 0;
+  governor->window_total_ms = 0.0f;
+  governor->fast_windows    = 0;
+}
+
+static void quality_governor_set_step(wgpu_quality_governor_t* governor,
+                                      uint32_t step)
+{
+  if (step == governor->step) {
+    return;
+  }
+  governor->step    = step;
+  governor->changed = true;
+  quality_governor_reset_samples(governor);
+}
+
+bool wgpu_quality_governor_update(wgpu_quality_governor_t* governor)
+{
+  governor->changed = false;
+  if (!governor->enabled || !wgpu_gpu_timer_is_supported(governor->gpu_timer)) {
+    return false;
+  }
+
+  /* Only resolved frames count, the timer lags a few frames behind */
+  wgpu_gpu_timer_stats_t stats;
+  wgpu_gpu_timer_get_stats(governor->gpu_timer, &stats);
+  if (stats.frame_count == governor->last_frame_count) {
+    return false;
+  }
+  governor->last_frame_count = stats.frame_count;
+  if (governor->skip_count > 0) {
+    --governor->skip_count;
+    return false;
+  }
+
+  governor->window_total_ms += wgpu_gpu_timer_get_frame_ms(governor->gpu_timer);
+  if (++governor->window_count < governor->desc.sample_count) {
+    return false;
+  }
+  governor->average_ms = governor->window_total_ms / governor->window_count;
+  governor->window_count    = 0;
+  governor->window_total_ms = 0.0f;
+
+  const wgpu_quality_governor_desc_t* d = &governor->desc;
+  if (governor->average_ms > d->target_ms * (1.0f + d->hysteresis)) {
+    governor->fast_windows = 0;
+    if (governor->step < governor->max_step) {
+      quality_governor_set_step(governor, governor->step + 1);
+    }
+  }
+  else if (governor->average_ms < d->target_ms * (1.0f - d->hysteresis)) {
+    if (++governor->fast_windows >= QUALITY_GOVERNOR_UPGRADE_WINDOWS
+        && governor->step > 0) {
+      quality_governor_set_step(governor, governor->step - 1);
+    }
+  }
+  else {
+    governor->fast_windows = 0;
+  }
+
+  return governor->changed;
+}
+
+bool wgpu_quality_governor_has_changed(wgpu_quality_governor_t* governor)
+{
+  return governor->changed;
+}
+
+void wgpu_quality_governor_set_enabled(wgpu_quality_governor_t* governor,
+                                       bool enabled)
+{
+  /* Without GPU frame times the governor can not make any decision */
+  enabled = enabled && wgpu_gpu_timer_is_supported(governor->gpu_timer);
+  if (governor->enabled == enabled) {
+    return;
+  }
+  governor->enabled = enabled;
+  quality_governor_set_step(governor, 0);
+  quality_governor_reset_samples(governor);
+}
+
+bool wgpu_quality_governor_is_enabled(wgpu_quality_governor_t* governor)
+{
+  return governor->enabled;
+}
+
+void wgpu_quality_governor_set_target_ms(wgpu_quality_governor_t* governor,
+                                         float target_ms)
+{
+  if (target_ms > 0.0f) {
+    governor->desc.target_ms = target_ms;
+    quality_governor_reset_samples(governor);
+  }
+}
+
+float wgpu_quality_governor_get_target_ms(wgpu_quality_governor_t* governor)
+{
+  return governor->desc.target_ms;
+}
+
+uint32_t wgpu_quality_governor_get_level(wgpu_quality_governor_t* governor)
+{
+  const uint32_t top = governor->desc.level_count - 1;
+  return governor->step <= governor->scale_step_count ?
+           top :
+           top - (governor->step - governor->scale_step_count);
+}
+
+float wgpu_quality_governor_get_render_scale(wgpu_quality_governor_t* governor)
+{
+  const uint32_t scale_step = MIN(governor->step, governor->scale_step_count);
+  return MAX(1.0f - (float)scale_step * governor->desc.render_scale_step,
+             governor->desc.min_render_scale);
+}
+
+float wgpu_quality_governor_get_average_ms(wgpu_quality_governor_t* governor)
+{
+  return governor->average_ms;
+}
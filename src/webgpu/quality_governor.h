@@ -0,0 +1,70 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include "gpu_timer.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Quality Governor
+ *
+ * Holds a GPU frame time target by trading image quality for speed: the GPU
+ * frame times measured by the GPU timer are smoothed, and when they stay above
+ * the target the governor first lowers the render scale and then the quality
+ * level exposed by the example; when they stay below the target it raises them
+ * again in the reverse order. The thresholds form a dead band around the
+ * target and raising the quality requires a longer streak of fast frames than
+ * lowering it, which keeps the governor from oscillating between two steps.
+ * Without timestamp query support the governor stays disabled, so the example
+ * keeps its own quality settings.
+ * -------------------------------------------------------------------------- */
+
+typedef struct wgpu_quality_governor_desc_t {
+  float target_ms;         /* GPU frame time to hold, defaults to 16.0 */
+  float hysteresis;        /* dead band around the target, defaults to 0.15 */
+  uint32_t level_count;    /* quality levels of the example, defaults to 1 */
+  float min_render_scale;  /* defaults to 0.5 */
+  float render_scale_step; /* defaults to 0.125 */
+  uint32_t sample_count;   /* GPU frame times per decision, defaults to 8 */
+} wgpu_quality_governor_desc_t;
+
+typedef struct wgpu_quality_governor wgpu_quality_governor_t;
+
+/* Quality governor construction / destruction */
+wgpu_quality_governor_t*
+wgpu_quality_governor_create(wgpu_gpu_timer_t* gpu_timer,
+                             const wgpu_quality_governor_desc_t* desc);
+void wgpu_quality_governor_destroy(wgpu_quality_governor_t* governor);
+
+/**
+ * @brief Consumes the GPU frame times resolved since the last call and
+ * adjusts the render scale and the quality level. Called once per frame by
+ * the example base, before the example renders.
+ * @return true if the render scale or the quality level changed
+ */
+bool wgpu_quality_governor_update(wgpu_quality_governor_t* governor);
+
+/* Returns true if the last update (or set_enabled) changed the settings */
+bool wgpu_quality_governor_has_changed(wgpu_quality_governor_t* governor);
+
+/**
+ * @brief Enables or disables the governor. A disabled governor reports the
+ * highest quality level at full render scale. The governor can not be enabled
+ * without timestamp query support.
+ */
+void wgpu_quality_governor_set_enabled(wgpu_quality_governor_t* governor,
+                                       bool enabled);
+bool wgpu_quality_governor_is_enabled(wgpu_quality_governor_t* governor);
+
+void wgpu_quality_governor_set_target_ms(wgpu_quality_governor_t* governor,
+                                         float target_ms);
+float wgpu_quality_governor_get_target_ms(wgpu_quality_governor_t* governor);
+
+/* Quality level in [0, level_count), 0 being the lowest quality */
+uint32_t wgpu_quality_governor_get_level(wgpu_quality_governor_t* governor);
+
+/* Render scale in [min_render_scale, 1] */
+float wgpu_quality_governor_get_render_scale(wgpu_quality_governor_t* governor);
+
+/* Smoothed GPU frame time in milliseconds the decisions are based on */
+float wgpu_quality_governor_get_average_ms(wgpu_quality_governor_t* governor);
+
+#endif /* QUALITY_GOVERNOR_H */
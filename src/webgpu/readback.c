@@ -0,0 +1,711 @@
+#include "readback.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Readback Service
+ * -------------------------------------------------------------------------- */
+
+typedef enum readback_slot_state_t {
+  READBACK_SLOT_STATE_FREE,
+  READBACK_SLOT_STATE_RECORDED,  /* copy recorded, waiting for submission */
+  READBACK_SLOT_STATE_SUBMITTED, /* copy submitted, waiting to be mapped */
+  READBACK_SLOT_STATE_MAPPING,   /* map requested, waiting for the GPU */
+  READBACK_SLOT_STATE_MAPPED,
+  READBACK_SLOT_STATE_FAILED,
+} readback_slot_state_t;
+
+typedef struct readback_slot_t {
+  readback_slot_state_t state;
+  WGPUBuffer buffer;
+  uint64_t capacity;
+  uint64_t size;
+  bool is_texture;
+  uint32_t width;
+  uint32_t height;
+  uint32_t padded_bytes_per_row;
+  uint32_t unpadded_bytes_per_row;
+  WGPUTextureFormat format;
+  wgpu_readback_callback_t callback;
+  void* userdata;
+  wgpu_readback_encoding_t encoding;
+  char filename[STRMAX];
+  wgpu_readback_encoded_callback_t encoded_callback;
+  void* encoded_userdata;
+} readback_slot_t;
+
+/* Image encoding job processed by the worker thread */
+typedef struct readback_encode_job_t {
+  struct readback_encode_job_t* next;
+  wgpu_readback_encoding_t encoding;
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row;
+  uint8_t* pixels;
+  char filename[STRMAX];
+  wgpu_readback_encoded_callback_t callback;
+  void* userdata;
+  bool success;
+} readback_encode_job_t;
+
+struct wgpu_readback {
+  wgpu_context_t* wgpu_context;
+  readback_slot_t slots[WGPU_READBACK_POOL_SIZE];
+  /* Scratch memory used to remove the row padding */
+  struct {
+    uint8_t* data;
+    uint64_t size;
+  } scratch;
+  /* Encoder worker thread */
+  struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t idle_cond;
+    readback_encode_job_t* head;
+    readback_encode_job_t* tail;
+    readback_encode_job_t* done; /* finished, callbacks not yet invoked */
+    uint32_t pending;
+    bool running;
+    bool quit;
+  } worker;
+  wgpu_readback_stats_t stats;
+};
+
+uint32_t wgpu_readback_get_bytes_per_texel(WGPUTextureFormat format)
+{
+  switch (format) {
+    case WGPUTextureFormat_R8Unorm:
+      return 1;
+    case WGPUTextureFormat_R16Float:
+      return 2;
+    case WGPUTextureFormat_RGBA8Unorm:
+    case WGPUTextureFormat_RGBA8UnormSrgb:
+    case WGPUTextureFormat_BGRA8Unorm:
+    case WGPUTextureFormat_BGRA8UnormSrgb:
+    case WGPUTextureFormat_R32Float:
+    case WGPUTextureFormat_R32Uint:
+    case WGPUTextureFormat_Depth32Float:
+      return 4;
+    case WGPUTextureFormat_RG32Float:
+    case WGPUTextureFormat_RGBA16Float:
+      return 8;
+    case WGPUTextureFormat_RGBA32Float:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+static bool is_bgra_format(WGPUTextureFormat format)
+{
+  return format == WGPUTextureFormat_BGRA8Unorm
+         || format == WGPUTextureFormat_BGRA8UnormSrgb;
+}
+
+/* Returns true if encode_image() can encode texels of the given format */
+static bool is_encoding_supported(wgpu_readback_encoding_t encoding,
+                                  WGPUTextureFormat format)
+{
+  switch (encoding) {
+    case WGPU_READBACK_ENCODING_PNG:
+      return format == WGPUTextureFormat_R8Unorm
+             || format == WGPUTextureFormat_RGBA8Unorm
+             || format == WGPUTextureFormat_RGBA8UnormSrgb
+             || is_bgra_format(format);
+    case WGPU_READBACK_ENCODING_HDR:
+      return format == WGPUTextureFormat_R32Float
+             || format == WGPUTextureFormat_RGBA32Float
+             || format == WGPUTextureFormat_RGBA16Float
+             || format == WGPUTextureFormat_Depth32Float;
+    default:
+      return true;
+  }
+}
+
+/* IEEE 754 half to single precision conversion */
+static float half_to_float(uint16_t h)
+{
+  const uint32_t sign     = (uint32_t)(h & 0x8000) << 16;
+  const uint32_t exponent = (h >> 10) & 0x1F;
+  uint32_t mantissa       = h & 0x3FF;
+  uint32_t bits           = 0;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    }
+    else {
+      /* Denormalized half, renormalize */
+      int32_t e = -1;
+      do {
+        ++e;
+        mantissa <<= 1;
+      } while ((mantissa & 0x400) == 0);
+      bits = sign | ((uint32_t)(127 - 15 - e) << 23)
+             | ((mantissa & 0x3FF) << 13);
+    }
+  }
+  else if (exponent == 0x1F) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  }
+  else {
+    bits = sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+  }
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+static bool encode_image(readback_encode_job_t* job)
+{
+  const uint32_t w = job->width, h = job->height;
+  int result       = 0;
+  if (job->encoding == WGPU_READBACK_ENCODING_PNG) {
+    if (is_bgra_format(job->format)) {
+      for (uint32_t i = 0; i < w * h; ++i) {
+        uint8_t* p = &job->pixels[i * 4];
+        uint8_t b  = p[0];
+        p[0]       = p[2];
+        p[2]       = b;
+      }
+    }
+    const int comp = (job->format == WGPUTextureFormat_R8Unorm) ? 1 : 4;
+    result         = stbi_write_png(job->filename, (int)w, (int)h, comp,
+                                    job->pixels, (int)job->bytes_per_row);
+  }
+  else if (job->encoding == WGPU_READBACK_ENCODING_HDR) {
+    if (job->format == WGPUTextureFormat_RGBA32Float) {
+      result = stbi_write_hdr(job->filename, (int)w, (int)h, 4,
+                              (const float*)job->pixels);
+    }
+    else if (job->format == WGPUTextureFormat_R32Float
+             || job->format == WGPUTextureFormat_Depth32Float) {
+      result = stbi_write_hdr(job->filename, (int)w, (int)h, 1,
+                              (const float*)job->pixels);
+    }
+    else if (job->format == WGPUTextureFormat_RGBA16Float) {
+      float* texels = (float*)malloc(w * h * 4 * sizeof(float));
+      const uint16_t* halfs = (const uint16_t*)job->pixels;
+      for (uint32_t i = 0; i < w * h * 4; ++i) {
+        texels[i] = half_to_float(halfs[i]);
+      }
+      result = stbi_write_hdr(job->filename, (int)w, (int)h, 4, texels);
+      free(texels);
+    }
+  }
+  if (!result) {
+    log_error("Readback: failed to encode image: %s", job->filename);
+  }
+  return result != 0;
+}
+
+/* Moves a finished job to the done list, called with the worker mutex held */
+static void finish_encode_job(wgpu_readback_t* readback,
+                              readback_encode_job_t* job)
+{
+  free(job->pixels);
+  job->pixels = NULL;
+  ++readback->stats.encoded;
+  job->next             = readback->worker.done;
+  readback->worker.done = job;
+}
+
+/* Invokes the callbacks of the finished image encodings */
+static void deliver_encoded_images(wgpu_readback_t* readback)
+{
+  pthread_mutex_lock(&readback->worker.mutex);
+  readback_encode_job_t* job = readback->worker.done;
+  readback->worker.done      = NULL;
+  pthread_mutex_unlock(&readback->worker.mutex);
+
+  while (job != NULL) {
+    readback_encode_job_t* next = job->next;
+    if (job->callback) {
+      job->callback(job->filename, job->success, job->userdata);
+    }
+    free(job);
+    job = next;
+  }
+}
+
+static void* encoder_thread_main(void* arg)
+{
+  wgpu_readback_t* readback = (wgpu_readback_t*)arg;
+
+  pthread_mutex_lock(&readback->worker.mutex);
+  while (true) {
+    while (readback->worker.head == NULL && !readback->worker.quit) {
+      pthread_cond_wait(&readback->worker.cond, &readback->worker.mutex);
+    }
+    if (readback->worker.head == NULL && readback->worker.quit) {
+      break;
+    }
+    readback_encode_job_t* job = readback->worker.head;
+    readback->worker.head      = job->next;
+    if (readback->worker.head == NULL) {
+      readback->worker.tail = NULL;
+    }
+    pthread_mutex_unlock(&readback->worker.mutex);
+
+    job->success = encode_image(job);
+
+    pthread_mutex_lock(&readback->worker.mutex);
+    finish_encode_job(readback, job);
+    --readback->worker.pending;
+    if (readback->worker.pending == 0) {
+      pthread_cond_broadcast(&readback->worker.idle_cond);
+    }
+  }
+  pthread_mutex_unlock(&readback->worker.mutex);
+
+  return NULL;
+}
+
+static void start_encoder_thread(wgpu_readback_t* readback)
+{
+  if (readback->worker.running) {
+    return;
+  }
+  readback->worker.quit = false;
+  if (pthread_create(&readback->worker.thread, NULL, encoder_thread_main,
+                     readback)
+      == 0) {
+    readback->worker.running = true;
+  }
+  else {
+    log_error("Readback: could not create the encoder thread");
+  }
+}
+
+static void enqueue_encode_job(wgpu_readback_t* readback,
+                               readback_slot_t* slot, const uint8_t* pixels)
+{
+  start_encoder_thread(readback);
+
+  const uint64_t size = (uint64_t)slot->unpadded_bytes_per_row * slot->height;
+  readback_encode_job_t* job
+    = (readback_encode_job_t*)calloc(1, sizeof(readback_encode_job_t));
+  job->encoding      = slot->encoding;
+  job->format        = slot->format;
+  job->width         = slot->width;
+  job->height        = slot->height;
+  job->bytes_per_row = slot->unpadded_bytes_per_row;
+  job->pixels        = (uint8_t*)malloc(size);
+  memcpy(job->pixels, pixels, size);
+  snprintf(job->filename, sizeof(job->filename), "%s", slot->filename);
+  job->callback = slot->encoded_callback;
+  job->userdata = slot->encoded_userdata;
+
+  if (!readback->worker.running) {
+    /* Fallback: encode synchronously */
+    job->success = encode_image(job);
+    pthread_mutex_lock(&readback->worker.mutex);
+    finish_encode_job(readback, job);
+    pthread_mutex_unlock(&readback->worker.mutex);
+    return;
+  }
+
+  pthread_mutex_lock(&readback->worker.mutex);
+  if (readback->worker.tail) {
+    readback->worker.tail->next = job;
+  }
+  else {
+    readback->worker.head = job;
+  }
+  readback->worker.tail = job;
+  ++readback->worker.pending;
+  pthread_cond_signal(&readback->worker.cond);
+  pthread_mutex_unlock(&readback->worker.mutex);
+}
+
+wgpu_readback_t* wgpu_readback_create(wgpu_context_t* wgpu_context)
+{
+  wgpu_readback_t* readback
+    = (wgpu_readback_t*)calloc(1, sizeof(wgpu_readback_t));
+  readback->wgpu_context = wgpu_context;
+
+  pthread_mutex_init(&readback->worker.mutex, NULL);
+  pthread_cond_init(&readback->worker.cond, NULL);
+  pthread_cond_init(&readback->worker.idle_cond, NULL);
+
+  return readback;
+}
+
+void wgpu_readback_destroy(wgpu_readback_t* readback)
+{
+  if (readback == NULL) {
+    return;
+  }
+
+  wgpu_readback_flush(readback);
+
+  if (readback->worker.running) {
+    pthread_mutex_lock(&readback->worker.mutex);
+    readback->worker.quit = true;
+    pthread_cond_signal(&readback->worker.cond);
+    pthread_mutex_unlock(&readback->worker.mutex);
+    pthread_join(readback->worker.thread, NULL);
+    readback->worker.running = false;
+  }
+  deliver_encoded_images(readback);
+  pthread_cond_destroy(&readback->worker.idle_cond);
+  pthread_cond_destroy(&readback->worker.cond);
+  pthread_mutex_destroy(&readback->worker.mutex);
+
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    WGPU_RELEASE_RESOURCE(Buffer, readback->slots[i].buffer)
+  }
+  free(readback->scratch.data);
+  free(readback);
+}
+
+/* Finds a free slot and ensures its staging buffer can hold size bytes */
+static readback_slot_t* acquire_slot(wgpu_readback_t* readback, uint64_t size)
+{
+  readback_slot_t* slot = NULL;
+  /* Prefer a free slot with a large enough staging buffer */
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    readback_slot_t* s = &readback->slots[i];
+    if (s->state == READBACK_SLOT_STATE_FREE) {
+      if (s->buffer != NULL && s->capacity >= size) {
+        slot = s;
+        break;
+      }
+      if (slot == NULL) {
+        slot = s;
+      }
+    }
+  }
+  if (slot == NULL) {
+    return NULL;
+  }
+
+  if (slot->buffer == NULL || slot->capacity < size) {
+    WGPU_RELEASE_RESOURCE(Buffer, slot->buffer)
+    slot->capacity = (size + 3) & ~3ull;
+    slot->buffer   = wgpuDeviceCreateBuffer(
+      readback->wgpu_context->device,
+      &(WGPUBufferDescriptor){
+          .label = "Readback - Staging buffer",
+          .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+          .size  = slot->capacity,
+      });
+    ASSERT(slot->buffer != NULL);
+  }
+
+  slot->size             = size;
+  slot->is_texture       = false;
+  slot->encoding         = WGPU_READBACK_ENCODING_NONE;
+  slot->filename[0]      = '\0';
+  slot->encoded_callback = NULL;
+  slot->encoded_userdata = NULL;
+  return slot;
+}
+
+bool wgpu_readback_can_accept(wgpu_readback_t* readback)
+{
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    if (readback->slots[i].state == READBACK_SLOT_STATE_FREE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool wgpu_readback_copy_buffer(wgpu_readback_t* readback,
+                               WGPUCommandEncoder cmd_enc,
+                               const wgpu_readback_buffer_desc_t* desc)
+{
+  ASSERT(desc->buffer && desc->size > 0 && desc->size % 4 == 0);
+
+  ++readback->stats.requested;
+  readback_slot_t* slot = acquire_slot(readback, desc->size);
+  if (slot == NULL) {
+    ++readback->stats.dropped;
+    return false;
+  }
+
+  wgpuCommandEncoderCopyBufferToBuffer(cmd_enc, desc->buffer, desc->offset,
+                                       slot->buffer, 0, desc->size);
+
+  slot->callback = desc->callback;
+  slot->userdata = desc->userdata;
+  slot->state    = READBACK_SLOT_STATE_RECORDED;
+  ++readback->stats.in_flight;
+
+  return true;
+}
+
+bool wgpu_readback_copy_texture(wgpu_readback_t* readback,
+                                WGPUCommandEncoder cmd_enc,
+                                const wgpu_readback_texture_desc_t* desc)
+{
+  ASSERT(desc->texture && desc->width > 0 && desc->height > 0);
+
+  ++readback->stats.requested;
+
+  const uint32_t bytes_per_texel
+    = wgpu_readback_get_bytes_per_texel(desc->format);
+  if (bytes_per_texel == 0) {
+    log_error("Readback: unsupported texture format: %d", (int)desc->format);
+    ++readback->stats.dropped;
+    return false;
+  }
+  const bool encode = desc->encoding.type != WGPU_READBACK_ENCODING_NONE
+                      && desc->encoding.filename != NULL;
+  if (encode && !is_encoding_supported(desc->encoding.type, desc->format)) {
+    log_error("Readback: texture format %d can not be encoded as %s",
+              (int)desc->format,
+              desc->encoding.type == WGPU_READBACK_ENCODING_PNG ? "PNG" :
+                                                                  "HDR");
+    ++readback->stats.dropped;
+    return false;
+  }
+
+  // It is a WebGPU requirement that ImageCopyBuffer.layout.bytesPerRow %
+  // COPY_BYTES_PER_ROW_ALIGNMENT == 0, so the staging buffer rows are padded
+  const uint32_t align                  = WGPU_COPY_BYTES_PER_ROW_ALIGNMENT;
+  const uint32_t unpadded_bytes_per_row = desc->width * bytes_per_texel;
+  const uint32_t padded_bytes_per_row
+    = (unpadded_bytes_per_row + align - 1) / align * align;
+
+  readback_slot_t* slot
+    = acquire_slot(readback, (uint64_t)padded_bytes_per_row * desc->height);
+  if (slot == NULL) {
+    ++readback->stats.dropped;
+    return false;
+  }
+
+  wgpuCommandEncoderCopyTextureToBuffer(cmd_enc,
+    // Source
+    &(WGPUImageCopyTexture){
+      .texture  = desc->texture,
+      .mipLevel = desc->mip_level,
+      .origin   = (WGPUOrigin3D){
+        .z = desc->array_layer,
+      },
+      .aspect   = (desc->format == WGPUTextureFormat_Depth32Float) ?
+                    WGPUTextureAspect_DepthOnly :
+                    WGPUTextureAspect_All,
+    },
+    // Destination
+    &(WGPUImageCopyBuffer){
+      .buffer = slot->buffer,
+      .layout = (WGPUTextureDataLayout){
+        .offset       = 0,
+        .bytesPerRow  = padded_bytes_per_row,
+        .rowsPerImage = desc->height,
+      },
+    },
+    // Copy size
+    &(WGPUExtent3D){
+      .width              = desc->width,
+      .height             = desc->height,
+      .depthOrArrayLayers = 1,
+    });
+
+  slot->is_texture             = true;
+  slot->width                  = desc->width;
+  slot->height                 = desc->height;
+  slot->padded_bytes_per_row   = padded_bytes_per_row;
+  slot->unpadded_bytes_per_row = unpadded_bytes_per_row;
+  slot->format                 = desc->format;
+  slot->callback               = desc->callback;
+  slot->userdata               = desc->userdata;
+  if (encode) {
+    slot->encoding = desc->encoding.type;
+    snprintf(slot->filename, sizeof(slot->filename), "%s",
+             desc->encoding.filename);
+    slot->encoded_callback = desc->encoding.callback;
+    slot->encoded_userdata = desc->encoding.userdata;
+  }
+  slot->state = READBACK_SLOT_STATE_RECORDED;
+  ++readback->stats.in_flight;
+
+  return true;
+}
+
+static void readback_map_cb(WGPUBufferMapAsyncStatus status, void* user_data)
+{
+  readback_slot_t* slot = (readback_slot_t*)user_data;
+  slot->state = (status == WGPUBufferMapAsyncStatus_Success) ?
+                  READBACK_SLOT_STATE_MAPPED :
+                  READBACK_SLOT_STATE_FAILED;
+}
+
+static const uint8_t* unpad_rows(wgpu_readback_t* readback,
+                                 readback_slot_t* slot, const uint8_t* mapping)
+{
+  if (slot->padded_bytes_per_row == slot->unpadded_bytes_per_row) {
+    return mapping;
+  }
+
+  const uint64_t size = (uint64_t)slot->unpadded_bytes_per_row * slot->height;
+  if (readback->scratch.size < size) {
+    free(readback->scratch.data);
+    readback->scratch.data = (uint8_t*)malloc(size);
+    readback->scratch.size = size;
+  }
+  const uint8_t* src = mapping;
+  uint8_t* dst       = readback->scratch.data;
+  for (uint32_t y = 0; y < slot->height; ++y) {
+    memcpy(dst, src, slot->unpadded_bytes_per_row);
+    src += slot->padded_bytes_per_row;
+    dst += slot->unpadded_bytes_per_row;
+  }
+  return readback->scratch.data;
+}
+
+static void complete_slot(wgpu_readback_t* readback, readback_slot_t* slot)
+{
+  wgpu_readback_result_t result = {
+    .status = WGPU_READBACK_STATUS_ERROR,
+    .format = slot->format,
+  };
+
+  if (slot->state == READBACK_SLOT_STATE_MAPPED) {
+    const uint8_t* mapping = (const uint8_t*)wgpuBufferGetConstMappedRange(
+      slot->buffer, 0, slot->size);
+    if (mapping != NULL) {
+      result.status = WGPU_READBACK_STATUS_SUCCESS;
+      if (slot->is_texture) {
+        result.data          = unpad_rows(readback, slot, mapping);
+        result.size          = (uint64_t)slot->unpadded_bytes_per_row
+                               * slot->height;
+        result.width         = slot->width;
+        result.height        = slot->height;
+        result.bytes_per_row = slot->unpadded_bytes_per_row;
+        if (slot->encoding != WGPU_READBACK_ENCODING_NONE) {
+          enqueue_encode_job(readback, slot, (const uint8_t*)result.data);
+        }
+      }
+      else {
+        result.data = mapping;
+        result.size = slot->size;
+      }
+    }
+  }
+
+  if (result.status == WGPU_READBACK_STATUS_SUCCESS) {
+    ++readback->stats.completed;
+  }
+  else {
+    ++readback->stats.failed;
+  }
+  if (slot->callback) {
+    slot->callback(&result, slot->userdata);
+  }
+
+  if (slot->state == READBACK_SLOT_STATE_MAPPED) {
+    wgpuBufferUnmap(slot->buffer);
+  }
+  slot->callback = NULL;
+  slot->userdata = NULL;
+  slot->state    = READBACK_SLOT_STATE_FREE;
+  --readback->stats.in_flight;
+}
+
+void wgpu_readback_mark_submitted(wgpu_readback_t* readback)
+{
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    readback_slot_t* slot = &readback->slots[i];
+    if (slot->state == READBACK_SLOT_STATE_RECORDED) {
+      slot->state = READBACK_SLOT_STATE_SUBMITTED;
+    }
+  }
+}
+
+void wgpu_readback_pump(wgpu_readback_t* readback)
+{
+  deliver_encoded_images(readback);
+
+  if (readback->stats.in_flight == 0) {
+    return;
+  }
+
+  /* Map the staging buffers of the submitted copies */
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    readback_slot_t* slot = &readback->slots[i];
+    if (slot->state == READBACK_SLOT_STATE_SUBMITTED) {
+      slot->state = READBACK_SLOT_STATE_MAPPING;
+      wgpuBufferMapAsync(slot->buffer, WGPUMapMode_Read, 0, slot->size,
+                         readback_map_cb, slot);
+    }
+  }
+
+  /* Process pending map callbacks */
+  wgpuDeviceTick(readback->wgpu_context->device);
+
+  /* Deliver finished readbacks */
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    readback_slot_t* slot = &readback->slots[i];
+    if (slot->state == READBACK_SLOT_STATE_MAPPED
+        || slot->state == READBACK_SLOT_STATE_FAILED) {
+      complete_slot(readback, slot);
+    }
+  }
+}
+
+/* Returns true while a submitted readback has not been delivered */
+static bool readback_is_busy(wgpu_readback_t* readback)
+{
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    const readback_slot_state_t state = readback->slots[i].state;
+    if (state != READBACK_SLOT_STATE_FREE
+        && state != READBACK_SLOT_STATE_RECORDED) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void wgpu_readback_flush(wgpu_readback_t* readback)
+{
+  while (readback_is_busy(readback)) {
+    wgpu_readback_pump(readback);
+  }
+
+  /* The copies of command buffers that were never submitted cannot finish */
+  for (uint32_t i = 0; i < WGPU_READBACK_POOL_SIZE; ++i) {
+    readback_slot_t* slot = &readback->slots[i];
+    if (slot->state == READBACK_SLOT_STATE_RECORDED) {
+      slot->state = READBACK_SLOT_STATE_FAILED;
+      complete_slot(readback, slot);
+    }
+  }
+
+  if (readback->worker.running) {
+    pthread_mutex_lock(&readback->worker.mutex);
+    while (readback->worker.pending > 0) {
+      pthread_cond_wait(&readback->worker.idle_cond, &readback->worker.mutex);
+    }
+    pthread_mutex_unlock(&readback->worker.mutex);
+  }
+  deliver_encoded_images(readback);
+}
+
+void wgpu_readback_get_stats(wgpu_readback_t* readback,
+                             wgpu_readback_stats_t* stats)
+{
+  pthread_mutex_lock(&readback->worker.mutex);
+  *stats = readback->stats;
+  pthread_mutex_unlock(&readback->worker.mutex);
+}
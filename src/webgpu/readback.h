@@ -0,0 +1,143 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Readback Service
+ *
+ * Asynchronous, non-blocking GPU -> CPU readback of buffers and textures. The
+ * service owns a pool of MapRead staging buffers. A readback request records a
+ * copy into the given command encoder and reserves a staging buffer; once the
+ * command buffer is submitted (see wgpu_readback_mark_submitted()),
+ * wgpu_readback_pump() maps the staging buffer and delivers the data to the
+ * completion callback on a later frame, without ever waiting on the GPU.
+ * Texture readbacks are delivered with the row padding required by WebGPU
+ * (256 bytes) removed and can optionally be encoded to an image file on a
+ * worker thread.
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of readbacks in flight */
+#define WGPU_READBACK_POOL_SIZE 16u
+
+/* Alignment of ImageCopyBuffer.layout.bytesPerRow */
+#define WGPU_COPY_BYTES_PER_ROW_ALIGNMENT 256u
+
+typedef enum wgpu_readback_status_t {
+  WGPU_READBACK_STATUS_SUCCESS,
+  WGPU_READBACK_STATUS_ERROR,
+} wgpu_readback_status_t;
+
+typedef enum wgpu_readback_encoding_t {
+  WGPU_READBACK_ENCODING_NONE,
+  WGPU_READBACK_ENCODING_PNG, /* R8 / RGBA8 / BGRA8 unorm formats */
+  WGPU_READBACK_ENCODING_HDR, /* Radiance HDR, 32-bit float and RGBA16Float */
+} wgpu_readback_encoding_t;
+
+/* Result passed to the completion callback, valid during the callback only */
+typedef struct wgpu_readback_result_t {
+  wgpu_readback_status_t status;
+  const void* data;
+  uint64_t size;
+  /* Texture readbacks only */
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row; /* unpadded */
+  WGPUTextureFormat format;
+} wgpu_readback_result_t;
+
+typedef void (*wgpu_readback_callback_t)(const wgpu_readback_result_t* result,
+                                         void* userdata);
+
+/* Invoked once the image file of a texture readback has been written */
+typedef void (*wgpu_readback_encoded_callback_t)(const char* filename,
+                                                 bool success, void* userdata);
+
+typedef struct wgpu_readback_buffer_desc_t {
+  WGPUBuffer buffer; /* must have WGPUBufferUsage_CopySrc */
+  uint64_t offset;
+  uint64_t size;
+  wgpu_readback_callback_t callback;
+  void* userdata;
+} wgpu_readback_buffer_desc_t;
+
+typedef struct wgpu_readback_texture_desc_t {
+  WGPUTexture texture; /* must have WGPUTextureUsage_CopySrc */
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mip_level;
+  uint32_t array_layer;
+  wgpu_readback_callback_t callback; /* optional when encoding to a file */
+  void* userdata;
+  struct {
+    wgpu_readback_encoding_t type;
+    const char* filename; /* copied, may be freed after the call */
+    wgpu_readback_encoded_callback_t callback; /* optional */
+    void* userdata;
+  } encoding;
+} wgpu_readback_texture_desc_t;
+
+typedef struct wgpu_readback_stats_t {
+  uint64_t requested;
+  uint64_t completed;
+  uint64_t failed;
+  uint64_t dropped; /* requests rejected because the pool was exhausted */
+  uint64_t encoded;
+  uint32_t in_flight;
+} wgpu_readback_stats_t;
+
+typedef struct wgpu_readback wgpu_readback_t;
+
+/* Readback service construction / destruction */
+wgpu_readback_t* wgpu_readback_create(wgpu_context_t* wgpu_context);
+void wgpu_readback_destroy(wgpu_readback_t* readback);
+
+/**
+ * @brief Records a buffer to readback copy into the command encoder.
+ * @return false if no staging buffer is available (the request is dropped)
+ */
+bool wgpu_readback_copy_buffer(wgpu_readback_t* readback,
+                               WGPUCommandEncoder cmd_enc,
+                               const wgpu_readback_buffer_desc_t* desc);
+
+/**
+ * @brief Records a texture to readback copy into the command encoder.
+ * @return false if no staging buffer is available, the format is not
+ * supported or can not be encoded as requested (the request is dropped)
+ */
+bool wgpu_readback_copy_texture(wgpu_readback_t* readback,
+                                WGPUCommandEncoder cmd_enc,
+                                const wgpu_readback_texture_desc_t* desc);
+
+/**
+ * @brief Marks the copies recorded so far as submitted, must be called after
+ * the command buffers containing them were submitted to the queue. Called by
+ * wgpu_flush_command_buffers().
+ */
+void wgpu_readback_mark_submitted(wgpu_readback_t* readback);
+
+/**
+ * @brief Advances all readbacks in flight. Maps the staging buffers of
+ * submitted copies, processes pending map callbacks and invokes the completion
+ * callbacks of finished readbacks and image encodings. Never blocks.
+ */
+void wgpu_readback_pump(wgpu_readback_t* readback);
+
+/**
+ * @brief Waits until all submitted readbacks and queued image encodings are
+ * finished. Copies that were recorded but never submitted fail. Blocking,
+ * intended for shutdown and offline tooling only.
+ */
+void wgpu_readback_flush(wgpu_readback_t* readback);
+
+/* Returns true if a staging buffer is available for a new readback */
+bool wgpu_readback_can_accept(wgpu_readback_t* readback);
+
+void wgpu_readback_get_stats(wgpu_readback_t* readback,
+                             wgpu_readback_stats_t* stats);
+
+/* Returns the size in bytes of a texel of the given format, 0 if unsupported */
+uint32_t wgpu_readback_get_bytes_per_texel(WGPUTextureFormat format);
+
+#endif /* READBACK_H */
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "../core/file.h"
+#include "../core/hashmap.h"
 #include "../core/log.h"
 #include "../core/macro.h"
 
@@ -47,6 +48,189 @@ WGPUShaderModule wgpu_create_shader_module_from_wgsl_file(WGPUDevice device,
   return shader_module;
 }
 
+/* -------------------------------------------------------------------------- *
+ * Shader module cache
+ * -------------------------------------------------------------------------- */
+
+typedef enum shader_cache_kind_t {
+  SHADER_CACHE_KIND_WGSL  = 1,
+  SHADER_CACHE_KIND_SPIRV = 2,
+} shader_cache_kind_t;
+
+typedef struct shader_cache_entry_t {
+  uint64_t hash; /* hash of the source bytes and the kind */
+  WGPUShaderModule module;
+  uint32_t ref_count; /* modules handed out and not yet released */
+} shader_cache_entry_t;
+
+/* Maps a handed out module back to its cache entry */
+typedef struct shader_cache_module_t {
+  WGPUShaderModule module;
+  uint64_t hash;
+} shader_cache_module_t;
+
+struct wgpu_shader_cache {
+  struct hashmap* entries;
+  struct hashmap* modules;
+  wgpu_shader_cache_stats_t stats;
+};
+
+static uint64_t shader_cache_entry_hash(const void* item, uint64_t seed0,
+                                        uint64_t seed1)
+{
+  UNUSED_VAR(seed0);
+  UNUSED_VAR(seed1);
+  /* The key already is a hash */
+  return ((const shader_cache_entry_t*)item)->hash;
+}
+
+static int shader_cache_entry_compare(const void* a, const void* b,
+                                      void* udata)
+{
+  UNUSED_VAR(udata);
+  const uint64_t ha = ((const shader_cache_entry_t*)a)->hash;
+  const uint64_t hb = ((const shader_cache_entry_t*)b)->hash;
+  return (ha > hb) - (ha < hb);
+}
+
+static uint64_t shader_cache_module_hash(const void* item, uint64_t seed0,
+                                         uint64_t seed1)
+{
+  const shader_cache_module_t* m = (const shader_cache_module_t*)item;
+  return hashmap_sip(&m->module, sizeof(m->module), seed0, seed1);
+}
+
+static int shader_cache_module_compare(const void* a, const void* b,
+                                       void* udata)
+{
+  UNUSED_VAR(udata);
+  const uintptr_t ma = (uintptr_t)((const shader_cache_module_t*)a)->module;
+  const uintptr_t mb = (uintptr_t)((const shader_cache_module_t*)b)->module;
+  return (ma > mb) - (ma < mb);
+}
+
+static void shader_cache_entry_free(void* item)
+{
+  shader_cache_entry_t* entry = (shader_cache_entry_t*)item;
+  WGPU_RELEASE_RESOURCE(ShaderModule, entry->module);
+}
+
+static struct wgpu_shader_cache* shader_cache_get(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->shader_cache == NULL) {
+    struct wgpu_shader_cache* shader_cache
+      = (struct wgpu_shader_cache*)calloc(1, sizeof(*shader_cache));
+    shader_cache->entries
+      = hashmap_new(sizeof(shader_cache_entry_t), 0, 0, 0,
+                    shader_cache_entry_hash, shader_cache_entry_compare,
+                    shader_cache_entry_free, NULL);
+    shader_cache->modules
+      = hashmap_new(sizeof(shader_cache_module_t), 0, 0, 0,
+                    shader_cache_module_hash, shader_cache_module_compare,
+                    NULL, NULL);
+    wgpu_context->shader_cache = shader_cache;
+  }
+  return wgpu_context->shader_cache;
+}
+
+/* Returns a new reference to the module compiled from the given source */
+static WGPUShaderModule shader_cache_acquire(wgpu_context_t* wgpu_context,
+                                             shader_cache_kind_t kind,
+                                             const void* data, size_t size)
+{
+  struct wgpu_shader_cache* shader_cache = shader_cache_get(wgpu_context);
+
+  shader_cache_entry_t key = {
+    .hash = hashmap_sip(data, size, (uint64_t)kind, 0x5348414445524341ull),
+  };
+  shader_cache_entry_t* entry
+    = (shader_cache_entry_t*)hashmap_get(shader_cache->entries, &key);
+  if (entry != NULL) {
+    ++shader_cache->stats.hit_count;
+    ++entry->ref_count;
+    wgpuShaderModuleReference(entry->module);
+    return entry->module;
+  }
+
+  ++shader_cache->stats.miss_count;
+  key.module = kind == SHADER_CACHE_KIND_WGSL ?
+                 wgpu_create_shader_module_from_wgsl(wgpu_context->device,
+                                                     (const char*)data) :
+                 wgpu_create_shader_module_from_spirv_bytecode(
+                   wgpu_context->device, (const uint8_t*)data,
+                   (uint32_t)size);
+  if (key.module == NULL) {
+    return NULL;
+  }
+  /* One reference is held by the cache, one is returned */
+  key.ref_count = 1;
+  wgpuShaderModuleReference(key.module);
+  hashmap_set(shader_cache->entries, &key);
+  hashmap_set(shader_cache->modules, &(shader_cache_module_t){
+                                       .module = key.module,
+                                       .hash   = key.hash,
+                                     });
+  return key.module;
+}
+
+void wgpu_release_shader_module(wgpu_context_t* wgpu_context,
+                                WGPUShaderModule shader_module)
+{
+  if (shader_module == NULL) {
+    return;
+  }
+  struct wgpu_shader_cache* shader_cache = wgpu_context->shader_cache;
+  if (shader_cache != NULL) {
+    /* Modules not handed out by the cache are not found */
+    shader_cache_module_t module_key = {.module = shader_module};
+    const shader_cache_module_t* m
+      = (const shader_cache_module_t*)hashmap_get(shader_cache->modules,
+                                                   &module_key);
+    shader_cache_entry_t key = {.hash = m != NULL ? m->hash : 0};
+    shader_cache_entry_t* entry
+      = m != NULL ?
+          (shader_cache_entry_t*)hashmap_get(shader_cache->entries, &key) :
+          NULL;
+    if (entry != NULL && entry->ref_count > 0 && --entry->ref_count == 0) {
+      /* Releases the reference held by the cache */
+      hashmap_delete(shader_cache->modules, &module_key);
+      shader_cache_entry_free(hashmap_delete(shader_cache->entries, &key));
+    }
+  }
+  wgpuShaderModuleRelease(shader_module);
+}
+
+void wgpu_shader_cache_get_stats(wgpu_context_t* wgpu_context,
+                                 wgpu_shader_cache_stats_t* stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  if (wgpu_context->shader_cache != NULL) {
+    *stats = wgpu_context->shader_cache->stats;
+    stats->module_count
+      = (uint32_t)hashmap_count(wgpu_context->shader_cache->entries);
+  }
+}
+
+void wgpu_shader_cache_purge(wgpu_context_t* wgpu_context)
+{
+  if (wgpu_context->shader_cache != NULL) {
+    hashmap_clear(wgpu_context->shader_cache->entries, false);
+    hashmap_clear(wgpu_context->shader_cache->modules, false);
+  }
+}
+
+void wgpu_shader_cache_destroy(struct wgpu_shader_cache* shader_cache)
+{
+  if (shader_cache == NULL) {
+    return;
+  }
+  log_debug("Shader cache: %u hits, %u misses", shader_cache->stats.hit_count,
+            shader_cache->stats.miss_count);
+  hashmap_free(shader_cache->entries);
+  hashmap_free(shader_cache->modules);
+  free(shader_cache);
+}
+
 WGPUShaderModule
 wgpu_create_shader_module(wgpu_context_t* wgpu_context,
                           const wgpu_shader_desc_t* shader_desc)
@@ -56,25 +240,32 @@ wgpu_create_shader_module(wgpu_context_t* wgpu_context,
   if (shader_desc->file != NULL) {
     /* WebGPU Shader from file */
     if (filename_has_extension(shader_desc->file, "spv")) {
-      shader_module = wgpu_create_shader_module_from_spirv_file(
-        wgpu_context->device, shader_desc->file);
+      file_read_result_t result;
+      read_file(shader_desc->file, &result, 0);
+      shader_module = shader_cache_acquire(
+        wgpu_context, SHADER_CACHE_KIND_SPIRV, result.data, result.size);
+      free(result.data);
     }
     else if (filename_has_extension(shader_desc->file, "wgsl")) {
-      shader_module = wgpu_create_shader_module_from_wgsl_file(
-        wgpu_context->device, shader_desc->file);
+      file_read_result_t result;
+      read_file(shader_desc->file, &result, 1);
+      shader_module = shader_cache_acquire(
+        wgpu_context, SHADER_CACHE_KIND_WGSL, result.data, result.size);
+      free(result.data);
     }
   }
   else if ((shader_desc->byte_code.data != NULL)
            && (shader_desc->byte_code.size != 0)) {
     /* WebGPU Shader from SPIR-V bytecode */
-    shader_module = wgpu_create_shader_module_from_spirv_bytecode(
-      wgpu_context->device, shader_desc->byte_code.data,
+    shader_module = shader_cache_acquire(
+      wgpu_context, SHADER_CACHE_KIND_SPIRV, shader_desc->byte_code.data,
       shader_desc->byte_code.size);
   }
   else if (shader_desc->wgsl_code.source != NULL) {
     /* WebGPU Shader from WGSL code */
-    shader_module = wgpu_create_shader_module_from_wgsl(
-      wgpu_context->device, shader_desc->wgsl_code.source);
+    shader_module = shader_cache_acquire(
+      wgpu_context, SHADER_CACHE_KIND_WGSL, shader_desc->wgsl_code.source,
+      strlen(shader_desc->wgsl_code.source));
   }
 
   return shader_module;
@@ -136,6 +327,7 @@ wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
 
   wgpu_shader_t shader = {0};
   shader.module        = wgpu_create_shader_module(wgpu_context, desc);
+  shader.wgpu_context  = wgpu_context;
   ASSERT(shader.module);
 
   shader.programmable_stage_descriptor = (WGPUProgrammableStageDescriptor){
@@ -150,8 +342,9 @@ wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
 
 void wgpu_shader_release(wgpu_shader_t* shader)
 {
-  ASSERT(shader->module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, shader->module);
+  ASSERT(shader->module && shader->wgpu_context);
+  wgpu_release_shader_module(shader->wgpu_context, shader->module);
+  shader->module = NULL;
 }
 
 WGPUVertexState wgpu_create_vertex_state(wgpu_context_t* wgpu_context,
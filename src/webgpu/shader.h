@@ -24,6 +24,7 @@ typedef struct wgpu_shader_desc_t {
 typedef struct wgpu_shader_t {
   WGPUProgrammableStageDescriptor programmable_stage_descriptor;
   WGPUShaderModule module;
+  wgpu_context_t* wgpu_context; /* owner of the shader module cache */
 } wgpu_shader_t;
 
 /* Helper functions */
@@ -40,6 +41,33 @@ WGPUShaderModule
 wgpu_create_shader_module(wgpu_context_t* wgpu_context,
                           const wgpu_shader_desc_t* shader_desc);
 
+/*
+ * Shader module cache
+ *
+ * wgpu_create_shader_module() and the vertex / fragment state helpers look up
+ * the module in a per context cache keyed by a 64-bit hash of the source
+ * (WGSL text or SPIR-V bytes, including file contents) and its kind, so a
+ * source shared by several stages or pipelines is only compiled once. Every
+ * returned module is a new reference and should be released with
+ * wgpu_release_shader_module(), which drops the cache entry once all modules
+ * handed out for that source have been released. Releasing a module with
+ * WGPU_RELEASE_RESOURCE instead stays valid, but pins its cache entry until
+ * wgpu_shader_cache_purge() is called or the context is destroyed.
+ */
+typedef struct wgpu_shader_cache_stats_t {
+  uint32_t hit_count;
+  uint32_t miss_count;
+  uint32_t module_count; /* modules currently held by the cache */
+} wgpu_shader_cache_stats_t;
+
+void wgpu_release_shader_module(wgpu_context_t* wgpu_context,
+                                WGPUShaderModule shader_module);
+void wgpu_shader_cache_get_stats(wgpu_context_t* wgpu_context,
+                                 wgpu_shader_cache_stats_t* stats);
+/* Drops all cached modules, modules still referenced stay valid */
+void wgpu_shader_cache_purge(wgpu_context_t* wgpu_context);
+void wgpu_shader_cache_destroy(struct wgpu_shader_cache* shader_cache);
+
 /* Shader creating/releasing */
 wgpu_shader_t wgpu_shader_create(wgpu_context_t* wgpu_context,
                                  const wgpu_shader_desc_t* desc);
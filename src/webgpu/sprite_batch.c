@@ -0,0 +1,986 @@
+#include "sprite_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/macro.h"
+
+#include "buffer.h"
+#include "shader.h"
+#include "wgsl_preprocessor.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Sprite Batch
+ * -------------------------------------------------------------------------- */
+
+/* Must match the workgroup size of the culling shader */
+#define SPRITE_WORKGROUP_SIZE 64u
+
+/* The visible lists of the draws start at multiples of the storage buffer
+ * offset alignment (256 bytes), they are bound with dynamic offsets */
+#define SPRITE_VISIBLE_ALIGNMENT 64u
+
+#define SPRITE_DEFAULT_CAPACITY 1024u
+
+/* Sprite instance, must match Sprite in the shaders */
+typedef struct sprite_instance_t {
+  float position[2];
+  float size[2];
+  float uv_offset[2];
+  float uv_scale[2];
+  uint32_t color; /* RGBA8 */
+  float rotation;
+  uint32_t draw; /* draw of the instance, used by the culling */
+  uint32_t padding;
+} sprite_instance_t;
+
+/* Run of instances on the same page, must match Draw in the culling shader */
+typedef struct sprite_draw_t {
+  uint32_t first_instance;
+  uint32_t instance_count;
+  uint32_t visible_offset; /* first slot in the visible list (culling) */
+  uint32_t page;
+} sprite_draw_t;
+
+/* Must match Uniforms in the shaders */
+typedef struct sprite_uniforms_t {
+  mat4 view_projection;
+  uint32_t instance_count;
+  uint32_t draw_count;
+  uint32_t padding[2];
+} sprite_uniforms_t;
+
+/* Order of the instances */
+typedef struct sprite_sort_key_t {
+  float depth;
+  uint32_t page;
+  wgpu_sprite_id_t id;
+} sprite_sort_key_t;
+
+struct wgpu_sprite_batch {
+  wgpu_context_t* wgpu_context;
+  wgpu_texture_atlas_t* atlas;
+  bool gpu_culling;
+  /* Sprites by id, ids of removed sprites are reused */
+  wgpu_sprite_t* sprites;
+  uint32_t* instance_of; /* instance of a sprite, UINT32_MAX if removed */
+  wgpu_sprite_id_t* free_ids;
+  uint32_t free_id_count;
+  uint32_t id_count;
+  uint32_t id_capacity;
+  uint32_t sprite_count;
+  /* Instances, sorted back to front */
+  sprite_instance_t* instances;
+  sprite_sort_key_t* sort_keys;
+  bool order_dirty;
+  uint32_t dirty_begin; /* instances to upload */
+  uint32_t dirty_end;
+  sprite_draw_t* draws;
+  uint32_t draw_count;
+  uint32_t draw_capacity;
+  bool draws_dirty;
+  uint32_t last_draw_count;
+  /* Buffers */
+  wgpu_buffer_t uniform_buffer;
+  wgpu_buffer_t instance_buffer;
+  wgpu_buffer_t visible_buffer;
+  wgpu_buffer_t draw_buffer;
+  wgpu_buffer_t indirect_buffer;
+  uint32_t instance_capacity;
+  uint32_t visible_capacity;
+  /* Rendering */
+  WGPUSampler sampler;
+  WGPUBindGroupLayout bind_group_layout;
+  WGPUBindGroupLayout page_bind_group_layout;
+  WGPUPipelineLayout pipeline_layout;
+  WGPURenderPipeline render_pipeline;
+  WGPUBindGroup bind_group;
+  WGPUBindGroup page_bind_groups[WGPU_TEXTURE_ATLAS_MAX_PAGES];
+  uint32_t page_bind_group_count;
+  /* Culling */
+  WGPUBindGroupLayout cull_bind_group_layout;
+  WGPUPipelineLayout cull_pipeline_layout;
+  WGPUComputePipeline reset_pipeline;
+  WGPUComputePipeline cull_pipeline;
+  WGPUBindGroup cull_bind_group;
+};
+
+// clang-format off
+static const char* sprite_common_wgsl = CODE(
+  struct Uniforms {
+    viewProjection : mat4x4f,
+    instanceCount : u32,
+    drawCount : u32,
+  }
+
+  struct Sprite {
+    position : vec2f,
+    size : vec2f,
+    uvOffset : vec2f,
+    uvScale : vec2f,
+    color : u32,
+    rotation : f32,
+    draw : u32,
+    padding : u32,
+  }
+
+  @group(0) @binding(0) var<uniform> uniforms : Uniforms;
+  @group(0) @binding(1) var<storage, read> sprites : array<Sprite>;
+);
+
+static const char* sprite_render_shader_wgsl = CODE(
+  @group(0) @binding(2) var<storage, read> visible : array<u32>;
+  @group(1) @binding(0) var pageSampler : sampler;
+  @group(1) @binding(1) var pageTexture : texture_2d<f32>;
+
+  struct VertexOutput {
+    @builtin(position) position : vec4f,
+    @location(0) uv : vec2f,
+    @location(1) color : vec4f,
+  }
+
+  fn spriteVertex(sprite : Sprite, vertexIndex : u32) -> VertexOutput {
+    var corners = array<vec2f, 6>(
+      vec2f(0.0, 0.0), vec2f(1.0, 0.0), vec2f(0.0, 1.0),
+      vec2f(0.0, 1.0), vec2f(1.0, 0.0), vec2f(1.0, 1.0)
+    );
+    let corner = corners[vertexIndex];
+    let offset = (corner - 0.5) * sprite.size;
+    let c = cos(sprite.rotation);
+    let s = sin(sprite.rotation);
+    let rotated = vec2f(offset.x * c - offset.y * s,
+                        offset.x * s + offset.y * c);
+    let position = sprite.position + rotated;
+
+    var output : VertexOutput;
+    output.position = uniforms.viewProjection * vec4f(position, 0.0, 1.0);
+    // Image rows go down, world y goes up
+    let uv = vec2f(corner.x, 1.0 - corner.y);
+    output.uv = sprite.uvOffset + uv * sprite.uvScale;
+    output.color = unpack4x8unorm(sprite.color);
+    return output;
+  }
+
+  @vertex
+  fn vs_main(@builtin(vertex_index) vertexIndex : u32,
+             @builtin(instance_index) instanceIndex : u32) -> VertexOutput {
+    return spriteVertex(sprites[instanceIndex], vertexIndex);
+  }
+
+  // Instances of the visible list of the draw (bound with a dynamic offset)
+  @vertex
+  fn vs_culled(@builtin(vertex_index) vertexIndex : u32,
+               @builtin(instance_index) instanceIndex : u32) -> VertexOutput {
+    return spriteVertex(sprites[visible[instanceIndex]], vertexIndex);
+  }
+
+  @fragment
+  fn fs_main(input : VertexOutput) -> @location(0) vec4f {
+    let color = textureSample(pageTexture, pageSampler, input.uv) * input.color;
+    // Premultiplied alpha
+    return vec4f(color.rgb * color.a, color.a);
+  }
+);
+
+static const char* sprite_cull_shader_wgsl = CODE(
+  struct Draw {
+    firstInstance : u32,
+    instanceCount : u32,
+    visibleOffset : u32,
+    page : u32,
+  }
+
+  struct DrawArgs {
+    vertexCount : u32,
+    instanceCount : atomic<u32>,
+    firstVertex : u32,
+    firstInstance : u32,
+  }
+
+  @group(0) @binding(2) var<storage, read> draws : array<Draw>;
+  @group(0) @binding(3) var<storage, read_write> visible : array<u32>;
+  @group(0) @binding(4) var<storage, read_write> drawArgs : array<DrawArgs>;
+
+  // Clears the instance counts of the indirect draws
+  @compute @workgroup_size(64)
+  fn reset(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= uniforms.drawCount) {
+      return;
+    }
+
+    drawArgs[id.x].vertexCount = 6u;
+    atomicStore(&drawArgs[id.x].instanceCount, 0u);
+    drawArgs[id.x].firstVertex = 0u;
+    drawArgs[id.x].firstInstance = 0u;
+  }
+
+  // Tests the bounding square of the (rotated) sprite against the view
+  fn isVisible(sprite : Sprite) -> bool {
+    let radius = 0.5 * length(sprite.size);
+    var ndcMin = vec2f(1e30);
+    var ndcMax = vec2f(-1e30);
+    for (var i = 0u; i < 4u; i++) {
+      let direction = vec2f(f32(i & 1u), f32(i >> 1u)) * 2.0 - 1.0;
+      let clip = uniforms.viewProjection
+                 * vec4f(sprite.position + direction * radius, 0.0, 1.0);
+      ndcMin = min(ndcMin, clip.xy / clip.w);
+      ndcMax = max(ndcMax, clip.xy / clip.w);
+    }
+    return all(ndcMax >= vec2f(-1.0)) && all(ndcMin <= vec2f(1.0));
+  }
+
+  // Appends the visible sprites to the visible list of their draw
+  @compute @workgroup_size(64)
+  fn cull(@builtin(global_invocation_id) id : vec3u) {
+    if (id.x >= uniforms.instanceCount) {
+      return;
+    }
+
+    let sprite = sprites[id.x];
+    if (!isVisible(sprite)) {
+      return;
+    }
+    let slot = atomicAdd(&drawArgs[sprite.draw].instanceCount, 1u);
+    visible[draws[sprite.draw].visibleOffset + slot] = id.x;
+  }
+);
+// clang-format on
+
+static uint32_t sprite_pack_color(const vec4 color)
+{
+  uint32_t packed = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    const float c = MIN(MAX(color[i], 0.0f), 1.0f);
+    packed |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+  }
+  return packed;
+}
+
+static void sprite_batch_write_instance(wgpu_sprite_batch_t* sb,
+                                        uint32_t instance, wgpu_sprite_id_t id,
+                                        uint32_t draw)
+{
+  const wgpu_sprite_t* sprite = &sb->sprites[id];
+  sb->instances[instance]     = (sprite_instance_t){
+    .position  = {sprite->position[0], sprite->position[1]},
+    .size      = {sprite->size[0], sprite->size[1]},
+    .uv_offset = {sprite->region.uv_offset[0], sprite->region.uv_offset[1]},
+    .uv_scale  = {sprite->region.uv_scale[0], sprite->region.uv_scale[1]},
+    .color     = sprite_pack_color(sprite->color),
+    .rotation  = sprite->rotation,
+    .draw      = draw,
+  };
+  sb->instance_of[id] = instance;
+  sb->dirty_begin     = MIN(sb->dirty_begin, instance);
+  sb->dirty_end       = MAX(sb->dirty_end, instance + 1);
+}
+
+/* Back to front, then by page so that sprites of the same depth share draws */
+static int sprite_sort_key_compare(const void* a, const void* b)
+{
+  const sprite_sort_key_t* key_a = (const sprite_sort_key_t*)a;
+  const sprite_sort_key_t* key_b = (const sprite_sort_key_t*)b;
+  if (key_a->depth != key_b->depth) {
+    return key_a->depth > key_b->depth ? -1 : 1;
+  }
+  if (key_a->page != key_b->page) {
+    return key_a->page < key_b->page ? -1 : 1;
+  }
+  return key_a->id < key_b->id ? -1 : (key_a->id > key_b->id ? 1 : 0);
+}
+
+/* Sorts the instances and splits them into draws */
+static void sprite_batch_sort(wgpu_sprite_batch_t* sb)
+{
+  uint32_t count = 0;
+  for (wgpu_sprite_id_t id = 0; id < sb->id_count; ++id) {
+    if (sb->instance_of[id] != UINT32_MAX) {
+      sb->sort_keys[count++] = (sprite_sort_key_t){
+        .depth = sb->sprites[id].depth,
+        .page  = sb->sprites[id].region.page,
+        .id    = id,
+      };
+    }
+  }
+  ASSERT(count == sb->sprite_count);
+  qsort(sb->sort_keys, count, sizeof(sprite_sort_key_t),
+        sprite_sort_key_compare);
+
+  sb->draw_count          = 0;
+  uint32_t visible_offset = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t page = sb->sort_keys[i].page;
+    if (sb->draw_count == 0 || sb->draws[sb->draw_count - 1].page != page) {
+      if (sb->draw_count == sb->draw_capacity) {
+        sb->draw_capacity = MAX(sb->draw_capacity * 2, 16u);
+        sb->draws         = (sprite_draw_t*)realloc(
+          sb->draws, sb->draw_capacity * sizeof(sprite_draw_t));
+      }
+      if (sb->draw_count > 0) {
+        const sprite_draw_t* last = &sb->draws[sb->draw_count - 1];
+        visible_offset += (last->instance_count + SPRITE_VISIBLE_ALIGNMENT - 1)
+                          / SPRITE_VISIBLE_ALIGNMENT
+                          * SPRITE_VISIBLE_ALIGNMENT;
+      }
+      sb->draws[sb->draw_count++] = (sprite_draw_t){
+        .first_instance = i,
+        .visible_offset = visible_offset,
+        .page           = page,
+      };
+    }
+    ++sb->draws[sb->draw_count - 1].instance_count;
+    sprite_batch_write_instance(sb, i, sb->sort_keys[i].id,
+                                sb->draw_count - 1);
+  }
+
+  sb->order_dirty = false;
+  sb->draws_dirty = true;
+}
+
+/* -------------------------------------------------------------------------- *
+ * GPU resources
+ * -------------------------------------------------------------------------- */
+
+static void sprite_batch_create_bind_groups(wgpu_sprite_batch_t* sb)
+{
+  WGPUDevice device = sb->wgpu_context->device;
+
+  WGPU_RELEASE_RESOURCE(BindGroup, sb->bind_group)
+  WGPUBindGroupEntry bg_entries[3] = {
+    [0] = (WGPUBindGroupEntry) {
+      .binding = 0,
+      .buffer  = sb->uniform_buffer.buffer,
+      .size    = sb->uniform_buffer.size,
+    },
+    [1] = (WGPUBindGroupEntry) {
+      .binding = 1,
+      .buffer  = sb->instance_buffer.buffer,
+      .size    = sb->instance_buffer.size,
+    },
+    /* The visible list of one draw */
+    [2] = (WGPUBindGroupEntry) {
+      .binding = 2,
+      .buffer  = sb->visible_buffer.buffer,
+      .size    = sb->gpu_culling ? sb->instance_capacity * sizeof(uint32_t) :
+                                   sb->visible_buffer.size,
+    },
+  };
+  sb->bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Sprite batch - Bind group",
+              .layout     = sb->bind_group_layout,
+              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+              .entries    = bg_entries,
+            });
+  ASSERT(sb->bind_group != NULL);
+
+  if (!sb->gpu_culling) {
+    return;
+  }
+
+  WGPU_RELEASE_RESOURCE(BindGroup, sb->cull_bind_group)
+  const wgpu_buffer_t* buffers[5] = {
+    &sb->uniform_buffer, &sb->instance_buffer, &sb->draw_buffer,
+    &sb->visible_buffer, &sb->indirect_buffer,
+  };
+  WGPUBindGroupEntry cull_bg_entries[5] = {0};
+  for (uint32_t b = 0; b < (uint32_t)ARRAY_SIZE(cull_bg_entries); ++b) {
+    cull_bg_entries[b] = (WGPUBindGroupEntry){
+      .binding = b,
+      .buffer  = buffers[b]->buffer,
+      .size    = buffers[b]->size,
+    };
+  }
+  sb->cull_bind_group = wgpuDeviceCreateBindGroup(
+    device, &(WGPUBindGroupDescriptor){
+              .label      = "Sprite batch - Culling bind group",
+              .layout     = sb->cull_bind_group_layout,
+              .entryCount = (uint32_t)ARRAY_SIZE(cull_bg_entries),
+              .entries    = cull_bg_entries,
+            });
+  ASSERT(sb->cull_bind_group != NULL);
+}
+
+/* Grows the buffers to the sprites and draws, recreates the bind groups if a
+ * buffer was replaced */
+static void sprite_batch_prepare_buffers(wgpu_sprite_batch_t* sb)
+{
+  wgpu_context_t* wgpu_context = sb->wgpu_context;
+  bool buffers_changed         = sb->bind_group == NULL;
+
+  if (sb->sprite_count > sb->instance_capacity
+      || sb->instance_buffer.buffer == NULL) {
+    sb->instance_capacity = MAX(sb->instance_capacity, 1u);
+    while (sb->instance_capacity < sb->sprite_count) {
+      sb->instance_capacity *= 2;
+    }
+    wgpu_destroy_buffer(&sb->instance_buffer);
+    sb->instance_buffer = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Sprite batch - Instance buffer",
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+        .size  = sb->instance_capacity * sizeof(sprite_instance_t),
+      });
+    /* The new buffer holds none of the instances */
+    sb->dirty_begin = 0;
+    sb->dirty_end   = sb->sprite_count;
+    buffers_changed = true;
+  }
+
+  /* The visible list of the last draw may start close to the end of the
+   * others, every draw binds instance_capacity slots */
+  uint32_t visible_capacity = 1;
+  if (sb->gpu_culling) {
+    const uint32_t last_offset
+      = sb->draw_count > 0 ? sb->draws[sb->draw_count - 1].visible_offset : 0;
+    visible_capacity = last_offset + sb->instance_capacity;
+  }
+  if (visible_capacity > sb->visible_capacity
+      || sb->visible_buffer.buffer == NULL) {
+    sb->visible_capacity = MAX(visible_capacity, sb->visible_capacity * 2);
+    wgpu_destroy_buffer(&sb->visible_buffer);
+    sb->visible_buffer = wgpu_create_buffer(
+      wgpu_context, &(wgpu_buffer_desc_t){
+                      .label = "Sprite batch - Visible list buffer",
+                      .usage = WGPUBufferUsage_Storage,
+                      .size  = sb->visible_capacity * sizeof(uint32_t),
+                    });
+    buffers_changed = true;
+  }
+
+  if (sb->gpu_culling
+      && (sb->draw_count * sizeof(sprite_draw_t) > sb->draw_buffer.size
+          || sb->draw_buffer.buffer == NULL)) {
+    const uint32_t draw_capacity = MAX(sb->draw_capacity, 16u);
+    wgpu_destroy_buffer(&sb->draw_buffer);
+    wgpu_destroy_buffer(&sb->indirect_buffer);
+    sb->draw_buffer = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Sprite batch - Draw buffer",
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+        .size  = draw_capacity * sizeof(sprite_draw_t),
+      });
+    sb->indirect_buffer = wgpu_create_buffer(
+      wgpu_context,
+      &(wgpu_buffer_desc_t){
+        .label = "Sprite batch - Indirect buffer",
+        .usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect,
+        .size  = draw_capacity * 4 * sizeof(uint32_t),
+      });
+    sb->draws_dirty = true;
+    buffers_changed = true;
+  }
+
+  if (buffers_changed) {
+    sprite_batch_create_bind_groups(sb);
+  }
+}
+
+/* Bind groups of the atlas pages added since the last update */
+static void sprite_batch_prepare_pages(wgpu_sprite_batch_t* sb)
+{
+  const uint32_t page_count = wgpu_texture_atlas_get_page_count(sb->atlas);
+  for (uint32_t i = sb->page_bind_group_count; i < page_count; ++i) {
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry) {
+        .binding = 0,
+        .sampler = sb->sampler,
+      },
+      [1] = (WGPUBindGroupEntry) {
+        .binding     = 1,
+        .textureView = wgpu_texture_atlas_get_page_view(sb->atlas, i),
+      },
+    };
+    sb->page_bind_groups[i] = wgpuDeviceCreateBindGroup(
+      sb->wgpu_context->device,
+      &(WGPUBindGroupDescriptor){
+        .label      = "Sprite batch - Page bind group",
+        .layout     = sb->page_bind_group_layout,
+        .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+        .entries    = bg_entries,
+      });
+    ASSERT(sb->page_bind_groups[i] != NULL);
+  }
+  sb->page_bind_group_count = page_count;
+}
+
+/* Shader permutation key of the culling compute shader */
+#define SPRITE_SHADER_CULL (1u << 0)
+
+static const char* sprite_shader_keys[1] = {
+  "CULL", /* */
+};
+
+static void
+sprite_batch_prepare_pipelines(wgpu_sprite_batch_t* sb,
+                               const wgpu_sprite_batch_desc_t* desc)
+{
+  WGPUDevice device = sb->wgpu_context->device;
+
+  /* The render and the culling shader share the common declarations, their
+   * bindings differ so they are separate modules */
+  const char* shader_sources[] = {
+    sprite_common_wgsl,
+    "#ifdef CULL",
+    sprite_cull_shader_wgsl,
+    "#else",
+    sprite_render_shader_wgsl,
+    "#endif",
+  };
+  wgpu_shader_permutations_t* shaders = wgpu_shader_permutations_create(
+    sb->wgpu_context, &(wgpu_shader_permutations_desc_t){
+                        .label  = "Sprite batch - Shader WGSL",
+                        .source = {
+                          .sources = {
+                            .count   = (uint32_t)ARRAY_SIZE(shader_sources),
+                            .entries = shader_sources,
+                          },
+                        },
+                        .keys      = sprite_shader_keys,
+                        .key_count = (uint32_t)ARRAY_SIZE(sprite_shader_keys),
+                      });
+
+  sb->sampler = wgpuDeviceCreateSampler(
+    device, &(WGPUSamplerDescriptor){
+              .label         = "Sprite batch - Sampler",
+              .addressModeU  = WGPUAddressMode_ClampToEdge,
+              .addressModeV  = WGPUAddressMode_ClampToEdge,
+              .addressModeW  = WGPUAddressMode_ClampToEdge,
+              .minFilter     = WGPUFilterMode_Linear,
+              .magFilter     = WGPUFilterMode_Linear,
+              .mipmapFilter  = WGPUMipmapFilterMode_Nearest,
+              .lodMinClamp   = 0.0f,
+              .lodMaxClamp   = 1.0f,
+              .maxAnisotropy = 1,
+            });
+  ASSERT(sb->sampler != NULL);
+
+  /* Uniforms, instances and the visible list of a draw */
+  WGPUBindGroupLayoutEntry bgl_entries[3] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type           = WGPUBufferBindingType_Uniform,
+        .minBindingSize = sizeof(sprite_uniforms_t),
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = WGPUBufferBindingType_ReadOnlyStorage,
+      },
+    },
+    [2] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 2,
+      .visibility = WGPUShaderStage_Vertex,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type             = WGPUBufferBindingType_ReadOnlyStorage,
+        .hasDynamicOffset = true,
+      },
+    },
+  };
+  sb->bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Sprite batch - Bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(bgl_entries),
+              .entries    = bgl_entries,
+            });
+  ASSERT(sb->bind_group_layout != NULL);
+
+  /* Sampler and texture of an atlas page */
+  WGPUBindGroupLayoutEntry page_bgl_entries[2] = {
+    [0] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 0,
+      .visibility = WGPUShaderStage_Fragment,
+      .sampler = (WGPUSamplerBindingLayout) {
+        .type = WGPUSamplerBindingType_Filtering,
+      },
+    },
+    [1] = (WGPUBindGroupLayoutEntry) {
+      .binding    = 1,
+      .visibility = WGPUShaderStage_Fragment,
+      .texture = (WGPUTextureBindingLayout) {
+        .sampleType    = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D,
+      },
+    },
+  };
+  sb->page_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Sprite batch - Page bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(page_bgl_entries),
+              .entries    = page_bgl_entries,
+            });
+  ASSERT(sb->page_bind_group_layout != NULL);
+
+  WGPUBindGroupLayout bind_group_layouts[2]
+    = {sb->bind_group_layout, sb->page_bind_group_layout};
+  sb->pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label = "Sprite batch - Pipeline layout",
+              .bindGroupLayoutCount = (uint32_t)ARRAY_SIZE(bind_group_layouts),
+              .bindGroupLayouts     = bind_group_layouts,
+            });
+  ASSERT(sb->pipeline_layout != NULL);
+
+  /* Premultiplied alpha "over" blending */
+  WGPUBlendState blend_state = {
+    .color = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+    },
+    .alpha = {
+      .operation = WGPUBlendOperation_Add,
+      .srcFactor = WGPUBlendFactor_One,
+      .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+    },
+  };
+  WGPUColorTargetState color_target_state = {
+    .format    = desc->color_format,
+    .blend     = &blend_state,
+    .writeMask = WGPUColorWriteMask_All,
+  };
+
+  /* The sprites are ordered by the sort, not by the depth test */
+  WGPUDepthStencilState depth_stencil_state = {0};
+  if (desc->depth_format != WGPUTextureFormat_Undefined) {
+    depth_stencil_state
+      = wgpu_create_depth_stencil_state(&(create_depth_stencil_state_desc_t){
+        .format              = desc->depth_format,
+        .depth_write_enabled = false,
+      });
+    depth_stencil_state.depthCompare = WGPUCompareFunction_Always;
+  }
+
+  WGPUShaderModule shader_module
+    = wgpu_shader_permutations_get_module(shaders, 0);
+  ASSERT(shader_module != NULL);
+  sb->render_pipeline = wgpuDeviceCreateRenderPipeline(
+    device,
+    &(WGPURenderPipelineDescriptor){
+      .label  = "Sprite batch - Render pipeline",
+      .layout = sb->pipeline_layout,
+      .primitive = {
+        .topology = WGPUPrimitiveTopology_TriangleList,
+        .cullMode = WGPUCullMode_None,
+      },
+      .vertex = {
+        .module     = shader_module,
+        .entryPoint = sb->gpu_culling ? "vs_culled" : "vs_main",
+      },
+      .fragment = &(WGPUFragmentState){
+        .module      = shader_module,
+        .entryPoint  = "fs_main",
+        .targetCount = 1,
+        .targets     = &color_target_state,
+      },
+      .depthStencil
+      = desc->depth_format != WGPUTextureFormat_Undefined ?
+          &depth_stencil_state :
+          NULL,
+      .multisample = {
+        .count = 1,
+        .mask  = 0xffffffff,
+      },
+    });
+  ASSERT(sb->render_pipeline != NULL);
+
+  if (!sb->gpu_culling) {
+    wgpu_shader_permutations_destroy(shaders);
+    return;
+  }
+
+  /* Uniforms, instances, draws, visible lists and indirect draw arguments */
+  WGPUBindGroupLayoutEntry cull_bgl_entries[5] = {0};
+  for (uint32_t i = 0; i < (uint32_t)ARRAY_SIZE(cull_bgl_entries); ++i) {
+    cull_bgl_entries[i] = (WGPUBindGroupLayoutEntry) {
+      .binding    = i,
+      .visibility = WGPUShaderStage_Compute,
+      .buffer = (WGPUBufferBindingLayout) {
+        .type = i == 0 ? WGPUBufferBindingType_Uniform :
+                i < 3  ? WGPUBufferBindingType_ReadOnlyStorage :
+                         WGPUBufferBindingType_Storage,
+      },
+    };
+  }
+  sb->cull_bind_group_layout = wgpuDeviceCreateBindGroupLayout(
+    device, &(WGPUBindGroupLayoutDescriptor){
+              .label      = "Sprite batch - Culling bind group layout",
+              .entryCount = (uint32_t)ARRAY_SIZE(cull_bgl_entries),
+              .entries    = cull_bgl_entries,
+            });
+  ASSERT(sb->cull_bind_group_layout != NULL);
+  sb->cull_pipeline_layout = wgpuDeviceCreatePipelineLayout(
+    device, &(WGPUPipelineLayoutDescriptor){
+              .label                = "Sprite batch - Culling pipeline layout",
+              .bindGroupLayoutCount = 1,
+              .bindGroupLayouts     = &sb->cull_bind_group_layout,
+            });
+  ASSERT(sb->cull_pipeline_layout != NULL);
+
+  shader_module
+    = wgpu_shader_permutations_get_module(shaders, SPRITE_SHADER_CULL);
+  ASSERT(shader_module != NULL);
+  sb->reset_pipeline = wgpuDeviceCreateComputePipeline(
+    device, &(WGPUComputePipelineDescriptor){
+              .label   = "Sprite batch - Culling reset pipeline",
+              .layout  = sb->cull_pipeline_layout,
+              .compute = {
+                .module     = shader_module,
+                .entryPoint = "reset",
+              },
+            });
+  ASSERT(sb->reset_pipeline != NULL);
+  sb->cull_pipeline = wgpuDeviceCreateComputePipeline(
+    device, &(WGPUComputePipelineDescriptor){
+              .label   = "Sprite batch - Culling pipeline",
+              .layout  = sb->cull_pipeline_layout,
+              .compute = {
+                .module     = shader_module,
+                .entryPoint = "cull",
+              },
+            });
+  ASSERT(sb->cull_pipeline != NULL);
+
+  /* The pipelines hold on to the shader modules */
+  wgpu_shader_permutations_destroy(shaders);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Sprite batch
+ * -------------------------------------------------------------------------- */
+
+wgpu_sprite_batch_t*
+wgpu_sprite_batch_create(wgpu_context_t* wgpu_context,
+                         const wgpu_sprite_batch_desc_t* desc)
+{
+  ASSERT(desc->atlas != NULL);
+
+  wgpu_sprite_batch_t* sb
+    = (wgpu_sprite_batch_t*)calloc(1, sizeof(wgpu_sprite_batch_t));
+  sb->wgpu_context      = wgpu_context;
+  sb->atlas             = desc->atlas;
+  sb->gpu_culling       = desc->gpu_culling;
+  sb->instance_capacity = desc->capacity > 0 ? desc->capacity :
+                                               SPRITE_DEFAULT_CAPACITY;
+  sb->dirty_begin       = UINT32_MAX;
+
+  sb->uniform_buffer = wgpu_create_buffer(
+    wgpu_context, &(wgpu_buffer_desc_t){
+                    .label = "Sprite batch - Uniform buffer",
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+                    .size  = sizeof(sprite_uniforms_t),
+                  });
+  sprite_batch_prepare_pipelines(sb, desc);
+  sprite_batch_prepare_buffers(sb);
+
+  return sb;
+}
+
+void wgpu_sprite_batch_destroy(wgpu_sprite_batch_t* sb)
+{
+  if (sb == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < sb->page_bind_group_count; ++i) {
+    WGPU_RELEASE_RESOURCE(BindGroup, sb->page_bind_groups[i])
+  }
+  WGPU_RELEASE_RESOURCE(BindGroup, sb->bind_group)
+  WGPU_RELEASE_RESOURCE(BindGroup, sb->cull_bind_group)
+  WGPU_RELEASE_RESOURCE(RenderPipeline, sb->render_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, sb->reset_pipeline)
+  WGPU_RELEASE_RESOURCE(ComputePipeline, sb->cull_pipeline)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, sb->pipeline_layout)
+  WGPU_RELEASE_RESOURCE(PipelineLayout, sb->cull_pipeline_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, sb->bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, sb->page_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(BindGroupLayout, sb->cull_bind_group_layout)
+  WGPU_RELEASE_RESOURCE(Sampler, sb->sampler)
+  wgpu_destroy_buffer(&sb->uniform_buffer);
+  wgpu_destroy_buffer(&sb->instance_buffer);
+  wgpu_destroy_buffer(&sb->visible_buffer);
+  wgpu_destroy_buffer(&sb->draw_buffer);
+  wgpu_destroy_buffer(&sb->indirect_buffer);
+  free(sb->sprites);
+  free(sb->instance_of);
+  free(sb->free_ids);
+  free(sb->instances);
+  free(sb->sort_keys);
+  free(sb->draws);
+  free(sb);
+}
+
+wgpu_sprite_id_t wgpu_sprite_batch_add(wgpu_sprite_batch_t* sb,
+                                       const wgpu_sprite_t* sprite)
+{
+  wgpu_sprite_id_t id = WGPU_SPRITE_INVALID_ID;
+  if (sb->free_id_count > 0) {
+    id = sb->free_ids[--sb->free_id_count];
+  }
+  else {
+    if (sb->id_count == sb->id_capacity) {
+      sb->id_capacity = MAX(sb->id_capacity * 2, SPRITE_DEFAULT_CAPACITY);
+      sb->sprites     = (wgpu_sprite_t*)realloc(
+        sb->sprites, sb->id_capacity * sizeof(wgpu_sprite_t));
+      sb->instance_of = (uint32_t*)realloc(
+        sb->instance_of, sb->id_capacity * sizeof(uint32_t));
+      sb->free_ids    = (wgpu_sprite_id_t*)realloc(
+        sb->free_ids, sb->id_capacity * sizeof(wgpu_sprite_id_t));
+      sb->instances   = (sprite_instance_t*)realloc(
+        sb->instances, sb->id_capacity * sizeof(sprite_instance_t));
+      sb->sort_keys   = (sprite_sort_key_t*)realloc(
+        sb->sort_keys, sb->id_capacity * sizeof(sprite_sort_key_t));
+    }
+    id = sb->id_count++;
+  }
+
+  sb->sprites[id]     = *sprite;
+  sb->instance_of[id] = 0; /* assigned by the sort */
+  ++sb->sprite_count;
+  sb->order_dirty = true;
+  return id;
+}
+
+void wgpu_sprite_batch_set(wgpu_sprite_batch_t* sb, wgpu_sprite_id_t id,
+                           const wgpu_sprite_t* sprite)
+{
+  ASSERT(id < sb->id_count && sb->instance_of[id] != UINT32_MAX);
+
+  /* Sprites keep their instance unless their order changes */
+  const wgpu_sprite_t* previous = &sb->sprites[id];
+  const bool order_changed      = previous->depth != sprite->depth
+                             || previous->region.page != sprite->region.page;
+  sb->sprites[id] = *sprite;
+  if (order_changed || sb->order_dirty) {
+    sb->order_dirty = true;
+    return;
+  }
+
+  const uint32_t instance = sb->instance_of[id];
+  sprite_batch_write_instance(sb, instance, id, sb->instances[instance].draw);
+}
+
+void wgpu_sprite_batch_remove(wgpu_sprite_batch_t* sb, wgpu_sprite_id_t id)
+{
+  if (id >= sb->id_count || sb->instance_of[id] == UINT32_MAX) {
+    return;
+  }
+
+  sb->instance_of[id]               = UINT32_MAX;
+  sb->free_ids[sb->free_id_count++] = id;
+  --sb->sprite_count;
+  sb->order_dirty = true;
+}
+
+void wgpu_sprite_batch_clear(wgpu_sprite_batch_t* sb)
+{
+  sb->id_count      = 0;
+  sb->free_id_count = 0;
+  sb->sprite_count  = 0;
+  sb->order_dirty   = true;
+}
+
+uint32_t wgpu_sprite_batch_get_count(wgpu_sprite_batch_t* sb)
+{
+  return sb->sprite_count;
+}
+
+void wgpu_sprite_batch_update(wgpu_sprite_batch_t* sb,
+                              WGPUCommandEncoder cmd_enc,
+                              mat4 view_projection)
+{
+  wgpu_context_t* wgpu_context = sb->wgpu_context;
+
+  if (sb->order_dirty) {
+    sprite_batch_sort(sb);
+  }
+  sprite_batch_prepare_buffers(sb);
+  sprite_batch_prepare_pages(sb);
+
+  /* Changed instances and draws */
+  if (sb->dirty_begin < sb->dirty_end) {
+    wgpu_queue_write_buffer(
+      wgpu_context, sb->instance_buffer.buffer,
+      sb->dirty_begin * sizeof(sprite_instance_t),
+      &sb->instances[sb->dirty_begin],
+      (sb->dirty_end - sb->dirty_begin) * sizeof(sprite_instance_t));
+  }
+  sb->dirty_begin = UINT32_MAX;
+  sb->dirty_end   = 0;
+  if (sb->gpu_culling && sb->draws_dirty && sb->draw_count > 0) {
+    wgpu_queue_write_buffer(wgpu_context, sb->draw_buffer.buffer, 0,
+                            sb->draws,
+                            sb->draw_count * sizeof(sprite_draw_t));
+  }
+  sb->draws_dirty = false;
+
+  sprite_uniforms_t uniforms = {
+    .instance_count = sb->sprite_count,
+    .draw_count     = sb->draw_count,
+  };
+  glm_mat4_copy(view_projection, uniforms.view_projection);
+  wgpu_queue_write_buffer(wgpu_context, sb->uniform_buffer.buffer, 0,
+                          &uniforms, sizeof(uniforms));
+
+  if (!sb->gpu_culling || sb->sprite_count == 0) {
+    return;
+  }
+
+  /* Reset the indirect draws, then append the visible sprites */
+  WGPUComputePassEncoder cpass_enc
+    = wgpuCommandEncoderBeginComputePass(cmd_enc, NULL);
+  wgpuComputePassEncoderSetBindGroup(cpass_enc, 0, sb->cull_bind_group, 0,
+                                     NULL);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, sb->reset_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (sb->draw_count + SPRITE_WORKGROUP_SIZE - 1) / SPRITE_WORKGROUP_SIZE, 1,
+    1);
+  wgpuComputePassEncoderSetPipeline(cpass_enc, sb->cull_pipeline);
+  wgpuComputePassEncoderDispatchWorkgroups(
+    cpass_enc,
+    (sb->sprite_count + SPRITE_WORKGROUP_SIZE - 1) / SPRITE_WORKGROUP_SIZE, 1,
+    1);
+  wgpuComputePassEncoderEnd(cpass_enc);
+  WGPU_RELEASE_RESOURCE(ComputePassEncoder, cpass_enc)
+}
+
+void wgpu_sprite_batch_draw(wgpu_sprite_batch_t* sb,
+                            WGPURenderPassEncoder rpass_enc)
+{
+  sb->last_draw_count = 0;
+  if (sb->sprite_count == 0 || sb->order_dirty) {
+    return;
+  }
+
+  wgpuRenderPassEncoderSetPipeline(rpass_enc, sb->render_pipeline);
+  for (uint32_t i = 0; i < sb->draw_count; ++i) {
+    const sprite_draw_t* draw = &sb->draws[i];
+    const uint32_t offset
+      = sb->gpu_culling ? draw->visible_offset * sizeof(uint32_t) : 0;
+    wgpuRenderPassEncoderSetBindGroup(rpass_enc, 0, sb->bind_group, 1,
+                                      &offset);
+    wgpuRenderPassEncoderSetBindGroup(
+      rpass_enc, 1, sb->page_bind_groups[draw->page], 0, NULL);
+    if (sb->gpu_culling) {
+      wgpuRenderPassEncoderDrawIndirect(rpass_enc, sb->indirect_buffer.buffer,
+                                        i * 4 * sizeof(uint32_t));
+    }
+    else {
+      wgpuRenderPassEncoderDraw(rpass_enc, 6, draw->instance_count, 0,
+                                draw->first_instance);
+    }
+    ++sb->last_draw_count;
+  }
+}
+
+uint32_t wgpu_sprite_batch_get_draw_count(wgpu_sprite_batch_t* sb)
+{
+  return sb->last_draw_count;
+}
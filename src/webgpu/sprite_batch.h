@@ -0,0 +1,80 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+#include "texture_atlas.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Sprite Batch
+ *
+ * Draws textured, tinted and rotated 2D sprites whose images live in a
+ * texture atlas. The sprites are kept in a persistent instance buffer: a
+ * changed sprite only uploads its own instance, the instances are reordered
+ * only when sprites are added or removed or change their depth or page.
+ * Sprites are drawn back to front by depth with one instanced draw per run of
+ * sprites on the same atlas page, i.e. one draw per page unless the depth
+ * ranges of the pages interleave.
+ * Optionally the sprites are culled against the view on the GPU, e.g. for
+ * large tile layers: a compute pass compacts the visible sprites of every draw
+ * and writes the instance counts of indirect draws. Culling does not keep the
+ * order within a draw, so it suits sprites that do not overlap.
+ * -------------------------------------------------------------------------- */
+
+typedef uint32_t wgpu_sprite_id_t;
+
+#define WGPU_SPRITE_INVALID_ID UINT32_MAX
+
+typedef struct wgpu_sprite_t {
+  vec2 position;  /* center in world units */
+  vec2 size;      /* width and height in world units */
+  float rotation; /* radians, counterclockwise */
+  float depth;    /* sprites with larger depth are drawn first */
+  vec4 color;     /* multiplied with the atlas image */
+  wgpu_atlas_region_t region;
+} wgpu_sprite_t;
+
+typedef struct wgpu_sprite_batch_desc_t {
+  wgpu_texture_atlas_t* atlas; /* must outlive the sprite batch */
+  uint32_t capacity;           /* initial number of sprites, grows on demand */
+  WGPUTextureFormat color_format;
+  WGPUTextureFormat depth_format; /* WGPUTextureFormat_Undefined if none */
+  bool gpu_culling;
+} wgpu_sprite_batch_desc_t;
+
+typedef struct wgpu_sprite_batch wgpu_sprite_batch_t;
+
+/* Sprite batch construction / destruction */
+wgpu_sprite_batch_t*
+wgpu_sprite_batch_create(wgpu_context_t* wgpu_context,
+                         const wgpu_sprite_batch_desc_t* desc);
+void wgpu_sprite_batch_destroy(wgpu_sprite_batch_t* sprite_batch);
+
+/* Sprites */
+wgpu_sprite_id_t wgpu_sprite_batch_add(wgpu_sprite_batch_t* sprite_batch,
+                                       const wgpu_sprite_t* sprite);
+void wgpu_sprite_batch_set(wgpu_sprite_batch_t* sprite_batch,
+                           wgpu_sprite_id_t id, const wgpu_sprite_t* sprite);
+void wgpu_sprite_batch_remove(wgpu_sprite_batch_t* sprite_batch,
+                              wgpu_sprite_id_t id);
+void wgpu_sprite_batch_clear(wgpu_sprite_batch_t* sprite_batch);
+uint32_t wgpu_sprite_batch_get_count(wgpu_sprite_batch_t* sprite_batch);
+
+/**
+ * @brief Uploads the changed sprites and, with GPU culling, records the
+ * culling compute pass into the command encoder. Must be called once per
+ * frame outside of a pass, before wgpu_sprite_batch_draw().
+ */
+void wgpu_sprite_batch_update(wgpu_sprite_batch_t* sprite_batch,
+                              WGPUCommandEncoder cmd_enc,
+                              mat4 view_projection);
+
+/* Draws the sprites, one draw call per run of sprites on the same page */
+void wgpu_sprite_batch_draw(wgpu_sprite_batch_t* sprite_batch,
+                            WGPURenderPassEncoder rpass_enc);
+
+/* Number of draw calls issued by wgpu_sprite_batch_draw() */
+uint32_t wgpu_sprite_batch_get_draw_count(wgpu_sprite_batch_t* sprite_batch);
+
+#endif /* SPRITE_BATCH_H */
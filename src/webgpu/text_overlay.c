@@ -347,8 +347,8 @@ static void text_overlay_prepare_pipeline(text_overlay_t* text_overlay)
 
   // Shader modules are no longer needed once the graphics pipeline has been
   // created
-  WGPU_RELEASE_RESOURCE(ShaderModule, vertex_state_desc.module);
-  WGPU_RELEASE_RESOURCE(ShaderModule, fragment_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, vertex_state_desc.module);
+  wgpu_release_shader_module(wgpu_context, fragment_state_desc.module);
 }
 
 // Prepare a separate render pass for rendering the text as an overlay
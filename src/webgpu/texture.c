@@ -7,6 +7,7 @@
 #include "../core/file.h"
 #include "../core/log.h"
 #include "../core/macro.h"
+#include "../core/trace.h"
 #include "shader.h"
 
 #ifdef __GNUC__
@@ -46,6 +47,7 @@ void wgpu_image_to_texure(wgpu_context_t* wgpu_context, WGPUTexture texture,
 {
   const uint64_t data_size = size.width * size.height * size.depthOrArrayLayers
                              * channels * sizeof(uint8_t);
+  TRACE_SCOPE("Texture upload");
   wgpuQueueWriteTexture(wgpu_context->queue,
     &(WGPUImageCopyTexture) {
       .texture = texture,
@@ -299,13 +301,10 @@ void wgpu_mipmap_generator_destroy(wgpu_mipmap_generator_t* mipmap_generator)
       mipmap_generator->active_pipelines[i] = false;
     }
   }
-  if (!mipmap_generator->vertex_state_desc.module
-      || !mipmap_generator->fragment_state_desc.module) {
-    WGPU_RELEASE_RESOURCE(ShaderModule,
-                          mipmap_generator->vertex_state_desc.module);
-    WGPU_RELEASE_RESOURCE(ShaderModule,
-                          mipmap_generator->fragment_state_desc.module);
-  }
+  wgpu_release_shader_module(mipmap_generator->wgpu_context,
+                             mipmap_generator->vertex_state_desc.module);
+  wgpu_release_shader_module(mipmap_generator->wgpu_context,
+                             mipmap_generator->fragment_state_desc.module);
   free(mipmap_generator);
 }
 
@@ -1636,3 +1635,157 @@ texture_t wgpu_create_empty_texture(wgpu_context_t* wgpu_context)
     .sampler         = sampler,
   };
 }
+
+texture_t wgpu_create_texture_array_from_textures(wgpu_context_t* wgpu_context,
+                                                  texture_t* const* textures,
+                                                  uint32_t texture_count,
+                                                  uint32_t width,
+                                                  uint32_t height)
+{
+  ASSERT(texture_count > 0);
+
+  /* Create texture array */
+  const WGPUTextureFormat format = textures[0]->format;
+  WGPUTextureDescriptor texture_desc = {
+    .label = "Texture array",
+    .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding
+             | WGPUTextureUsage_RenderAttachment,
+    .dimension = WGPUTextureDimension_2D,
+    .size = (WGPUExtent3D) {
+      .width              = width,
+      .height             = height,
+      .depthOrArrayLayers = texture_count,
+    },
+    .format        = format,
+    .mipLevelCount = calculate_mip_level_count(width, height),
+    .sampleCount   = 1,
+  };
+  WGPUTexture texture
+    = wgpuDeviceCreateTexture(wgpu_context->device, &texture_desc);
+  ASSERT(texture != NULL);
+
+  /* The mipmap generator blit pipeline copies and resizes the layers */
+  wgpu_create_texture_client(wgpu_context);
+  struct wgpu_texture_client_t* texture_client = wgpu_context->texture_client;
+  if (texture_client->wgpu_mipmap_generator == NULL) {
+    texture_client->wgpu_mipmap_generator
+      = wgpu_mipmap_generator_create(wgpu_context);
+  }
+  wgpu_mipmap_generator_t* mipmap_generator
+    = texture_client->wgpu_mipmap_generator;
+  WGPURenderPipeline pipeline
+    = wgpu_mipmap_generator_get_mipmap_pipeline(mipmap_generator, format);
+  WGPUBindGroupLayout bind_group_layout
+    = mipmap_generator->pipeline_layouts[(uint32_t)format];
+
+  WGPUCommandEncoder cmd_encoder
+    = wgpuDeviceCreateCommandEncoder(wgpu_context->device, NULL);
+  for (uint32_t layer = 0; layer < texture_count; ++layer) {
+    ASSERT(textures[layer]->format == format);
+    WGPUTextureView src_view = wgpuTextureCreateView(
+      textures[layer]->texture, &(WGPUTextureViewDescriptor){
+                                  .label           = "src_view",
+                                  .aspect          = WGPUTextureAspect_All,
+                                  .baseMipLevel    = 0,
+                                  .mipLevelCount   = 1,
+                                  .dimension       = WGPUTextureViewDimension_2D,
+                                  .baseArrayLayer  = 0,
+                                  .arrayLayerCount = 1,
+                                });
+    WGPUTextureView dst_view = wgpuTextureCreateView(
+      texture, &(WGPUTextureViewDescriptor){
+                 .label           = "dst_view",
+                 .aspect          = WGPUTextureAspect_All,
+                 .baseMipLevel    = 0,
+                 .mipLevelCount   = 1,
+                 .dimension       = WGPUTextureViewDimension_2D,
+                 .baseArrayLayer  = layer,
+                 .arrayLayerCount = 1,
+               });
+
+    WGPUBindGroupEntry bg_entries[2] = {
+      [0] = (WGPUBindGroupEntry){
+        .binding = 0,
+        .sampler = mipmap_generator->sampler,
+      },
+      [1] = (WGPUBindGroupEntry){
+        .binding     = 1,
+        .textureView = src_view,
+      },
+    };
+    WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+      wgpu_context->device, &(WGPUBindGroupDescriptor){
+                              .layout     = bind_group_layout,
+                              .entryCount = (uint32_t)ARRAY_SIZE(bg_entries),
+                              .entries    = bg_entries,
+                            });
+
+    WGPURenderPassEncoder pass_encoder = wgpuCommandEncoderBeginRenderPass(
+      cmd_encoder, &(WGPURenderPassDescriptor){
+                     .colorAttachmentCount = 1,
+                     .colorAttachments     = &(WGPURenderPassColorAttachment){
+                       .view       = dst_view,
+                       .depthSlice = ~0,
+                       .loadOp     = WGPULoadOp_Clear,
+                       .storeOp    = WGPUStoreOp_Store,
+                     },
+                   });
+    wgpuRenderPassEncoderSetPipeline(pass_encoder, pipeline);
+    wgpuRenderPassEncoderSetBindGroup(pass_encoder, 0, bind_group, 0, NULL);
+    wgpuRenderPassEncoderDraw(pass_encoder, 3, 1, 0, 0);
+    wgpuRenderPassEncoderEnd(pass_encoder);
+
+    WGPU_RELEASE_RESOURCE(RenderPassEncoder, pass_encoder)
+    WGPU_RELEASE_RESOURCE(BindGroup, bind_group)
+    WGPU_RELEASE_RESOURCE(TextureView, src_view)
+    WGPU_RELEASE_RESOURCE(TextureView, dst_view)
+  }
+  WGPUCommandBuffer command_buffer
+    = wgpuCommandEncoderFinish(cmd_encoder, NULL);
+  ASSERT(command_buffer != NULL);
+  WGPU_RELEASE_RESOURCE(CommandEncoder, cmd_encoder)
+  wgpuQueueSubmit(wgpu_context->queue, 1, &command_buffer);
+  WGPU_RELEASE_RESOURCE(CommandBuffer, command_buffer)
+
+  /* Generate the mip chain of all layers */
+  if (texture_desc.mipLevelCount > 1) {
+    wgpu_mipmap_generator_generate_mipmap(mipmap_generator, texture,
+                                          &texture_desc);
+  }
+
+  /* Create the texture view */
+  WGPUTextureView view = wgpuTextureCreateView(
+    texture, &(WGPUTextureViewDescriptor){
+               .format          = format,
+               .dimension       = WGPUTextureViewDimension_2DArray,
+               .baseMipLevel    = 0,
+               .mipLevelCount   = texture_desc.mipLevelCount,
+               .baseArrayLayer  = 0,
+               .arrayLayerCount = texture_count,
+             });
+
+  /* Create the texture sampler */
+  WGPUSamplerDescriptor sampler_desc = {
+    .addressModeU  = WGPUAddressMode_Repeat,
+    .addressModeV  = WGPUAddressMode_Repeat,
+    .addressModeW  = WGPUAddressMode_Repeat,
+    .minFilter     = WGPUFilterMode_Linear,
+    .magFilter     = WGPUFilterMode_Linear,
+    .mipmapFilter  = WGPUMipmapFilterMode_Linear,
+    .lodMinClamp   = 0.0f,
+    .lodMaxClamp   = (float)texture_desc.mipLevelCount,
+    .maxAnisotropy = 1,
+  };
+  WGPUSampler sampler
+    = wgpuDeviceCreateSampler(wgpu_context->device, &sampler_desc);
+
+  return (texture_t){
+    .size            = texture_desc.size,
+    .mip_level_count = texture_desc.mipLevelCount,
+    .format          = texture_desc.format,
+    .dimension       = texture_desc.dimension,
+    .texture         = texture,
+    .view            = view,
+    .sampler         = sampler,
+  };
+}
@@ -130,4 +130,15 @@ texture_t wgpu_create_texture_cubemap_from_files(
 /* Texture creation with dimension 1x1 */
 texture_t wgpu_create_empty_texture(wgpu_context_t* wgpu_context);
 
+/**
+ * @brief Creates a 2D texture array with a full mip chain from 2D textures of
+ * the same (renderable) format. Each texture is blitted into its own layer,
+ * textures of a different size are resized to the array size.
+ */
+texture_t wgpu_create_texture_array_from_textures(wgpu_context_t* wgpu_context,
+                                                  texture_t* const* textures,
+                                                  uint32_t texture_count,
+                                                  uint32_t width,
+                                                  uint32_t height);
+
 #endif /* TEXTURE_H */
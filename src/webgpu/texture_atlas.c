@@ -0,0 +1,342 @@
+#include "texture_atlas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/log.h"
+#include "../core/macro.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Texture Atlas
+ * -------------------------------------------------------------------------- */
+
+#define TEXTURE_ATLAS_DEFAULT_PAGE_SIZE 2048u
+
+/* Horizontal segment of the skyline, the area below y is (partially) used */
+typedef struct atlas_skyline_node_t {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+} atlas_skyline_node_t;
+
+typedef struct atlas_page_t {
+  WGPUTexture texture;
+  WGPUTextureView view;
+  /* Skyline from left to right, covering the page width */
+  atlas_skyline_node_t* nodes;
+  uint32_t node_count;
+  uint64_t used_area;
+} atlas_page_t;
+
+struct wgpu_texture_atlas {
+  wgpu_context_t* wgpu_context;
+  char label[STRMAX];
+  uint32_t page_width;
+  uint32_t page_height;
+  uint32_t padding;
+  atlas_page_t pages[WGPU_TEXTURE_ATLAS_MAX_PAGES];
+  uint32_t page_count;
+};
+
+/* -------------------------------------------------------------------------- *
+ * Skyline packer
+ * -------------------------------------------------------------------------- */
+
+/* Lowest y position of a width x height rectangle starting at node index */
+static bool skyline_fit(const wgpu_texture_atlas_t* atlas,
+                        const atlas_page_t* page, uint32_t index,
+                        uint32_t width, uint32_t height, uint32_t* y)
+{
+  if (page->nodes[index].x + width > atlas->page_width) {
+    return false;
+  }
+
+  uint32_t width_left = width;
+  *y                  = page->nodes[index].y;
+  for (uint32_t i = index; width_left > 0; ++i) {
+    *y = MAX(*y, page->nodes[i].y);
+    if (*y + height > atlas->page_height) {
+      return false;
+    }
+    if (page->nodes[i].width >= width_left) {
+      break;
+    }
+    width_left -= page->nodes[i].width;
+  }
+  return true;
+}
+
+static void skyline_remove_node(atlas_page_t* page, uint32_t index)
+{
+  memmove(&page->nodes[index], &page->nodes[index + 1],
+          (page->node_count - index - 1) * sizeof(atlas_skyline_node_t));
+  --page->node_count;
+}
+
+/* Places the rectangle on the skyline node with the lowest resulting top
+ * edge (bottom-left rule), ties go to the narrowest node */
+static bool skyline_insert(const wgpu_texture_atlas_t* atlas,
+                           atlas_page_t* page, uint32_t width, uint32_t height,
+                           uint32_t* x, uint32_t* y)
+{
+  uint32_t best_index = UINT32_MAX, best_top = UINT32_MAX;
+  uint32_t best_width = UINT32_MAX;
+  for (uint32_t i = 0; i < page->node_count; ++i) {
+    uint32_t node_y = 0;
+    if (!skyline_fit(atlas, page, i, width, height, &node_y)) {
+      continue;
+    }
+    const uint32_t top = node_y + height;
+    if (top < best_top
+        || (top == best_top && page->nodes[i].width < best_width)) {
+      best_index = i;
+      best_top   = top;
+      best_width = page->nodes[i].width;
+      *x         = page->nodes[i].x;
+      *y         = node_y;
+    }
+  }
+  if (best_index == UINT32_MAX) {
+    return false;
+  }
+
+  /* The new node covers the rectangle, the nodes below it are shortened or
+   * removed */
+  memmove(&page->nodes[best_index + 1], &page->nodes[best_index],
+          (page->node_count - best_index) * sizeof(atlas_skyline_node_t));
+  page->nodes[best_index] = (atlas_skyline_node_t){
+    .x     = *x,
+    .y     = *y + height,
+    .width = width,
+  };
+  ++page->node_count;
+  for (uint32_t i = best_index + 1; i < page->node_count;) {
+    const atlas_skyline_node_t* previous = &page->nodes[i - 1];
+    const uint32_t previous_end          = previous->x + previous->width;
+    if (page->nodes[i].x >= previous_end) {
+      break;
+    }
+    const uint32_t shrink = previous_end - page->nodes[i].x;
+    if (page->nodes[i].width > shrink) {
+      page->nodes[i].x += shrink;
+      page->nodes[i].width -= shrink;
+      break;
+    }
+    skyline_remove_node(page, i);
+  }
+
+  /* Merge neighbors of the same height */
+  for (uint32_t i = 0; i + 1 < page->node_count;) {
+    if (page->nodes[i].y == page->nodes[i + 1].y) {
+      page->nodes[i].width += page->nodes[i + 1].width;
+      skyline_remove_node(page, i + 1);
+    }
+    else {
+      ++i;
+    }
+  }
+
+  page->used_area += (uint64_t)width * height;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Pages
+ * -------------------------------------------------------------------------- */
+
+static atlas_page_t* texture_atlas_add_page(wgpu_texture_atlas_t* atlas)
+{
+  if (atlas->page_count >= WGPU_TEXTURE_ATLAS_MAX_PAGES) {
+    return NULL;
+  }
+
+  atlas_page_t* page = &atlas->pages[atlas->page_count];
+  char label[STRMAX];
+  snprintf(label, sizeof(label), "%s - Page %u", atlas->label,
+           atlas->page_count);
+  page->texture = wgpuDeviceCreateTexture(
+    atlas->wgpu_context->device,
+    &(WGPUTextureDescriptor){
+      .label         = label,
+      .usage         = WGPUTextureUsage_TextureBinding
+                       | WGPUTextureUsage_CopyDst,
+      .dimension     = WGPUTextureDimension_2D,
+      .size          = (WGPUExtent3D){
+        .width              = atlas->page_width,
+        .height             = atlas->page_height,
+        .depthOrArrayLayers = 1,
+      },
+      .format        = WGPUTextureFormat_RGBA8Unorm,
+      .mipLevelCount = 1,
+      .sampleCount   = 1,
+    });
+  ASSERT(page->texture != NULL);
+  page->view = wgpuTextureCreateView(page->texture, NULL);
+  ASSERT(page->view != NULL);
+
+  /* A page with at most one node per pixel column */
+  page->nodes = (atlas_skyline_node_t*)calloc(atlas->page_width + 1,
+                                              sizeof(atlas_skyline_node_t));
+  page->nodes[0]   = (atlas_skyline_node_t){.width = atlas->page_width};
+  page->node_count = 1;
+
+  ++atlas->page_count;
+  return page;
+}
+
+/* Uploads the image with its border pixels repeated into the padding */
+static void texture_atlas_upload(wgpu_texture_atlas_t* atlas,
+                                 atlas_page_t* page, const uint8_t* pixels,
+                                 uint32_t width, uint32_t height, uint32_t x,
+                                 uint32_t y)
+{
+  const uint32_t padding       = atlas->padding;
+  const uint32_t padded_width  = width + 2 * padding;
+  const uint32_t padded_height = height + 2 * padding;
+  uint8_t* padded = (uint8_t*)malloc(padded_width * padded_height * 4);
+  for (uint32_t row = 0; row < padded_height; ++row) {
+    const uint32_t src_row = row < padding ? 0 : MIN(row - padding, height - 1);
+    for (uint32_t column = 0; column < padded_width; ++column) {
+      const uint32_t src_column
+        = column < padding ? 0 : MIN(column - padding, width - 1);
+      memcpy(&padded[(row * padded_width + column) * 4],
+             &pixels[(src_row * width + src_column) * 4], 4);
+    }
+  }
+
+  wgpuQueueWriteTexture(atlas->wgpu_context->queue,
+    &(WGPUImageCopyTexture) {
+      .texture  = page->texture,
+      .mipLevel = 0,
+      .origin   = (WGPUOrigin3D) {
+        .x = x,
+        .y = y,
+        .z = 0,
+      },
+      .aspect = WGPUTextureAspect_All,
+    },
+    padded, padded_width * padded_height * 4,
+    &(WGPUTextureDataLayout){
+      .offset       = 0,
+      .bytesPerRow  = padded_width * 4,
+      .rowsPerImage = padded_height,
+    },
+    &(WGPUExtent3D){
+      .width              = padded_width,
+      .height             = padded_height,
+      .depthOrArrayLayers = 1,
+    });
+  free(padded);
+}
+
+wgpu_texture_atlas_t*
+wgpu_texture_atlas_create(wgpu_context_t* wgpu_context,
+                          const wgpu_texture_atlas_desc_t* desc)
+{
+  wgpu_texture_atlas_t* atlas
+    = (wgpu_texture_atlas_t*)calloc(1, sizeof(wgpu_texture_atlas_t));
+  atlas->wgpu_context = wgpu_context;
+  snprintf(atlas->label, sizeof(atlas->label), "%s",
+           desc->label != NULL ? desc->label : "Texture atlas");
+  atlas->page_width  = desc->page_width > 0 ? desc->page_width :
+                                              TEXTURE_ATLAS_DEFAULT_PAGE_SIZE;
+  atlas->page_height = desc->page_height > 0 ?
+                         desc->page_height :
+                         TEXTURE_ATLAS_DEFAULT_PAGE_SIZE;
+  atlas->padding     = desc->padding > 0 ? desc->padding : 1u;
+
+  return atlas;
+}
+
+void wgpu_texture_atlas_destroy(wgpu_texture_atlas_t* atlas)
+{
+  if (atlas == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    WGPU_RELEASE_RESOURCE(TextureView, atlas->pages[i].view)
+    WGPU_RELEASE_RESOURCE(Texture, atlas->pages[i].texture)
+    free(atlas->pages[i].nodes);
+  }
+  free(atlas);
+}
+
+bool wgpu_texture_atlas_add_image(wgpu_texture_atlas_t* atlas,
+                                  const uint8_t* pixels, uint32_t width,
+                                  uint32_t height, wgpu_atlas_region_t* region)
+{
+  const uint32_t padded_width  = width + 2 * atlas->padding;
+  const uint32_t padded_height = height + 2 * atlas->padding;
+  if (width == 0 || height == 0 || padded_width > atlas->page_width
+      || padded_height > atlas->page_height) {
+    log_error("Texture atlas: a %ux%u image does not fit into a page", width,
+              height);
+    return false;
+  }
+
+  /* First page with space, a new page otherwise */
+  atlas_page_t* page = NULL;
+  uint32_t x = 0, y = 0;
+  for (uint32_t i = 0; i < atlas->page_count && page == NULL; ++i) {
+    if (skyline_insert(atlas, &atlas->pages[i], padded_width, padded_height,
+                       &x, &y)) {
+      page = &atlas->pages[i];
+    }
+  }
+  if (page == NULL) {
+    page = texture_atlas_add_page(atlas);
+    if (page == NULL) {
+      log_error("Texture atlas: all %u pages are full",
+                WGPU_TEXTURE_ATLAS_MAX_PAGES);
+      return false;
+    }
+    skyline_insert(atlas, page, padded_width, padded_height, &x, &y);
+  }
+
+  texture_atlas_upload(atlas, page, pixels, width, height, x, y);
+
+  *region = (wgpu_atlas_region_t){
+    .page      = (uint32_t)(page - atlas->pages),
+    .x         = x + atlas->padding,
+    .y         = y + atlas->padding,
+    .width     = width,
+    .height    = height,
+    .uv_offset = {
+      (float)(x + atlas->padding) / (float)atlas->page_width,
+      (float)(y + atlas->padding) / (float)atlas->page_height,
+    },
+    .uv_scale  = {
+      (float)width / (float)atlas->page_width,
+      (float)height / (float)atlas->page_height,
+    },
+  };
+  return true;
+}
+
+uint32_t wgpu_texture_atlas_get_page_count(wgpu_texture_atlas_t* atlas)
+{
+  return atlas->page_count;
+}
+
+WGPUTextureView wgpu_texture_atlas_get_page_view(wgpu_texture_atlas_t* atlas,
+                                                 uint32_t page)
+{
+  return page < atlas->page_count ? atlas->pages[page].view : NULL;
+}
+
+float wgpu_texture_atlas_get_occupancy(wgpu_texture_atlas_t* atlas)
+{
+  if (atlas->page_count == 0) {
+    return 0.0f;
+  }
+
+  uint64_t used_area = 0;
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    used_area += atlas->pages[i].used_area;
+  }
+  return (float)((double)used_area
+                 / ((double)atlas->page_count * atlas->page_width
+                    * atlas->page_height));
+}
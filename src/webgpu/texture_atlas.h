@@ -0,0 +1,65 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <cglm/cglm.h>
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Texture Atlas
+ *
+ * Packs images of different sizes into a few large RGBA8 textures (pages) at
+ * runtime, so that sprites using them can be drawn with one draw call per
+ * page instead of one per image. Images are placed with the skyline bottom-left
+ * heuristic, a new page is started when an image fits into none of the
+ * existing pages. The border pixels of every image are repeated into a padding
+ * around it, so that linear filtering does not bleed neighboring images in.
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of pages of an atlas */
+#define WGPU_TEXTURE_ATLAS_MAX_PAGES 8u
+
+typedef struct wgpu_texture_atlas_desc_t {
+  const char* label;
+  uint32_t page_width;  /* defaults to 2048 */
+  uint32_t page_height; /* defaults to 2048 */
+  uint32_t padding;     /* repeated border pixels, defaults to 1 */
+} wgpu_texture_atlas_desc_t;
+
+/* Location of an image in the atlas */
+typedef struct wgpu_atlas_region_t {
+  uint32_t page;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  vec2 uv_offset; /* normalized texture coordinates of the top left corner */
+  vec2 uv_scale;  /* normalized size */
+} wgpu_atlas_region_t;
+
+typedef struct wgpu_texture_atlas wgpu_texture_atlas_t;
+
+/* Texture atlas construction / destruction */
+wgpu_texture_atlas_t*
+wgpu_texture_atlas_create(wgpu_context_t* wgpu_context,
+                          const wgpu_texture_atlas_desc_t* desc);
+void wgpu_texture_atlas_destroy(wgpu_texture_atlas_t* atlas);
+
+/**
+ * @brief Packs an RGBA8 image (tightly packed rows) into the atlas and uploads
+ * it to its page.
+ * @return false if the image is larger than a page or all pages are full
+ */
+bool wgpu_texture_atlas_add_image(wgpu_texture_atlas_t* atlas,
+                                  const uint8_t* pixels, uint32_t width,
+                                  uint32_t height, wgpu_atlas_region_t* region);
+
+/* Pages */
+uint32_t wgpu_texture_atlas_get_page_count(wgpu_texture_atlas_t* atlas);
+WGPUTextureView wgpu_texture_atlas_get_page_view(wgpu_texture_atlas_t* atlas,
+                                                 uint32_t page);
+
+/* Fraction of the page area covered by images (and their padding) */
+float wgpu_texture_atlas_get_occupancy(wgpu_texture_atlas_t* atlas);
+
+#endif /* TEXTURE_ATLAS_H */
@@ -0,0 +1,548 @@
+#include "wgsl_preprocessor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/file.h"
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "shader.h"
+
+/* -------------------------------------------------------------------------- *
+ * WGSL Preprocessor
+ * -------------------------------------------------------------------------- */
+
+#define WGSL_PREPROCESSOR_MAX_DEFINES 128u
+#define WGSL_PREPROCESSOR_MAX_INCLUDES 64u
+#define WGSL_PREPROCESSOR_MAX_INCLUDE_DEPTH 16u
+#define WGSL_PREPROCESSOR_MAX_CONDITIONALS 32u
+#define WGSL_PREPROCESSOR_MAX_PATH 512u
+
+typedef struct wgsl_define_t {
+  char* name;
+  char* value;
+} wgsl_define_t;
+
+typedef struct wgsl_preprocessor_t {
+  wgsl_define_t defines[WGSL_PREPROCESSOR_MAX_DEFINES];
+  uint32_t define_count;
+  char* includes[WGSL_PREPROCESSOR_MAX_INCLUDES]; /* resolved paths */
+  uint32_t include_count;
+  uint32_t include_depth;
+  struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+  } output;
+} wgsl_preprocessor_t;
+
+typedef struct wgsl_conditional_t {
+  bool parent_active;
+  bool condition;
+  bool has_else;
+} wgsl_conditional_t;
+
+static bool wgsl_is_identifier_start(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool wgsl_is_identifier_char(char c)
+{
+  return wgsl_is_identifier_start(c) || (c >= '0' && c <= '9');
+}
+
+static char* wgsl_strndup(const char* str, size_t size)
+{
+  char* copy = (char*)malloc(size + 1);
+  memcpy(copy, str, size);
+  copy[size] = '\0';
+  return copy;
+}
+
+static void wgsl_append(wgsl_preprocessor_t* pp, const char* data,
+                        size_t size)
+{
+  if (pp->output.size + size + 1 > pp->output.capacity) {
+    size_t capacity = MAX(pp->output.capacity * 2, (size_t)4096);
+    while (capacity < pp->output.size + size + 1) {
+      capacity *= 2;
+    }
+    pp->output.data     = (char*)realloc(pp->output.data, capacity);
+    pp->output.capacity = capacity;
+  }
+  memcpy(pp->output.data + pp->output.size, data, size);
+  pp->output.size += size;
+  pp->output.data[pp->output.size] = '\0';
+}
+
+static wgsl_define_t* wgsl_find_define(wgsl_preprocessor_t* pp,
+                                       const char* name, size_t name_size)
+{
+  for (uint32_t i = 0; i < pp->define_count; ++i) {
+    if (strlen(pp->defines[i].name) == name_size
+        && strncmp(pp->defines[i].name, name, name_size) == 0) {
+      return &pp->defines[i];
+    }
+  }
+  return NULL;
+}
+
+static bool wgsl_set_define(wgsl_preprocessor_t* pp, const char* name,
+                            size_t name_size, const char* value,
+                            size_t value_size)
+{
+  wgsl_define_t* define = wgsl_find_define(pp, name, name_size);
+  if (define == NULL) {
+    if (pp->define_count >= WGSL_PREPROCESSOR_MAX_DEFINES) {
+      log_error("WGSL preprocessor: too many defines");
+      return false;
+    }
+    define       = &pp->defines[pp->define_count++];
+    define->name = wgsl_strndup(name, name_size);
+  }
+  else {
+    free(define->value);
+  }
+  define->value = wgsl_strndup(value, value_size);
+  return true;
+}
+
+static void wgsl_undef(wgsl_preprocessor_t* pp, const char* name,
+                       size_t name_size)
+{
+  wgsl_define_t* define = wgsl_find_define(pp, name, name_size);
+  if (define != NULL) {
+    free(define->name);
+    free(define->value);
+    *define = pp->defines[--pp->define_count];
+  }
+}
+
+/* Appends a line of code, replacing the defined identifiers outside of line
+ * comments */
+static void wgsl_append_code(wgsl_preprocessor_t* pp, const char* line,
+                             size_t size)
+{
+  if (pp->define_count == 0) {
+    wgsl_append(pp, line, size);
+    return;
+  }
+  size_t code_size = 0;
+  while (code_size < size
+         && !(line[code_size] == '/' && code_size + 1 < size
+              && line[code_size + 1] == '/')) {
+    ++code_size;
+  }
+  size_t copied = 0, i = 0;
+  while (i < code_size) {
+    if (!wgsl_is_identifier_start(line[i])
+        || (i > 0 && wgsl_is_identifier_char(line[i - 1]))) {
+      ++i;
+      continue;
+    }
+    const size_t start = i;
+    while (i < code_size && wgsl_is_identifier_char(line[i])) {
+      ++i;
+    }
+    wgsl_define_t* define = wgsl_find_define(pp, line + start, i - start);
+    if (define != NULL) {
+      wgsl_append(pp, line + copied, start - copied);
+      wgsl_append(pp, define->value, strlen(define->value));
+      copied = i;
+    }
+  }
+  wgsl_append(pp, line + copied, size - copied);
+}
+
+/* Splits "word rest" into the first word and the trimmed rest */
+static const char* wgsl_next_word(const char* str, const char* end,
+                                  size_t* word_size)
+{
+  while (str < end && (*str == ' ' || *str == '\t')) {
+    ++str;
+  }
+  const char* word = str;
+  while (str < end && *str != ' ' && *str != '\t') {
+    ++str;
+  }
+  *word_size = (size_t)(str - word);
+  return word;
+}
+
+static void wgsl_directory_of(const char* path, char* dir, size_t dir_size)
+{
+  const char* slash = strrchr(path, '/');
+  const char* back  = strrchr(path, '\\');
+  if (back != NULL && (slash == NULL || back > slash)) {
+    slash = back;
+  }
+  const size_t size = slash ? (size_t)(slash - path) : 0;
+  snprintf(dir, dir_size, "%.*s", (int)size, path);
+}
+
+static bool wgsl_process_source(wgsl_preprocessor_t* pp, const char* source,
+                                const char* name, const char* dir);
+
+static bool wgsl_process_include(wgsl_preprocessor_t* pp, const char* path,
+                                 size_t path_size, const char* dir)
+{
+  char resolved[WGSL_PREPROCESSOR_MAX_PATH];
+  if (dir != NULL && dir[0] != '\0') {
+    snprintf(resolved, sizeof(resolved), "%s/%.*s", dir, (int)path_size,
+             path);
+  }
+  else {
+    snprintf(resolved, sizeof(resolved), "%.*s", (int)path_size, path);
+  }
+
+  /* Every file is included once, like an include guard */
+  for (uint32_t i = 0; i < pp->include_count; ++i) {
+    if (strcmp(pp->includes[i], resolved) == 0) {
+      return true;
+    }
+  }
+  if (pp->include_count >= WGSL_PREPROCESSOR_MAX_INCLUDES
+      || pp->include_depth >= WGSL_PREPROCESSOR_MAX_INCLUDE_DEPTH) {
+    log_error("WGSL preprocessor: too many includes at %s", resolved);
+    return false;
+  }
+  if (!file_exists(resolved)) {
+    log_error("WGSL preprocessor: include file %s not found", resolved);
+    return false;
+  }
+  pp->includes[pp->include_count++] = wgsl_strndup(resolved, strlen(resolved));
+
+  file_read_result_t result;
+  read_file(resolved, &result, 1);
+  char include_dir[WGSL_PREPROCESSOR_MAX_PATH];
+  wgsl_directory_of(resolved, include_dir, sizeof(include_dir));
+  ++pp->include_depth;
+  const bool success
+    = wgsl_process_source(pp, (const char*)result.data, resolved, include_dir);
+  --pp->include_depth;
+  free(result.data);
+  return success;
+}
+
+static bool wgsl_process_source(wgsl_preprocessor_t* pp, const char* source,
+                                const char* name, const char* dir)
+{
+  wgsl_conditional_t conditionals[WGSL_PREPROCESSOR_MAX_CONDITIONALS];
+  uint32_t conditional_count = 0;
+  bool active                = true;
+  uint32_t line_number       = 0;
+
+  const char* line = source;
+  while (*line != '\0') {
+    const char* line_end = strchr(line, '\n');
+    if (line_end == NULL) {
+      line_end = line + strlen(line);
+    }
+    const char* next = *line_end == '\n' ? line_end + 1 : line_end;
+    ++line_number;
+
+    const char* c = line;
+    while (c < line_end && (*c == ' ' || *c == '\t')) {
+      ++c;
+    }
+    if (c == line_end || *c != '#') {
+      if (active) {
+        wgsl_append_code(pp, line, (size_t)(next - line));
+      }
+      line = next;
+      continue;
+    }
+
+    /* Directive */
+    const char* end = line_end;
+    while (end > c && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+      --end;
+    }
+    size_t directive_size = 0, arg_size = 0;
+    const char* directive = wgsl_next_word(c + 1, end, &directive_size);
+    const char* arg       = wgsl_next_word(directive + directive_size, end,
+                                           &arg_size);
+#define WGSL_DIRECTIVE_IS(str)                                                 \
+  (directive_size == strlen(str)                                               \
+   && strncmp(directive, str, directive_size) == 0)
+
+    if (WGSL_DIRECTIVE_IS("ifdef") || WGSL_DIRECTIVE_IS("ifndef")
+        || WGSL_DIRECTIVE_IS("if")) {
+      if (conditional_count >= WGSL_PREPROCESSOR_MAX_CONDITIONALS) {
+        log_error("WGSL preprocessor: %s:%u: conditionals nested too deep",
+                  name, line_number);
+        return false;
+      }
+      wgsl_define_t* define = wgsl_find_define(pp, arg, arg_size);
+      bool condition        = define != NULL;
+      if (WGSL_DIRECTIVE_IS("ifndef")) {
+        condition = !condition;
+      }
+      else if (WGSL_DIRECTIVE_IS("if") && define != NULL) {
+        condition = strcmp(define->value, "0") != 0;
+      }
+      conditionals[conditional_count++] = (wgsl_conditional_t){
+        .parent_active = active,
+        .condition     = condition,
+      };
+      active = active && condition;
+    }
+    else if (WGSL_DIRECTIVE_IS("else") || WGSL_DIRECTIVE_IS("endif")) {
+      if (conditional_count == 0) {
+        log_error("WGSL preprocessor: %s:%u: #%.*s without #if", name,
+                  line_number, (int)directive_size, directive);
+        return false;
+      }
+      wgsl_conditional_t* conditional = &conditionals[conditional_count - 1];
+      if (WGSL_DIRECTIVE_IS("endif")) {
+        active = conditional->parent_active;
+        --conditional_count;
+      }
+      else if (conditional->has_else) {
+        log_error("WGSL preprocessor: %s:%u: duplicate #else", name,
+                  line_number);
+        return false;
+      }
+      else {
+        conditional->has_else = true;
+        active = conditional->parent_active && !conditional->condition;
+      }
+    }
+    else if (!active) {
+      /* Directives of inactive blocks are skipped */
+    }
+    else if (WGSL_DIRECTIVE_IS("include")) {
+      if (arg_size < 2 || arg[0] != '"' || arg[arg_size - 1] != '"') {
+        log_error("WGSL preprocessor: %s:%u: expected #include \"file\"",
+                  name, line_number);
+        return false;
+      }
+      if (!wgsl_process_include(pp, arg + 1, arg_size - 2, dir)) {
+        log_error("WGSL preprocessor: included from %s:%u", name,
+                  line_number);
+        return false;
+      }
+    }
+    else if (WGSL_DIRECTIVE_IS("define")) {
+      size_t value_size = 0;
+      const char* value = wgsl_next_word(arg + arg_size, end, &value_size);
+      value_size        = (size_t)(end - value);
+      if (arg_size == 0
+          || !wgsl_set_define(pp, arg, arg_size, value_size ? value : "1",
+                              value_size ? value_size : 1)) {
+        log_error("WGSL preprocessor: %s:%u: invalid #define", name,
+                  line_number);
+        return false;
+      }
+    }
+    else if (WGSL_DIRECTIVE_IS("undef")) {
+      wgsl_undef(pp, arg, arg_size);
+    }
+    else {
+      log_error("WGSL preprocessor: %s:%u: unknown directive #%.*s", name,
+                line_number, (int)directive_size, directive);
+      return false;
+    }
+#undef WGSL_DIRECTIVE_IS
+
+    line = next;
+  }
+
+  if (conditional_count > 0) {
+    log_error("WGSL preprocessor: %s: unterminated #if", name);
+    return false;
+  }
+  return true;
+}
+
+/* Joins the source chunks with newlines, so that each chunk starts a line */
+static char* wgsl_join_sources(const char* const* sources, uint32_t count)
+{
+  size_t size = 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    size += strlen(sources[i]) + 1;
+  }
+  char* source  = (char*)malloc(size);
+  size_t offset = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    const size_t chunk_size = strlen(sources[i]);
+    memcpy(source + offset, sources[i], chunk_size);
+    offset += chunk_size;
+    source[offset++] = '\n';
+  }
+  source[offset] = '\0';
+  return source;
+}
+
+char* wgpu_wgsl_preprocess(const wgpu_wgsl_preprocess_desc_t* desc)
+{
+  ASSERT(desc && (desc->file || desc->source || desc->sources.count > 0));
+
+  wgsl_preprocessor_t* pp
+    = (wgsl_preprocessor_t*)calloc(1, sizeof(wgsl_preprocessor_t));
+  bool success = true;
+  for (uint32_t i = 0; i < desc->defines.count && success; ++i) {
+    const wgpu_wgsl_define_t* define = &desc->defines.entries[i];
+    const char* value = define->value != NULL ? define->value : "1";
+    success = wgsl_set_define(pp, define->name, strlen(define->name), value,
+                              strlen(value));
+  }
+
+  if (success && desc->file != NULL) {
+    success = wgsl_process_include(pp, desc->file, strlen(desc->file), NULL);
+  }
+  else if (success && desc->source != NULL) {
+    success = wgsl_process_source(pp, desc->source, "<source>",
+                                  desc->include_dir);
+  }
+  else if (success) {
+    char* source
+      = wgsl_join_sources(desc->sources.entries, desc->sources.count);
+    success = wgsl_process_source(pp, source, "<source>", desc->include_dir);
+    free(source);
+  }
+  if (success && pp->output.data == NULL) {
+    wgsl_append(pp, "", 0);
+  }
+
+  for (uint32_t i = 0; i < pp->define_count; ++i) {
+    free(pp->defines[i].name);
+    free(pp->defines[i].value);
+  }
+  for (uint32_t i = 0; i < pp->include_count; ++i) {
+    free(pp->includes[i]);
+  }
+  char* output = pp->output.data;
+  if (!success) {
+    free(output);
+    output = NULL;
+  }
+  free(pp);
+
+  return output;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Shader permutations
+ * -------------------------------------------------------------------------- */
+
+typedef struct shader_permutation_t {
+  uint64_t key;
+  WGPUShaderModule module;
+} shader_permutation_t;
+
+struct wgpu_shader_permutations {
+  wgpu_context_t* wgpu_context;
+  wgpu_shader_permutations_desc_t desc;
+  shader_permutation_t* modules;
+  uint32_t module_count;
+  uint32_t module_capacity;
+};
+
+wgpu_shader_permutations_t*
+wgpu_shader_permutations_create(wgpu_context_t* wgpu_context,
+                                const wgpu_shader_permutations_desc_t* desc)
+{
+  ASSERT(desc && desc->key_count <= WGPU_SHADER_PERMUTATION_MAX_KEYS);
+
+  wgpu_shader_permutations_t* permutations
+    = (wgpu_shader_permutations_t*)calloc(1,
+                                          sizeof(wgpu_shader_permutations_t));
+  permutations->wgpu_context = wgpu_context;
+  permutations->desc         = *desc;
+
+  return permutations;
+}
+
+void wgpu_shader_permutations_destroy(wgpu_shader_permutations_t* permutations)
+{
+  if (permutations == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < permutations->module_count; ++i) {
+    wgpu_release_shader_module(permutations->wgpu_context,
+                               permutations->modules[i].module);
+  }
+  free(permutations->modules);
+  free(permutations);
+}
+
+static WGPUShaderModule
+shader_permutations_compile(wgpu_shader_permutations_t* permutations,
+                            uint64_t key)
+{
+  const wgpu_shader_permutations_desc_t* desc = &permutations->desc;
+
+  /* Shared defines followed by one define per set key bit */
+  const uint32_t define_count = desc->source.defines.count + desc->key_count;
+  wgpu_wgsl_define_t* defines
+    = (wgpu_wgsl_define_t*)calloc(MAX(define_count, 1u), sizeof(*defines));
+  uint32_t count = desc->source.defines.count;
+  if (count > 0) {
+    memcpy(defines, desc->source.defines.entries, count * sizeof(*defines));
+  }
+  for (uint32_t i = 0; i < desc->key_count; ++i) {
+    if ((key >> i) & 1u) {
+      defines[count++] = (wgpu_wgsl_define_t){.name = desc->keys[i]};
+    }
+  }
+
+  wgpu_wgsl_preprocess_desc_t preprocess_desc = desc->source;
+  preprocess_desc.defines.count               = count;
+  preprocess_desc.defines.entries             = defines;
+  char* wgsl_code = wgpu_wgsl_preprocess(&preprocess_desc);
+  free(defines);
+  if (wgsl_code == NULL) {
+    log_error("Shader permutations: %s, key 0x%llx failed to preprocess",
+              desc->label ? desc->label : "", (unsigned long long)key);
+    return NULL;
+  }
+
+  WGPUShaderModule module = wgpu_create_shader_module(
+    permutations->wgpu_context, &(wgpu_shader_desc_t){
+                                  .label            = desc->label,
+                                  .wgsl_code.source = wgsl_code,
+                                });
+  free(wgsl_code);
+  return module;
+}
+
+WGPUShaderModule
+wgpu_shader_permutations_get_module(wgpu_shader_permutations_t* permutations,
+                                    uint64_t key)
+{
+  const uint32_t key_count = permutations->desc.key_count;
+  if (key_count < WGPU_SHADER_PERMUTATION_MAX_KEYS) {
+    key &= (1ull << key_count) - 1ull;
+  }
+
+  for (uint32_t i = 0; i < permutations->module_count; ++i) {
+    if (permutations->modules[i].key == key) {
+      return permutations->modules[i].module;
+    }
+  }
+
+  WGPUShaderModule module = shader_permutations_compile(permutations, key);
+  if (module == NULL) {
+    return NULL;
+  }
+  if (permutations->module_count == permutations->module_capacity) {
+    permutations->module_capacity
+      = MAX(permutations->module_capacity * 2, 4u);
+    permutations->modules = (shader_permutation_t*)realloc(
+      permutations->modules,
+      permutations->module_capacity * sizeof(shader_permutation_t));
+  }
+  permutations->modules[permutations->module_count++]
+    = (shader_permutation_t){.key = key, .module = module};
+  return module;
+}
+
+uint32_t wgpu_shader_permutations_get_module_count(
+  wgpu_shader_permutations_t* permutations)
+{
+  return permutations->module_count;
+}
@@ -0,0 +1,90 @@
+#ifndef WGSL_PREPROCESSOR_H
+#define WGSL_PREPROCESSOR_H
+
+#include "context.h"
+
+/* -------------------------------------------------------------------------- *
+ * WGSL Preprocessor
+ *
+ * Expands a small set of directives in WGSL sources, so shared structs and
+ * functions live in one file and shader variants are selected with defines
+ * instead of copies of the source:
+ *
+ *   #include "file.wgsl"   inserted once per preprocessed source, the path is
+ *                          relative to the including file (or include_dir)
+ *   #define NAME [value]   replaces the identifier NAME in the following code
+ *   #undef NAME
+ *   #ifdef NAME, #ifndef NAME, #if NAME, #else, #endif
+ *                          #if is true if NAME is defined and not "0"
+ *
+ * Directives must start a line, defines are not replaced in line comments.
+ * In-memory sources can be given in chunks, e.g. CODE() strings that stay
+ * below the string length limit of C99 or directives selecting between
+ * chunks. Shader permutations build on it: each bit of
+ * a permutation key defines one feature name, and the module of a key is
+ * preprocessed and compiled (through the shader module cache) the first time
+ * it is requested.
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of feature names of a permutation set */
+#define WGPU_SHADER_PERMUTATION_MAX_KEYS 64u
+
+typedef struct wgpu_wgsl_define_t {
+  const char* name;
+  const char* value; /* NULL defines the name as "1" */
+} wgpu_wgsl_define_t;
+
+typedef struct wgpu_wgsl_preprocess_desc_t {
+  const char* file;        /* file has priority over source */
+  const char* source;      /* in-memory WGSL source */
+  /* In-memory WGSL source in chunks joined with newlines, used if file and
+   * source are NULL */
+  struct {
+    uint32_t count;
+    const char* const* entries;
+  } sources;
+  const char* include_dir; /* resolves the includes of an in-memory source */
+  struct {
+    uint32_t count;
+    wgpu_wgsl_define_t const* entries;
+  } defines;
+} wgpu_wgsl_preprocess_desc_t;
+
+/**
+ * @brief Expands the directives of a WGSL source.
+ * @return the preprocessed source, to be released with free(), or NULL on
+ * error
+ */
+char* wgpu_wgsl_preprocess(const wgpu_wgsl_preprocess_desc_t* desc);
+
+typedef struct wgpu_shader_permutations_desc_t {
+  const char* label;
+  wgpu_wgsl_preprocess_desc_t source; /* source and defines of all variants */
+  /* Feature names, bit i of a permutation key defines keys[i] */
+  const char* const* keys;
+  uint32_t key_count;
+} wgpu_shader_permutations_desc_t;
+
+typedef struct wgpu_shader_permutations wgpu_shader_permutations_t;
+
+/* Shader permutations construction / destruction, the strings and arrays of
+ * the descriptor must outlive the permutation set */
+wgpu_shader_permutations_t*
+wgpu_shader_permutations_create(wgpu_context_t* wgpu_context,
+                                const wgpu_shader_permutations_desc_t* desc);
+void wgpu_shader_permutations_destroy(wgpu_shader_permutations_t* permutations);
+
+/**
+ * @brief Returns the shader module of a permutation key, compiling it on
+ * first use. The module is owned by the permutation set.
+ * @return the shader module or NULL if preprocessing failed
+ */
+WGPUShaderModule
+wgpu_shader_permutations_get_module(wgpu_shader_permutations_t* permutations,
+                                    uint64_t key);
+
+/* Number of permutations compiled so far */
+uint32_t wgpu_shader_permutations_get_module_count(
+  wgpu_shader_permutations_t* permutations);
+
+#endif /* WGSL_PREPROCESSOR_H */
@@ -0,0 +1,492 @@
+#include "workgroup_tuner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/file.h"
+#include "../core/hashmap.h"
+#include "../core/log.h"
+#include "../core/macro.h"
+
+#include "readback.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Workgroup Tuner
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of kernels of a tuner */
+#define WORKGROUP_TUNER_MAX_KERNELS 16u
+
+/* Dispatches that can be timed concurrently */
+#define WORKGROUP_TUNER_SLOT_COUNT 8u
+
+/* Begin and end timestamp of a dispatch */
+#define WORKGROUP_TUNER_QUERY_COUNT 2u
+
+/* Timed dispatches discarded per candidate, e.g. for pipeline warm-up */
+#define WORKGROUP_TUNER_WARMUP_SAMPLES 2u
+
+/* Maximum length of a cache file line */
+#define WORKGROUP_TUNER_MAX_LINE_LENGTH 512u
+
+typedef enum workgroup_tuner_slot_state_t {
+  WORKGROUP_TUNER_SLOT_STATE_FREE,
+  WORKGROUP_TUNER_SLOT_STATE_RECORDING,
+  WORKGROUP_TUNER_SLOT_STATE_PENDING, /* waiting for the readback */
+} workgroup_tuner_slot_state_t;
+
+typedef struct workgroup_tuner_slot_t {
+  struct wgpu_tuned_kernel* kernel;
+  uint32_t candidate;
+  workgroup_tuner_slot_state_t state;
+  WGPUQuerySet query_set;
+  WGPUBuffer resolve_buffer;
+  WGPUComputePassTimestampWrites timestamp_writes;
+} workgroup_tuner_slot_t;
+
+typedef struct tuned_kernel_candidate_t {
+  uint32_t value;
+  WGPUComputePipeline pipeline;
+  uint32_t sample_count; /* including the warm-up samples */
+  double total_ms;
+} tuned_kernel_candidate_t;
+
+struct wgpu_tuned_kernel {
+  struct wgpu_workgroup_tuner* tuner;
+  char key[WORKGROUP_TUNER_MAX_LINE_LENGTH / 2]; /* key in the cache file */
+  tuned_kernel_candidate_t candidates[WGPU_WORKGROUP_TUNER_MAX_CANDIDATES];
+  uint32_t candidate_count;
+  uint32_t current; /* candidate of the current dispatch */
+  uint32_t next;    /* candidate of the next timed dispatch */
+  workgroup_tuner_slot_t* current_slot;
+  bool tuned;
+  float dispatch_ms;
+};
+
+struct wgpu_workgroup_tuner {
+  wgpu_context_t* wgpu_context;
+  char cache_file[STRMAX];
+  char adapter_key[STRMAX];
+  bool tuning;
+  bool defaults_only;
+  uint32_t sample_count;
+  workgroup_tuner_slot_t slots[WORKGROUP_TUNER_SLOT_COUNT];
+  uint32_t slot_index;
+  wgpu_tuned_kernel_t* kernels[WORKGROUP_TUNER_MAX_KERNELS];
+  uint32_t kernel_count;
+};
+
+wgpu_workgroup_tuner_t*
+wgpu_workgroup_tuner_create(wgpu_context_t* wgpu_context,
+                            const wgpu_workgroup_tuner_desc_t* desc)
+{
+  wgpu_workgroup_tuner_t* tuner
+    = (wgpu_workgroup_tuner_t*)calloc(1, sizeof(wgpu_workgroup_tuner_t));
+  tuner->wgpu_context = wgpu_context;
+  snprintf(tuner->cache_file, sizeof(tuner->cache_file), "%s",
+           desc->cache_file ? desc->cache_file :
+                              WGPU_WORKGROUP_TUNER_CACHE_FILE);
+  snprintf(tuner->adapter_key, sizeof(tuner->adapter_key), "%s",
+           desc->adapter_key ? desc->adapter_key : "");
+  tuner->sample_count
+    = (desc->sample_count > 0 ? desc->sample_count : 16u)
+      + WORKGROUP_TUNER_WARMUP_SAMPLES;
+  tuner->defaults_only = desc->defaults_only;
+  tuner->tuning
+    = desc->tuning && !desc->defaults_only
+      && wgpu_has_feature(wgpu_context, WGPUFeatureName_TimestampQuery);
+  if (desc->tuning && !desc->defaults_only && !tuner->tuning) {
+    log_warn("Workgroup tuner: timestamp queries are not supported by the "
+             "device, using cached or default values");
+  }
+  if (!tuner->tuning) {
+    return tuner;
+  }
+
+  wgpu_create_readback(wgpu_context);
+
+  for (uint32_t i = 0; i < WORKGROUP_TUNER_SLOT_COUNT; ++i) {
+    workgroup_tuner_slot_t* slot = &tuner->slots[i];
+    slot->state                  = WORKGROUP_TUNER_SLOT_STATE_FREE;
+    slot->query_set              = wgpuDeviceCreateQuerySet(
+      wgpu_context->device, &(WGPUQuerySetDescriptor){
+                              .label = "Workgroup tuner - Query set",
+                              .type  = WGPUQueryType_Timestamp,
+                              .count = WORKGROUP_TUNER_QUERY_COUNT,
+                            });
+    slot->resolve_buffer = wgpuDeviceCreateBuffer(
+      wgpu_context->device,
+      &(WGPUBufferDescriptor){
+        .label = "Workgroup tuner - Resolve buffer",
+        .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+        .size  = WORKGROUP_TUNER_QUERY_COUNT * sizeof(uint64_t),
+      });
+  }
+
+  return tuner;
+}
+
+void wgpu_workgroup_tuner_destroy(wgpu_workgroup_tuner_t* tuner)
+{
+  if (tuner == NULL) {
+    return;
+  }
+
+  /* Pending readbacks reference the slots and kernels */
+  if (tuner->tuning && tuner->wgpu_context->readback != NULL) {
+    wgpu_readback_flush(tuner->wgpu_context->readback);
+  }
+
+  for (uint32_t i = 0; i < WORKGROUP_TUNER_SLOT_COUNT; ++i) {
+    WGPU_RELEASE_RESOURCE(QuerySet, tuner->slots[i].query_set)
+    WGPU_RELEASE_RESOURCE(Buffer, tuner->slots[i].resolve_buffer)
+  }
+  for (uint32_t i = 0; i < tuner->kernel_count; ++i) {
+    wgpu_tuned_kernel_t* kernel = tuner->kernels[i];
+    for (uint32_t c = 0; c < kernel->candidate_count; ++c) {
+      WGPU_RELEASE_RESOURCE(ComputePipeline, kernel->candidates[c].pipeline)
+    }
+    free(kernel);
+  }
+  free(tuner);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Cache file
+ *
+ * One line per tuned kernel: "<adapter key>\t<kernel key>\t<value>".
+ * -------------------------------------------------------------------------- */
+
+static bool workgroup_tuner_load_value(wgpu_workgroup_tuner_t* tuner,
+                                       const char* key, uint32_t* value)
+{
+  if (tuner->defaults_only) {
+    return false;
+  }
+
+  FILE* file = fopen(tuner->cache_file, "r");
+  if (file == NULL) {
+    return false;
+  }
+
+  char line[WORKGROUP_TUNER_MAX_LINE_LENGTH];
+  char prefix[WORKGROUP_TUNER_MAX_LINE_LENGTH];
+  snprintf(prefix, sizeof(prefix), "%s\t%s\t", tuner->adapter_key, key);
+  const size_t prefix_length = strlen(prefix);
+  bool found                 = false;
+  while (!found && fgets(line, sizeof(line), file) != NULL) {
+    found = strncmp(line, prefix, prefix_length) == 0
+            && sscanf(line + prefix_length, "%u", value) == 1;
+  }
+  fclose(file);
+
+  return found;
+}
+
+static void workgroup_tuner_store_value(wgpu_workgroup_tuner_t* tuner,
+                                        const char* key, uint32_t value)
+{
+  /* Keep the entries of other adapters and kernels */
+  file_read_result_t cache = {0};
+  if (file_exists(tuner->cache_file)) {
+    read_file(tuner->cache_file, &cache, 1);
+  }
+
+  FILE* file = fopen(tuner->cache_file, "w");
+  if (file == NULL) {
+    log_warn("Workgroup tuner: could not write %s", tuner->cache_file);
+    free(cache.data);
+    return;
+  }
+
+  char prefix[WORKGROUP_TUNER_MAX_LINE_LENGTH];
+  snprintf(prefix, sizeof(prefix), "%s\t%s\t", tuner->adapter_key, key);
+  const size_t prefix_length = strlen(prefix);
+  char* line                 = (char*)cache.data;
+  while (line != NULL && *line != '\0') {
+    char* end = strchr(line, '\n');
+    const size_t length
+      = end != NULL ? (size_t)(end - line) + 1 : strlen(line);
+    if (strncmp(line, prefix, prefix_length) != 0) {
+      fwrite(line, 1, length, file);
+    }
+    line += length;
+  }
+  fprintf(file, "%s%u\n", prefix, value);
+  fclose(file);
+  free(cache.data);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Kernels
+ * -------------------------------------------------------------------------- */
+
+static uint64_t tuned_kernel_hash_source(const wgpu_shader_desc_t* desc)
+{
+  if (desc->file != NULL) {
+    file_read_result_t result = {0};
+    read_file(desc->file, &result, 1);
+    const uint64_t hash = hashmap_sip(result.data, result.size, 0, 0);
+    free(result.data);
+    return hash;
+  }
+  if (desc->byte_code.data != NULL) {
+    return hashmap_sip(desc->byte_code.data, desc->byte_code.size, 0, 0);
+  }
+  return hashmap_sip(desc->wgsl_code.source, strlen(desc->wgsl_code.source), 0,
+                     0);
+}
+
+static WGPUComputePipeline
+tuned_kernel_create_pipeline(wgpu_context_t* wgpu_context,
+                             const wgpu_tuned_kernel_desc_t* desc,
+                             WGPUShaderModule shader_module, uint32_t value)
+{
+  /* The tuned constant is appended to the constants of the shader */
+  const uint32_t constant_count = desc->shader.constants.count + 1;
+  WGPUConstantEntry* constants
+    = (WGPUConstantEntry*)calloc(constant_count, sizeof(WGPUConstantEntry));
+  for (uint32_t i = 0; i < desc->shader.constants.count; ++i) {
+    constants[i] = desc->shader.constants.entries[i];
+  }
+  constants[constant_count - 1] = (WGPUConstantEntry){
+    .key   = desc->constant ? desc->constant : "workgroup_size",
+    .value = (double)value,
+  };
+
+  WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(
+    wgpu_context->device,
+    &(WGPUComputePipelineDescriptor){
+      .label   = desc->label,
+      .layout  = desc->layout,
+      .compute = (WGPUProgrammableStageDescriptor){
+        .module        = shader_module,
+        .entryPoint    = desc->shader.entry ? desc->shader.entry : "main",
+        .constantCount = constant_count,
+        .constants     = constants,
+      },
+    });
+  ASSERT(pipeline != NULL);
+  free(constants);
+
+  return pipeline;
+}
+
+wgpu_tuned_kernel_t*
+wgpu_workgroup_tuner_add_kernel(wgpu_workgroup_tuner_t* tuner,
+                                const wgpu_tuned_kernel_desc_t* desc)
+{
+  ASSERT(tuner->kernel_count < WORKGROUP_TUNER_MAX_KERNELS);
+  /* Bind groups must be compatible with the pipelines of all candidates */
+  ASSERT(desc->label != NULL && desc->layout != NULL);
+  ASSERT(desc->default_value > 0);
+
+  wgpu_tuned_kernel_t* kernel
+    = (wgpu_tuned_kernel_t*)calloc(1, sizeof(wgpu_tuned_kernel_t));
+  kernel->tuner                         = tuner;
+  tuner->kernels[tuner->kernel_count++] = kernel;
+  snprintf(kernel->key, sizeof(kernel->key), "%s:%s:%016llx", desc->label,
+           desc->constant ? desc->constant : "workgroup_size",
+           (unsigned long long)tuned_kernel_hash_source(&desc->shader));
+
+  /* Candidate values within the workgroup size limits */
+  static const uint32_t default_candidates[4] = {32, 64, 128, 256};
+  const uint32_t* candidates = desc->candidates ? desc->candidates :
+                                                  default_candidates;
+  const uint32_t candidate_count
+    = desc->candidates ? MIN(desc->candidate_count,
+                             WGPU_WORKGROUP_TUNER_MAX_CANDIDATES) :
+                         (uint32_t)ARRAY_SIZE(default_candidates);
+  WGPUSupportedLimits limits = {0};
+  wgpuDeviceGetLimits(tuner->wgpu_context->device, &limits);
+  const uint32_t max_value
+    = MIN(limits.limits.maxComputeInvocationsPerWorkgroup,
+          limits.limits.maxComputeWorkgroupSizeX);
+
+  uint32_t cached_value = 0;
+  const bool cached = workgroup_tuner_load_value(tuner, kernel->key,
+                                                 &cached_value);
+  if (cached || !tuner->tuning) {
+    /* Single candidate, the value is final */
+    kernel->candidates[0].value = cached ? cached_value : desc->default_value;
+    kernel->candidate_count     = 1;
+  }
+  else {
+    for (uint32_t i = 0; i < candidate_count; ++i) {
+      if (candidates[i] > 0 && (max_value == 0 || candidates[i] <= max_value)) {
+        kernel->candidates[kernel->candidate_count++].value = candidates[i];
+      }
+    }
+    if (kernel->candidate_count == 0) {
+      kernel->candidates[kernel->candidate_count++].value
+        = desc->default_value;
+    }
+  }
+  kernel->tuned = kernel->candidate_count == 1;
+
+  WGPUShaderModule shader_module
+    = wgpu_create_shader_module(tuner->wgpu_context, &desc->shader);
+  ASSERT(shader_module != NULL);
+  for (uint32_t i = 0; i < kernel->candidate_count; ++i) {
+    kernel->candidates[i].pipeline = tuned_kernel_create_pipeline(
+      tuner->wgpu_context, desc, shader_module, kernel->candidates[i].value);
+  }
+  wgpu_release_shader_module(tuner->wgpu_context, shader_module);
+
+  if (cached) {
+    log_debug("Workgroup tuner: %s = %u (cached)", desc->label, cached_value);
+  }
+
+  return kernel;
+}
+
+static void tuned_kernel_finish(wgpu_tuned_kernel_t* kernel)
+{
+  const uint32_t sample_count
+    = kernel->tuner->sample_count - WORKGROUP_TUNER_WARMUP_SAMPLES;
+  uint32_t best = 0;
+  float best_ms = 0.0f;
+  for (uint32_t i = 0; i < kernel->candidate_count; ++i) {
+    const float average_ms
+      = (float)(kernel->candidates[i].total_ms / sample_count);
+    if (i == 0 || average_ms < best_ms) {
+      best    = i;
+      best_ms = average_ms;
+    }
+  }
+
+  /* Only the pipeline of the fastest candidate is kept */
+  for (uint32_t i = 0; i < kernel->candidate_count; ++i) {
+    if (i != best) {
+      WGPU_RELEASE_RESOURCE(ComputePipeline, kernel->candidates[i].pipeline)
+    }
+  }
+  kernel->candidates[0]   = kernel->candidates[best];
+  kernel->candidate_count = 1;
+  kernel->current         = 0;
+  kernel->tuned           = true;
+  kernel->dispatch_ms     = best_ms;
+
+  log_info("Workgroup tuner: %s = %u (%.3f ms)", kernel->key,
+           kernel->candidates[0].value, best_ms);
+  workgroup_tuner_store_value(kernel->tuner, kernel->key,
+                              kernel->candidates[0].value);
+}
+
+static void workgroup_tuner_readback_cb(const wgpu_readback_result_t* result,
+                                        void* user_data)
+{
+  workgroup_tuner_slot_t* slot = (workgroup_tuner_slot_t*)user_data;
+  wgpu_tuned_kernel_t* kernel  = slot->kernel;
+  slot->state                  = WORKGROUP_TUNER_SLOT_STATE_FREE;
+
+  if (kernel->tuned || result->status != WGPU_READBACK_STATUS_SUCCESS
+      || result->size < WORKGROUP_TUNER_QUERY_COUNT * sizeof(uint64_t)) {
+    return;
+  }
+
+  uint64_t timestamps[WORKGROUP_TUNER_QUERY_COUNT];
+  memcpy(timestamps, result->data, sizeof(timestamps));
+  /* Timestamps can be zero or out of order, e.g. after a power state change */
+  if (timestamps[0] == 0 || timestamps[1] < timestamps[0]) {
+    return;
+  }
+
+  tuned_kernel_candidate_t* candidate = &kernel->candidates[slot->candidate];
+  if (++candidate->sample_count > WORKGROUP_TUNER_WARMUP_SAMPLES) {
+    candidate->total_ms
+      += (double)(timestamps[1] - timestamps[0]) / 1000000.0;
+  }
+
+  for (uint32_t i = 0; i < kernel->candidate_count; ++i) {
+    if (kernel->candidates[i].sample_count < kernel->tuner->sample_count) {
+      return;
+    }
+  }
+  tuned_kernel_finish(kernel);
+}
+
+void wgpu_tuned_kernel_begin(wgpu_tuned_kernel_t* kernel)
+{
+  wgpu_workgroup_tuner_t* tuner = kernel->tuner;
+  kernel->current_slot          = NULL;
+  if (kernel->tuned) {
+    return;
+  }
+
+  /* Candidates take turns, so that they are timed under the same load */
+  const uint32_t candidate = kernel->next;
+  kernel->next             = (kernel->next + 1) % kernel->candidate_count;
+  kernel->current          = candidate;
+
+  /* The dispatch is not timed if all slots are still waiting for results */
+  workgroup_tuner_slot_t* slot = &tuner->slots[tuner->slot_index];
+  if (slot->state != WORKGROUP_TUNER_SLOT_STATE_FREE
+      || !wgpu_readback_can_accept(tuner->wgpu_context->readback)) {
+    return;
+  }
+  tuner->slot_index    = (tuner->slot_index + 1) % WORKGROUP_TUNER_SLOT_COUNT;
+  slot->kernel         = kernel;
+  slot->candidate      = candidate;
+  slot->state          = WORKGROUP_TUNER_SLOT_STATE_RECORDING;
+  kernel->current_slot = slot;
+
+  /* Written by the compute pass of the dispatch */
+  slot->timestamp_writes = (WGPUComputePassTimestampWrites){
+    .querySet                  = slot->query_set,
+    .beginningOfPassWriteIndex = 0,
+    .endOfPassWriteIndex       = 1,
+  };
+}
+
+void wgpu_tuned_kernel_end(wgpu_tuned_kernel_t* kernel,
+                           WGPUCommandEncoder cmd_enc)
+{
+  workgroup_tuner_slot_t* slot = kernel->current_slot;
+  if (slot == NULL) {
+    return;
+  }
+  kernel->current_slot = NULL;
+
+  wgpuCommandEncoderResolveQuerySet(cmd_enc, slot->query_set, 0,
+                                    WORKGROUP_TUNER_QUERY_COUNT,
+                                    slot->resolve_buffer, 0);
+  const bool recorded = wgpu_readback_copy_buffer(
+    kernel->tuner->wgpu_context->readback, cmd_enc,
+    &(wgpu_readback_buffer_desc_t){
+      .buffer   = slot->resolve_buffer,
+      .size     = WORKGROUP_TUNER_QUERY_COUNT * sizeof(uint64_t),
+      .callback = workgroup_tuner_readback_cb,
+      .userdata = slot,
+    });
+  slot->state = recorded ? WORKGROUP_TUNER_SLOT_STATE_PENDING :
+                           WORKGROUP_TUNER_SLOT_STATE_FREE;
+}
+
+const WGPUComputePassTimestampWrites*
+wgpu_tuned_kernel_get_timestamp_writes(wgpu_tuned_kernel_t* kernel)
+{
+  return kernel->current_slot ? &kernel->current_slot->timestamp_writes :
+                                NULL;
+}
+
+WGPUComputePipeline wgpu_tuned_kernel_get_pipeline(wgpu_tuned_kernel_t* kernel)
+{
+  return kernel->candidates[kernel->current].pipeline;
+}
+
+uint32_t wgpu_tuned_kernel_get_value(wgpu_tuned_kernel_t* kernel)
+{
+  return kernel->candidates[kernel->current].value;
+}
+
+bool wgpu_tuned_kernel_is_tuned(wgpu_tuned_kernel_t* kernel)
+{
+  return kernel->tuned;
+}
+
+float wgpu_tuned_kernel_get_dispatch_ms(wgpu_tuned_kernel_t* kernel)
+{
+  return kernel->dispatch_ms;
+}
@@ -0,0 +1,94 @@
+#ifndef WORKGROUP_TUNER_H
+#define WORKGROUP_TUNER_H
+
+#include "shader.h"
+
+/* -------------------------------------------------------------------------- *
+ * WebGPU Workgroup Tuner
+ *
+ * Picks the workgroup size (or any other dispatch shape parameter, e.g. a tile
+ * size) of compute kernels per adapter. The kernel declares the parameter as a
+ * pipeline-overridable constant instead of a literal baked into the source:
+ *
+ *   override workgroup_size : u32 = 64u;
+ *   @compute @workgroup_size(workgroup_size) fn main(...)
+ *
+ * The tuner creates one pipeline per candidate value from the same shader
+ * module, alternates between them on consecutive dispatches and times each
+ * dispatch with timestamp queries while the example runs. Once every candidate
+ * has been timed often enough the fastest one is kept and stored in a cache
+ * file, keyed by adapter, kernel and shader source, so later launches on the
+ * same GPU start with the tuned value. Without timestamp query support, or
+ * with tuning disabled, the cached value or else the default value is used.
+ * Deterministic runs use the default values on every adapter.
+ * -------------------------------------------------------------------------- */
+
+/* Maximum number of candidate values of a kernel */
+#define WGPU_WORKGROUP_TUNER_MAX_CANDIDATES 8u
+
+/* Cache file used if none is specified */
+#define WGPU_WORKGROUP_TUNER_CACHE_FILE "workgroup_tuning.cache"
+
+typedef struct wgpu_workgroup_tuner_desc_t {
+  const char* cache_file;  /* defaults to WGPU_WORKGROUP_TUNER_CACHE_FILE */
+  const char* adapter_key; /* identifies the adapter in the cache file */
+  bool tuning;             /* false only uses cached or default values */
+  bool defaults_only;      /* ignores the cache, e.g. for deterministic runs */
+  uint32_t sample_count;   /* timed dispatches per candidate, defaults to 16 */
+} wgpu_workgroup_tuner_desc_t;
+
+typedef struct wgpu_tuned_kernel_desc_t {
+  const char* label;         /* kernel name in the cache file */
+  wgpu_shader_desc_t shader; /* WGSL compute shader and its other constants */
+  WGPUPipelineLayout layout; /* explicit layout shared by all candidates */
+  const char* constant;      /* defaults to "workgroup_size" */
+  uint32_t default_value;    /* used when nothing is tuned or cached */
+  /* Candidate values, defaults to 32, 64, 128 and 256. Values exceeding the
+   * workgroup size limits of the device are dropped. */
+  uint32_t candidate_count;
+  uint32_t const* candidates;
+} wgpu_tuned_kernel_desc_t;
+
+typedef struct wgpu_workgroup_tuner wgpu_workgroup_tuner_t;
+typedef struct wgpu_tuned_kernel wgpu_tuned_kernel_t;
+
+/* Workgroup tuner construction / destruction, destroys all kernels */
+wgpu_workgroup_tuner_t*
+wgpu_workgroup_tuner_create(wgpu_context_t* wgpu_context,
+                            const wgpu_workgroup_tuner_desc_t* desc);
+void wgpu_workgroup_tuner_destroy(wgpu_workgroup_tuner_t* tuner);
+
+/**
+ * @brief Creates the pipelines of a compute kernel, only the pipeline of the
+ * cached value if the kernel was already tuned on this adapter.
+ * @return the kernel, owned by the tuner
+ */
+wgpu_tuned_kernel_t*
+wgpu_workgroup_tuner_add_kernel(wgpu_workgroup_tuner_t* tuner,
+                                const wgpu_tuned_kernel_desc_t* desc);
+
+/**
+ * @brief Selects the value of the next dispatch. Must be followed by the
+ * compute pass using wgpu_tuned_kernel_get_pipeline(),
+ * wgpu_tuned_kernel_get_value() and wgpu_tuned_kernel_get_timestamp_writes(),
+ * and by wgpu_tuned_kernel_end() which resolves the timestamps.
+ */
+void wgpu_tuned_kernel_begin(wgpu_tuned_kernel_t* kernel);
+void wgpu_tuned_kernel_end(wgpu_tuned_kernel_t* kernel,
+                           WGPUCommandEncoder cmd_enc);
+
+/* Timestamp writes of the dispatch's compute pass, NULL if it is not timed */
+const WGPUComputePassTimestampWrites*
+wgpu_tuned_kernel_get_timestamp_writes(wgpu_tuned_kernel_t* kernel);
+
+/* Pipeline and value of the current dispatch */
+WGPUComputePipeline wgpu_tuned_kernel_get_pipeline(wgpu_tuned_kernel_t* kernel);
+uint32_t wgpu_tuned_kernel_get_value(wgpu_tuned_kernel_t* kernel);
+
+/* Returns true once the value is final (tuned, cached or not tunable) */
+bool wgpu_tuned_kernel_is_tuned(wgpu_tuned_kernel_t* kernel);
+
+/* Average GPU time of a dispatch with the final value, 0 if not measured */
+float wgpu_tuned_kernel_get_dispatch_ms(wgpu_tuned_kernel_t* kernel);
+
+#endif /* WORKGROUP_TUNER_H */